@@ -0,0 +1,178 @@
+"""
+Closed-Loop End-to-End Latency Benchmark
+========================================
+Runs the full production loop against a simulated controller:
+
+  griddy_fleet_sim (firmware grid_model + binary protocol, /out and /in)
+    → main.process_hardware_telemetry
+    → optimizer.schedule
+    → main.send_dispatch_to_hardware
+    → dispatch applied and acked by the simulator
+
+The simulator holds demand flat, injects a demand step on every node, and
+reports time-to-actuation and settling time of the dispatched supply. The
+harness adds the backend's own per-frame pipeline time. Each (optimizer,
+node count) pair runs on an identical trace (same seed, same step) and
+prints one JSON line.
+
+Usage:
+    cmake -S host -B host/build && cmake --build host/build -j
+    cd backend
+    python e2e_latency_bench.py --fleet-sim ../host/build/fleet_sim/griddy_fleet_sim \\
+        --optimizers milp,proportional --nodes 8,32,128
+"""
+
+import argparse
+import asyncio
+import json
+import logging
+import os
+import subprocess
+import sys
+import time
+from typing import Any, Dict, List
+
+import websockets
+
+# Keep the backend quiet and off the network before importing it
+os.environ.setdefault("GRIDDY_ESP32_ADDR", "127.0.0.1:0")
+logging.disable(logging.WARNING)
+
+import main as backend  # noqa: E402
+from binary_protocol import BinaryProtocol  # noqa: E402
+from microgrid_optimizer import EnergySource  # noqa: E402
+from optimizer_registry import available_optimizers, create_optimizer  # noqa: E402
+
+
+def percentiles(samples: List[float]) -> Dict[str, float]:
+    """p50/p90/p99/max of a list of samples."""
+    if not samples:
+        return {"count": 0}
+    ordered = sorted(samples)
+
+    def pick(q: float) -> float:
+        return round(ordered[min(len(ordered) - 1, int(q * len(ordered)))], 3)
+
+    return {
+        "count": len(ordered),
+        "mean": round(sum(ordered) / len(ordered), 3),
+        "p50": pick(0.50),
+        "p90": pick(0.90),
+        "p99": pick(0.99),
+        "max": round(ordered[-1], 3),
+    }
+
+
+def reset_backend(optimizer_name: str, nodes: int):
+    """Fresh optimizer and history, with supply headroom for the step."""
+    backend.optimizer = create_optimizer(optimizer_name, epoch_len=1/24, horizon=10)
+    backend.telemetry_buffer.clear()
+    backend.confidence_scores.clear()
+    backend.cerebras_agent = None  # No LLM escalation inside a latency benchmark
+    backend.ENERGY_SOURCES[:] = [
+        EnergySource(id="BENCH", max_supply_amps=nodes * 5.0, cost_per_amp=0.10, ramp_limit_amps=None),
+    ]
+
+
+async def drain_acks(websocket):
+    """Consume dispatch acks so the /in socket never backs up."""
+    try:
+        async for _ in websocket:
+            pass
+    except websockets.exceptions.ConnectionClosed:
+        pass
+
+
+async def connect_retry(uri: str, attempts: int = 50):
+    for _ in range(attempts):
+        try:
+            return await websockets.connect(uri, ping_interval=None, max_queue=None)
+        except OSError:
+            await asyncio.sleep(0.1)
+    raise RuntimeError(f"Could not connect to {uri}")
+
+
+async def run_case(args, optimizer_name: str, nodes: int, port: int) -> Dict[str, Any]:
+    sim = subprocess.Popen(
+        [args.fleet_sim, "--devices", "1", "--nodes", str(nodes), "--rate", str(args.rate),
+         "--threads", "1", "--base-port", str(port), "--flat-demand",
+         "--step-at", str(args.step_at), "--step-amps", str(args.step_amps),
+         "--duration", str(args.duration), "--report-interval", "0", "--seed", str(args.seed)],
+        stdout=subprocess.PIPE, stderr=subprocess.DEVNULL, text=True)
+
+    reset_backend(optimizer_name, nodes)
+    pipeline_ms: List[float] = []
+    frames = 0
+    try:
+        out_ws = await connect_retry(f"ws://127.0.0.1:{port}/out")
+        in_ws = await connect_retry(f"ws://127.0.0.1:{port}/in")
+        backend.hardware_websocket_in = in_ws
+        ack_task = asyncio.create_task(drain_acks(in_ws))
+
+        try:
+            async for message in out_ws:
+                packet = BinaryProtocol.decode_telemetry(message)
+                if not packet:
+                    continue
+                frames += 1
+                start = time.perf_counter()
+                await backend.process_hardware_telemetry(BinaryProtocol.telemetry_to_json_compat(packet))
+                pipeline_ms.append((time.perf_counter() - start) * 1000)
+        except websockets.exceptions.ConnectionClosed:
+            pass
+        finally:
+            backend.hardware_websocket_in = None
+            ack_task.cancel()
+    finally:
+        report_text, _ = sim.communicate(timeout=args.duration + 10)
+
+    report = json.loads(report_text)
+    return {
+        "optimizer": optimizer_name,
+        "nodes": nodes,
+        "rate_hz": args.rate,
+        "frames_processed": frames,
+        "pipeline_ms": percentiles(pipeline_ms),
+        "dispatch_latency_us": report["dispatch_latency_us"],
+        "step": report.get("step"),
+        "frames_per_s": report["frames_per_s"],
+        "dispatch_per_s": report["dispatch_per_s"],
+    }
+
+
+async def main_async(args):
+    port = args.port
+    for optimizer_name in args.optimizers:
+        for nodes in args.nodes:
+            result = await run_case(args, optimizer_name, nodes, port)
+            print(json.dumps(result), flush=True)
+            port += 1  # Avoid TIME_WAIT on the previous run's port
+
+
+def parse_list(text: str, cast=str) -> List[Any]:
+    return [cast(item) for item in text.split(",") if item]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Closed-loop telemetry → optimizer → dispatch benchmark")
+    parser.add_argument("--fleet-sim", required=True, help="Path to the griddy_fleet_sim binary")
+    parser.add_argument("--optimizers", default="milp", type=lambda s: parse_list(s),
+                        help=f"Comma-separated optimizer names ({', '.join(available_optimizers())})")
+    parser.add_argument("--nodes", default="8,32,128", type=lambda s: parse_list(s, int))
+    parser.add_argument("--rate", type=float, default=24.0, help="Telemetry rate in Hz")
+    parser.add_argument("--step-at", type=float, default=5.0, help="Seconds before the demand step")
+    parser.add_argument("--step-amps", type=float, default=1.0, help="Demand step per node in amps")
+    parser.add_argument("--duration", type=float, default=15.0, help="Seconds per case")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--port", type=int, default=9900)
+    args = parser.parse_args()
+
+    for name in args.optimizers:
+        if name not in available_optimizers():
+            parser.error(f"unknown optimizer '{name}'")
+
+    asyncio.run(main_async(args))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
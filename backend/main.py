@@ -16,6 +16,7 @@ Author: HackMIT 2025 Team
 import asyncio
 import json
 import logging
+import os
 # Import binary protocol from project root
 import sys
 import time
@@ -33,7 +34,8 @@ from cerebras_agent import (CerebrasAgent, EnergySourceInfo, NodeReading,
                             create_cerebras_agent)
 from fastapi import FastAPI, HTTPException, WebSocket, WebSocketDisconnect
 from fastapi.middleware.cors import CORSMiddleware
-from microgrid_optimizer import DemandRecord, EnergySource, MicrogridOptimizer
+from microgrid_optimizer import DemandRecord, EnergySource
+from optimizer_registry import create_optimizer
 from pydantic import BaseModel
 from rich.console import Console
 from rich.live import Live
@@ -41,8 +43,10 @@ from rich.table import Table
 from rich.text import Text
 
 sys.path.insert(0, str(Path(__file__).parent.parent))
-from binary_protocol import (NODE_TYPE_CONSUMER, BinaryProtocol, DispatchNode,
-                             DispatchPacket, TelemetryPacket)
+from binary_protocol import (DISPATCH_ACK_APPLIED, DISPATCH_MAX_NODE_ID, NODE_CHANNEL_NONE,
+                             NODE_CONTROL_ADD, NODE_CONTROL_REMOVE,
+                             NODE_TYPE_CONSUMER, BinaryProtocol, ClockSync, DispatchNode,
+                             DispatchPacket, TelemetryPacket, TelemetryState)
 
 logging.basicConfig(level=logging.INFO)
 logger = logging.getLogger(__name__)
@@ -52,7 +56,25 @@ hardware_websocket_out: Optional[websockets.WebSocketCommonProtocol] = None
 hardware_websocket_in: Optional[websockets.WebSocketCommonProtocol] = None
 out_ready_event: Event = Event()  # Signal that /out is connected and streaming
 frontend_clients: List[WebSocket] = []
-optimizer = MicrogridOptimizer(epoch_len=1/24, horizon=10)
+# Solver engine, swappable via GRIDDY_OPTIMIZER (see optimizer_registry.py)
+optimizer = create_optimizer(os.environ.get("GRIDDY_OPTIMIZER", "milp"), epoch_len=1/24, horizon=10)
+
+# Telemetry frames granted ahead on /out; each processed frame grants one
+# more, so the controller coalesces to the newest frame instead of queueing
+# behind a slow optimizer. 0 disables flow control.
+OUT_CREDIT_WINDOW = int(os.environ.get("GRIDDY_OUT_CREDITS", "2"))
+
+# TSYN clock-sync pings per /out connection; telemetry timestamps (µs since
+# controller boot) are mapped onto this host's wall clock with the estimate.
+# 0 disables sync and stamps frames on arrival instead.
+CLOCK_SYNC_INTERVAL = float(os.environ.get("GRIDDY_CLOCK_SYNC_S", "1.0"))
+controller_clocks: Dict[str, ClockSync] = {}  # Per controller address
+
+# Send dispatch as dense DDSP frames (uint16 duty per node, only changed
+# nodes) instead of DISP; duties last sent, reset whenever /in reconnects.
+# DISP ids are one byte, so a cycle with any higher id goes out as DDSP anyway.
+DENSE_DISPATCH = os.environ.get("GRIDDY_DENSE_DISPATCH", "0") == "1"
+dense_duties_sent: Dict[int, int] = {}
 telemetry_buffer = deque(maxlen=1000)  # Store last 1000 readings
 latest_metrics: Dict[str, Any] = {}
 confidence_scores = deque(maxlen=100)
@@ -173,7 +195,14 @@ def create_metrics_table() -> Table:
     return table
 
 async def get_esp32_ip():
-    """Get ESP32 IP from key-value store."""
+    """Get ESP32 IP from key-value store.
+
+    GRIDDY_ESP32_ADDR ("host[:port]") overrides the lookup, e.g. to point the
+    backend at a device served by host/fleet_sim.
+    """
+    override = os.environ.get("GRIDDY_ESP32_ADDR")
+    if override:
+        return override
     import httpx
     try:
         async with httpx.AsyncClient(verify=False) as client:  # Disable SSL verification for dev
@@ -185,6 +214,81 @@ async def get_esp32_ip():
         logger.error(f"Failed to get ESP32 IP: {e}")
         return "192.168.1.100"  # fallback
 
+def monotonic_us() -> int:
+    return time.monotonic_ns() // 1000
+
+class ControllerTimebase:
+    """Maps one controller's telemetry timestamps onto the backend wall clock.
+
+    Uses the clock-sync estimate once it has a reply; before that, and for
+    history fetched right after connecting, the first frame converted is
+    anchored to the time of the call.
+    """
+
+    def __init__(self, clock: ClockSync):
+        self.clock = clock
+        self.anchor_us: Optional[int] = None
+        self.anchor_local_us = 0
+
+    def to_wall(self, timestamp_us: int) -> float:
+        """Seconds on time.time()'s clock."""
+        if self.anchor_us is None:
+            self.anchor_us = timestamp_us
+            self.anchor_local_us = monotonic_us()
+        if self.clock.synced:
+            local_us = self.clock.to_local(timestamp_us)
+        else:
+            local_us = self.anchor_local_us + (timestamp_us - self.anchor_us)
+        return time.time() - (monotonic_us() - local_us) / 1e6
+
+async def send_clock_sync(websocket):
+    """Ping the controller clock on /out until the connection closes."""
+    while True:
+        await websocket.send(BinaryProtocol.encode_time_sync(monotonic_us()))
+        await asyncio.sleep(CLOCK_SYNC_INTERVAL)
+
+def aligned_telemetry(packet: TelemetryPacket, timebase: ControllerTimebase) -> Dict[str, Any]:
+    data = BinaryProtocol.telemetry_to_json_compat(packet)
+    data["timestamp"] = timebase.to_wall(packet.timestamp_us) * 1000
+    return data
+
+async def backfill_telemetry_history(esp_ip: str, timebase: ControllerTimebase, before: float):
+    """Merge frames the ESP32 buffered during a link outage into the telemetry buffer.
+
+    History is only recorded for the optimizer's forecast; no dispatch is run
+    for it. Frames already seen or not older than `before` (seconds) are skipped.
+    """
+    import httpx
+    try:
+        async with httpx.AsyncClient() as client:
+            response = await client.get(f"http://{esp_ip}/history", timeout=2.0)
+        if response.status_code != 200:
+            return
+    except Exception as e:
+        logger.debug(f"No telemetry history from ESP32: {e}")
+        return
+
+    latest = max((r.timestamp for r in telemetry_buffer), default=0.0)
+    records = []
+    for packet in BinaryProtocol.decode_telemetry_history(response.content):
+        timestamp = timebase.to_wall(packet.timestamp_us)
+        if not latest < timestamp < before:
+            continue
+        for node in packet.nodes:
+            if node.type == NODE_TYPE_CONSUMER:
+                records.append(DemandRecord(
+                    timestamp=timestamp,
+                    node_id=str(node.id),
+                    demand_amps=float(node.demand),
+                    fulfillment=float(node.fulfillment)
+                ))
+
+    if records:
+        merged = sorted(list(telemetry_buffer) + records, key=lambda r: r.timestamp)
+        telemetry_buffer.clear()
+        telemetry_buffer.extend(merged)
+        logger.info(f"Backfilled {len(records)} telemetry records from ESP32 history")
+
 async def connect_to_esp32_out():
     """Connect to ESP32 /out endpoint for telemetry data."""
     global hardware_websocket_out
@@ -198,6 +302,15 @@ async def connect_to_esp32_out():
             async with websockets.connect(uri, ping_interval=None) as websocket:
                 hardware_websocket_out = websocket
                 logger.info("Connected to ESP32 /out for telemetry")
+                # Rebuilds the node set from report-by-exception frames; the
+                # controller opens every subscription with a keyframe
+                telemetry_state = TelemetryState()
+                # Fresh estimate per connection: the controller may have
+                # rebooted, restarting its clock
+                controller_clocks[esp_ip] = ClockSync()
+                timebase = ControllerTimebase(controller_clocks[esp_ip])
+                if OUT_CREDIT_WINDOW > 0:
+                    await websocket.send(BinaryProtocol.encode_flow_credit(OUT_CREDIT_WINDOW))
 
                 # Explicitly pull the first frame like the test script does
                 logger.info("Awaiting first telemetry frame from /out...")
@@ -208,13 +321,18 @@ async def connect_to_esp32_out():
                         continue
                     logger.info(f"First /out frame received: {len(first_msg)} bytes")
                     first_packet = BinaryProtocol.decode_telemetry(first_msg)
+                    if first_packet:
+                        first_packet = telemetry_state.apply(first_packet)
                     if not first_packet:
                         logger.warning("Failed to decode first telemetry packet from /out; hex dump follows")
                         logger.warning(first_msg[:32].hex())
                     else:
-                        logger.info(f"First packet OK: {len(first_packet.nodes)} nodes @ ts={first_packet.timestamp}")
+                        logger.info(f"First packet OK: {len(first_packet.nodes)} nodes @ ts={first_packet.timestamp_us}us")
+                        first_data = aligned_telemetry(first_packet, timebase)
                         # Process immediately
-                        await process_hardware_telemetry(BinaryProtocol.telemetry_to_json_compat(first_packet))
+                        await process_hardware_telemetry(first_data)
+                        # Fill in what the controller buffered while it was offline
+                        await backfill_telemetry_history(esp_ip, timebase, first_data["timestamp"] / 1000)
                         # Only now signal readiness for /in
                         if not out_ready_event.is_set():
                             out_ready_event.set()
@@ -222,29 +340,62 @@ async def connect_to_esp32_out():
                     logger.warning("Timeout waiting for first /out telemetry (2s). Will reconnect.")
                     continue
 
-                # Stream subsequent frames
-                async for message in websocket:
-                    try:
-                        if isinstance(message, bytes):
-                            packet = BinaryProtocol.decode_telemetry(message)
-                            if packet:
-                                await process_hardware_telemetry(BinaryProtocol.telemetry_to_json_compat(packet))
-                            else:
-                                logger.warning(f"Decode failure on /out packet ({len(message)} bytes)")
-                                logger.warning(message[:32].hex())
-                        else:
-                            logger.error(f"Received text on /out; ignoring. Frame={message!r}")
-                    except Exception as e:
-                        logger.error(f"Error processing telemetry from /out: {e}")
+                # Stream subsequent frames, replacing the first frame's credit
+                if OUT_CREDIT_WINDOW > 0:
+                    await websocket.send(BinaryProtocol.encode_flow_credit(1))
+                sync_task = asyncio.create_task(send_clock_sync(websocket)) if CLOCK_SYNC_INTERVAL > 0 else None
+                try:
+                    await stream_telemetry(websocket, telemetry_state, timebase)
+                finally:
+                    if sync_task:
+                        sync_task.cancel()
 
         except Exception as e:
             logger.error(f"ESP32 /out connection failed: {e}")
             hardware_websocket_out = None
             await asyncio.sleep(5)
 
+async def stream_telemetry(websocket, telemetry_state: TelemetryState, timebase: ControllerTimebase):
+    """Process /out frames until the connection closes."""
+    async for message in websocket:
+        try:
+            if isinstance(message, bytes):
+                reply = BinaryProtocol.decode_time_sync_reply(message)
+                if reply:
+                    # Not a telemetry frame: no credit to replace
+                    timebase.clock.add(reply, monotonic_us())
+                    continue
+                packet = BinaryProtocol.decode_telemetry(message)
+                if packet:
+                    packet = telemetry_state.apply(packet)
+                    if packet:
+                        await process_hardware_telemetry(aligned_telemetry(packet, timebase))
+                else:
+                    logger.warning(f"Decode failure on /out packet ({len(message)} bytes)")
+                    logger.warning(message[:32].hex())
+            else:
+                logger.error(f"Received text on /out; ignoring. Frame={message!r}")
+        except Exception as e:
+            logger.error(f"Error processing telemetry from /out: {e}")
+        if OUT_CREDIT_WINDOW > 0:
+            await websocket.send(BinaryProtocol.encode_flow_credit(1))
+
+def esp32_control_addr(esp_ip: str) -> str:
+    """Address of the firmware's dedicated /in listener.
+
+    The controller serves /in on its own high-priority control port
+    (CONFIG_POWER_GRID_CONTROL_PORT, 81 by default) as well as on port 80.
+    GRIDDY_ESP32_CONTROL_PORT overrides the port; an address that already
+    carries a port (e.g. a fleet_sim device) is used as is.
+    """
+    if ":" in esp_ip:
+        return esp_ip
+    return f"{esp_ip}:{os.environ.get('GRIDDY_ESP32_CONTROL_PORT', '81')}"
+
 async def connect_to_esp32_in():
     """Connect to ESP32 /in endpoint for sending dispatch commands."""
     global hardware_websocket_in
+    use_control_port = True
 
     while True:
         try:
@@ -254,18 +405,33 @@ async def connect_to_esp32_in():
                 await out_ready_event.wait()
 
             esp_ip = await get_esp32_ip()
-            uri = f"ws://{esp_ip}/in"
+            addr = esp32_control_addr(esp_ip) if use_control_port else esp_ip
+            uri = f"ws://{addr}/in"
             logger.info(f"Connecting to ESP32 /in at {uri}")
 
-            async with websockets.connect(uri, ping_interval=None) as websocket:
+            try:
+                websocket = await websockets.connect(uri, ping_interval=None)
+            except OSError:
+                if addr == esp_ip:
+                    raise
+                # Firmware without a control server: fall back to port 80
+                logger.warning(f"No control listener at {addr}; using /in on {esp_ip}")
+                use_control_port = False
+                continue
+
+            async with websocket:
                 hardware_websocket_in = websocket
+                dense_duties_sent.clear()
                 logger.info("Connected to ESP32 /in for dispatch commands")
 
-                # Keep connection alive, but don't expect messages back
+                # Keep connection alive; the ESP32 acks each dispatch frame
                 try:
                     async for message in websocket:
-                        # /in endpoint shouldn't send us data, but handle it gracefully
-                        logger.debug(f"Unexpected message from /in endpoint: {message}")
+                        ack = BinaryProtocol.decode_dispatch_ack(message) if isinstance(message, bytes) else None
+                        if ack is None:
+                            logger.debug(f"Unexpected message from /in endpoint: {message}")
+                        elif ack.status != DISPATCH_ACK_APPLIED:
+                            logger.warning(f"ESP32 rejected dispatch #{ack.seq}")
                 except websockets.exceptions.ConnectionClosed:
                     logger.info("ESP32 /in connection closed")
 
@@ -505,6 +671,21 @@ def calculate_confidence_score(records: List[DemandRecord], dispatch: List[Dict]
     confidence = (0.3 * time_confidence + 0.5 * satisfaction_ratio + 0.2 * variance_confidence)
     return min(1.0, max(0.0, confidence))
 
+def encode_dense_dispatch(dispatch_instructions: List[Dict[str, Any]]) -> bytes:
+    """Encode dispatch as a DDSP frame covering the dispatched id range.
+
+    Only duties that differ from the last frame are sent (sparse form) unless
+    every node changed; ids in the range without an instruction keep theirs.
+    """
+    duties = {int(d["id"]): BinaryProtocol.supply_to_duty(float(d["supply_amps"]) / 5.0)
+              for d in dispatch_instructions}
+    base = min(duties)
+    span = max(duties) - base + 1
+    values = [duties.get(base + i, dense_duties_sent.get(base + i, 0)) for i in range(span)]
+    changed = [(base + i) in duties and dense_duties_sent.get(base + i) != values[i] for i in range(span)]
+    dense_duties_sent.update(duties)
+    return BinaryProtocol.encode_dispatch_dense(base, values, None if all(changed) else changed)
+
 async def send_dispatch_to_hardware(dispatch_instructions: List[Dict[str, Any]]):
     """Send optimization results back to ESP32 hardware via /in endpoint."""
     global hardware_websocket_in
@@ -514,6 +695,14 @@ async def send_dispatch_to_hardware(dispatch_instructions: List[Dict[str, Any]])
         return
 
     try:
+        wide_ids = any(int(d["id"]) > DISPATCH_MAX_NODE_ID for d in dispatch_instructions)
+        if (DENSE_DISPATCH or wide_ids) and dispatch_instructions:
+            binary_data = encode_dense_dispatch(dispatch_instructions)
+            await hardware_websocket_in.send(binary_data)
+            dispatch_timestamps.append(time.time())
+            logger.debug(f"Sent dense dispatch to ESP32 /in: {len(dispatch_instructions)} commands ({len(binary_data)} bytes)")
+            return
+
         # Convert to binary dispatch format
         dispatch_nodes = []
         for d in dispatch_instructions:
@@ -694,17 +883,31 @@ async def get_confidence_history():
         "average": np.mean(confidence_scores) if confidence_scores else 0.0
     }
 
+async def send_node_control(op: int, node_id: int, channel: int = NODE_CHANNEL_NONE):
+    """Add or remove a node in the ESP32's runtime node table via /in.
+
+    The controller acks with a DACK (applied = 1 on success), which the /in
+    reader logs if rejected.
+    """
+    if not hardware_websocket_in:
+        raise HTTPException(status_code=503, detail="ESP32 /in not connected")
+    await hardware_websocket_in.send(
+        BinaryProtocol.encode_node_control(op, node_id, NODE_TYPE_CONSUMER, channel))
+
 @app.post("/consumers")
 async def add_consumer(consumer_data: dict):
-    """Add a new consumer node."""
+    """Add a new consumer node.
+
+    Any id in 1..65535 is accepted; "channel" binds it to an actuator output.
+    """
     try:
-        # For now, just simulate adding a consumer
-        # In a real implementation, this would add to the ESP32 simulation
-        consumer_id = consumer_data.get("id")
+        consumer_id = int(consumer_data.get("id"))
         name = consumer_data.get("name", f"Consumer {consumer_id}")
         demand = float(consumer_data.get("demand", 1.0))
-        
+        channel = int(consumer_data.get("channel", NODE_CHANNEL_NONE))
+
         logger.info(f"Adding consumer: {name} (ID: {consumer_id}) with {demand}A demand")
+        await send_node_control(NODE_CONTROL_ADD, consumer_id, channel)
         
         return {
             "status": "success",
@@ -716,6 +919,8 @@ async def add_consumer(consumer_data: dict):
                 "fulfillment": 0.0
             }
         }
+    except HTTPException:
+        raise
     except Exception as e:
         raise HTTPException(status_code=400, detail=str(e))
 
@@ -724,14 +929,39 @@ async def remove_consumer(consumer_id: int):
     """Remove a consumer node."""
     try:
         logger.info(f"Removing consumer with ID: {consumer_id}")
-        
+        await send_node_control(NODE_CONTROL_REMOVE, consumer_id)
+        dense_duties_sent.pop(consumer_id, None)
+
         return {
             "status": "success",
             "message": f"Consumer {consumer_id} removed successfully"
         }
+    except HTTPException:
+        raise
     except Exception as e:
         raise HTTPException(status_code=400, detail=str(e))
 
+@app.put("/consumers/{consumer_id}/deadband")
+async def set_consumer_deadband(consumer_id: int, deadband: dict):
+    """Set a node's report-by-exception deadbands.
+
+    Body: {"demand": amps, "fulfillment": fraction}; an omitted key returns
+    that deadband to the controller default.
+    """
+    if not hardware_websocket_in:
+        raise HTTPException(status_code=503, detail="ESP32 /in not connected")
+    try:
+        demand = deadband.get("demand")
+        fulfillment = deadband.get("fulfillment")
+        message = BinaryProtocol.encode_node_deadband(
+            consumer_id,
+            None if demand is None else float(demand),
+            None if fulfillment is None else float(fulfillment))
+    except (TypeError, ValueError) as e:
+        raise HTTPException(status_code=400, detail=str(e))
+    await hardware_websocket_in.send(message)
+    return {"status": "success", "id": consumer_id, "deadband": deadband}
+
 if __name__ == "__main__":
     import uvicorn
     uvicorn.run(
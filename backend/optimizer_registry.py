@@ -0,0 +1,111 @@
+"""
+Optimizer Registry
+==================
+Named optimizer factories so the backend and benchmarks can swap solver
+engines on identical traces without code changes.
+
+An optimizer is any object with
+    schedule(records: List[DemandRecord], sources: List[EnergySource]) -> List[Dict]
+returning {"id", "supply_amps", "source_id"} dispatch instructions, like
+MicrogridOptimizer. Factories take the keyword arguments epoch_len and
+horizon and may ignore them.
+
+Usage:
+    optimizer = create_optimizer("milp", epoch_len=1/24, horizon=10)
+
+The backend picks its engine from the GRIDDY_OPTIMIZER environment variable.
+"""
+
+from typing import Any, Callable, Dict, List, Protocol
+
+from microgrid_optimizer import DemandRecord, EnergySource, MicrogridOptimizer
+
+
+class Optimizer(Protocol):
+    """Interface shared by all registered optimizers."""
+
+    def schedule(self,
+                 records: List[DemandRecord],
+                 sources: List[EnergySource]) -> List[Dict[str, Any]]:
+        ...
+
+
+_REGISTRY: Dict[str, Callable[..., Optimizer]] = {}
+
+
+def register_optimizer(name: str):
+    """Decorator registering an optimizer factory (class or function) under name."""
+    def decorator(factory: Callable[..., Optimizer]):
+        if name in _REGISTRY:
+            raise ValueError(f"Optimizer '{name}' already registered")
+        _REGISTRY[name] = factory
+        return factory
+    return decorator
+
+
+def create_optimizer(name: str, **kwargs) -> Optimizer:
+    """Instantiate a registered optimizer by name."""
+    try:
+        factory = _REGISTRY[name]
+    except KeyError:
+        raise ValueError(f"Unknown optimizer '{name}' (available: {', '.join(available_optimizers())})") from None
+    return factory(**kwargs)
+
+
+def available_optimizers() -> List[str]:
+    """Names of all registered optimizers."""
+    return sorted(_REGISTRY)
+
+
+@register_optimizer("milp")
+def _create_milp(epoch_len: float = 1/24, horizon: int = 10) -> Optimizer:
+    """MILP over a Fourier demand forecast (the production engine)."""
+    return MicrogridOptimizer(epoch_len=epoch_len, horizon=horizon)
+
+
+@register_optimizer("proportional")
+class ProportionalOptimizer:
+    """
+    Solver-free baseline: meet each node's latest demand from the cheapest
+    sources first, scaling every node down equally when capacity runs out.
+    """
+
+    def __init__(self, epoch_len: float = 1/24, horizon: int = 10):
+        self.epoch_len = epoch_len
+        self.horizon = horizon
+
+    def schedule(self,
+                 records: List[DemandRecord],
+                 sources: List[EnergySource]) -> List[Dict[str, Any]]:
+        if not records or not sources:
+            return []
+
+        # Latest demand per node
+        latest: Dict[str, DemandRecord] = {}
+        for record in records:
+            current = latest.get(record.node_id)
+            if current is None or record.timestamp >= current.timestamp:
+                latest[record.node_id] = record
+
+        total_demand = sum(max(0.0, r.demand_amps) for r in latest.values())
+        capacity = sum(s.max_supply_amps for s in sources)
+        scale = min(1.0, capacity / total_demand) if total_demand > 0 else 0.0
+
+        outputs = []
+        ordered = sorted(sources, key=lambda s: s.cost_per_amp)
+        remaining = [s.max_supply_amps for s in ordered]
+        for node_id, record in latest.items():
+            need = max(0.0, record.demand_amps) * scale
+            for i, source in enumerate(ordered):
+                if need <= 1e-6:
+                    break
+                take = min(need, remaining[i])
+                if take > 1e-6:
+                    outputs.append({
+                        "id": node_id,
+                        "supply_amps": round(take, 3),
+                        "source_id": source.id
+                    })
+                    remaining[i] -= take
+                    need -= take
+        return outputs
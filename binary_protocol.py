@@ -12,7 +12,7 @@ Protocol Design:
 Telemetry Format (ESP32 → Backend):
   Header: 4 bytes
     - Magic: 0x47524944 ("GRID")
-  Timestamp: 4 bytes (uint32, milliseconds)
+  Timestamp: 8 bytes (uint64, microseconds since controller boot)
   Node Count: 1 byte (uint8)
   Nodes: Variable length
     Each node: 10 bytes
@@ -20,6 +20,28 @@ Telemetry Format (ESP32 → Backend):
       - Type: 1 byte (0=power, 1=consumer)
       - Demand: 4 bytes (float32, amps)
       - Fulfillment: 4 bytes (float32, percentage)
+  Controllers with node ids above 255 send the wide form instead: magic
+  0x57445247 ("GRDW") and a 2-byte (uint16) ID, 11 bytes per node.
+  Frames where any node carries sensed current use magic 0x53445247 ("GRDS"):
+  the wide node record, then a fields byte (bit 0=min, 1=max, 2=mean, 3=rms)
+  and one float32 (amps) per set bit, in bit order. Nodes without sensing
+  send fields = 0 and nothing after it.
+  Report-by-exception controllers send "GRDD" (0x44445247) frames:
+    magic, timestamp, seq (uint16), flags (uint8: bit 0 = keyframe, bit 1 =
+    records carry the GRDS fields byte), node count, then GRDW/GRDS records
+    for the nodes that moved beyond their deadband. Keyframes list every
+    node. TelemetryState rebuilds the full node set; after a sequence gap it
+    waits for the next keyframe.
+
+Aggregate Format (host/aggregator → Backend, on its /out):
+  One frame per epoch merging many controllers onto the aggregator clock:
+    magic 0x41445247 ("GRDA"), timestamp (uint64 µs, epoch time), epoch
+    (uint32), controller count (uint16), node stride (uint16), then per
+    controller: id (uint16), flags (uint8: 1=interpolated, 2=stale,
+    4=offline, 8=unsynced), age_us (uint32, epoch minus newest sample at or
+    before it), node count (uint8) and GRDW node records. Node ids are
+    global: controller id * stride + the controller's node id. Dispatch to
+    the aggregator uses the same global ids (DDSP for ids above 255).
 
 Dispatch Format (Backend → ESP32):
   Header: 4 bytes
@@ -31,22 +53,104 @@ Dispatch Format (Backend → ESP32):
       - Supply: 4 bytes (float32, 0.0-1.0 normalized)
       - Source: 1 byte (uint8, source ID)
 
+Dense Dispatch (Backend → ESP32, on /in), 2 bytes per node:
+  Header: 9 bytes
+    - Magic: 0x50534444 ("DDSP")
+    - Base: 2 bytes (uint16, node id of the first duty)
+    - Count: 2 bytes (uint16, node ids covered: base .. base + count - 1)
+    - Flags: 1 byte (bit 0 = sparse)
+  Dense: count duties, 2 bytes each (uint16, LEDC steps 0-8191)
+  Sparse: per group of 8 nodes, a change mask byte (bit i = node base + 8g + i)
+    followed by the duties of the set bits; unchanged nodes keep their duty
+
+Dispatch Ack (ESP32 → Backend, on /in, one per dispatch frame in order):
+  Header: 4 bytes
+    - Magic: 0x4B434144 ("DACK")
+  Sequence: 4 bytes (uint32, dispatch frames received by the controller)
+  Status: 1 byte (0=applied, 1=invalid)
+  Applied: 1 byte (uint8, nodes applied)
+
+Flow Credit (Backend → ESP32, on /out):
+  Header: 4 bytes
+    - Magic: 0x44455243 ("CRED")
+  Credits: 2 bytes (uint16, further telemetry frames the subscriber accepts)
+  A subscriber that never sends one receives every frame. Once it has,
+  frames produced without credit are dropped and the newest one is sent on
+  the next grant.
+
+Node Control (Backend → ESP32, on /in), 9 bytes, acked with a DACK
+(applied = 1 if the node table changed):
+  Header: 4 bytes
+    - Magic: 0x45444F4E ("NODE")
+  Op: 1 byte (1=add, 2=remove)
+  ID: 2 bytes (uint16, any id but 0)
+  Type: 1 byte (0=power, 1=consumer; ignored on remove)
+  Channel: 1 byte (actuator output index, 0xFF = none)
+
+Time Sync (Backend → ESP32 and back, on /out):
+  Ping, 12 bytes:
+    - Magic: 0x4E595354 ("TSYN")
+    - Origin: 8 bytes (uint64, sender clock, echoed back)
+  Reply, 28 bytes:
+    - Magic: 0x52595354 ("TSYR")
+    - Origin: 8 bytes (uint64, from the ping)
+    - Receive: 8 bytes (uint64, controller clock when the ping arrived)
+    - Transmit: 8 bytes (uint64, controller clock when the reply left)
+  ClockSync turns replies into an offset and drift estimate, so telemetry
+  timestamps can be mapped onto the backend clock.
+
+Telemetry History (ESP32 GET /history):
+  Frames recorded while the Wi-Fi link was down, oldest first, each as
+    - Length: 2 bytes (uint16)
+    - Telemetry frame as above
+
 Total sizes:
-- Telemetry: 9 + (10 * node_count) bytes
+- Telemetry: 13 + (10 * node_count) bytes (wide: 13 + 11 * node_count;
+  sensed: 13 + 12 * node_count + 4 per field)
 - Dispatch: 9 + (6 * node_count) bytes
-- For 6 nodes: Telemetry=63 bytes, Dispatch=45 bytes
+- For 6 nodes: Telemetry=73 bytes, Dispatch=45 bytes
 - JSON equivalent: ~200-300 bytes each
 
 Author: HackMIT 2025 Team
 """
 
 import struct
+from collections import deque
 from dataclasses import dataclass
 from typing import Any, Dict, List, Optional, Tuple
 
 # Protocol constants
 TELEMETRY_MAGIC = 0x47524944  # "GRID"
+TELEMETRY_WIDE_MAGIC = 0x57445247  # "GRDW": uint16 node ids
+TELEMETRY_STATS_MAGIC = 0x53445247  # "GRDS": GRDW plus optional sensed fields
+TELEMETRY_FIELDS = ("min", "max", "mean", "rms")  # Field bit i = TELEMETRY_FIELDS[i]
+TELEMETRY_DELTA_MAGIC = 0x44445247  # "GRDD": report-by-exception frame
+TELEMETRY_DELTA_KEYFRAME = 0x01
+TELEMETRY_DELTA_FIELDS = 0x02
+AGGREGATE_MAGIC = 0x41445247  # "GRDA": host/aggregator merged frame
+AGGREGATE_INTERPOLATED = 0x01
+AGGREGATE_STALE = 0x02
+AGGREGATE_OFFLINE = 0x04
+AGGREGATE_UNSYNCED = 0x08
 DISPATCH_MAGIC = 0x44495350   # "DISP"
+DISPATCH_MAX_NODE_ID = 0xFF   # DISP ids are one byte; higher ids need DDSP
+DISPATCH_ACK_MAGIC = 0x4B434144  # "DACK"
+FLOW_CREDIT_MAGIC = 0x44455243  # "CRED"
+TIME_SYNC_MAGIC = 0x4E595354  # "TSYN"
+TIME_SYNC_REPLY_MAGIC = 0x52595354  # "TSYR"
+DISPATCH_DENSE_MAGIC = 0x50534444  # "DDSP"
+DISPATCH_DENSE_SPARSE = 0x01
+DISPATCH_DUTY_MAX = (1 << 13) - 1  # Firmware LEDC duty resolution
+NODE_CONTROL_MAGIC = 0x45444F4E  # "NODE"
+NODE_CONTROL_ADD = 1
+NODE_CONTROL_REMOVE = 2
+NODE_CONTROL_DEADBAND = 3  # type byte = demand (10 mA steps), channel byte = fulfillment (0.001 steps)
+NODE_DEADBAND_DEFAULT = 0xFF
+NODE_CHANNEL_NONE = 0xFF
+
+# Dispatch ack status
+DISPATCH_ACK_APPLIED = 0
+DISPATCH_ACK_INVALID = 1
 
 # Node types
 NODE_TYPE_POWER = 0
@@ -59,12 +163,23 @@ class TelemetryNode:
     type: int  # 0=power, 1=consumer
     demand: float  # Amps
     fulfillment: float  # Percentage
+    sensed: Optional[Dict[str, float]] = None  # Window current by TELEMETRY_FIELDS name (amps)
 
 @dataclass
 class TelemetryPacket:
     """Complete telemetry packet from ESP32."""
-    timestamp: int  # Milliseconds
+    timestamp_us: int  # Microseconds since controller boot
     nodes: List[TelemetryNode]
+    seq: Optional[int] = None  # GRDD frames only
+    keyframe: bool = True  # False for GRDD frames that carry only changed nodes
+    controllers: Optional[List["AggregateController"]] = None  # GRDA frames only
+
+@dataclass
+class AggregateController:
+    """Per-controller alignment of one GRDA epoch."""
+    id: int
+    flags: int  # AGGREGATE_* bits
+    age_us: int  # 0xFFFFFFFF if unknown
 
 @dataclass
 class DispatchNode:
@@ -78,6 +193,123 @@ class DispatchPacket:
     """Complete dispatch packet to ESP32."""
     nodes: List[DispatchNode]
 
+@dataclass
+class DispatchAck:
+    """Acknowledgement of one dispatch frame from ESP32."""
+    seq: int  # Dispatch frames received by the controller
+    status: int  # DISPATCH_ACK_APPLIED / DISPATCH_ACK_INVALID
+    applied: int  # Nodes applied
+
+class TelemetryState:
+    """Receiver-side reconstruction of report-by-exception (GRDD) telemetry.
+
+    Mirrors telemetry_state_apply() in the firmware protocol module: full
+    frames and keyframes replace the node set, deltas that follow the last
+    sequence number update or add nodes, and a gap leaves the state unsynced
+    until the next keyframe.
+    """
+
+    def __init__(self):
+        self.nodes: Dict[int, TelemetryNode] = {}
+        self.seq: Optional[int] = None
+        self.synced = False
+        self.keyframes = 0
+        self.deltas = 0
+        self.gaps = 0
+
+    def apply(self, packet: TelemetryPacket) -> Optional[TelemetryPacket]:
+        """Apply one decoded frame; returns the full node set, or None while unsynced."""
+        if packet.keyframe:
+            self.nodes = {node.id: node for node in packet.nodes}
+            self.seq = packet.seq
+            self.synced = True
+            self.keyframes += 1
+        elif not self.synced or packet.seq != ((self.seq or 0) + 1) & 0xFFFF:
+            self.gaps += int(self.synced)
+            self.synced = False
+            return None
+        else:
+            for node in packet.nodes:
+                self.nodes[node.id] = node
+            self.seq = packet.seq
+            self.deltas += 1
+        return TelemetryPacket(timestamp_us=packet.timestamp_us, nodes=list(self.nodes.values()))
+
+@dataclass
+class TimeSyncReply:
+    """TSYR reply: the ping's origin and the controller's receive/transmit times."""
+    origin_us: int
+    receive_us: int
+    transmit_us: int
+
+class ClockSync:
+    """Controller clock estimate from TSYN exchanges (NTP style).
+
+    Mirrors griddy::clock_sync in the host tools: keeps the last `window`
+    exchanges, drops those slower than the median round trip, and fits
+    offset (controller - local) against local time by least squares. With
+    fewer than two kept exchanges, or under a second between them, drift is
+    taken as 0. Local times are any monotonic microsecond clock.
+    """
+
+    def __init__(self, window: int = 64):
+        self.samples = deque(maxlen=window)  # (local_us, offset_us, delay_us)
+        self.exchanges = 0
+        self.min_delay_us = 0
+        self.offset_us = 0.0  # At ref_us
+        self.slope = 0.0
+        self.ref_us = 0
+
+    @property
+    def synced(self) -> bool:
+        return bool(self.samples)
+
+    @property
+    def drift_ppm(self) -> float:
+        return self.slope * 1e6
+
+    def add(self, reply: TimeSyncReply, arrival_us: int) -> bool:
+        """Add one exchange; False if the reply is inconsistent."""
+        delay = (arrival_us - reply.origin_us) - (reply.transmit_us - reply.receive_us)
+        if delay < 0 or reply.transmit_us < reply.receive_us:
+            return False
+        offset = ((reply.receive_us - reply.origin_us) + (reply.transmit_us - arrival_us)) / 2
+        self.samples.append((reply.origin_us + (arrival_us - reply.origin_us) // 2, offset, delay))
+        self.exchanges += 1
+        self._fit()
+        return True
+
+    def _fit(self):
+        delays = sorted(s[2] for s in self.samples)
+        median = delays[len(delays) // 2]
+        self.min_delay_us = delays[0]
+        kept = [s for s in self.samples if s[2] <= median]
+        self.ref_us = kept[-1][0]
+        n = len(kept)
+        ts = [s[0] - self.ref_us for s in kept]
+        sum_t, sum_o = sum(ts), sum(s[1] for s in kept)
+        sum_tt = sum(t * t for t in ts)
+        sum_to = sum(t * s[1] for t, s in zip(ts, kept))
+        denominator = n * sum_tt - sum_t * sum_t
+        if n < 2 or kept[-1][0] - kept[0][0] < 1_000_000 or denominator <= 0:
+            best = min(kept, key=lambda s: s[2])
+            self.ref_us, self.offset_us, self.slope = best[0], best[1], 0.0
+            return
+        self.slope = (n * sum_to - sum_t * sum_o) / denominator
+        self.offset_us = (sum_o - self.slope * sum_t) / n
+
+    def _offset_at(self, local_us: float) -> float:
+        return self.offset_us + self.slope * (local_us - self.ref_us)
+
+    def to_local(self, controller_us: int) -> int:
+        """Controller timestamp to local time."""
+        local = controller_us - self.offset_us
+        return int(controller_us - self._offset_at(local))
+
+    def to_controller(self, local_us: int) -> int:
+        """Local time to the controller clock."""
+        return int(local_us + self._offset_at(local_us))
+
 class BinaryProtocol:
     """Binary protocol encoder/decoder for ESP32 ↔ Backend communication."""
     
@@ -93,22 +325,38 @@ class BinaryProtocol:
             Binary data ready for WebSocket transmission
         """
         data = bytearray()
+        delta = packet.seq is not None
+        stats = any(node.sensed for node in packet.nodes)
+        wide = delta or stats or any(node.id > 0xFF for node in packet.nodes)
+        magic = (TELEMETRY_DELTA_MAGIC if delta else TELEMETRY_STATS_MAGIC if stats else
+                 TELEMETRY_WIDE_MAGIC if wide else TELEMETRY_MAGIC)
         
         # Header: Magic (4 bytes)
-        data.extend(struct.pack('<I', TELEMETRY_MAGIC))
+        data.extend(struct.pack('<I', magic))
         
-        # Timestamp (4 bytes)
-        data.extend(struct.pack('<I', packet.timestamp))
+        # Timestamp (8 bytes)
+        data.extend(struct.pack('<Q', packet.timestamp_us))
+
+        # Delta frames: sequence (2 bytes) and flags (1 byte)
+        if delta:
+            flags = (TELEMETRY_DELTA_KEYFRAME if packet.keyframe else 0) | (TELEMETRY_DELTA_FIELDS if stats else 0)
+            data.extend(struct.pack('<HB', packet.seq, flags))
         
         # Node count (1 byte)
         data.extend(struct.pack('<B', len(packet.nodes)))
         
-        # Nodes (10 bytes each)
+        # Nodes (10 bytes each, 11 when wide)
         for node in packet.nodes:
-            data.extend(struct.pack('<B', node.id))        # ID (1 byte)
+            data.extend(struct.pack('<H' if wide else '<B', node.id))  # ID (1 or 2 bytes)
             data.extend(struct.pack('<B', node.type))      # Type (1 byte)
             data.extend(struct.pack('<f', node.demand))    # Demand (4 bytes)
             data.extend(struct.pack('<f', node.fulfillment))  # Fulfillment (4 bytes)
+            if stats:
+                present = [(bit, name) for bit, name in enumerate(TELEMETRY_FIELDS)
+                           if node.sensed and name in node.sensed]
+                data.append(sum(1 << bit for bit, _ in present))  # Fields (1 byte)
+                for _, name in present:
+                    data.extend(struct.pack('<f', node.sensed[name]))
         
         return bytes(data)
     
@@ -123,7 +371,7 @@ class BinaryProtocol:
         Returns:
             TelemetryPacket or None if invalid
         """
-        if len(data) < 9:  # Minimum: header + timestamp + count
+        if len(data) < 13:  # Minimum: header + timestamp + count
             return None
         
         try:
@@ -132,24 +380,29 @@ class BinaryProtocol:
             # Check magic
             magic, = struct.unpack('<I', data[offset:offset+4])
             offset += 4
-            if magic != TELEMETRY_MAGIC:
+            if magic in (TELEMETRY_STATS_MAGIC, TELEMETRY_DELTA_MAGIC):
+                return BinaryProtocol._decode_telemetry_records(data, magic == TELEMETRY_DELTA_MAGIC)
+            if magic == AGGREGATE_MAGIC:
+                return BinaryProtocol._decode_aggregate(data)
+            if magic not in (TELEMETRY_MAGIC, TELEMETRY_WIDE_MAGIC):
                 return None
+            id_size = 2 if magic == TELEMETRY_WIDE_MAGIC else 1
             
             # Timestamp
-            timestamp, = struct.unpack('<I', data[offset:offset+4])
-            offset += 4
+            timestamp, = struct.unpack('<Q', data[offset:offset+8])
+            offset += 8
             
             # Node count
             node_count, = struct.unpack('<B', data[offset:offset+1])
             offset += 1
             
-            # Parse nodes with fixed per-node stride (10 bytes)
+            # Parse nodes with fixed per-node stride (10 bytes, 11 when wide)
             remaining_bytes = len(data) - offset
             if node_count == 0:
-                return TelemetryPacket(timestamp=timestamp, nodes=[])
+                return TelemetryPacket(timestamp_us=timestamp, nodes=[])
             bytes_per_node = remaining_bytes // node_count
 
-            if bytes_per_node < 10:
+            if bytes_per_node < 9 + id_size:
                 return None
 
             nodes = []
@@ -158,7 +411,8 @@ class BinaryProtocol:
                     break
 
                 base = offset
-                node_id, = struct.unpack('<B', data[base:base+1])
+                node_id, = struct.unpack('<H' if id_size == 2 else '<B', data[base:base+id_size])
+                base += id_size - 1
                 node_type, = struct.unpack('<B', data[base+1:base+2])
                 demand, = struct.unpack('<f', data[base+2:base+6])
                 fulfillment, = struct.unpack('<f', data[base+6:base+10])
@@ -173,11 +427,67 @@ class BinaryProtocol:
                 # Advance by stride (tolerate any extra bytes per node if present)
                 offset += bytes_per_node
             
-            return TelemetryPacket(timestamp=timestamp, nodes=nodes)
+            return TelemetryPacket(timestamp_us=timestamp, nodes=nodes)
             
         except struct.error as e:
             return None
     
+    @staticmethod
+    def _decode_telemetry_records(data: bytes, delta: bool) -> Optional[TelemetryPacket]:
+        """Decode a GRDS or GRDD frame: variable-size nodes, parsed in sequence."""
+        seq, flags = None, TELEMETRY_DELTA_FIELDS
+        if delta:
+            timestamp, seq, flags, node_count = struct.unpack_from('<QHBB', data, 4)
+            offset = 16
+            if flags & ~(TELEMETRY_DELTA_KEYFRAME | TELEMETRY_DELTA_FIELDS):
+                return None
+        else:
+            timestamp, node_count = struct.unpack_from('<QB', data, 4)
+            offset = 13
+        has_fields = bool(flags & TELEMETRY_DELTA_FIELDS)
+        nodes = []
+        for _ in range(node_count):
+            if has_fields:
+                node_id, node_type, demand, fulfillment, fields = struct.unpack_from('<HBffB', data, offset)
+                offset += 12
+            else:
+                node_id, node_type, demand, fulfillment = struct.unpack_from('<HBff', data, offset)
+                fields = 0
+                offset += 11
+            if fields & ~0x0F:
+                return None
+            sensed = {}
+            for bit, name in enumerate(TELEMETRY_FIELDS):
+                if fields & (1 << bit):
+                    sensed[name], = struct.unpack_from('<f', data, offset)
+                    offset += 4
+            nodes.append(TelemetryNode(id=node_id, type=node_type, demand=demand,
+                                       fulfillment=fulfillment, sensed=sensed or None))
+        if offset != len(data):
+            return None
+        if delta:
+            return TelemetryPacket(timestamp_us=timestamp, nodes=nodes, seq=seq,
+                                   keyframe=bool(flags & TELEMETRY_DELTA_KEYFRAME))
+        return TelemetryPacket(timestamp_us=timestamp, nodes=nodes)
+
+    @staticmethod
+    def _decode_aggregate(data: bytes) -> Optional[TelemetryPacket]:
+        """Decode a GRDA frame into one packet with global node ids."""
+        timestamp, _epoch, controller_count, _stride = struct.unpack_from('<QIHH', data, 4)
+        offset = 20
+        nodes, controllers = [], []
+        for _ in range(controller_count):
+            controller_id, flags, age_us, node_count = struct.unpack_from('<HBIB', data, offset)
+            offset += 8
+            controllers.append(AggregateController(id=controller_id, flags=flags, age_us=age_us))
+            for _ in range(node_count):
+                node_id, node_type, demand, fulfillment = struct.unpack_from('<HBff', data, offset)
+                offset += 11
+                nodes.append(TelemetryNode(id=node_id, type=node_type, demand=demand, fulfillment=fulfillment))
+        if offset != len(data):
+            return None
+        return TelemetryPacket(timestamp_us=timestamp, nodes=nodes, controllers=controllers)
+
     @staticmethod
     def encode_dispatch(packet: DispatchPacket) -> bytes:
         """
@@ -188,7 +498,14 @@ class BinaryProtocol:
             
         Returns:
             Binary data ready for WebSocket transmission
+
+        Raises:
+            ValueError: A node id above DISPATCH_MAX_NODE_ID (use
+                encode_dispatch_dense for those)
         """
+        if any(not 0 <= node.id <= DISPATCH_MAX_NODE_ID for node in packet.nodes):
+            raise ValueError("DISP node ids must fit in uint8; use dense dispatch")
+
         data = bytearray()
         
         # Header: Magic (4 bytes)
@@ -260,17 +577,188 @@ class BinaryProtocol:
         except struct.error:
             return None
 
+    @staticmethod
+    def decode_dispatch_ack(data: bytes) -> Optional[DispatchAck]:
+        """
+        Decode a dispatch ack from the ESP32 /in endpoint.
+
+        Args:
+            data: Binary data
+
+        Returns:
+            DispatchAck or None if invalid
+        """
+        if len(data) != 10:
+            return None
+
+        magic, seq, status, applied = struct.unpack('<IIBB', data)
+        if magic != DISPATCH_ACK_MAGIC:
+            return None
+
+        return DispatchAck(seq=seq, status=status, applied=applied)
+
+    @staticmethod
+    def supply_to_duty(supply: float) -> int:
+        """Convert a 0-1 supply to a dense dispatch duty, as the firmware does."""
+        return int(max(0.0, min(1.0, supply)) * DISPATCH_DUTY_MAX)
+
+    @staticmethod
+    def encode_dispatch_dense(base: int, duties: List[int],
+                              changed: Optional[List[bool]] = None) -> bytes:
+        """
+        Encode a dense dispatch frame.
+
+        Args:
+            base: Node id of duties[0]
+            duties: Duty per node id from base, in LEDC steps (0-8191)
+            changed: Per-node change flags; if given, only flagged duties are
+                sent and the others keep their current value on the device
+
+        Returns:
+            Binary data ready for WebSocket transmission
+        """
+        count = len(duties)
+        if base < 0 or base + count > 0x10000:
+            raise ValueError("dense dispatch ids must fit in uint16")
+        duties = [max(0, min(int(d), DISPATCH_DUTY_MAX)) for d in duties]
+        flags = DISPATCH_DENSE_SPARSE if changed is not None else 0
+        data = bytearray(struct.pack('<IHHB', DISPATCH_DENSE_MAGIC, base, count, flags))
+
+        if changed is None:
+            data.extend(struct.pack(f'<{count}H', *duties))
+            return bytes(data)
+
+        for group in range(0, count, 8):
+            members = range(group, min(group + 8, count))
+            mask = 0
+            for i in members:
+                if changed[i]:
+                    mask |= 1 << (i - group)
+            data.append(mask)
+            for i in members:
+                if mask & (1 << (i - group)):
+                    data.extend(struct.pack('<H', duties[i]))
+        return bytes(data)
+
+    @staticmethod
+    def encode_flow_credit(credits: int) -> bytes:
+        """
+        Encode a flow credit grant for the ESP32 /out endpoint.
+
+        Args:
+            credits: Additional frames to accept (clamped to 0..65535)
+
+        Returns:
+            Binary data (6 bytes)
+        """
+        return struct.pack('<IH', FLOW_CREDIT_MAGIC, max(0, min(int(credits), 0xFFFF)))
+
+    @staticmethod
+    def encode_time_sync(origin_us: int) -> bytes:
+        """
+        Encode a TSYN clock-sync ping for the ESP32 /out endpoint.
+
+        Args:
+            origin_us: Sender clock in microseconds, echoed back in the reply
+
+        Returns:
+            Binary data (12 bytes)
+        """
+        return struct.pack('<IQ', TIME_SYNC_MAGIC, origin_us)
+
+    @staticmethod
+    def decode_time_sync_reply(data: bytes) -> Optional[TimeSyncReply]:
+        """
+        Decode a TSYR reply from the ESP32 /out endpoint.
+
+        Returns:
+            TimeSyncReply or None if data is not a reply
+        """
+        if len(data) != 28:
+            return None
+        magic, origin, receive, transmit = struct.unpack('<IQQQ', data)
+        if magic != TIME_SYNC_REPLY_MAGIC:
+            return None
+        return TimeSyncReply(origin_us=origin, receive_us=receive, transmit_us=transmit)
+
+    @staticmethod
+    def encode_node_control(op: int, node_id: int, node_type: int = NODE_TYPE_CONSUMER,
+                            channel: int = NODE_CHANNEL_NONE) -> bytes:
+        """
+        Encode a node add/remove message for the ESP32 /in endpoint.
+
+        Args:
+            op: NODE_CONTROL_ADD or NODE_CONTROL_REMOVE
+            node_id: Node id, 1..65535
+            node_type: NODE_TYPE_POWER or NODE_TYPE_CONSUMER
+            channel: Actuator output index, or NODE_CHANNEL_NONE
+
+        Returns:
+            Binary data (9 bytes)
+        """
+        if op not in (NODE_CONTROL_ADD, NODE_CONTROL_REMOVE) or not 0 < node_id <= 0xFFFF:
+            raise ValueError("invalid node control message")
+        return struct.pack('<IBHBB', NODE_CONTROL_MAGIC, op, node_id, node_type, channel)
+
+    @staticmethod
+    def encode_node_deadband(node_id: int, demand_amps: Optional[float] = None,
+                             fulfillment: Optional[float] = None) -> bytes:
+        """
+        Encode a report-by-exception deadband for one node (NODE op 3).
+
+        Args:
+            node_id: Node id, 1..65535
+            demand_amps: Demand deadband, 0-2.54 A in 10 mA steps; None = controller default
+            fulfillment: Fulfillment deadband, 0-0.254 in 0.001 steps; None = controller default
+
+        Returns:
+            Binary data (9 bytes)
+        """
+        if not 0 < node_id <= 0xFFFF:
+            raise ValueError("invalid node id")
+        demand = NODE_DEADBAND_DEFAULT if demand_amps is None else min(254, max(0, round(demand_amps * 100)))
+        ff = NODE_DEADBAND_DEFAULT if fulfillment is None else min(254, max(0, round(fulfillment * 1000)))
+        return struct.pack('<IBHBB', NODE_CONTROL_MAGIC, NODE_CONTROL_DEADBAND, node_id, demand, ff)
+
+    @staticmethod
+    def decode_telemetry_history(data: bytes) -> List[TelemetryPacket]:
+        """
+        Decode the ESP32 GET /history body: telemetry frames buffered while
+        the link was down, oldest first, each behind a uint16 length.
+
+        Args:
+            data: Response body
+
+        Returns:
+            Decoded packets; a truncated or invalid record ends the list
+        """
+        packets = []
+        offset = 0
+        while offset + 2 <= len(data):
+            length, = struct.unpack('<H', data[offset:offset+2])
+            offset += 2
+            if offset + length > len(data):
+                break
+            packet = BinaryProtocol.decode_telemetry(data[offset:offset+length])
+            if packet is None:
+                break
+            packets.append(packet)
+            offset += length
+        return packets
+
     @staticmethod
     def telemetry_to_json_compat(packet: TelemetryPacket) -> Dict[str, Any]:
         """Convert binary telemetry to JSON-compatible format for existing code."""
         return {
-            "timestamp": packet.timestamp,
+            "timestamp": packet.timestamp_us // 1000,
+            "timestamp_us": packet.timestamp_us,
             "nodes": [
                 {
                     "id": node.id,
                     "type": "consumer" if node.type == NODE_TYPE_CONSUMER else "power",
                     "demand": node.demand,
-                    "ff": node.fulfillment
+                    "ff": node.fulfillment,
+                    **({"sensed": node.sensed} if node.sensed else {})
                 }
                 for node in packet.nodes
             ]
@@ -295,7 +783,7 @@ def test_protocol():
     
     # Test telemetry
     telemetry = TelemetryPacket(
-        timestamp=1234567890,
+        timestamp_us=1234567890123,
         nodes=[
             TelemetryNode(id=1, type=NODE_TYPE_POWER, demand=0.0, fulfillment=95.5),
             TelemetryNode(id=2, type=NODE_TYPE_CONSUMER, demand=2.5, fulfillment=88.2),
@@ -329,6 +817,21 @@ def test_protocol():
     print(f"Original: {dispatch}")
     print(f"Decoded:  {decoded}")
     print(f"Match: {dispatch == decoded}")
+    print()
+
+    # Ids above 255 only fit dense dispatch
+    wide = DispatchPacket(nodes=[DispatchNode(id=300, supply=0.5, source=1)])
+    try:
+        BinaryProtocol.encode_dispatch(wide)
+        rejected = False
+    except ValueError:
+        rejected = True
+    duty = BinaryProtocol.supply_to_duty(0.5)
+    encoded = BinaryProtocol.encode_dispatch_dense(300, [duty])
+    magic, base, count, flags = struct.unpack_from('<IHHB', encoded)
+    (decoded_duty,) = struct.unpack_from('<H', encoded, 9)
+    print(f"Id 300: DISP rejected: {rejected}, DDSP {len(encoded)} bytes")
+    print(f"Match: {rejected and magic == DISPATCH_DENSE_MAGIC and (base, count, flags) == (300, 1, 0) and decoded_duty == duty}")
 
 if __name__ == "__main__":
     test_protocol()
@@ -126,6 +126,31 @@ esp_err_t example_configure_stdin_stdout(void);
  */
 esp_netif_t *get_example_netif_from_desc(const char *desc);
 
+#if CONFIG_EXAMPLE_CONNECT_WIFI
+/**
+ * @brief Timestamps of the last Wi-Fi connect, in esp_timer microseconds
+ *
+ * A phase that has not happened (yet) is 0.
+ */
+typedef struct {
+    int64_t start_us;       /*!< example_wifi_start() entered */
+    int64_t started_us;     /*!< Wi-Fi driver started */
+    int64_t connect_us;     /*!< esp_wifi_connect() issued */
+    int64_t associated_us;  /*!< WIFI_EVENT_STA_CONNECTED */
+    int64_t got_ip_us;      /*!< IP_EVENT_STA_GOT_IP */
+    bool fast_path;         /*!< Connected to the cached BSSID/channel without a scan */
+    bool cached_lease;      /*!< Reused the cached IP lease instead of DHCP */
+    uint8_t fallbacks;      /*!< Directed connects that fell back to a scan */
+} example_wifi_connect_timing_t;
+
+/**
+ * @brief Get per-phase timings of the last Wi-Fi connect
+ *
+ * @param[out] timing Timestamps and fast-connect outcome
+ */
+void example_wifi_get_connect_timing(example_wifi_connect_timing_t *timing);
+#endif
+
 #if CONFIG_EXAMPLE_PROVIDE_WIFI_CONSOLE_CMD
 /**
  * @brief Register wifi connect commands
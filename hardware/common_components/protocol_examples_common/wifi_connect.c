@@ -16,6 +16,10 @@
 #include "protocol_examples_common.h"
 #include "example_common_private.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#if CONFIG_EXAMPLE_WIFI_FAST_CONNECT
+#include "nvs.h"
+#endif
 
 #if CONFIG_EXAMPLE_CONNECT_WIFI
 
@@ -27,11 +31,179 @@ static SemaphoreHandle_t s_semph_get_ip6_addrs = NULL;
 #endif
 
 static int s_retry_num = 0;
+static example_wifi_connect_timing_t s_timing;
+#if CONFIG_EXAMPLE_WIFI_RECONNECT_FOREVER
+static esp_timer_handle_t s_reconnect_timer = NULL;
+
+static void example_wifi_reconnect(void *arg)
+{
+    esp_err_t err = esp_wifi_connect();
+    if (err != ESP_OK && err != ESP_ERR_WIFI_NOT_STARTED) {
+        ESP_LOGW(TAG, "Reconnect failed to start: %s", esp_err_to_name(err));
+    }
+}
+#endif
+
+#if CONFIG_EXAMPLE_WIFI_FAST_CONNECT
+/*
+ * Fast connect: the BSSID, channel and IP lease of the last AP that gave us
+ * an address are kept in NVS. The next connect goes straight to that BSSID on
+ * that channel (no scan), optionally with the cached lease instead of DHCP,
+ * and falls back to the configured scan if the AP does not answer in time.
+ */
+#define FAST_CONNECT_NVS_NAMESPACE "wifi_fast"
+#define FAST_CONNECT_NVS_KEY "ap"
+#define FAST_CONNECT_MAGIC 0x31434657  /* "WFC1" */
+
+typedef struct {
+    uint32_t magic;
+    uint8_t ssid[32];
+    uint8_t bssid[6];
+    uint8_t channel;
+    esp_netif_ip_info_t ip_info;
+    esp_netif_dns_info_t dns;
+} example_wifi_fast_cache_t;
+
+static example_wifi_fast_cache_t s_fast_cache;
+static wifi_config_t s_scan_config;          /* Configuration to fall back to */
+static volatile bool s_fast_attempt = false; /* Directed connect in flight */
+static bool s_directed_config = false;       /* Driver holds the cached BSSID/channel */
+static esp_timer_handle_t s_fast_timer = NULL;
+
+static bool example_wifi_fast_load(example_wifi_fast_cache_t *cache)
+{
+    nvs_handle_t nvs;
+    size_t len = sizeof(*cache);
+
+    if (nvs_open(FAST_CONNECT_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return false;
+    }
+    esp_err_t err = nvs_get_blob(nvs, FAST_CONNECT_NVS_KEY, cache, &len);
+    nvs_close(nvs);
+    return err == ESP_OK && len == sizeof(*cache) && cache->magic == FAST_CONNECT_MAGIC;
+}
+
+/* Called on every IPv4 lease; only writes flash when something changed */
+static void example_wifi_fast_save(const ip_event_got_ip_t *event)
+{
+    wifi_ap_record_t ap;
+    example_wifi_fast_cache_t cache = { .magic = FAST_CONNECT_MAGIC };
+
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) {
+        return;
+    }
+    memcpy(cache.ssid, s_scan_config.sta.ssid, sizeof(cache.ssid));
+    memcpy(cache.bssid, ap.bssid, sizeof(cache.bssid));
+    cache.channel = ap.primary;
+    cache.ip_info = event->ip_info;
+    esp_netif_get_dns_info(event->esp_netif, ESP_NETIF_DNS_MAIN, &cache.dns);
+
+    if (memcmp(&cache, &s_fast_cache, sizeof(cache)) == 0) {
+        return;
+    }
+
+    nvs_handle_t nvs;
+    if (nvs_open(FAST_CONNECT_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;
+    }
+    if (nvs_set_blob(nvs, FAST_CONNECT_NVS_KEY, &cache, sizeof(cache)) == ESP_OK &&
+            nvs_commit(nvs) == ESP_OK) {
+        s_fast_cache = cache;
+        ESP_LOGI(TAG, "Cached AP %02x:%02x:%02x:%02x:%02x:%02x on channel %d for fast connect",
+                 cache.bssid[0], cache.bssid[1], cache.bssid[2], cache.bssid[3], cache.bssid[4], cache.bssid[5],
+                 cache.channel);
+    }
+    nvs_close(nvs);
+}
+
+/* Point the connect at the cached AP if it belongs to the configured SSID */
+static void example_wifi_fast_prepare(wifi_config_t *wifi_config)
+{
+    s_scan_config = *wifi_config;
+    s_fast_attempt = false;
+    s_directed_config = false;
+
+    if (!example_wifi_fast_load(&s_fast_cache) ||
+            memcmp(s_fast_cache.ssid, wifi_config->sta.ssid, sizeof(s_fast_cache.ssid)) != 0) {
+        memset(&s_fast_cache, 0, sizeof(s_fast_cache));
+        return;
+    }
+
+    wifi_config->sta.bssid_set = true;
+    memcpy(wifi_config->sta.bssid, s_fast_cache.bssid, sizeof(wifi_config->sta.bssid));
+    wifi_config->sta.channel = s_fast_cache.channel;
+    wifi_config->sta.scan_method = WIFI_FAST_SCAN;
+    s_fast_attempt = true;
+    s_directed_config = true;
+
+#if CONFIG_EXAMPLE_WIFI_FAST_CONNECT_CACHED_LEASE
+    if (s_fast_cache.ip_info.ip.addr != 0 &&
+            esp_netif_dhcpc_stop(s_example_sta_netif) == ESP_OK) {
+        esp_netif_set_ip_info(s_example_sta_netif, &s_fast_cache.ip_info);
+        esp_netif_set_dns_info(s_example_sta_netif, ESP_NETIF_DNS_MAIN, &s_fast_cache.dns);
+        s_timing.cached_lease = true;
+    }
+#endif
+
+    ESP_LOGI(TAG, "Fast connect to cached AP on channel %d%s", s_fast_cache.channel,
+             s_timing.cached_lease ? " with cached lease" : "");
+    esp_timer_start_once(s_fast_timer, CONFIG_EXAMPLE_WIFI_FAST_CONNECT_TIMEOUT_MS * 1000ULL);
+}
+
+/*
+ * Switch back to the scanning configuration. Returns true if a directed
+ * attempt was abandoned, in which case the caller should reconnect without
+ * counting a retry.
+ */
+static bool example_wifi_fast_fallback(void)
+{
+    if (!s_fast_attempt) {
+        return false;
+    }
+    s_fast_attempt = false;
+    s_directed_config = false;
+    s_timing.fallbacks++;
+    esp_timer_stop(s_fast_timer);
+
+    if (s_timing.cached_lease) {
+        s_timing.cached_lease = false;
+        esp_netif_dhcpc_start(s_example_sta_netif);
+    }
+    ESP_LOGI(TAG, "Cached AP did not answer, falling back to scan");
+    esp_wifi_set_config(WIFI_IF_STA, &s_scan_config);
+    return true;
+}
+
+/* Directed connect timed out before association: force the fallback */
+static void example_wifi_fast_timeout(void *arg)
+{
+    if (s_fast_attempt && s_timing.associated_us == 0) {
+        esp_wifi_disconnect();
+    }
+}
+#endif /* CONFIG_EXAMPLE_WIFI_FAST_CONNECT */
+
+void example_wifi_get_connect_timing(example_wifi_connect_timing_t *timing)
+{
+    *timing = s_timing;
+}
 
 static void example_handler_on_wifi_disconnect(void *arg, esp_event_base_t event_base,
                                int32_t event_id, void *event_data)
 {
+#if CONFIG_EXAMPLE_WIFI_FAST_CONNECT
+    if (example_wifi_fast_fallback()) {
+        s_timing.associated_us = 0;
+        esp_wifi_connect();
+        return;
+    }
+    /* Link lost after a directed connect: retry the cached AP once, then scan */
+    if (s_directed_config) {
+        s_fast_attempt = true;
+    }
+#endif
     s_retry_num++;
+#if !CONFIG_EXAMPLE_WIFI_RECONNECT_FOREVER
     if (s_retry_num > CONFIG_EXAMPLE_WIFI_CONN_MAX_RETRY) {
         ESP_LOGI(TAG, "WiFi Connect failed %d times, stop reconnect.", s_retry_num);
         /* let example_wifi_sta_do_connect() return */
@@ -46,11 +218,28 @@ static void example_handler_on_wifi_disconnect(void *arg, esp_event_base_t event
         example_wifi_sta_do_disconnect();
         return;
     }
+#endif
     wifi_event_sta_disconnected_t *disconn = event_data;
     if (disconn->reason == WIFI_REASON_ROAMING) {
         ESP_LOGD(TAG, "station roaming, do nothing");
         return;
     }
+#if CONFIG_EXAMPLE_WIFI_RECONNECT_FOREVER
+    /* First retry at once, then back off exponentially; never give up */
+    if (s_retry_num > 1) {
+        uint32_t delay_ms = CONFIG_EXAMPLE_WIFI_RECONNECT_BACKOFF_MIN_MS;
+        for (int i = 2; i < s_retry_num && delay_ms < CONFIG_EXAMPLE_WIFI_RECONNECT_BACKOFF_MAX_MS; i++) {
+            delay_ms *= 2;
+        }
+        if (delay_ms > CONFIG_EXAMPLE_WIFI_RECONNECT_BACKOFF_MAX_MS) {
+            delay_ms = CONFIG_EXAMPLE_WIFI_RECONNECT_BACKOFF_MAX_MS;
+        }
+        ESP_LOGI(TAG, "Wi-Fi disconnected %d, retry %d in %u ms", disconn->reason, s_retry_num, (unsigned)delay_ms);
+        esp_timer_stop(s_reconnect_timer);
+        esp_timer_start_once(s_reconnect_timer, delay_ms * 1000ULL);
+        return;
+    }
+#endif
     ESP_LOGI(TAG, "Wi-Fi disconnected %d, trying to reconnect...", disconn->reason);
     esp_err_t err = esp_wifi_connect();
     if (err == ESP_ERR_WIFI_NOT_STARTED) {
@@ -62,6 +251,9 @@ static void example_handler_on_wifi_disconnect(void *arg, esp_event_base_t event
 static void example_handler_on_wifi_connect(void *esp_netif, esp_event_base_t event_base,
                             int32_t event_id, void *event_data)
 {
+    if (s_timing.associated_us == 0) {
+        s_timing.associated_us = esp_timer_get_time();
+    }
 #if CONFIG_EXAMPLE_CONNECT_IPV6
     esp_netif_create_ip6_linklocal(esp_netif);
 #endif // CONFIG_EXAMPLE_CONNECT_IPV6
@@ -76,6 +268,28 @@ static void example_handler_on_sta_got_ip(void *arg, esp_event_base_t event_base
         return;
     }
     ESP_LOGI(TAG, "Got IPv4 event: Interface \"%s\" address: " IPSTR, esp_netif_get_desc(event->esp_netif), IP2STR(&event->ip_info.ip));
+
+#if CONFIG_EXAMPLE_WIFI_FAST_CONNECT
+    bool fast_path = s_fast_attempt;
+    s_fast_attempt = false;
+    esp_timer_stop(s_fast_timer);
+#endif
+    if (s_timing.got_ip_us == 0) {
+        s_timing.got_ip_us = esp_timer_get_time();
+#if CONFIG_EXAMPLE_WIFI_FAST_CONNECT
+        s_timing.fast_path = fast_path;
+#endif
+        ESP_LOGI(TAG, "Wi-Fi up in %lld ms (driver %lld, associate %lld, IP %lld ms; %s%s)",
+                 (long long)((s_timing.got_ip_us - s_timing.start_us) / 1000),
+                 (long long)((s_timing.started_us - s_timing.start_us) / 1000),
+                 (long long)((s_timing.associated_us - s_timing.connect_us) / 1000),
+                 (long long)((s_timing.got_ip_us - s_timing.associated_us) / 1000),
+                 s_timing.fast_path ? "cached AP" : "scan",
+                 s_timing.cached_lease ? ", cached lease" : "");
+    }
+#if CONFIG_EXAMPLE_WIFI_FAST_CONNECT
+    example_wifi_fast_save(event);
+#endif
     if (s_semph_get_ip_addrs) {
         xSemaphoreGive(s_semph_get_ip_addrs);
     } else {
@@ -108,6 +322,9 @@ static void example_handler_on_sta_got_ipv6(void *arg, esp_event_base_t event_ba
 
 void example_wifi_start(void)
 {
+    memset(&s_timing, 0, sizeof(s_timing));
+    s_timing.start_us = esp_timer_get_time();
+
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
 
@@ -121,6 +338,26 @@ void example_wifi_start(void)
     ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM));
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_start());
+    s_timing.started_us = esp_timer_get_time();
+
+#if CONFIG_EXAMPLE_WIFI_RECONNECT_FOREVER
+    if (s_reconnect_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = example_wifi_reconnect,
+            .name = "wifi_retry",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_reconnect_timer));
+    }
+#endif
+#if CONFIG_EXAMPLE_WIFI_FAST_CONNECT
+    if (s_fast_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = example_wifi_fast_timeout,
+            .name = "wifi_fast",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&timer_args, &s_fast_timer));
+    }
+#endif
 }
 
 
@@ -162,7 +399,13 @@ esp_err_t example_wifi_sta_do_connect(wifi_config_t wifi_config, bool wait)
 #endif
 
     ESP_LOGI(TAG, "Connecting to %s...", wifi_config.sta.ssid);
+    s_timing.associated_us = 0;
+    s_timing.got_ip_us = 0;
+#if CONFIG_EXAMPLE_WIFI_FAST_CONNECT
+    example_wifi_fast_prepare(&wifi_config);
+#endif
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    s_timing.connect_us = esp_timer_get_time();
     esp_err_t ret = esp_wifi_connect();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "WiFi connect failed! ret:%x", ret);
@@ -180,15 +423,20 @@ esp_err_t example_wifi_sta_do_connect(wifi_config_t wifi_config, bool wait)
         vSemaphoreDelete(s_semph_get_ip6_addrs);
         s_semph_get_ip6_addrs = NULL;
 #endif
+#if !CONFIG_EXAMPLE_WIFI_RECONNECT_FOREVER
         if (s_retry_num > CONFIG_EXAMPLE_WIFI_CONN_MAX_RETRY) {
             return ESP_FAIL;
         }
+#endif
     }
     return ESP_OK;
 }
 
 esp_err_t example_wifi_sta_do_disconnect(void)
 {
+#if CONFIG_EXAMPLE_WIFI_RECONNECT_FOREVER
+    esp_timer_stop(s_reconnect_timer);
+#endif
     ESP_ERROR_CHECK(esp_event_handler_unregister(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &example_handler_on_wifi_disconnect));
     ESP_ERROR_CHECK(esp_event_handler_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, &example_handler_on_sta_got_ip));
     ESP_ERROR_CHECK(esp_event_handler_unregister(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, &example_handler_on_wifi_connect));
@@ -0,0 +1,105 @@
+#ifndef ACTUATOR_H
+#define ACTUATOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Actuator drivers.
+ *
+ * A driver owns PWM outputs 0..outputs-1 and applies setpoints in batches:
+ * one apply() call stages every duty in the batch and latches them together,
+ * costing a single update pass (LEDC, MCPWM) or a single bus transaction
+ * (PWM expander). The dispatch path therefore collects a frame's setpoints
+ * and hands them over once instead of writing node by node.
+ *
+ * Duties are in ACTUATOR_DUTY_BITS-bit steps whatever the hardware's native
+ * resolution; drivers rescale. The interface has no platform types so the
+ * mock driver also builds for the host tools.
+ */
+
+#define ACTUATOR_DUTY_BITS 13
+#define ACTUATOR_DUTY_MAX ((1 << ACTUATOR_DUTY_BITS) - 1)
+#define ACTUATOR_MAX_OUTPUTS 16     // Per driver; LEDC on the ESP32 has 16
+
+typedef struct {
+    uint16_t output;
+    uint16_t duty;                  // 0..ACTUATOR_DUTY_MAX
+} actuator_setpoint_t;
+
+typedef struct actuator_driver actuator_driver_t;
+
+struct actuator_driver {
+    const char *name;
+    int outputs;                    // 0 if the hardware failed to initialize
+    /**
+     * Stage and latch a batch; later setpoints for the same output win.
+     * Outputs out of range are ignored. Returns false on a bus error.
+     */
+    bool (*apply)(actuator_driver_t *driver, const actuator_setpoint_t *setpoints, int count);
+    void *ctx;
+};
+
+static inline bool actuator_apply(actuator_driver_t *driver, const actuator_setpoint_t *setpoints, int count)
+{
+    return count <= 0 || !driver->apply || driver->apply(driver, setpoints, count);
+}
+
+/**
+ * @brief LEDC outputs: low-speed channels first, then high-speed channels on
+ *        chips that have them (16 outputs on the ESP32)
+ *
+ * @param gpios Output pins, one per output
+ * @param count Number of outputs (clamped to the channels available)
+ * @param freq_hz PWM frequency
+ * @param initial Initial duty per output, or NULL for all off
+ * @return true if every channel was configured
+ */
+bool actuator_ledc_init(actuator_driver_t *driver, const int *gpios, int count, uint32_t freq_hz,
+                        const uint16_t *initial);
+
+/**
+ * @brief MCPWM outputs: two per operator, one timer per MCPWM group; new
+ *        compare values latch together at the next period start
+ *
+ * Parameters as for actuator_ledc_init().
+ */
+bool actuator_mcpwm_init(actuator_driver_t *driver, const int *gpios, int count, uint32_t freq_hz,
+                         const uint16_t *initial);
+
+typedef struct {
+    int sda_gpio;
+    int scl_gpio;
+    uint8_t address;                // 7-bit I2C address
+    uint32_t scl_hz;
+    uint32_t pwm_hz;
+} actuator_expander_config_t;
+
+/**
+ * @brief PCA9685 16-channel I2C PWM expander; a batch is written as one
+ *        auto-increment transaction covering the changed channel span
+ */
+bool actuator_expander_init(actuator_driver_t *driver, const actuator_expander_config_t *config,
+                            const uint16_t *initial);
+
+// Mock driver: records duties and counts transactions
+typedef struct {
+    uint16_t *duties;               // Caller-provided, one per output
+    uint32_t applies;               // apply() calls, i.e. bus transactions
+    uint32_t writes;                // Setpoints applied
+} actuator_mock_t;
+
+/**
+ * @brief Mock driver for host tools; duties start at 0
+ */
+void actuator_mock_init(actuator_driver_t *driver, actuator_mock_t *mock, uint16_t *duties, int outputs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ACTUATOR_H
@@ -0,0 +1,137 @@
+#include "actuator.h"
+#include <string.h>
+#include "driver/i2c_master.h"
+#include "esp_rom_sys.h"
+#include "esp_log.h"
+
+#define TAG "actuator"
+
+// PCA9685 registers
+#define PCA9685_MODE1 0x00
+#define PCA9685_MODE2 0x01
+#define PCA9685_LED0 0x06           // LEDn_ON_L at 0x06 + 4n; ON_L, ON_H, OFF_L, OFF_H
+#define PCA9685_PRESCALE 0xFE
+
+#define MODE1_AI 0x20               // Register auto-increment
+#define MODE1_SLEEP 0x10
+#define MODE2_OUTDRV 0x04           // Totem-pole outputs
+#define LED_FULL 0x10               // Full on/off bit in ON_H/OFF_H
+
+#define PCA9685_OSC_HZ 25000000
+#define PCA9685_CHANNELS 16
+#define PCA9685_TIMEOUT_MS 10
+
+static i2c_master_dev_handle_t device;
+
+// Register image of every channel; a batch rewrites the span between the
+// first and last changed channel in one auto-increment transaction
+static uint8_t frame[1 + PCA9685_CHANNELS * 4];
+
+static void stage(int channel, uint16_t duty)
+{
+    uint8_t *led = &frame[1 + channel * 4];
+    uint16_t off = duty >> (ACTUATOR_DUTY_BITS - 12);  // 12-bit counter
+
+    memset(led, 0, 4);
+    if (duty == 0) {
+        led[3] = LED_FULL;
+    } else if (duty >= ACTUATOR_DUTY_MAX) {
+        led[1] = LED_FULL;
+    } else {
+        led[2] = off & 0xFF;
+        led[3] = off >> 8;
+    }
+}
+
+static esp_err_t write_span(int first, int last)
+{
+    // The register byte sits right before the first channel's image
+    uint8_t *start = &frame[first * 4];
+    uint8_t saved = *start;
+    *start = PCA9685_LED0 + first * 4;
+    esp_err_t ret = i2c_master_transmit(device, start, 1 + (last - first + 1) * 4, PCA9685_TIMEOUT_MS);
+    *start = saved;
+    return ret;
+}
+
+static bool expander_apply(actuator_driver_t *driver, const actuator_setpoint_t *setpoints, int count)
+{
+    int first = PCA9685_CHANNELS;
+    int last = -1;
+
+    for (int i = 0; i < count; i++) {
+        int channel = setpoints[i].output;
+        if (channel >= driver->outputs) {
+            continue;
+        }
+        stage(channel, setpoints[i].duty);
+        if (channel < first) first = channel;
+        if (channel > last) last = channel;
+    }
+    if (last < 0) {
+        return true;
+    }
+
+    esp_err_t ret = write_span(first, last);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "PCA9685 write failed: %s", esp_err_to_name(ret));
+    }
+    return ret == ESP_OK;
+}
+
+static esp_err_t write_reg(uint8_t reg, uint8_t value)
+{
+    uint8_t buffer[2] = { reg, value };
+    return i2c_master_transmit(device, buffer, sizeof(buffer), PCA9685_TIMEOUT_MS);
+}
+
+bool actuator_expander_init(actuator_driver_t *driver, const actuator_expander_config_t *config,
+                            const uint16_t *initial)
+{
+    memset(driver, 0, sizeof(*driver));
+    driver->name = "pca9685";
+    driver->apply = expander_apply;
+
+    i2c_master_bus_handle_t bus;
+    i2c_master_bus_config_t bus_config = {
+        .i2c_port = -1,
+        .sda_io_num = config->sda_gpio,
+        .scl_io_num = config->scl_gpio,
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .glitch_ignore_cnt = 7,
+        .flags.enable_internal_pullup = true,
+    };
+    i2c_device_config_t dev_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = config->address,
+        .scl_speed_hz = config->scl_hz,
+    };
+
+    // Prescaler can only be written while the oscillator sleeps
+    uint32_t prescale = (PCA9685_OSC_HZ + 2048 * config->pwm_hz) / (4096 * config->pwm_hz) - 1;
+    if (prescale < 3) prescale = 3;
+    if (prescale > 255) prescale = 255;
+
+    esp_err_t ret;
+    if ((ret = i2c_new_master_bus(&bus_config, &bus)) != ESP_OK ||
+        (ret = i2c_master_bus_add_device(bus, &dev_config, &device)) != ESP_OK ||
+        (ret = write_reg(PCA9685_MODE1, MODE1_AI | MODE1_SLEEP)) != ESP_OK ||
+        (ret = write_reg(PCA9685_PRESCALE, (uint8_t)prescale)) != ESP_OK ||
+        (ret = write_reg(PCA9685_MODE2, MODE2_OUTDRV)) != ESP_OK ||
+        (ret = write_reg(PCA9685_MODE1, MODE1_AI)) != ESP_OK) {
+        ESP_LOGE(TAG, "PCA9685 at 0x%02x failed: %s", config->address, esp_err_to_name(ret));
+        return false;
+    }
+    esp_rom_delay_us(500);  // Oscillator start-up
+
+    for (int i = 0; i < PCA9685_CHANNELS; i++) {
+        stage(i, initial ? initial[i] : 0);
+    }
+    if ((ret = write_span(0, PCA9685_CHANNELS - 1)) != ESP_OK) {
+        ESP_LOGE(TAG, "PCA9685 initial duties failed: %s", esp_err_to_name(ret));
+        return false;
+    }
+
+    driver->outputs = PCA9685_CHANNELS;
+    return true;
+}
@@ -0,0 +1,122 @@
+#include "actuator.h"
+#include <string.h>
+#include "driver/ledc.h"
+#include "soc/soc_caps.h"
+#include "esp_log.h"
+
+#define TAG "actuator"
+
+#if SOC_LEDC_SUPPORT_HS_MODE
+#define LEDC_OUTPUTS (2 * LEDC_CHANNEL_MAX)
+#else
+#define LEDC_OUTPUTS LEDC_CHANNEL_MAX
+#endif
+
+_Static_assert(LEDC_TIMER_13_BIT == ACTUATOR_DUTY_BITS, "LEDC runs at the actuator resolution");
+
+// Last duty set per output, so unchanged outputs cost nothing
+static uint16_t ledc_duty[ACTUATOR_MAX_OUTPUTS];
+
+// Outputs 0..LEDC_CHANNEL_MAX-1 are low-speed channels, the rest high-speed
+static void output_channel(int output, ledc_mode_t *mode, ledc_channel_t *channel)
+{
+#if SOC_LEDC_SUPPORT_HS_MODE
+    if (output >= LEDC_CHANNEL_MAX) {
+        *mode = LEDC_HIGH_SPEED_MODE;
+        *channel = (ledc_channel_t)(output - LEDC_CHANNEL_MAX);
+        return;
+    }
+#endif
+    *mode = LEDC_LOW_SPEED_MODE;
+    *channel = (ledc_channel_t)output;
+}
+
+static bool ledc_apply(actuator_driver_t *driver, const actuator_setpoint_t *setpoints, int count)
+{
+    uint32_t staged = 0;  // Bit per output
+
+    // Stage every duty, then latch; each channel picks its new duty up at
+    // the start of its next PWM period
+    for (int i = 0; i < count; i++) {
+        int output = setpoints[i].output;
+        uint16_t duty = setpoints[i].duty > ACTUATOR_DUTY_MAX ? ACTUATOR_DUTY_MAX : setpoints[i].duty;
+        if (output >= driver->outputs || (ledc_duty[output] == duty && !(staged & (1u << output)))) {
+            continue;
+        }
+        ledc_mode_t mode;
+        ledc_channel_t channel;
+        output_channel(output, &mode, &channel);
+        ledc_set_duty(mode, channel, duty);
+        ledc_duty[output] = duty;
+        staged |= 1u << output;
+    }
+
+    for (int output = 0; staged; output++, staged >>= 1) {
+        if (staged & 1) {
+            ledc_mode_t mode;
+            ledc_channel_t channel;
+            output_channel(output, &mode, &channel);
+            ledc_update_duty(mode, channel);
+        }
+    }
+    return true;
+}
+
+bool actuator_ledc_init(actuator_driver_t *driver, const int *gpios, int count, uint32_t freq_hz,
+                        const uint16_t *initial)
+{
+    memset(driver, 0, sizeof(*driver));
+    driver->name = "ledc";
+    driver->apply = ledc_apply;
+
+    if (count > LEDC_OUTPUTS) count = LEDC_OUTPUTS;
+    if (count > ACTUATOR_MAX_OUTPUTS) count = ACTUATOR_MAX_OUTPUTS;
+
+    // One timer per speed mode in use
+    for (int mode = 0; mode < LEDC_SPEED_MODE_MAX; mode++) {
+#if SOC_LEDC_SUPPORT_HS_MODE
+        bool used = mode == LEDC_LOW_SPEED_MODE ? count > 0 : count > LEDC_CHANNEL_MAX;
+#else
+        bool used = count > 0;
+#endif
+        if (!used) {
+            continue;
+        }
+        ledc_timer_config_t timer_config = {
+            .speed_mode = (ledc_mode_t)mode,
+            .duty_resolution = LEDC_TIMER_13_BIT,
+            .timer_num = LEDC_TIMER_0,
+            .freq_hz = freq_hz,
+            .clk_cfg = LEDC_AUTO_CLK
+        };
+        esp_err_t ret = ledc_timer_config(&timer_config);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "LEDC timer (mode %d) failed: %s", mode, esp_err_to_name(ret));
+            return false;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        ledc_mode_t mode;
+        ledc_channel_t channel;
+        output_channel(i, &mode, &channel);
+        ledc_duty[i] = initial ? initial[i] : 0;
+        ledc_channel_config_t channel_config = {
+            .speed_mode = mode,
+            .channel = channel,
+            .timer_sel = LEDC_TIMER_0,
+            .intr_type = LEDC_INTR_DISABLE,
+            .gpio_num = gpios[i],
+            .duty = ledc_duty[i],
+            .hpoint = 0
+        };
+        esp_err_t ret = ledc_channel_config(&channel_config);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "LEDC output %d on GPIO %d failed: %s", i, gpios[i], esp_err_to_name(ret));
+            return false;
+        }
+    }
+
+    driver->outputs = count;
+    return true;
+}
@@ -0,0 +1,128 @@
+#include "actuator.h"
+#include <string.h>
+#include "driver/mcpwm_prelude.h"
+#include "soc/soc_caps.h"
+#include "esp_log.h"
+
+#define TAG "actuator"
+
+#define MCPWM_RESOLUTION_HZ 10000000    // 0.1 µs ticks
+#define MCPWM_OUTPUTS_PER_GROUP (SOC_MCPWM_OPERATORS_PER_GROUP * SOC_MCPWM_COMPARATORS_PER_OPERATOR)
+#define MCPWM_OUTPUTS (SOC_MCPWM_GROUPS * MCPWM_OUTPUTS_PER_GROUP)
+
+static mcpwm_cmpr_handle_t comparators[ACTUATOR_MAX_OUTPUTS];
+static uint32_t period_ticks;
+
+static uint32_t compare_ticks(uint16_t duty)
+{
+    if (duty > ACTUATOR_DUTY_MAX) {
+        duty = ACTUATOR_DUTY_MAX;
+    }
+    return (uint32_t)(((uint64_t)duty * period_ticks) / ACTUATOR_DUTY_MAX);
+}
+
+// Compare values are shadowed and load at timer zero, so a batch written
+// within one period takes effect on every output at the same edge
+static bool mcpwm_apply(actuator_driver_t *driver, const actuator_setpoint_t *setpoints, int count)
+{
+    bool ok = true;
+
+    for (int i = 0; i < count; i++) {
+        if (setpoints[i].output >= driver->outputs) {
+            continue;
+        }
+        ok &= mcpwm_comparator_set_compare_value(comparators[setpoints[i].output],
+                                                 compare_ticks(setpoints[i].duty)) == ESP_OK;
+    }
+    return ok;
+}
+
+// Output i: group i / MCPWM_OUTPUTS_PER_GROUP, two comparator/generator
+// pairs per operator
+static esp_err_t add_output(int i, int gpio, uint16_t duty, mcpwm_timer_handle_t timer, mcpwm_oper_handle_t *oper)
+{
+    esp_err_t ret;
+
+    if (i % SOC_MCPWM_COMPARATORS_PER_OPERATOR == 0) {
+        mcpwm_operator_config_t oper_config = {
+            .group_id = i / MCPWM_OUTPUTS_PER_GROUP,
+        };
+        if ((ret = mcpwm_new_operator(&oper_config, oper)) != ESP_OK ||
+            (ret = mcpwm_operator_connect_timer(*oper, timer)) != ESP_OK) {
+            return ret;
+        }
+    }
+
+    mcpwm_comparator_config_t cmpr_config = {
+        .flags.update_cmp_on_tez = true,
+    };
+    if ((ret = mcpwm_new_comparator(*oper, &cmpr_config, &comparators[i])) != ESP_OK) {
+        return ret;
+    }
+
+    mcpwm_gen_handle_t generator;
+    mcpwm_generator_config_t gen_config = {
+        .gen_gpio_num = gpio,
+    };
+    if ((ret = mcpwm_new_generator(*oper, &gen_config, &generator)) != ESP_OK ||
+        (ret = mcpwm_comparator_set_compare_value(comparators[i], compare_ticks(duty))) != ESP_OK) {
+        return ret;
+    }
+
+    // High from the start of the period until the compare value
+    if ((ret = mcpwm_generator_set_action_on_timer_event(generator,
+            MCPWM_GEN_TIMER_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP, MCPWM_TIMER_EVENT_EMPTY, MCPWM_GEN_ACTION_HIGH))) != ESP_OK) {
+        return ret;
+    }
+    return mcpwm_generator_set_action_on_compare_event(generator,
+            MCPWM_GEN_COMPARE_EVENT_ACTION(MCPWM_TIMER_DIRECTION_UP, comparators[i], MCPWM_GEN_ACTION_LOW));
+}
+
+bool actuator_mcpwm_init(actuator_driver_t *driver, const int *gpios, int count, uint32_t freq_hz,
+                         const uint16_t *initial)
+{
+    mcpwm_timer_handle_t timers[SOC_MCPWM_GROUPS] = {0};
+    mcpwm_oper_handle_t oper = NULL;
+
+    memset(driver, 0, sizeof(*driver));
+    driver->name = "mcpwm";
+    driver->apply = mcpwm_apply;
+
+    if (count > MCPWM_OUTPUTS) count = MCPWM_OUTPUTS;
+    if (count > ACTUATOR_MAX_OUTPUTS) count = ACTUATOR_MAX_OUTPUTS;
+    period_ticks = MCPWM_RESOLUTION_HZ / (freq_hz ? freq_hz : 1000);
+
+    for (int i = 0; i < count; i++) {
+        int group = i / MCPWM_OUTPUTS_PER_GROUP;
+        esp_err_t ret = ESP_OK;
+
+        if (!timers[group]) {
+            mcpwm_timer_config_t timer_config = {
+                .group_id = group,
+                .clk_src = MCPWM_TIMER_CLK_SRC_DEFAULT,
+                .resolution_hz = MCPWM_RESOLUTION_HZ,
+                .period_ticks = period_ticks,
+                .count_mode = MCPWM_TIMER_COUNT_MODE_UP,
+            };
+            ret = mcpwm_new_timer(&timer_config, &timers[group]);
+        }
+        if (ret == ESP_OK) {
+            ret = add_output(i, gpios[i], initial ? initial[i] : 0, timers[group], &oper);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "MCPWM output %d on GPIO %d failed: %s", i, gpios[i], esp_err_to_name(ret));
+            return false;
+        }
+    }
+
+    for (int group = 0; group < SOC_MCPWM_GROUPS; group++) {
+        if (timers[group] && (mcpwm_timer_enable(timers[group]) != ESP_OK ||
+                              mcpwm_timer_start_stop(timers[group], MCPWM_TIMER_START_NO_STOP) != ESP_OK)) {
+            ESP_LOGE(TAG, "MCPWM timer %d failed to start", group);
+            return false;
+        }
+    }
+
+    driver->outputs = count;
+    return true;
+}
@@ -0,0 +1,30 @@
+#include "actuator.h"
+#include <string.h>
+
+static bool mock_apply(actuator_driver_t *driver, const actuator_setpoint_t *setpoints, int count)
+{
+    actuator_mock_t *mock = driver->ctx;
+
+    for (int i = 0; i < count; i++) {
+        if (setpoints[i].output >= driver->outputs) {
+            continue;
+        }
+        mock->duties[setpoints[i].output] =
+            setpoints[i].duty > ACTUATOR_DUTY_MAX ? ACTUATOR_DUTY_MAX : setpoints[i].duty;
+        mock->writes++;
+    }
+    mock->applies++;
+    return true;
+}
+
+void actuator_mock_init(actuator_driver_t *driver, actuator_mock_t *mock, uint16_t *duties, int outputs)
+{
+    memset(mock, 0, sizeof(*mock));
+    mock->duties = duties;
+    memset(duties, 0, sizeof(*duties) * (outputs > 0 ? outputs : 0));
+
+    driver->name = "mock";
+    driver->outputs = outputs > 0 ? outputs : 0;
+    driver->apply = mock_apply;
+    driver->ctx = mock;
+}
@@ -0,0 +1,275 @@
+#include "adc_sense.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#ifndef CONFIG_POWER_GRID_SENSE
+#define CONFIG_POWER_GRID_SENSE 0
+#endif
+#ifndef CONFIG_POWER_GRID_SENSE_CHANNELS
+#define CONFIG_POWER_GRID_SENSE_CHANNELS "0,3,6,7"
+#endif
+#ifndef CONFIG_POWER_GRID_SENSE_SAMPLE_HZ
+#define CONFIG_POWER_GRID_SENSE_SAMPLE_HZ 20000
+#endif
+#ifndef CONFIG_POWER_GRID_SENSE_ZERO_CODE
+#define CONFIG_POWER_GRID_SENSE_ZERO_CODE 2048
+#endif
+#ifndef CONFIG_POWER_GRID_SENSE_UA_PER_CODE
+#define CONFIG_POWER_GRID_SENSE_UA_PER_CODE 2000
+#endif
+#ifndef CONFIG_POWER_GRID_SENSE_DECIMATION
+#define CONFIG_POWER_GRID_SENSE_DECIMATION 8
+#endif
+#ifndef CONFIG_POWER_GRID_SENSE_TASK_PRIORITY
+#define CONFIG_POWER_GRID_SENSE_TASK_PRIORITY 6
+#endif
+
+#define TAG "adc_sense"
+
+static adc_continuous_handle_t adc_handle;
+static TaskHandle_t sense_task_handle;
+static sense_t sense;
+static sense_window_t last_window;
+static adc_sense_stats_t stats;
+// A frame takes the filter bank a few hundred µs, too long to mask
+// interrupts for: sense is guarded by a mutex, and the spinlock only covers
+// the copies published from it (stats, last_window)
+static SemaphoreHandle_t sense_mutex;
+static portMUX_TYPE sense_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static bool IRAM_ATTR on_conv_done(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data)
+{
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(sense_task_handle, &woken);
+    return woken == pdTRUE;
+}
+
+static bool IRAM_ATTR on_pool_ovf(adc_continuous_handle_t handle, const adc_continuous_evt_data_t *edata, void *user_data)
+{
+    stats.overflows++;
+    return false;
+}
+
+static void sense_task(void *arg)
+{
+    static uint8_t frame[ADC_SENSE_FRAME_BYTES];
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Drain every completed frame
+        uint32_t len = 0;
+        while (adc_continuous_read(adc_handle, frame, sizeof(frame), &len, 0) == ESP_OK) {
+            xSemaphoreTake(sense_mutex, portMAX_DELAY);
+            sense_feed(&sense, frame, len);
+            uint32_t stray = sense.stray;
+            xSemaphoreGive(sense_mutex);
+
+            portENTER_CRITICAL(&sense_lock);
+            stats.frames++;
+            stats.stray = stray;
+            portEXIT_CRITICAL(&sense_lock);
+        }
+    }
+}
+
+bool adc_sense_start(void)
+{
+    if (!CONFIG_POWER_GRID_SENSE) {
+        return false;
+    }
+
+    // Comma-separated ADC1 channel list, sense index i = i-th entry
+    uint8_t channels[SENSE_MAX_CHANNELS];
+    int count = 0;
+    const char *p = CONFIG_POWER_GRID_SENSE_CHANNELS;
+    while (*p && count < SENSE_MAX_CHANNELS) {
+        char *end;
+        long channel = strtol(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        channels[count++] = (uint8_t)channel;
+        p = end + strspn(end, ", ");
+    }
+    if (count == 0) {
+        ESP_LOGW(TAG, "No sense channels configured");
+        return false;
+    }
+
+    sense_mutex = xSemaphoreCreateMutex();
+    sense_init(&sense, channels, count, CONFIG_POWER_GRID_SENSE_ZERO_CODE,
+               CONFIG_POWER_GRID_SENSE_UA_PER_CODE * 1e-6f, CONFIG_POWER_GRID_SENSE_DECIMATION);
+
+    adc_continuous_handle_cfg_t handle_config = {
+        .max_store_buf_size = 2 * ADC_SENSE_FRAME_BYTES,
+        .conv_frame_size = ADC_SENSE_FRAME_BYTES,
+    };
+    adc_digi_pattern_config_t pattern[SENSE_MAX_CHANNELS];
+    for (int i = 0; i < count; i++) {
+        pattern[i] = (adc_digi_pattern_config_t){
+            .atten = ADC_ATTEN_DB_12,
+            .channel = channels[i],
+            .unit = ADC_UNIT_1,
+            .bit_width = ADC_BITWIDTH_12,
+        };
+    }
+    adc_continuous_config_t adc_config = {
+        .pattern_num = count,
+        .adc_pattern = pattern,
+        .sample_freq_hz = CONFIG_POWER_GRID_SENSE_SAMPLE_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+    adc_continuous_evt_cbs_t callbacks = {
+        .on_conv_done = on_conv_done,
+        .on_pool_ovf = on_pool_ovf,
+    };
+
+    xTaskCreate(sense_task, "adc_sense", 3072, NULL, CONFIG_POWER_GRID_SENSE_TASK_PRIORITY, &sense_task_handle);
+
+    esp_err_t ret;
+    if ((ret = adc_continuous_new_handle(&handle_config, &adc_handle)) != ESP_OK ||
+        (ret = adc_continuous_config(adc_handle, &adc_config)) != ESP_OK ||
+        (ret = adc_continuous_register_event_callbacks(adc_handle, &callbacks, NULL)) != ESP_OK ||
+        (ret = adc_continuous_start(adc_handle)) != ESP_OK) {
+        ESP_LOGE(TAG, "Continuous ADC start failed: %s", esp_err_to_name(ret));
+        vTaskDelete(sense_task_handle);
+        sense_task_handle = NULL;
+        return false;
+    }
+
+    portENTER_CRITICAL(&sense_lock);
+    stats.running = true;
+    stats.channels = count;
+    stats.sample_hz = CONFIG_POWER_GRID_SENSE_SAMPLE_HZ;
+    stats.decimation = CONFIG_POWER_GRID_SENSE_DECIMATION;
+    portEXIT_CRITICAL(&sense_lock);
+
+    ESP_LOGI(TAG, "Sensing %d channel(s) (%s) at %d Hz aggregate, decimated by %d", count,
+             CONFIG_POWER_GRID_SENSE_CHANNELS, CONFIG_POWER_GRID_SENSE_SAMPLE_HZ, CONFIG_POWER_GRID_SENSE_DECIMATION);
+    return true;
+}
+
+bool adc_sense_take_window(sense_window_t *window)
+{
+    bool running;
+
+    portENTER_CRITICAL(&sense_lock);
+    running = stats.running;
+    portEXIT_CRITICAL(&sense_lock);
+    if (!running) {
+        return false;
+    }
+
+    xSemaphoreTake(sense_mutex, portMAX_DELAY);
+    sense_take_window(&sense, window);
+    xSemaphoreGive(sense_mutex);
+
+    portENTER_CRITICAL(&sense_lock);
+    last_window = *window;
+    portEXIT_CRITICAL(&sense_lock);
+
+    return true;
+}
+
+void adc_sense_get_stats(adc_sense_stats_t *out)
+{
+    portENTER_CRITICAL(&sense_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&sense_lock);
+}
+
+size_t adc_sense_to_json(char *buffer, size_t size)
+{
+    adc_sense_stats_t snapshot;
+    sense_window_t window;
+
+    if (size == 0) {
+        return 0;
+    }
+
+    portENTER_CRITICAL(&sense_lock);
+    snapshot = stats;
+    window = last_window;
+    portEXIT_CRITICAL(&sense_lock);
+
+    size_t len = snprintf(buffer, size,
+                          "{\"running\":%s,\"channels\":%d,\"sample_hz\":%u,\"decimation\":%d,\"frames\":%u,"
+                          "\"overflows\":%u,\"stray\":%u,\"window\":[",
+                          snapshot.running ? "true" : "false", snapshot.channels, (unsigned)snapshot.sample_hz,
+                          snapshot.decimation, (unsigned)snapshot.frames, (unsigned)snapshot.overflows, (unsigned)snapshot.stray);
+    for (int i = 0; i < window.channels && len < size; i++) {
+        len += snprintf(buffer + len, size - len, "%s{\"rms_a\":%.3f,\"mean_a\":%.3f,\"min_a\":%.3f,\"max_a\":%.3f,\"samples\":%u}",
+                        i ? "," : "", window.rms_amps[i], window.mean_amps[i], window.min_amps[i],
+                        window.max_amps[i], (unsigned)window.samples[i]);
+    }
+    if (len < size) {
+        len += snprintf(buffer + len, size - len, "]}");
+    }
+
+    return len < size ? len : size - 1;
+}
+
+size_t adc_sense_bench_to_json(char *buffer, size_t size, int channels)
+{
+    // Private pipeline state, so the bench never touches the live windows;
+    // static because a sense_t is too big for the httpd stack
+    static sense_t bench;
+    static uint8_t frame[ADC_SENSE_FRAME_BYTES];
+    static int32_t scans[SENSE_BLOCK_SCANS][FILTER_BANK_LANES];
+    uint8_t adc_channels[SENSE_MAX_CHANNELS];
+    size_t words = sizeof(frame) / 2;
+
+    if (size == 0) {
+        return 0;
+    }
+    if (channels < 1) channels = 1;
+    if (channels > SENSE_MAX_CHANNELS) channels = SENSE_MAX_CHANNELS;
+
+    // Sawtooth codes around mid-rail, channels scanned in order
+    for (int i = 0; i < channels; i++) {
+        adc_channels[i] = (uint8_t)i;
+    }
+    for (size_t w = 0; w < words; w++) {
+        uint16_t word = sense_pack_word((uint8_t)(w % channels), (uint16_t)(1024 + (w * 37) % 2048));
+        frame[2 * w] = (uint8_t)(word & 0xFF);
+        frame[2 * w + 1] = (uint8_t)(word >> 8);
+    }
+    for (int s = 0; s < SENSE_BLOCK_SCANS; s++) {
+        for (int l = 0; l < FILTER_BANK_LANES; l++) {
+            scans[s][l] = l < channels ? (s * 37 + l * 101) % 2048 - 1024 : 0;
+        }
+    }
+    sense_init(&bench, adc_channels, channels, 2048, 1e-3f, CONFIG_POWER_GRID_SENSE_DECIMATION);
+
+    // Best of several passes, to leave out interrupts and cache misses
+    uint32_t feed_cycles = UINT32_MAX;
+    uint32_t filter_cycles = UINT32_MAX;
+    for (int pass = 0; pass < 8; pass++) {
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        sense_feed(&bench, frame, sizeof(frame));
+        uint32_t t1 = esp_cpu_get_cycle_count();
+        filter_bank_feed(&bench.bank, (const int32_t (*)[FILTER_BANK_LANES])scans, SENSE_BLOCK_SCANS);
+        uint32_t t2 = esp_cpu_get_cycle_count();
+        feed_cycles = t1 - t0 < feed_cycles ? t1 - t0 : feed_cycles;
+        filter_cycles = t2 - t1 < filter_cycles ? t2 - t1 : filter_cycles;
+    }
+
+    size_t len = snprintf(buffer, size,
+                          "{\"channels\":%d,\"decimation\":%d,\"frame_samples\":%u,"
+                          "\"feed_cycles_per_sample\":%.2f,\"filter_cycles_per_sample\":%.2f}",
+                          channels, CONFIG_POWER_GRID_SENSE_DECIMATION, (unsigned)words,
+                          (double)feed_cycles / words,
+                          (double)filter_cycles / (SENSE_BLOCK_SCANS * channels));
+    return len < size ? len : size - 1;
+}
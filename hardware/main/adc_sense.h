@@ -0,0 +1,78 @@
+#ifndef ADC_SENSE_H
+#define ADC_SENSE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "sense.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Continuous (DMA) ADC current sensing.
+ *
+ * The ADC scans the configured channels at CONFIG_POWER_GRID_SENSE_SAMPLE_HZ
+ * (aggregate) and DMA fills ADC_SENSE_FRAME_BYTES conversion frames into a
+ * two-frame pool, so one frame is drained while the next fills. The
+ * conversion-done ISR only notifies the sense task once per frame; no code
+ * runs per sample. The task feeds each frame to sense.c, which decimates it
+ * through the filter bank, and every telemetry tick takes the window (min,
+ * max, mean and RMS current per channel).
+ *
+ * Sense channel i measures the current through actuator output i.
+ */
+
+#define ADC_SENSE_FRAME_BYTES 1024  // 512 samples per wakeup
+
+typedef struct {
+    bool running;
+    int channels;
+    uint32_t sample_hz;
+    int decimation;         // Scans per filter bank output
+    uint32_t frames;        // DMA frames processed
+    uint32_t overflows;     // Frames lost because the task fell behind
+    uint32_t stray;         // Samples from unconfigured channels
+} adc_sense_stats_t;
+
+/**
+ * @brief Configure and start sampling; no-op when sensing is disabled
+ *
+ * @return true if sampling is running
+ */
+bool adc_sense_start(void);
+
+/**
+ * @brief Take the window accumulated since the previous call
+ *
+ * @return false if sensing is not running (window left untouched)
+ */
+bool adc_sense_take_window(sense_window_t *window);
+
+void adc_sense_get_stats(adc_sense_stats_t *stats);
+
+/**
+ * @brief Write stats and the last window as JSON
+ *
+ * @return Length of the JSON text (truncated to size - 1)
+ */
+size_t adc_sense_to_json(char *buffer, size_t size);
+
+/**
+ * @brief Time the pipeline on a synthetic frame, in CPU cycles
+ *
+ * Runs on private state, so it works with sensing disabled. Reports the full
+ * path (frame decode, scan assembly and filter) and the filter bank alone,
+ * both per sample of one channel.
+ *
+ * @param channels Channels in the synthetic scan (1..SENSE_MAX_CHANNELS)
+ * @return Length of the JSON text (truncated to size - 1)
+ */
+size_t adc_sense_bench_to_json(char *buffer, size_t size, int channels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ADC_SENSE_H
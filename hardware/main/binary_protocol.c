@@ -8,27 +8,52 @@ size_t encode_telemetry(const telemetry_packet_t *packet, uint8_t *buffer)
         return 0;
     }
     
+    // Ids above 255 need the wide frame, optional fields the stats frame;
+    // everything else stays on GRID. Delta frames always use wide records.
+    bool delta = packet->magic == TELEMETRY_DELTA_MAGIC;
+    bool wide = delta;
+    bool stats = false;
+    for (int i = 0; i < packet->node_count; i++) {
+        wide |= packet->nodes[i].id > 0xFF;
+        stats |= (packet->nodes[i].fields & TELEMETRY_FIELDS_ALL) != 0;
+    }
+    wide |= stats;
+
     size_t offset = 0;
     
     // Magic (4 bytes, little-endian)
-    uint32_t magic = TELEMETRY_MAGIC;
+    uint32_t magic = delta ? TELEMETRY_DELTA_MAGIC : stats ? TELEMETRY_STATS_MAGIC :
+                     wide ? TELEMETRY_WIDE_MAGIC : TELEMETRY_MAGIC;
     memcpy(buffer + offset, &magic, 4);
     offset += 4;
     
-    // Timestamp (4 bytes, little-endian)
-    memcpy(buffer + offset, &packet->timestamp, 4);
-    offset += 4;
+    // Timestamp (8 bytes, little-endian)
+    memcpy(buffer + offset, &packet->timestamp_us, 8);
+    offset += 8;
+
+    if (delta) {
+        memcpy(buffer + offset, &packet->seq, 2);           // Sequence (2 bytes)
+        offset += 2;
+        buffer[offset] = (uint8_t)((packet->flags & TELEMETRY_DELTA_KEYFRAME) |
+                                   (stats ? TELEMETRY_DELTA_FIELDS : 0));  // Flags (1 byte)
+        offset += 1;
+    }
     
     // Node count (1 byte)
     buffer[offset] = packet->node_count;
     offset += 1;
     
-    // Nodes (9 bytes each)
+    // Nodes (10 bytes each, 11 when wide)
     for (int i = 0; i < packet->node_count; i++) {
         const telemetry_node_t *node = &packet->nodes[i];
         
-        buffer[offset] = node->id;              // ID (1 byte)
-        offset += 1;
+        if (wide) {
+            memcpy(buffer + offset, &node->id, 2);  // ID (2 bytes)
+            offset += 2;
+        } else {
+            buffer[offset] = (uint8_t)node->id;     // ID (1 byte)
+            offset += 1;
+        }
         
         buffer[offset] = node->type;            // Type (1 byte)
         offset += 1;
@@ -38,6 +63,208 @@ size_t encode_telemetry(const telemetry_packet_t *packet, uint8_t *buffer)
         
         memcpy(buffer + offset, &node->fulfillment, 4); // Fulfillment (4 bytes)
         offset += 4;
+
+        if (stats) {
+            uint8_t fields = node->fields & TELEMETRY_FIELDS_ALL;
+            buffer[offset] = fields;                    // Fields (1 byte)
+            offset += 1;
+            for (int f = 0; f < TELEMETRY_FIELD_COUNT; f++) {
+                if (fields & (1 << f)) {
+                    memcpy(buffer + offset, &node->field[f], 4);  // Field (4 bytes)
+                    offset += 4;
+                }
+            }
+        }
+    }
+    
+    return offset;
+}
+
+bool decode_telemetry(const uint8_t *data, size_t size, telemetry_packet_t *packet)
+{
+    if (!data || !packet || size < 13) {
+        return false;
+    }
+    
+    size_t offset = 0;
+    
+    // Check magic (4 bytes)
+    uint32_t magic;
+    memcpy(&magic, data + offset, 4);
+    offset += 4;
+    
+    if (magic != TELEMETRY_MAGIC && magic != TELEMETRY_WIDE_MAGIC && magic != TELEMETRY_STATS_MAGIC &&
+        magic != TELEMETRY_DELTA_MAGIC) {
+        return false;
+    }
+    bool delta = magic == TELEMETRY_DELTA_MAGIC;
+    bool stats = magic == TELEMETRY_STATS_MAGIC;
+    bool wide = magic != TELEMETRY_MAGIC;
+    
+    // Timestamp (8 bytes)
+    memcpy(&packet->timestamp_us, data + offset, 8);
+    offset += 8;
+
+    packet->seq = 0;
+    packet->flags = 0;
+    if (delta) {
+        if (size < TELEMETRY_DELTA_HEADER_SIZE) {
+            return false;
+        }
+        memcpy(&packet->seq, data + offset, 2);             // Sequence (2 bytes)
+        offset += 2;
+        packet->flags = data[offset];                       // Flags (1 byte)
+        offset += 1;
+        if (packet->flags & ~(TELEMETRY_DELTA_KEYFRAME | TELEMETRY_DELTA_FIELDS)) {
+            return false;
+        }
+        stats = packet->flags & TELEMETRY_DELTA_FIELDS;
+    }
+    
+    // Node count (1 byte)
+    uint8_t node_count = data[offset];
+    offset += 1;
+    
+    // Validate size; stats frames are variable and checked per node
+    size_t expected_size = (wide ? telemetry_wide_packet_size(node_count) : telemetry_packet_size(node_count)) +
+                           (delta ? TELEMETRY_DELTA_HEADER_SIZE - 13 : 0);
+    if (stats ? size < expected_size + node_count : size != expected_size) {
+        return false;
+    }
+    if (node_count > MAX_NODES_PER_PACKET) {
+        return false;
+    }
+    
+    packet->magic = magic;
+    packet->node_count = node_count;
+    
+    // Parse nodes (10 bytes each, 11 when wide, 12 + 4 per field with stats)
+    for (int i = 0; i < node_count; i++) {
+        telemetry_node_t *node = &packet->nodes[i];
+        
+        if (offset + (wide ? 11 : 10) > size) {
+            return false;                                   // Earlier fields ran into this node
+        }
+        
+        if (wide) {
+            memcpy(&node->id, data + offset, 2);            // ID (2 bytes)
+            offset += 2;
+        } else {
+            node->id = data[offset];                        // ID (1 byte)
+            offset += 1;
+        }
+        
+        node->type = data[offset];                          // Type (1 byte)
+        offset += 1;
+        
+        memcpy(&node->demand, data + offset, 4);            // Demand (4 bytes)
+        offset += 4;
+        
+        memcpy(&node->fulfillment, data + offset, 4);       // Fulfillment (4 bytes)
+        offset += 4;
+
+        node->fields = 0;
+        if (stats) {
+            if (offset + 1 > size) {
+                return false;
+            }
+            uint8_t fields = data[offset];                  // Fields (1 byte)
+            offset += 1;
+            if (fields & ~TELEMETRY_FIELDS_ALL) {
+                return false;
+            }
+            for (int f = 0; f < TELEMETRY_FIELD_COUNT; f++) {
+                if (fields & (1 << f)) {
+                    if (offset + 4 > size) {
+                        return false;
+                    }
+                    memcpy(&node->field[f], data + offset, 4);  // Field (4 bytes)
+                    offset += 4;
+                }
+            }
+            node->fields = fields;
+        }
+    }
+    
+    return offset == size;
+}
+
+void telemetry_state_init(telemetry_state_t *state)
+{
+    memset(state, 0, sizeof(*state));
+}
+
+bool telemetry_state_apply(telemetry_state_t *state, const telemetry_packet_t *packet)
+{
+    bool delta = packet->magic == TELEMETRY_DELTA_MAGIC;
+
+    if (!delta || (packet->flags & TELEMETRY_DELTA_KEYFRAME)) {
+        memcpy(&state->packet, packet, sizeof(*packet));
+        state->seq = packet->seq;
+        state->synced = true;
+        state->keyframes++;
+        return true;
+    }
+
+    if (!state->synced || packet->seq != (uint16_t)(state->seq + 1)) {
+        state->gaps += state->synced;
+        state->synced = false;
+        return false;
+    }
+
+    // Merge by id; linear search, nodes per frame are few
+    telemetry_packet_t *current = &state->packet;
+    for (int i = 0; i < packet->node_count; i++) {
+        const telemetry_node_t *node = &packet->nodes[i];
+        int j = 0;
+        while (j < current->node_count && current->nodes[j].id != node->id) {
+            j++;
+        }
+        if (j == current->node_count) {
+            if (current->node_count == MAX_NODES_PER_PACKET) {
+                state->gaps++;
+                state->synced = false;
+                return false;
+            }
+            current->node_count++;
+        }
+        current->nodes[j] = *node;
+    }
+    current->timestamp_us = packet->timestamp_us;
+    state->seq = packet->seq;
+    state->deltas++;
+    return true;
+}
+
+size_t encode_dispatch(const dispatch_packet_t *packet, uint8_t *buffer)
+{
+    if (!packet || !buffer) {
+        return 0;
+    }
+    
+    size_t offset = 0;
+    
+    // Magic (4 bytes, little-endian)
+    uint32_t magic = DISPATCH_MAGIC;
+    memcpy(buffer + offset, &magic, 4);
+    offset += 4;
+    
+    // Node count (1 byte)
+    buffer[offset] = packet->node_count;
+    offset += 1;
+    
+    // Nodes (6 bytes each)
+    for (int i = 0; i < packet->node_count; i++) {
+        const dispatch_node_t *node = &packet->nodes[i];
+        
+        buffer[offset] = node->id;                      // ID (1 byte)
+        offset += 1;
+        
+        memcpy(buffer + offset, &node->supply, 4);      // Supply (4 bytes)
+        offset += 4;
+        
+        buffer[offset] = node->source;                  // Source (1 byte)
+        offset += 1;
     }
     
     return offset;
@@ -89,3 +316,373 @@ bool decode_dispatch(const uint8_t *data, size_t size, dispatch_packet_t *packet
     
     return true;
 }
+
+size_t encode_dispatch_dense(uint16_t base, const uint16_t *duties, uint16_t count,
+                             const uint8_t *changed, uint8_t *buffer, size_t size)
+{
+    if ((!duties && count > 0) || !buffer || (uint32_t)base + count > 65536 ||
+        size < DISPATCH_DENSE_HEADER_SIZE) {
+        return 0;
+    }
+
+    uint32_t magic = DISPATCH_DENSE_MAGIC;
+    memcpy(buffer, &magic, 4);                  // Magic (4 bytes)
+    memcpy(buffer + 4, &base, 2);               // Base node id (2 bytes)
+    memcpy(buffer + 6, &count, 2);              // Node span (2 bytes)
+    buffer[8] = changed ? DISPATCH_DENSE_SPARSE : 0;
+    size_t offset = DISPATCH_DENSE_HEADER_SIZE;
+
+    if (!changed) {
+        if (size < offset + 2 * (size_t)count) {
+            return 0;
+        }
+        memcpy(buffer + offset, duties, 2 * (size_t)count);
+        return offset + 2 * (size_t)count;
+    }
+
+    // Sparse: mask byte per group of 8, then the duties of its set bits
+    for (uint32_t group = 0; group < count; group += 8) {
+        uint32_t n = count - group < 8 ? count - group : 8;
+        uint8_t mask = changed[group / 8] & (uint8_t)((1u << n) - 1);
+        if (size < offset + 1) {
+            return 0;
+        }
+        buffer[offset++] = mask;
+        for (uint32_t i = 0; i < n; i++) {
+            if (mask & (1u << i)) {
+                if (size < offset + 2) {
+                    return 0;
+                }
+                memcpy(buffer + offset, &duties[group + i], 2);
+                offset += 2;
+            }
+        }
+    }
+
+    return offset;
+}
+
+enum {
+    PHASE_MAGIC,
+    PHASE_DISP_COUNT,
+    PHASE_DISP_NODE,
+    PHASE_DENSE_HEADER,     // Base, count, flags
+    PHASE_DENSE_MASK,
+    PHASE_DENSE_DUTY,
+    PHASE_END               // Every declared node seen
+};
+
+static const uint8_t phase_size[] = {4, 1, DISPATCH_NODE_SIZE, 5, 1, 2, 0};
+
+// Move to the next dense duty: the next set bit of the current group when
+// sparse, else the next node; a new mask byte or the end when out of either
+static void dense_next(dispatch_stream_t *stream)
+{
+    if (!(stream->flags & DISPATCH_DENSE_SPARSE)) {
+        stream->phase = stream->index < stream->count ? PHASE_DENSE_DUTY : PHASE_END;
+        return;
+    }
+    while (stream->index < stream->group_end && !(stream->mask & 1)) {
+        stream->mask >>= 1;
+        stream->index++;
+    }
+    if (stream->index < stream->group_end) {
+        stream->phase = PHASE_DENSE_DUTY;
+    } else {
+        stream->phase = stream->index < stream->count ? PHASE_DENSE_MASK : PHASE_END;
+    }
+}
+
+// One complete record for the current phase; false on a protocol error
+static bool stream_record(dispatch_stream_t *stream, const uint8_t *record)
+{
+    switch (stream->phase) {
+    case PHASE_MAGIC: {
+        uint32_t magic;
+        memcpy(&magic, record, 4);
+        if (magic == DISPATCH_MAGIC) {
+            stream->phase = PHASE_DISP_COUNT;
+        } else if (magic == DISPATCH_DENSE_MAGIC) {
+            stream->phase = PHASE_DENSE_HEADER;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    case PHASE_DISP_COUNT:
+        stream->count = record[0];
+        stream->phase = stream->count ? PHASE_DISP_NODE : PHASE_END;
+        return true;
+
+    case PHASE_DISP_NODE: {
+        dispatch_node_t node;
+        node.id = record[0];
+        memcpy(&node.supply, record + 1, 4);
+        node.source = record[5];
+        if (stream->on_node) {
+            stream->on_node(&node, stream->ctx);
+        }
+        stream->nodes_done++;
+        if (++stream->index == stream->count) {
+            stream->phase = PHASE_END;
+        }
+        return true;
+    }
+
+    case PHASE_DENSE_HEADER:
+        memcpy(&stream->base, record, 2);
+        memcpy(&stream->count, record + 2, 2);
+        stream->flags = record[4];
+        if ((stream->flags & ~DISPATCH_DENSE_SPARSE) || (uint32_t)stream->base + stream->count > 65536) {
+            return false;
+        }
+        if (stream->count == 0) {
+            stream->phase = PHASE_END;
+        } else {
+            stream->phase = (stream->flags & DISPATCH_DENSE_SPARSE) ? PHASE_DENSE_MASK : PHASE_DENSE_DUTY;
+        }
+        return true;
+
+    case PHASE_DENSE_MASK: {
+        uint32_t n = stream->count - stream->index < 8 ? stream->count - stream->index : 8;
+        stream->mask = record[0];
+        stream->group_end = stream->index + n;
+        if (n < 8 && (stream->mask >> n)) {
+            return false;  // Bits past the last node
+        }
+        dense_next(stream);
+        return true;
+    }
+
+    case PHASE_DENSE_DUTY: {
+        uint16_t duty;
+        memcpy(&duty, record, 2);
+        if (duty > DISPATCH_DUTY_MAX) {
+            duty = DISPATCH_DUTY_MAX;
+        }
+        if (stream->on_duty) {
+            stream->on_duty((uint16_t)(stream->base + stream->index), duty, stream->ctx);
+        }
+        stream->nodes_done++;
+        stream->index++;
+        stream->mask >>= 1;
+        dense_next(stream);
+        return true;
+    }
+
+    default:
+        return false;
+    }
+}
+
+void dispatch_stream_begin(dispatch_stream_t *stream, dispatch_node_cb_t on_node,
+                           dispatch_duty_cb_t on_duty, void *ctx)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->on_node = on_node;
+    stream->on_duty = on_duty;
+    stream->ctx = ctx;
+    stream->phase = PHASE_MAGIC;
+    stream->status = DISPATCH_STREAM_MORE;
+}
+
+dispatch_stream_status_t dispatch_stream_feed(dispatch_stream_t *stream, const uint8_t *data, size_t len)
+{
+    if (stream->status != DISPATCH_STREAM_MORE) {
+        if (len > 0) {
+            stream->status = DISPATCH_STREAM_ERROR;  // Trailing bytes
+        }
+        return stream->status;
+    }
+
+    while (len > 0 && stream->phase != PHASE_END) {
+        size_t need = phase_size[stream->phase];
+        const uint8_t *record;
+
+        if (stream->pending_len == 0 && len >= need) {
+            // Whole record in this chunk: decode in place
+            record = data;
+            data += need;
+            len -= need;
+        } else {
+            size_t take = need - stream->pending_len;
+            if (take > len) {
+                take = len;
+            }
+            memcpy(stream->pending + stream->pending_len, data, take);
+            stream->pending_len += take;
+            data += take;
+            len -= take;
+            if (stream->pending_len < need) {
+                break;
+            }
+            record = stream->pending;
+            stream->pending_len = 0;
+        }
+
+        if (!stream_record(stream, record)) {
+            stream->status = DISPATCH_STREAM_ERROR;
+            return stream->status;
+        }
+    }
+
+    if (stream->phase == PHASE_END) {
+        stream->status = len > 0 ? DISPATCH_STREAM_ERROR : DISPATCH_STREAM_DONE;
+    }
+    return stream->status;
+}
+
+dispatch_stream_status_t dispatch_stream_end(dispatch_stream_t *stream)
+{
+    if (stream->status == DISPATCH_STREAM_MORE) {
+        stream->status = DISPATCH_STREAM_ERROR;  // Truncated
+    }
+    return stream->status;
+}
+
+size_t encode_dispatch_ack(const dispatch_ack_t *ack, uint8_t *buffer)
+{
+    if (!ack || !buffer) {
+        return 0;
+    }
+
+    uint32_t magic = DISPATCH_ACK_MAGIC;
+    memcpy(buffer, &magic, 4);              // Magic (4 bytes)
+    memcpy(buffer + 4, &ack->seq, 4);       // Sequence (4 bytes)
+    buffer[8] = ack->status;                // Status (1 byte)
+    buffer[9] = ack->applied;               // Applied node count (1 byte)
+
+    return DISPATCH_ACK_SIZE;
+}
+
+bool decode_dispatch_ack(const uint8_t *data, size_t size, dispatch_ack_t *ack)
+{
+    if (!data || !ack || size != DISPATCH_ACK_SIZE) {
+        return false;
+    }
+
+    uint32_t magic;
+    memcpy(&magic, data, 4);
+    if (magic != DISPATCH_ACK_MAGIC) {
+        return false;
+    }
+
+    ack->magic = magic;
+    memcpy(&ack->seq, data + 4, 4);
+    ack->status = data[8];
+    ack->applied = data[9];
+
+    return true;
+}
+
+size_t encode_flow_credit(const flow_credit_t *credit, uint8_t *buffer)
+{
+    if (!credit || !buffer) {
+        return 0;
+    }
+
+    uint32_t magic = FLOW_CREDIT_MAGIC;
+    memcpy(buffer, &magic, 4);              // Magic (4 bytes)
+    memcpy(buffer + 4, &credit->credits, 2); // Credits (2 bytes)
+
+    return FLOW_CREDIT_SIZE;
+}
+
+bool decode_flow_credit(const uint8_t *data, size_t size, flow_credit_t *credit)
+{
+    if (!data || !credit || size != FLOW_CREDIT_SIZE) {
+        return false;
+    }
+
+    uint32_t magic;
+    memcpy(&magic, data, 4);
+    if (magic != FLOW_CREDIT_MAGIC) {
+        return false;
+    }
+
+    credit->magic = magic;
+    memcpy(&credit->credits, data + 4, 2);
+
+    return true;
+}
+
+size_t encode_node_control(const node_control_t *control, uint8_t *buffer)
+{
+    if (!control || !buffer) {
+        return 0;
+    }
+
+    uint32_t magic = NODE_CONTROL_MAGIC;
+    memcpy(buffer, &magic, 4);              // Magic (4 bytes)
+    buffer[4] = control->op;                // Op (1 byte)
+    memcpy(buffer + 5, &control->id, 2);    // Node id (2 bytes)
+    buffer[7] = control->type;              // Type (1 byte)
+    buffer[8] = control->channel;           // Actuator channel (1 byte)
+
+    return NODE_CONTROL_SIZE;
+}
+
+bool decode_node_control(const uint8_t *data, size_t size, node_control_t *control)
+{
+    if (!data || !control || size != NODE_CONTROL_SIZE) {
+        return false;
+    }
+
+    uint32_t magic;
+    memcpy(&magic, data, 4);
+    if (magic != NODE_CONTROL_MAGIC) {
+        return false;
+    }
+
+    control->magic = magic;
+    control->op = data[4];
+    memcpy(&control->id, data + 5, 2);
+    control->type = data[7];
+    control->channel = data[8];
+
+    return control->id != 0 && (control->op == NODE_CONTROL_ADD || control->op == NODE_CONTROL_REMOVE ||
+                                control->op == NODE_CONTROL_DEADBAND);
+}
+
+size_t encode_time_sync(const time_sync_t *sync, uint8_t *buffer)
+{
+    if (!sync || !buffer || (sync->magic != TIME_SYNC_MAGIC && sync->magic != TIME_SYNC_REPLY_MAGIC)) {
+        return 0;
+    }
+
+    memcpy(buffer, &sync->magic, 4);            // Magic (4 bytes)
+    memcpy(buffer + 4, &sync->origin_us, 8);    // Origin time (8 bytes)
+    if (sync->magic == TIME_SYNC_MAGIC) {
+        return TIME_SYNC_SIZE;
+    }
+    memcpy(buffer + 12, &sync->receive_us, 8);  // Receive time (8 bytes)
+    memcpy(buffer + 20, &sync->transmit_us, 8); // Transmit time (8 bytes)
+
+    return TIME_SYNC_REPLY_SIZE;
+}
+
+bool decode_time_sync(const uint8_t *data, size_t size, time_sync_t *sync)
+{
+    if (!data || !sync || size < TIME_SYNC_SIZE) {
+        return false;
+    }
+
+    uint32_t magic;
+    memcpy(&magic, data, 4);
+    if (!(magic == TIME_SYNC_MAGIC && size == TIME_SYNC_SIZE) &&
+        !(magic == TIME_SYNC_REPLY_MAGIC && size == TIME_SYNC_REPLY_SIZE)) {
+        return false;
+    }
+
+    sync->magic = magic;
+    memcpy(&sync->origin_us, data + 4, 8);
+    sync->receive_us = 0;
+    sync->transmit_us = 0;
+    if (magic == TIME_SYNC_REPLY_MAGIC) {
+        memcpy(&sync->receive_us, data + 12, 8);
+        memcpy(&sync->transmit_us, data + 20, 8);
+    }
+
+    return true;
+}
@@ -11,28 +11,81 @@ extern "C" {
 
 // Protocol constants
 #define TELEMETRY_MAGIC 0x47524944  // "GRID"
+#define TELEMETRY_WIDE_MAGIC 0x57445247  // "GRDW": GRID with uint16 node ids
 #define DISPATCH_MAGIC  0x44495350  // "DISP"
-#define MAX_NODES_PER_PACKET 16
+#define DISPATCH_ACK_MAGIC 0x4B434144  // "DACK"
+#define FLOW_CREDIT_MAGIC 0x44455243   // "CRED"
+#define NODE_CONTROL_MAGIC 0x45444F4E  // "NODE"
+#define TELEMETRY_STATS_MAGIC 0x53445247  // "GRDS": GRDW plus optional per-node fields
+#define TELEMETRY_DELTA_MAGIC 0x44445247  // "GRDD": report-by-exception frame
+#define TIME_SYNC_MAGIC 0x4E595354  // "TSYN": clock sync ping
+#define TIME_SYNC_REPLY_MAGIC 0x52595354  // "TSYR": clock sync reply
+#ifndef MAX_NODES_PER_PACKET
+#define MAX_NODES_PER_PACKET 16     // Host tools build with 255
+#endif
 
 // Node types
 #define NODE_TYPE_POWER    0
 #define NODE_TYPE_CONSUMER 1
 
-// Telemetry structures (ESP32 → Backend)
+// Optional per-node fields: sensed current over the telemetry window, after
+// the decimating filter bank. Present fields follow the node in bit order.
+#define TELEMETRY_FIELD_MIN  0x01
+#define TELEMETRY_FIELD_MAX  0x02
+#define TELEMETRY_FIELD_MEAN 0x04
+#define TELEMETRY_FIELD_RMS  0x08
+#define TELEMETRY_FIELDS_ALL 0x0F
+#define TELEMETRY_FIELD_COUNT 4
+
+// Telemetry structures (ESP32 → Backend). Every frame starts with the magic
+// and a uint64 timestamp in microseconds since controller boot, the clock
+// TIME_SYNC replies report. Frames use TELEMETRY_MAGIC with
+// 1-byte ids, or TELEMETRY_WIDE_MAGIC with 2-byte ids when any id exceeds 255.
+// When any node carries fields the frame is TELEMETRY_STATS_MAGIC: 2-byte
+// ids, and after each node's fulfillment a fields byte followed by one float
+// per set bit (nodes without fields add a single 0 byte).
 typedef struct __attribute__((packed)) {
-    uint8_t id;
+    uint16_t id;
     uint8_t type;           // 0=power, 1=consumer
     float demand;           // Amps
     float fulfillment;      // Percentage
+    uint8_t fields;         // TELEMETRY_FIELD_* present in field[]
+    float field[TELEMETRY_FIELD_COUNT];  // Amps, indexed by bit: min, max, mean, rms
 } telemetry_node_t;
 
+// Report-by-exception frames carry only the nodes that moved beyond their
+// deadband since their last report, plus periodic keyframes with every node:
+//   magic u32, timestamp u64, seq u16, flags u8, node count u8, then GRDW
+//   node records (with the GRDS fields byte when TELEMETRY_DELTA_FIELDS).
+// seq counts frames; a receiver that sees a gap must wait for a keyframe.
+// Nodes absent from a keyframe have been removed.
+#define TELEMETRY_DELTA_KEYFRAME 0x01
+#define TELEMETRY_DELTA_FIELDS   0x02
+#define TELEMETRY_DELTA_HEADER_SIZE 16
+
 typedef struct __attribute__((packed)) {
-    uint32_t magic;         // TELEMETRY_MAGIC
-    uint32_t timestamp;     // Milliseconds
+    uint32_t magic;         // TELEMETRY_MAGIC; TELEMETRY_DELTA_MAGIC selects the delta encoding
+    uint64_t timestamp_us;  // Microseconds since controller boot
+    uint16_t seq;           // Delta frames only
+    uint8_t flags;          // Delta frames only: TELEMETRY_DELTA_KEYFRAME
     uint8_t node_count;
     telemetry_node_t nodes[MAX_NODES_PER_PACKET];
 } telemetry_packet_t;
 
+// Receiver-side reconstruction of the full node set from delta frames
+typedef struct {
+    bool synced;            // State matches the sender as of the last frame
+    uint16_t seq;           // Sequence of the last applied delta frame
+    uint32_t keyframes;     // Frames that replaced the whole state
+    uint32_t deltas;        // Delta frames merged
+    uint32_t gaps;          // Times a missing frame (or overflow) lost sync
+    telemetry_packet_t packet;  // Every node as last reported
+} telemetry_state_t;
+
+// Dispatch ack status
+#define DISPATCH_ACK_APPLIED 0
+#define DISPATCH_ACK_INVALID 1
+
 // Dispatch structures (Backend → ESP32)
 typedef struct __attribute__((packed)) {
     uint8_t id;
@@ -46,8 +99,115 @@ typedef struct __attribute__((packed)) {
     dispatch_node_t nodes[MAX_NODES_PER_PACKET];
 } dispatch_packet_t;
 
+// Dispatch ack (ESP32 → Backend on /in), one per dispatch frame in arrival order
+typedef struct __attribute__((packed)) {
+    uint32_t magic;         // DISPATCH_ACK_MAGIC
+    uint32_t seq;           // Dispatch frames received on this controller
+    uint8_t status;         // DISPATCH_ACK_APPLIED / DISPATCH_ACK_INVALID
+    uint8_t applied;        // Nodes applied
+} dispatch_ack_t;
+
+#define DISPATCH_ACK_SIZE 10
+
+// Flow credit (Backend → ESP32 on /out): the subscriber may receive `credits`
+// more telemetry frames. Credits add up; a subscriber that never sends one
+// receives every frame.
+typedef struct __attribute__((packed)) {
+    uint32_t magic;         // FLOW_CREDIT_MAGIC
+    uint16_t credits;
+} flow_credit_t;
+
+#define FLOW_CREDIT_SIZE 6
+
+// Node control (Backend → ESP32 on /in): add or remove a node at runtime, or
+// set its report-by-exception deadbands.
+// Acked with a DACK like dispatch frames (applied = 1 on success).
+#define NODE_CONTROL_ADD    1
+#define NODE_CONTROL_REMOVE 2
+#define NODE_CONTROL_DEADBAND 3     // Report-by-exception deadbands, in type/channel
+#define NODE_DEADBAND_DEFAULT 0xFF  // Deadband byte: use the controller default
+#define NODE_CHANNEL_NONE   0xFF    // Node without an actuator output
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;         // NODE_CONTROL_MAGIC
+    uint8_t op;             // NODE_CONTROL_*
+    uint16_t id;            // Any id but 0
+    uint8_t type;           // NODE_TYPE_*, ignored on remove; deadband: demand in 10 mA steps
+    uint8_t channel;        // Actuator output index or NODE_CHANNEL_NONE; deadband:
+                            // fulfillment in 0.001 steps
+} node_control_t;
+
+#define NODE_CONTROL_SIZE 9
+
+// Clock sync (subscriber → ESP32 on /out, NTP style): a ping carries the
+// subscriber's send time, opaque to the controller. The reply echoes it with
+// the controller's receive and transmit times on the telemetry clock. With
+// the subscriber's receive time t4:
+//   offset = ((receive - origin) + (transmit - t4)) / 2   controller - subscriber
+//   delay  = (t4 - origin) - (transmit - receive)         round trip on the wire
+// The offset is off by at most delay / 2.
+typedef struct __attribute__((packed)) {
+    uint32_t magic;         // TIME_SYNC_MAGIC (ping) or TIME_SYNC_REPLY_MAGIC
+    uint64_t origin_us;     // Subscriber clock at ping send
+    uint64_t receive_us;    // Controller clock at ping receipt (reply only)
+    uint64_t transmit_us;   // Controller clock at reply send (reply only)
+} time_sync_t;
+
+#define TIME_SYNC_SIZE 12
+#define TIME_SYNC_REPLY_SIZE 28
+
+#define DISPATCH_HEADER_SIZE 5      // Magic + node count
+#define DISPATCH_NODE_SIZE 6
+
+// Dense dispatch (Backend → ESP32 on /in): raw duties for a run of node ids,
+// 2 bytes per node, no float conversion or id lookup on the device.
+//   magic u32, base u16 (id of the first node), count u16, flags u8, then
+//   - flags == 0: count × u16 duty, for ids base .. base + count - 1
+//   - DISPATCH_DENSE_SPARSE: per group of 8 nodes, a change mask byte (bit i
+//     = node base + 8g + i) followed by the u16 duties of its set bits only;
+//     unchanged nodes keep their duty
+// Duties are in LEDC steps, 0..DISPATCH_DUTY_MAX; larger values clamp.
+#define DISPATCH_DENSE_MAGIC 0x50534444  // "DDSP"
+#define DISPATCH_DENSE_HEADER_SIZE 9
+#define DISPATCH_DENSE_SPARSE 0x01
+#define DISPATCH_DUTY_BITS 13           // Firmware LEDC duty resolution
+#define DISPATCH_DUTY_MAX ((1 << DISPATCH_DUTY_BITS) - 1)
+
+// Incremental dispatch decoder for DISP and DDSP frames: fed a frame in
+// arbitrary chunks (e.g. the fragments of a WebSocket message), it validates
+// the header and hands each node to a callback as soon as its record is in,
+// decoding in place whenever a record does not straddle two chunks.
+typedef enum {
+    DISPATCH_STREAM_MORE,   // Frame incomplete, feed more bytes
+    DISPATCH_STREAM_DONE,   // Exactly one complete frame consumed
+    DISPATCH_STREAM_ERROR   // Bad magic or mask, or bytes past the declared nodes
+} dispatch_stream_status_t;
+
+typedef void (*dispatch_node_cb_t)(const dispatch_node_t *node, void *ctx);
+typedef void (*dispatch_duty_cb_t)(uint16_t node_id, uint16_t duty, void *ctx);
+
+typedef struct {
+    dispatch_node_cb_t on_node;     // DISP records
+    dispatch_duty_cb_t on_duty;     // DDSP duties
+    void *ctx;
+    uint8_t pending[DISPATCH_NODE_SIZE];  // Header or record split across chunks
+    uint8_t pending_len;
+    uint8_t phase;
+    uint8_t flags;
+    uint8_t mask;           // Remaining change bits of the current group
+    uint16_t base;
+    uint16_t count;         // Nodes (DISP) or id span (DDSP) in the frame
+    uint16_t index;         // Next node offset in the frame
+    uint16_t group_end;
+    uint16_t nodes_done;    // Nodes handed to a callback so far
+    dispatch_stream_status_t status;
+} dispatch_stream_t;
+
 /**
  * @brief Encode telemetry data to binary format
+ *
+ * Picks the smallest frame that holds the nodes (GRID, GRDW, or GRDS when
+ * any node has fields), or GRDD when packet->magic is TELEMETRY_DELTA_MAGIC.
  * 
  * @param packet Telemetry packet to encode
  * @param buffer Output buffer (must be large enough)
@@ -55,6 +215,41 @@ typedef struct __attribute__((packed)) {
  */
 size_t encode_telemetry(const telemetry_packet_t *packet, uint8_t *buffer);
 
+/**
+ * @brief Decode binary telemetry data
+ * 
+ * @param data Binary data buffer
+ * @param size Size of data buffer
+ * @param packet Output telemetry packet
+ * @return true if decode successful, false otherwise
+ */
+bool decode_telemetry(const uint8_t *data, size_t size, telemetry_packet_t *packet);
+
+/**
+ * @brief Reset a receiver to "waiting for a keyframe"
+ */
+void telemetry_state_init(telemetry_state_t *state);
+
+/**
+ * @brief Apply a decoded frame to a receiver
+ *
+ * Full frames (GRID/GRDW/GRDS) and delta keyframes replace the state. Delta
+ * frames update or add their nodes if they follow the last applied sequence
+ * number; after a gap the state stays unsynced until the next keyframe.
+ *
+ * @return true if state->packet is now the sender's full node set
+ */
+bool telemetry_state_apply(telemetry_state_t *state, const telemetry_packet_t *packet);
+
+/**
+ * @brief Encode dispatch data to binary format
+ * 
+ * @param packet Dispatch packet to encode
+ * @param buffer Output buffer (must be large enough)
+ * @return Size of encoded data in bytes, or 0 on error
+ */
+size_t encode_dispatch(const dispatch_packet_t *packet, uint8_t *buffer);
+
 /**
  * @brief Decode binary dispatch data
  * 
@@ -65,6 +260,127 @@ size_t encode_telemetry(const telemetry_packet_t *packet, uint8_t *buffer);
  */
 bool decode_dispatch(const uint8_t *data, size_t size, dispatch_packet_t *packet);
 
+/**
+ * @brief Start decoding a new dispatch frame
+ *
+ * @param on_node Called per DISP record (may be NULL)
+ * @param on_duty Called per DDSP duty (may be NULL)
+ * @param ctx Passed to both
+ */
+void dispatch_stream_begin(dispatch_stream_t *stream, dispatch_node_cb_t on_node,
+                           dispatch_duty_cb_t on_duty, void *ctx);
+
+/**
+ * @brief Feed the next chunk of a dispatch frame
+ *
+ * Nodes completed by this chunk are passed to the callbacks in order. They
+ * are applied as they arrive, so a frame that later turns out malformed may
+ * already have applied some; nodes_done tells how many.
+ *
+ * @param stream Decoder state from dispatch_stream_begin()
+ * @param data Chunk
+ * @param len Chunk length (may be 0)
+ * @return DISPATCH_STREAM_MORE, _DONE or _ERROR (sticky)
+ */
+dispatch_stream_status_t dispatch_stream_feed(dispatch_stream_t *stream, const uint8_t *data, size_t len);
+
+/**
+ * @brief End of input: a frame still waiting for bytes is truncated
+ *
+ * @return DISPATCH_STREAM_DONE if a complete frame was decoded, else _ERROR
+ */
+dispatch_stream_status_t dispatch_stream_end(dispatch_stream_t *stream);
+
+/**
+ * @brief Encode a dense dispatch frame
+ *
+ * @param base Node id of duties[0]
+ * @param duties count duties, one per id from base
+ * @param count Number of ids covered (base + count <= 65536)
+ * @param changed Change bitmap, bit i of byte i / 8 for duties[i]; NULL sends all
+ * @param buffer Output buffer
+ * @param size Size of buffer
+ * @return Size of encoded data in bytes, or 0 on error or if it does not fit
+ */
+size_t encode_dispatch_dense(uint16_t base, const uint16_t *duties, uint16_t count,
+                             const uint8_t *changed, uint8_t *buffer, size_t size);
+
+/**
+ * @brief Encode a dispatch ack
+ *
+ * @param ack Ack to encode
+ * @param buffer Output buffer, at least DISPATCH_ACK_SIZE bytes
+ * @return DISPATCH_ACK_SIZE, or 0 on error
+ */
+size_t encode_dispatch_ack(const dispatch_ack_t *ack, uint8_t *buffer);
+
+/**
+ * @brief Decode a dispatch ack
+ *
+ * @param data Binary data buffer
+ * @param size Size of data buffer
+ * @param ack Output ack
+ * @return true if decode successful, false otherwise
+ */
+bool decode_dispatch_ack(const uint8_t *data, size_t size, dispatch_ack_t *ack);
+
+/**
+ * @brief Encode a flow credit grant
+ *
+ * @param credit Grant to encode
+ * @param buffer Output buffer, at least FLOW_CREDIT_SIZE bytes
+ * @return FLOW_CREDIT_SIZE, or 0 on error
+ */
+size_t encode_flow_credit(const flow_credit_t *credit, uint8_t *buffer);
+
+/**
+ * @brief Decode a flow credit grant
+ *
+ * @param data Binary data buffer
+ * @param size Size of data buffer
+ * @param credit Output grant
+ * @return true if decode successful, false otherwise
+ */
+bool decode_flow_credit(const uint8_t *data, size_t size, flow_credit_t *credit);
+
+/**
+ * @brief Encode a node control message
+ *
+ * @param control Message to encode
+ * @param buffer Output buffer, at least NODE_CONTROL_SIZE bytes
+ * @return NODE_CONTROL_SIZE, or 0 on error
+ */
+size_t encode_node_control(const node_control_t *control, uint8_t *buffer);
+
+/**
+ * @brief Decode a node control message
+ *
+ * @param data Binary data buffer
+ * @param size Size of data buffer
+ * @param control Output message
+ * @return true if decode successful, false otherwise
+ */
+bool decode_node_control(const uint8_t *data, size_t size, node_control_t *control);
+
+/**
+ * @brief Encode a clock sync ping or reply (by sync->magic)
+ *
+ * @param sync Message to encode
+ * @param buffer Output buffer, at least TIME_SYNC_REPLY_SIZE bytes
+ * @return TIME_SYNC_SIZE or TIME_SYNC_REPLY_SIZE, or 0 on error
+ */
+size_t encode_time_sync(const time_sync_t *sync, uint8_t *buffer);
+
+/**
+ * @brief Decode a clock sync ping or reply
+ *
+ * @param data Binary data buffer
+ * @param size Size of data buffer
+ * @param sync Output message; the controller times are 0 for a ping
+ * @return true if decode successful, false otherwise
+ */
+bool decode_time_sync(const uint8_t *data, size_t size, time_sync_t *sync);
+
 /**
  * @brief Calculate telemetry packet size
  * 
@@ -72,7 +388,22 @@ bool decode_dispatch(const uint8_t *data, size_t size, dispatch_packet_t *packet
  * @return Total packet size in bytes
  */
 static inline size_t telemetry_packet_size(uint8_t node_count) {
-    return 9 + (node_count * 9);  // Header(4) + timestamp(4) + count(1) + nodes(9*count)
+    return 13 + (node_count * 10);  // Header(4) + timestamp(8) + count(1) + nodes(10*count)
+}
+
+/**
+ * @brief Calculate wide (uint16 id) telemetry packet size
+ */
+static inline size_t telemetry_wide_packet_size(uint8_t node_count) {
+    return 13 + (node_count * 11);
+}
+
+/**
+ * @brief Largest frame encode_telemetry() can produce for node_count nodes:
+ *        a delta keyframe with every field on every node
+ */
+static inline size_t telemetry_max_packet_size(uint8_t node_count) {
+    return TELEMETRY_DELTA_HEADER_SIZE + (node_count * (12 + 4 * TELEMETRY_FIELD_COUNT));
 }
 
 /**
@@ -0,0 +1,65 @@
+#include "boot_trace.h"
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+
+#define BOOT_PHASE_NAME_ENTRY(id, name) name,
+static const char *const phase_names[BOOT_PHASE_COUNT] = {
+    BOOT_PHASES(BOOT_PHASE_NAME_ENTRY)
+};
+#undef BOOT_PHASE_NAME_ENTRY
+
+static int64_t phase_us[BOOT_PHASE_COUNT];
+static portMUX_TYPE boot_trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void boot_trace_mark(boot_phase_t phase)
+{
+    if ((unsigned)phase >= BOOT_PHASE_COUNT || phase_us[phase] != 0) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&boot_trace_lock);
+    if (phase_us[phase] == 0) {
+        phase_us[phase] = now > 0 ? now : 1;
+    }
+    portEXIT_CRITICAL(&boot_trace_lock);
+}
+
+int64_t boot_trace_get(boot_phase_t phase)
+{
+    if ((unsigned)phase >= BOOT_PHASE_COUNT) {
+        return 0;
+    }
+
+    // 64-bit loads are not atomic on Xtensa
+    portENTER_CRITICAL(&boot_trace_lock);
+    int64_t value = phase_us[phase];
+    portEXIT_CRITICAL(&boot_trace_lock);
+    return value;
+}
+
+size_t boot_trace_to_json(char *buffer, size_t size)
+{
+    size_t len = 0;
+
+    if (size == 0) {
+        return 0;
+    }
+
+    len += snprintf(buffer + len, size - len, "{");
+    for (int i = 0; i < BOOT_PHASE_COUNT && len < size; i++) {
+        int64_t value = boot_trace_get((boot_phase_t)i);
+        const char *sep = i ? "," : "";
+        if (value) {
+            len += snprintf(buffer + len, size - len, "%s\"%s\":%lld", sep, phase_names[i], (long long)value);
+        } else {
+            len += snprintf(buffer + len, size - len, "%s\"%s\":null", sep, phase_names[i]);
+        }
+    }
+    if (len < size) {
+        len += snprintf(buffer + len, size - len, "}");
+    }
+
+    return len < size ? len : size - 1;
+}
@@ -0,0 +1,63 @@
+#ifndef BOOT_TRACE_H
+#define BOOT_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Boot-phase timestamps.
+ *
+ * Each phase is stamped once, with esp_timer_get_time() at the first call to
+ * boot_trace_mark(); later marks of the same phase are ignored. Timestamps are
+ * microseconds since the esp_timer epoch (roughly since reset), so the
+ * first-frame mark is the boot-to-first-frame time.
+ */
+
+// X(id, name)
+#define BOOT_PHASES(X) \
+    X(BOOT_PHASE_APP_MAIN,          "app_main") \
+    X(BOOT_PHASE_PWM_READY,         "pwm_ready") \
+    X(BOOT_PHASE_OUTPUT_RESTORED,   "output_restored") \
+    X(BOOT_PHASE_HTTPD_READY,       "httpd_ready") \
+    X(BOOT_PHASE_NETIF_UP,          "netif_up") \
+    X(BOOT_PHASE_FIRST_SUBSCRIBER,  "first_subscriber") \
+    X(BOOT_PHASE_FIRST_FRAME,       "first_frame") \
+    X(BOOT_PHASE_FIRST_DISPATCH,    "first_dispatch") \
+    X(BOOT_PHASE_MDNS_READY,        "mdns_ready") \
+    X(BOOT_PHASE_IP_PUBLISHED,      "ip_published")
+
+#define BOOT_PHASE_ENUM_ENTRY(id, name) id,
+typedef enum {
+    BOOT_PHASES(BOOT_PHASE_ENUM_ENTRY)
+    BOOT_PHASE_COUNT
+} boot_phase_t;
+#undef BOOT_PHASE_ENUM_ENTRY
+
+/**
+ * @brief Stamp a phase if it has not been stamped yet (any task, not ISR)
+ */
+void boot_trace_mark(boot_phase_t phase);
+
+/**
+ * @brief Timestamp of a phase in µs, or 0 if it has not happened
+ */
+int64_t boot_trace_get(boot_phase_t phase);
+
+/**
+ * @brief Write all phases as a JSON object, e.g. {"app_main":31204,...,"first_frame":null}
+ *
+ * @param buffer Output buffer
+ * @param size Buffer size; the output is truncated (but terminated) if short
+ * @return Length of the JSON text
+ */
+size_t boot_trace_to_json(char *buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOOT_TRACE_H
@@ -0,0 +1,279 @@
+#include "deferred_log.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#define DLOG_TAG "dlog"
+
+#ifndef CONFIG_POWER_GRID_DLOG_RING_SIZE
+#define CONFIG_POWER_GRID_DLOG_RING_SIZE 32
+#endif
+#ifndef CONFIG_POWER_GRID_DLOG_TASK_PRIORITY
+#define CONFIG_POWER_GRID_DLOG_TASK_PRIORITY 1
+#endif
+#ifndef CONFIG_POWER_GRID_DLOG_FLUSH_MS
+#define CONFIG_POWER_GRID_DLOG_FLUSH_MS 50
+#endif
+
+#define DLOG_LINE_MAX 160
+
+typedef struct {
+    esp_log_level_t level;
+    const char *tag;
+    uint32_t min_interval_ms;
+    const char *fmt;
+} dlog_format_t;
+
+#define DLOG_TABLE_ENTRY(id, level, tag, interval, fmt) { level, tag, interval, fmt },
+static const dlog_format_t dlog_formats[DLOG_FORMAT_COUNT] = {
+    DLOG_FORMATS(DLOG_TABLE_ENTRY)
+};
+#undef DLOG_TABLE_ENTRY
+
+typedef struct {
+    uint16_t id;
+    uint8_t nargs;
+    dlog_arg_t args[DLOG_MAX_ARGS];
+} dlog_record_t;
+
+// Per-format aggregation window
+typedef struct {
+    bool open;
+    uint32_t start_ms;
+    uint32_t pending;       // Posts folded in since start_ms
+    uint8_t nargs;
+    dlog_arg_t args[DLOG_MAX_ARGS];  // Latest arguments seen in the window
+} dlog_window_t;
+
+static dlog_record_t ring[CONFIG_POWER_GRID_DLOG_RING_SIZE];
+static uint32_t ring_head = 0;  // Next slot to write (producers)
+static uint32_t ring_tail = 0;  // Next slot to read (log task)
+static dlog_window_t windows[DLOG_FORMAT_COUNT];
+static dlog_stats_t stats;
+static portMUX_TYPE dlog_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t dlog_task = NULL;
+
+static inline uint32_t dlog_now_ms(void)
+{
+    return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+}
+
+void dlog_post(dlog_id_t id, const dlog_arg_t *args, size_t nargs)
+{
+    if ((unsigned)id >= DLOG_FORMAT_COUNT) {
+        return;
+    }
+    if (nargs > DLOG_MAX_ARGS) {
+        nargs = DLOG_MAX_ARGS;
+    }
+
+    uint32_t now = dlog_now_ms();
+    const dlog_format_t *format = &dlog_formats[id];
+    dlog_window_t *window = &windows[id];
+
+    portENTER_CRITICAL(&dlog_lock);
+
+    if (!dlog_task) {
+        stats.dropped++;
+        portEXIT_CRITICAL(&dlog_lock);
+        return;
+    }
+
+    // Inside the rate-limit window: fold into the aggregate, no ring traffic
+    if (format->min_interval_ms > 0 && window->open &&
+        (now - window->start_ms) < format->min_interval_ms) {
+        window->pending++;
+        window->nargs = (uint8_t)nargs;
+        memcpy(window->args, args, nargs * sizeof(dlog_arg_t));
+        stats.aggregated++;
+        portEXIT_CRITICAL(&dlog_lock);
+        return;
+    }
+
+    uint32_t used = ring_head - ring_tail;
+    if (used >= CONFIG_POWER_GRID_DLOG_RING_SIZE) {
+        stats.dropped++;
+        portEXIT_CRITICAL(&dlog_lock);
+        return;
+    }
+
+    dlog_record_t *record = &ring[ring_head % CONFIG_POWER_GRID_DLOG_RING_SIZE];
+    record->id = (uint16_t)id;
+    record->nargs = (uint8_t)nargs;
+    memcpy(record->args, args, nargs * sizeof(dlog_arg_t));
+    ring_head++;
+
+    window->open = true;
+    window->start_ms = now;
+    window->pending = 0;
+
+    stats.posted++;
+    if (used + 1 > stats.ring_high_water) {
+        stats.ring_high_water = used + 1;
+    }
+
+    portEXIT_CRITICAL(&dlog_lock);
+}
+
+/*
+ * Minimal printf driver for the restricted conversions allowed in
+ * DLOG_FORMATS. Each conversion is handed to snprintf with its own argument,
+ * so argument types never depend on va_list promotion rules.
+ */
+static void dlog_format(char *out, size_t out_size, const char *fmt,
+                        const dlog_arg_t *args, size_t nargs)
+{
+    size_t pos = 0;
+    size_t arg = 0;
+    char spec[16];
+
+    while (*fmt && pos + 1 < out_size) {
+        if (*fmt != '%') {
+            out[pos++] = *fmt++;
+            continue;
+        }
+        if (fmt[1] == '%') {
+            out[pos++] = '%';
+            fmt += 2;
+            continue;
+        }
+
+        // Copy the conversion spec up to and including its conversion char
+        size_t len = 0;
+        spec[len++] = *fmt++;
+        while (*fmt && strchr("diuxXcfFeEgGs", *fmt) == NULL && len < sizeof(spec) - 2) {
+            spec[len++] = *fmt++;
+        }
+        if (!*fmt) {
+            break;
+        }
+        char conv = *fmt++;
+        spec[len++] = conv;
+        spec[len] = '\0';
+
+        int written;
+        if (arg >= nargs) {
+            written = snprintf(out + pos, out_size - pos, "?");
+        } else if (strchr("fFeEgG", conv)) {
+            written = snprintf(out + pos, out_size - pos, spec, (double)args[arg].f);
+        } else if (conv == 's') {
+            written = snprintf(out + pos, out_size - pos, spec, args[arg].s ? args[arg].s : "(null)");
+        } else if (conv == 'u' || conv == 'x' || conv == 'X') {
+            written = snprintf(out + pos, out_size - pos, spec, (unsigned)args[arg].u);
+        } else {
+            written = snprintf(out + pos, out_size - pos, spec, (int)args[arg].i);
+        }
+        arg++;
+
+        if (written < 0) {
+            break;
+        }
+        pos += (size_t)written;
+        if (pos >= out_size) {
+            pos = out_size - 1;
+        }
+    }
+    out[pos] = '\0';
+}
+
+static void dlog_emit(dlog_id_t id, const dlog_arg_t *args, size_t nargs,
+                      uint32_t repeat, uint32_t window_ms)
+{
+    const dlog_format_t *format = &dlog_formats[id];
+    char line[DLOG_LINE_MAX];
+
+    dlog_format(line, sizeof(line), format->fmt, args, nargs);
+    if (repeat > 0) {
+        ESP_LOG_LEVEL(format->level, format->tag, "%s (x%lu in last %.1fs)",
+                      line, (unsigned long)repeat, window_ms / 1000.0f);
+    } else {
+        ESP_LOG_LEVEL(format->level, format->tag, "%s", line);
+    }
+    stats.emitted++;
+}
+
+static void dlog_task_fn(void *pvParameters)
+{
+    uint32_t reported_drops = 0;
+
+    while (1) {
+        // Drain the ring
+        while (1) {
+            dlog_record_t record;
+            portENTER_CRITICAL(&dlog_lock);
+            if (ring_tail == ring_head) {
+                portEXIT_CRITICAL(&dlog_lock);
+                break;
+            }
+            record = ring[ring_tail % CONFIG_POWER_GRID_DLOG_RING_SIZE];
+            ring_tail++;
+            portEXIT_CRITICAL(&dlog_lock);
+
+            dlog_emit((dlog_id_t)record.id, record.args, record.nargs, 0, 0);
+        }
+
+        // Flush aggregates whose window has expired
+        uint32_t now = dlog_now_ms();
+        for (int id = 0; id < DLOG_FORMAT_COUNT; id++) {
+            dlog_window_t snapshot;
+            uint32_t interval = dlog_formats[id].min_interval_ms;
+
+            portENTER_CRITICAL(&dlog_lock);
+            dlog_window_t *window = &windows[id];
+            bool expired = window->open && window->pending > 0 &&
+                           (now - window->start_ms) >= interval;
+            if (expired) {
+                snapshot = *window;
+                window->start_ms = now;
+                window->pending = 0;
+            }
+            portEXIT_CRITICAL(&dlog_lock);
+
+            if (expired) {
+                dlog_emit((dlog_id_t)id, snapshot.args, snapshot.nargs,
+                          snapshot.pending, now - snapshot.start_ms);
+            }
+        }
+
+        uint32_t drops = stats.dropped;
+        if (drops != reported_drops) {
+            ESP_LOGW(DLOG_TAG, "%lu log records dropped (ring full)",
+                     (unsigned long)(drops - reported_drops));
+            reported_drops = drops;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_POWER_GRID_DLOG_FLUSH_MS));
+    }
+}
+
+esp_err_t dlog_init(void)
+{
+    if (dlog_task) {
+        return ESP_OK;
+    }
+
+    TaskHandle_t task = NULL;
+    if (xTaskCreate(dlog_task_fn, "dlog", 3072, NULL,
+                    CONFIG_POWER_GRID_DLOG_TASK_PRIORITY, &task) != pdPASS) {
+        ESP_LOGE(DLOG_TAG, "Failed to create deferred log task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    portENTER_CRITICAL(&dlog_lock);
+    dlog_task = task;
+    portEXIT_CRITICAL(&dlog_lock);
+
+    ESP_LOGI(DLOG_TAG, "Deferred logger started (%d-record ring, %d formats)",
+             CONFIG_POWER_GRID_DLOG_RING_SIZE, DLOG_FORMAT_COUNT);
+    return ESP_OK;
+}
+
+void dlog_get_stats(dlog_stats_t *out)
+{
+    portENTER_CRITICAL(&dlog_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&dlog_lock);
+}
@@ -0,0 +1,103 @@
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Deferred binary logger.
+ *
+ * Hot paths post a format id plus raw arguments; a low-priority task does the
+ * printf formatting and UART output. Each format has a minimum interval: posts
+ * inside the interval only bump a counter and overwrite the latest arguments,
+ * and the aggregate is emitted once the interval expires.
+ *
+ * Format strings may only use int (%d %u %x %c), double (%f %e %g) and
+ * string (%s) conversions without length modifiers. %s arguments must point
+ * to static storage (e.g. esp_err_to_name()).
+ */
+
+// X(id, level, tag, min_interval_ms, format)
+#define DLOG_FORMATS(X) \
+    X(DLOG_WS_SEND_FAILED,     ESP_LOG_WARN, "power_grid", 1000,  "WebSocket send failed to client %d: %s") \
+    X(DLOG_OUT_CLIENT_GONE,    ESP_LOG_INFO, "power_grid", 0,     "Output client %d disconnected") \
+    X(DLOG_TELEMETRY_STATS,    ESP_LOG_INFO, "power_grid", 10000, "Telemetry: %d binary bytes to %d clients, %d JSON bytes to %d") \
+    X(DLOG_IN_RECV_ERROR,      ESP_LOG_WARN, "power_grid", 5000,  "WebSocket /in recv error: %s") \
+    X(DLOG_DISPATCH_APPLIED,   ESP_LOG_INFO, "power_grid", 10000, "Binary dispatch: node %d gets %.3f supply from source %d") \
+    X(DLOG_DISPATCH_INVALID,   ESP_LOG_WARN, "power_grid", 1000,  "Invalid binary dispatch received (%d bytes)") \
+    X(DLOG_NODE_CONTROL,       ESP_LOG_INFO, "power_grid", 0,     "Node control op %d for node %d: changed=%d") \
+    X(DLOG_POOL_EXHAUSTED,     ESP_LOG_WARN, "power_grid", 5000,  "Frame pool %s exhausted")
+
+#define DLOG_ENUM_ENTRY(id, level, tag, interval, fmt) id,
+typedef enum {
+    DLOG_FORMATS(DLOG_ENUM_ENTRY)
+    DLOG_FORMAT_COUNT
+} dlog_id_t;
+#undef DLOG_ENUM_ENTRY
+
+#define DLOG_MAX_ARGS 4
+
+typedef union {
+    int32_t i;
+    uint32_t u;
+    float f;
+    const char *s;
+} dlog_arg_t;
+
+#define DLOG_I(x) ((dlog_arg_t){ .i = (int32_t)(x) })
+#define DLOG_U(x) ((dlog_arg_t){ .u = (uint32_t)(x) })
+#define DLOG_F(x) ((dlog_arg_t){ .f = (float)(x) })
+#define DLOG_S(x) ((dlog_arg_t){ .s = (x) })
+
+/**
+ * @brief Post a log record; never blocks and never formats
+ *
+ * Usage: DLOG(DLOG_WS_SEND_FAILED, DLOG_I(slot), DLOG_S(esp_err_to_name(ret)));
+ */
+#define DLOG(id, ...) \
+    dlog_post((id), (const dlog_arg_t[]){ __VA_ARGS__ }, \
+              sizeof((const dlog_arg_t[]){ __VA_ARGS__ }) / sizeof(dlog_arg_t))
+
+typedef struct {
+    uint32_t posted;        // Records accepted into the ring
+    uint32_t aggregated;    // Posts folded into a rate-limited aggregate
+    uint32_t dropped;       // Posts lost because the ring was full
+    uint32_t emitted;       // Lines written by the log task
+    uint32_t ring_high_water;
+} dlog_stats_t;
+
+/**
+ * @brief Start the deferred log task
+ *
+ * Safe to call before the network is up. Posts made before init are counted
+ * as dropped.
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t dlog_init(void);
+
+/**
+ * @brief Post a record with raw arguments
+ *
+ * @param id Format id from DLOG_FORMATS
+ * @param args Argument array (copied)
+ * @param nargs Number of arguments, at most DLOG_MAX_ARGS
+ */
+void dlog_post(dlog_id_t id, const dlog_arg_t *args, size_t nargs);
+
+/**
+ * @brief Snapshot logger counters
+ */
+void dlog_get_stats(dlog_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DEFERRED_LOG_H
@@ -0,0 +1,117 @@
+#include "filter_bank.h"
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+static void reset_window(filter_bank_t *bank)
+{
+    for (int l = 0; l < FILTER_BANK_LANES; l++) {
+        bank->min[l] = FLT_MAX;
+        bank->max[l] = -FLT_MAX;
+        bank->sum[l] = 0.0f;
+        bank->sum_sq[l] = 0.0f;
+    }
+    bank->outputs = 0;
+}
+
+void filter_bank_init(filter_bank_t *bank, int channels, int decimation)
+{
+    if (channels < 0) channels = 0;
+    if (channels > FILTER_BANK_LANES) channels = FILTER_BANK_LANES;
+    if (decimation < 1) decimation = 1;
+    if (decimation > FILTER_BANK_MAX_DECIMATION) decimation = FILTER_BANK_MAX_DECIMATION;
+
+    memset(bank, 0, sizeof(*bank));
+    bank->channels = channels;
+    bank->decimation = decimation;
+    bank->warmup = FILTER_BANK_ORDER;
+    bank->gain = 1.0f;
+    for (int k = 0; k < FILTER_BANK_ORDER; k++) {
+        bank->gain /= (float)decimation;
+    }
+    reset_window(bank);
+}
+
+// Comb stages at the output rate, then the window accumulators
+static void emit(filter_bank_t *bank)
+{
+    float y[FILTER_BANK_LANES];
+
+    for (int l = 0; l < FILTER_BANK_LANES; l++) {
+        uint32_t v = bank->integ[FILTER_BANK_ORDER - 1][l];
+        for (int k = 0; k < FILTER_BANK_ORDER; k++) {
+            uint32_t in = v;
+            v -= bank->delay[k][l];
+            bank->delay[k][l] = in;
+        }
+        y[l] = (float)(int32_t)v * bank->gain;
+    }
+    if (bank->warmup > 0) {
+        bank->warmup--;
+        return;
+    }
+
+    for (int l = 0; l < FILTER_BANK_LANES; l++) {
+        bank->min[l] = y[l] < bank->min[l] ? y[l] : bank->min[l];
+        bank->max[l] = y[l] > bank->max[l] ? y[l] : bank->max[l];
+        bank->sum[l] += y[l];
+        bank->sum_sq[l] += y[l] * y[l];
+    }
+    bank->outputs++;
+}
+
+void filter_bank_feed(filter_bank_t *bank, const int32_t (*scans)[FILTER_BANK_LANES], size_t count)
+{
+    // Integrators live in a local copy: the input may alias the bank (both
+    // are 32-bit integers), which would force a reload per stage and scan
+    uint32_t integ[FILTER_BANK_ORDER][FILTER_BANK_LANES];
+    memcpy(integ, bank->integ, sizeof(integ));
+
+    size_t s = 0;
+    while (s < count) {
+        // Run up to the next output without a per-scan branch
+        size_t run = (size_t)(bank->decimation - bank->phase);
+        if (run > count - s) {
+            run = count - s;
+        }
+
+        for (size_t end = s + run; s < end; s++) {
+            const int32_t *x = scans[s];
+            for (int l = 0; l < FILTER_BANK_LANES; l++) {
+                integ[0][l] += (uint32_t)x[l];
+            }
+            for (int k = 1; k < FILTER_BANK_ORDER; k++) {
+                for (int l = 0; l < FILTER_BANK_LANES; l++) {
+                    integ[k][l] += integ[k - 1][l];
+                }
+            }
+        }
+
+        bank->phase += (int)run;
+        if (bank->phase == bank->decimation) {
+            bank->phase = 0;
+            memcpy(bank->integ[FILTER_BANK_ORDER - 1], integ[FILTER_BANK_ORDER - 1], sizeof(integ[0]));
+            emit(bank);
+        }
+    }
+
+    memcpy(bank->integ, integ, sizeof(integ));
+}
+
+void filter_bank_take(filter_bank_t *bank, filter_bank_window_t *window)
+{
+    memset(window, 0, sizeof(*window));
+    window->channels = bank->channels;
+    window->outputs = bank->outputs;
+
+    if (bank->outputs > 0) {
+        float inv = 1.0f / (float)bank->outputs;
+        for (int l = 0; l < bank->channels; l++) {
+            window->min[l] = bank->min[l];
+            window->max[l] = bank->max[l];
+            window->mean[l] = bank->sum[l] * inv;
+            window->rms[l] = sqrtf(bank->sum_sq[l] * inv);
+        }
+    }
+    reset_window(bank);
+}
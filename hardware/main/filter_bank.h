@@ -0,0 +1,85 @@
+#ifndef FILTER_BANK_H
+#define FILTER_BANK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Decimating filter bank for sensed current.
+ *
+ * Each channel runs a FILTER_BANK_ORDER-stage CIC decimator (integrators at
+ * the scan rate, combs at scan rate / decimation). The CIC low-pass removes
+ * content above the output rate before it is reduced, so min/max/mean/RMS of
+ * a telemetry window do not alias. Each decimated output updates running
+ * min, max, sum and sum of squares. A window take reads those and resets them.
+ * The first FILTER_BANK_ORDER outputs after init are the filter settling
+ * and are not accumulated.
+ *
+ * State is structure-of-arrays, one row of FILTER_BANK_LANES per stage. Every
+ * loop runs over all lanes with a constant trip count and no branches, so
+ * the host compiler turns a scan into a few vector instructions and the
+ * ESP32 runs straight-line code. Unused lanes compute zeros.
+ *
+ * Integrators wrap in uint32 arithmetic, which is exact for a CIC as long as
+ * the output fits: 13 input bits + ORDER * log2(decimation) <= 32.
+ */
+
+#define FILTER_BANK_LANES 8         // SENSE_MAX_CHANNELS
+#define FILTER_BANK_ORDER 3
+#define FILTER_BANK_MAX_DECIMATION 64
+
+typedef struct {
+    int channels;
+    float min[FILTER_BANK_LANES];   // Input units (zero-relative ADC codes)
+    float max[FILTER_BANK_LANES];
+    float mean[FILTER_BANK_LANES];
+    float rms[FILTER_BANK_LANES];
+    uint32_t outputs;               // Decimated samples in the window
+} filter_bank_window_t;
+
+typedef struct {
+    int channels;
+    int decimation;
+    int phase;                      // Scans since the last output
+    int warmup;                     // Outputs left before the combs have settled
+    float gain;                     // 1 / decimation^ORDER
+    uint32_t integ[FILTER_BANK_ORDER][FILTER_BANK_LANES];
+    uint32_t delay[FILTER_BANK_ORDER][FILTER_BANK_LANES];  // Previous input of each comb
+    float min[FILTER_BANK_LANES];
+    float max[FILTER_BANK_LANES];
+    float sum[FILTER_BANK_LANES];
+    float sum_sq[FILTER_BANK_LANES];
+    uint32_t outputs;
+} filter_bank_t;
+
+/**
+ * @brief Reset the bank
+ *
+ * @param channels Active lanes (clamped to FILTER_BANK_LANES)
+ * @param decimation Scans per output (clamped to 1..FILTER_BANK_MAX_DECIMATION)
+ */
+void filter_bank_init(filter_bank_t *bank, int channels, int decimation);
+
+/**
+ * @brief Run count scans through the bank
+ *
+ * @param scans Scan-major samples, scans[s][lane], zero-relative codes
+ */
+void filter_bank_feed(filter_bank_t *bank, const int32_t (*scans)[FILTER_BANK_LANES], size_t count);
+
+/**
+ * @brief Close the window into *window and start the next one
+ *
+ * Lanes are all zero if no output was produced since the last take.
+ */
+void filter_bank_take(filter_bank_t *bank, filter_bank_window_t *window);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FILTER_BANK_H
@@ -0,0 +1,124 @@
+#include "frame_pool.h"
+#include <stdio.h>
+
+#define FREE_NONE 0xFFFFu
+
+static inline uint32_t pack_head(uint32_t tag, uint32_t index)
+{
+    return (tag << 16) | index;
+}
+
+bool frame_pool_init(frame_pool_t *pool, const char *name, frame_t *frames, uint8_t *storage, size_t block_size,
+                     uint16_t blocks)
+{
+    if (blocks == 0 || blocks > FRAME_POOL_MAX_BLOCKS) {
+        return false;
+    }
+
+    pool->name = name;
+    pool->frames = frames;
+    pool->block_size = block_size;
+    pool->blocks = blocks;
+    for (uint16_t i = 0; i < blocks; i++) {
+        frames[i].pool = pool;
+        frames[i].data = storage + (size_t)i * block_size;
+        frames[i].len = 0;
+        frames[i].refs = 0;
+        frames[i].index = i;
+        frames[i].next_free = (uint16_t)(i + 1u < blocks ? i + 1u : FREE_NONE);
+    }
+    __atomic_store_n(&pool->in_use, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->high_water, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->allocs, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->exhausted, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->free_head, pack_head(0, 0), __ATOMIC_RELEASE);
+    return true;
+}
+
+frame_t *frame_pool_alloc(frame_pool_t *pool)
+{
+    uint32_t head = __atomic_load_n(&pool->free_head, __ATOMIC_ACQUIRE);
+    frame_t *frame;
+
+    while (1) {
+        uint32_t index = head & 0xFFFFu;
+        if (index == FREE_NONE) {
+            __atomic_fetch_add(&pool->exhausted, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+        // The link may be stale if another task popped this block first;
+        // the tag then no longer matches and the CAS fails
+        frame = &pool->frames[index];
+        uint32_t next = __atomic_load_n(&frame->next_free, __ATOMIC_RELAXED);
+        uint32_t desired = pack_head((head >> 16) + 1, next);
+        if (__atomic_compare_exchange_n(&pool->free_head, &head, desired, true, __ATOMIC_ACQUIRE,
+                                        __ATOMIC_ACQUIRE)) {
+            break;
+        }
+    }
+
+    frame->len = 0;
+    __atomic_store_n(&frame->refs, 1, __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(&pool->allocs, 1, __ATOMIC_RELAXED);
+    uint32_t used = __atomic_add_fetch(&pool->in_use, 1, __ATOMIC_RELAXED);
+    uint32_t high = __atomic_load_n(&pool->high_water, __ATOMIC_RELAXED);
+    while (used > high &&
+           !__atomic_compare_exchange_n(&pool->high_water, &high, used, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    return frame;
+}
+
+void frame_ref(frame_t *frame)
+{
+    __atomic_fetch_add(&frame->refs, 1, __ATOMIC_RELAXED);
+}
+
+void frame_release(frame_t *frame)
+{
+    // Release orders this holder's reads of the payload before the block
+    // can be handed out again
+    if (__atomic_sub_fetch(&frame->refs, 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+
+    frame_pool_t *pool = frame->pool;
+    uint32_t head = __atomic_load_n(&pool->free_head, __ATOMIC_RELAXED);
+    uint32_t desired;
+    do {
+        __atomic_store_n(&frame->next_free, (uint16_t)(head & 0xFFFFu), __ATOMIC_RELAXED);
+        desired = pack_head((head >> 16) + 1, frame->index);
+    } while (!__atomic_compare_exchange_n(&pool->free_head, &head, desired, true, __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED));
+    __atomic_fetch_sub(&pool->in_use, 1, __ATOMIC_RELAXED);
+}
+
+void frame_pool_get_stats(const frame_pool_t *pool, frame_pool_stats_t *stats)
+{
+    stats->name = pool->name;
+    stats->blocks = pool->blocks;
+    stats->block_size = (uint32_t)pool->block_size;
+    stats->in_use = __atomic_load_n(&pool->in_use, __ATOMIC_RELAXED);
+    stats->high_water = __atomic_load_n(&pool->high_water, __ATOMIC_RELAXED);
+    stats->allocs = __atomic_load_n(&pool->allocs, __ATOMIC_RELAXED);
+    stats->exhausted = __atomic_load_n(&pool->exhausted, __ATOMIC_RELAXED);
+}
+
+size_t frame_pool_to_json(const frame_pool_t *pool, char *buffer, size_t size)
+{
+    frame_pool_stats_t stats;
+
+    if (size == 0) {
+        return 0;
+    }
+    frame_pool_get_stats(pool, &stats);
+    int len = snprintf(buffer, size,
+                       "{\"name\":\"%s\",\"blocks\":%u,\"block_bytes\":%u,\"in_use\":%u,\"high_water\":%u,"
+                       "\"allocs\":%u,\"exhausted\":%u}",
+                       stats.name, (unsigned)stats.blocks, (unsigned)stats.block_size, (unsigned)stats.in_use,
+                       (unsigned)stats.high_water, (unsigned)stats.allocs, (unsigned)stats.exhausted);
+    if (len < 0) {
+        return 0;
+    }
+    return (size_t)len < size ? (size_t)len : size - 1;
+}
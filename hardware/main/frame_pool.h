@@ -0,0 +1,110 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fixed-block frame pool with reference-counted handles.
+ *
+ * A pool hands out equal-sized blocks from static storage given at init, so
+ * encoders, fan-out and dispatch never touch the heap. Allocation and
+ * release are lock-free. Free blocks form a stack whose head word holds a
+ * 16-bit tag beside the block index, and the tag changes on every push and
+ * pop. A pop that raced a pop and re-push of the same block (ABA) therefore
+ * fails its compare-and-swap and retries. Only 32-bit atomics are used,
+ * which the ESP32 has natively.
+ *
+ * A frame starts with one reference, owned by whoever allocated it. Every
+ * other holder takes its own with frame_ref(): a subscriber send in flight,
+ * or the "latest frame" slot. The last frame_release() returns the block.
+ * Only the allocator writes the payload, before the frame is shared.
+ *
+ * Each pool counts blocks in use, their high-water mark, allocations and
+ * allocations that found the pool empty.
+ */
+
+#define FRAME_POOL_MAX_BLOCKS 0xFFFE    // Index 0xFFFF marks the empty stack
+
+struct frame_pool;
+
+typedef struct {
+    struct frame_pool *pool;
+    uint8_t *data;          // block_size bytes
+    size_t len;             // Bytes written by the producer
+    uint32_t refs;          // Atomic
+    uint16_t index;
+    uint16_t next_free;     // Free-stack link while the block is in the pool
+} frame_t;
+
+typedef struct frame_pool {
+    const char *name;       // Static string, for stats and logs
+    frame_t *frames;
+    size_t block_size;
+    uint16_t blocks;
+    uint32_t free_head;     // Atomic: tag << 16 | index of the top free block
+    uint32_t in_use;        // Atomic counters
+    uint32_t high_water;
+    uint32_t allocs;
+    uint32_t exhausted;
+} frame_pool_t;
+
+typedef struct {
+    const char *name;
+    uint16_t blocks;
+    uint32_t block_size;
+    uint32_t in_use;
+    uint32_t high_water;    // Most blocks in use at once since init
+    uint32_t allocs;
+    uint32_t exhausted;     // Allocations that returned NULL
+} frame_pool_stats_t;
+
+/**
+ * @brief Set up a pool over caller-owned storage
+ *
+ * @param frames blocks handles
+ * @param storage blocks * block_size payload bytes
+ * @return false if blocks is 0 or above FRAME_POOL_MAX_BLOCKS
+ */
+bool frame_pool_init(frame_pool_t *pool, const char *name, frame_t *frames, uint8_t *storage, size_t block_size,
+                     uint16_t blocks);
+
+/**
+ * @brief Take a block with one reference and len 0
+ *
+ * @return NULL if every block is in use (counted as exhausted)
+ */
+frame_t *frame_pool_alloc(frame_pool_t *pool);
+
+/**
+ * @brief Add a reference for another holder
+ */
+void frame_ref(frame_t *frame);
+
+/**
+ * @brief Drop a reference; the last one returns the block to its pool
+ */
+void frame_release(frame_t *frame);
+
+/**
+ * @brief Snapshot the counters
+ */
+void frame_pool_get_stats(const frame_pool_t *pool, frame_pool_stats_t *stats);
+
+/**
+ * @brief Write the counters as one JSON object
+ *
+ * @return Length of the JSON text (truncated to size - 1)
+ */
+size_t frame_pool_to_json(const frame_pool_t *pool, char *buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FRAME_POOL_H
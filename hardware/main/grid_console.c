@@ -0,0 +1,389 @@
+#include "grid_console.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_console.h"
+#include "argtable3/argtable3.h"
+#include "latency_hist.h"
+#include "trace_capture.h"
+
+#define GRID_CONSOLE_TAG "grid_console"
+#define RATE_MIN_INTERVAL_MS 10         // One tick at the default 100 Hz
+#define RATE_MAX_INTERVAL_MS 60000
+#define TASKS_DEFAULT_WINDOW_MS 1000
+#define HIST_BAR_WIDTH 40
+
+static const grid_console_ops_t *console_ops;
+
+static struct {
+    struct arg_dbl *hz;
+    struct arg_int *interval;
+    struct arg_end *end;
+} rate_args;
+
+static struct {
+    struct arg_int *window;
+    struct arg_end *end;
+} tasks_args;
+
+static struct {
+    struct arg_str *action;
+    struct arg_int *events;
+    struct arg_int *duration;
+    struct arg_end *end;
+} trace_args;
+
+static struct {
+    struct arg_str *action;
+    struct arg_lit *buckets;
+    struct arg_end *end;
+} latency_args;
+
+static void print_rate(uint32_t interval_ms)
+{
+    printf("Telemetry: %.2f Hz (%u ms)\n", 1000.0 / interval_ms, (unsigned)interval_ms);
+}
+
+static int cmd_rate(int argc, char **argv)
+{
+    if (arg_parse(argc, argv, (void **)&rate_args) != 0) {
+        arg_print_errors(stderr, rate_args.end, argv[0]);
+        return 1;
+    }
+
+    uint32_t interval_ms;
+    if (rate_args.interval->count > 0) {
+        interval_ms = rate_args.interval->ival[0] > 0 ? (uint32_t)rate_args.interval->ival[0] : 0;
+    } else if (rate_args.hz->count > 0) {
+        double hz = rate_args.hz->dval[0];
+        interval_ms = hz > 0 ? (uint32_t)(1000.0 / hz + 0.5) : 0;
+    } else {
+        print_rate(console_ops->get_interval_ms());
+        return 0;
+    }
+
+    if (interval_ms < RATE_MIN_INTERVAL_MS || interval_ms > RATE_MAX_INTERVAL_MS) {
+        printf("Period must be %d..%d ms\n", RATE_MIN_INTERVAL_MS, RATE_MAX_INTERVAL_MS);
+        return 1;
+    }
+    console_ops->set_interval_ms(interval_ms);
+    print_rate(interval_ms);
+    return 0;
+}
+
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+static const char *task_state_name(eTaskState state)
+{
+    switch (state) {
+    case eRunning: return "run";
+    case eReady: return "ready";
+    case eBlocked: return "block";
+    case eSuspended: return "susp";
+    default: return "?";
+    }
+}
+
+static TaskStatus_t *task_snapshot(UBaseType_t *count, configRUN_TIME_COUNTER_TYPE *total)
+{
+    // Room for tasks created between the count and the snapshot
+    UBaseType_t room = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t *tasks = malloc(room * sizeof(TaskStatus_t));
+    if (!tasks) {
+        return NULL;
+    }
+    *count = uxTaskGetSystemState(tasks, room, total);
+    if (*count == 0) {
+        free(tasks);
+        return NULL;
+    }
+    return tasks;
+}
+#endif
+
+// CPU share of each task over the window, from two run-time counter
+// snapshots; 100% is every core busy for the whole window
+static int cmd_tasks(int argc, char **argv)
+{
+    if (arg_parse(argc, argv, (void **)&tasks_args) != 0) {
+        arg_print_errors(stderr, tasks_args.end, argv[0]);
+        return 1;
+    }
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+    int window_ms = tasks_args.window->count > 0 ? tasks_args.window->ival[0] : TASKS_DEFAULT_WINDOW_MS;
+    if (window_ms < 10 || window_ms > 60000) {
+        printf("Window must be 10..60000 ms\n");
+        return 1;
+    }
+
+    UBaseType_t before_count, after_count;
+    configRUN_TIME_COUNTER_TYPE before_total, after_total;
+    TaskStatus_t *before = task_snapshot(&before_count, &before_total);
+    vTaskDelay(pdMS_TO_TICKS(window_ms));
+    TaskStatus_t *after = task_snapshot(&after_count, &after_total);
+    if (!before || !after) {
+        printf("Out of memory for the task list\n");
+        free(before);
+        free(after);
+        return 1;
+    }
+
+    configRUN_TIME_COUNTER_TYPE elapsed = (after_total - before_total) * configNUMBER_OF_CORES;
+    printf("%-16s %4s %5s %6s %7s\n", "task", "prio", "state", "stack", "cpu");
+    for (UBaseType_t i = 0; i < after_count; i++) {
+        const TaskStatus_t *task = &after[i];
+        configRUN_TIME_COUNTER_TYPE start = 0;
+        bool found = false;
+        for (UBaseType_t j = 0; j < before_count && !found; j++) {
+            if (before[j].xHandle == task->xHandle) {
+                start = before[j].ulRunTimeCounter;
+                found = true;
+            }
+        }
+        printf("%-16s %4u %5s %6u ", task->pcTaskName, (unsigned)task->uxCurrentPriority,
+               task_state_name(task->eCurrentState), (unsigned)task->usStackHighWaterMark);
+        if (!found) {
+            printf("%7s\n", "new");
+        } else if (elapsed == 0) {
+            printf("%7s\n", "-");
+        } else {
+            printf("%6.1f%%\n", 100.0 * (double)(task->ulRunTimeCounter - start) / (double)elapsed);
+        }
+    }
+    printf("%u tasks over %d ms; stack is the free high-water mark\n", (unsigned)after_count, window_ms);
+    free(before);
+    free(after);
+    return 0;
+#else
+    printf("Needs CONFIG_FREERTOS_USE_TRACE_FACILITY and CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS\n");
+    return 1;
+#endif
+}
+
+// Lag is the time since a subscriber was last sent a frame, against the
+// period its decimation gives it
+static int cmd_subs(int argc, char **argv)
+{
+    grid_console_subscriber_t subs[OUT_FLOW_SLOTS];
+    int count = console_ops->get_subscribers(subs, OUT_FLOW_SLOTS);
+    uint32_t interval_ms = console_ops->get_interval_ms();
+
+    if (count == 0) {
+        printf("No /out subscribers\n");
+        return 0;
+    }
+    printf("%-4s %-6s %-6s %6s %5s %8s %8s %5s %8s %9s\n", "slot", "format", "mode", "credit", "decim",
+           "rate_hz", "lag_ms", "stale", "sent", "coalesced");
+    for (int i = 0; i < count; i++) {
+        const grid_console_subscriber_t *s = &subs[i];
+        uint32_t decimation = s->flow.decimation ? s->flow.decimation : 1;
+        char lag[12];
+        if (s->since_sent_ms == UINT32_MAX) {
+            snprintf(lag, sizeof(lag), "-");
+        } else {
+            // Flag a subscriber more than two of its periods behind
+            bool late = s->since_sent_ms > 2 * interval_ms * decimation;
+            snprintf(lag, sizeof(lag), "%u%s", (unsigned)s->since_sent_ms, late ? "!" : "");
+        }
+        printf("%-4d %-6s %-6s %6u %5u %8.2f %8s %5s %8u %9u\n", s->slot, s->json ? "json" : "binary",
+               s->flow.credit_mode ? "credit" : "push", (unsigned)s->flow.credit, (unsigned)decimation,
+               1000.0 / (interval_ms * decimation), lag, s->flow.stale ? "yes" : "no", (unsigned)s->flow.sent,
+               (unsigned)s->flow.coalesced);
+    }
+    return 0;
+}
+
+static void print_trace_info(void)
+{
+    trace_capture_info_t info;
+    trace_capture_get_info(&info);
+    if (info.limit == 0) {
+        printf("No trace captured (buffer: %u events)\n", (unsigned)trace_capture_capacity());
+        return;
+    }
+    printf("Trace %s: %u of %u events, %u ms", info.armed ? "capturing" : "stopped", (unsigned)info.events,
+           (unsigned)info.limit, (unsigned)info.elapsed_ms);
+    if (info.duration_ms) {
+        printf(" of %u", (unsigned)info.duration_ms);
+    }
+    printf("\n");
+}
+
+static int cmd_trace(int argc, char **argv)
+{
+    if (arg_parse(argc, argv, (void **)&trace_args) != 0) {
+        arg_print_errors(stderr, trace_args.end, argv[0]);
+        return 1;
+    }
+
+    const char *action = trace_args.action->count > 0 ? trace_args.action->sval[0] : "";
+    if (!strcmp(action, "start")) {
+        int events = trace_args.events->count > 0 ? trace_args.events->ival[0] : 0;
+        int duration_ms = trace_args.duration->count > 0 ? trace_args.duration->ival[0] : 0;
+        if (events < 0 || duration_ms < 0) {
+            printf("Events and duration must not be negative\n");
+            return 1;
+        }
+        trace_capture_start((uint32_t)events, (uint32_t)duration_ms);
+    } else if (!strcmp(action, "stop")) {
+        trace_capture_stop();
+    } else if (!strcmp(action, "dump")) {
+        printf("%13s %9s  %-8s %-18s %s\n", "time", "delta", "task", "event", "arg");
+        trace_capture_dump(stdout);
+    } else if (action[0]) {
+        printf("Unknown action '%s'; use start, stop or dump\n", action);
+        return 1;
+    }
+    print_trace_info();
+    return 0;
+}
+
+static void print_buckets(const latency_hist_t *hist)
+{
+    uint32_t peak = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        peak = hist->buckets[b] > peak ? hist->buckets[b] : peak;
+    }
+    for (int b = 0; b < LATENCY_BUCKETS && peak > 0; b++) {
+        if (hist->buckets[b] == 0) {
+            continue;
+        }
+        int bar = (int)(((uint64_t)hist->buckets[b] * HIST_BAR_WIDTH + peak - 1) / peak);
+        uint32_t low = b ? latency_bucket_limit_us(b - 1) : 0;
+        if (b == LATENCY_BUCKETS - 1) {
+            printf("    >= %-8u us %8u  ", (unsigned)low, (unsigned)hist->buckets[b]);
+        } else {
+            printf("    %8u..%-8u us %8u  ", (unsigned)low, (unsigned)latency_bucket_limit_us(b),
+                   (unsigned)hist->buckets[b]);
+        }
+        printf("%.*s\n", bar, "########################################");
+    }
+}
+
+static int cmd_latency(int argc, char **argv)
+{
+    if (arg_parse(argc, argv, (void **)&latency_args) != 0) {
+        arg_print_errors(stderr, latency_args.end, argv[0]);
+        return 1;
+    }
+
+    const char *action = latency_args.action->count > 0 ? latency_args.action->sval[0] : "";
+    if (!strcmp(action, "reset")) {
+        latency_reset();
+        printf("Latency histograms cleared\n");
+        return 0;
+    } else if (action[0]) {
+        printf("Unknown action '%s'; use reset\n", action);
+        return 1;
+    }
+
+    // Percentiles are bucket upper bounds, so within a factor of two
+    printf("%-17s %8s %8s %8s %8s %8s %8s\n", "path (us)", "count", "mean", "p50", "p90", "p99", "max");
+    for (int p = 0; p < LATENCY_PATH_COUNT; p++) {
+        latency_hist_t hist;
+        latency_snapshot((latency_path_t)p, &hist);
+        printf("%-17s %8u %8u %8u %8u %8u %8u\n", latency_path_name((latency_path_t)p), (unsigned)hist.count,
+               hist.count ? (unsigned)(hist.sum_us / hist.count) : 0, (unsigned)latency_percentile_us(&hist, 0.50f),
+               (unsigned)latency_percentile_us(&hist, 0.90f), (unsigned)latency_percentile_us(&hist, 0.99f),
+               (unsigned)hist.max_us);
+        if (latency_args.buckets->count > 0) {
+            print_buckets(&hist);
+        }
+    }
+    return 0;
+}
+
+static void register_commands(void)
+{
+    rate_args.hz = arg_dbl0(NULL, NULL, "<hz>", "new telemetry rate");
+    rate_args.interval = arg_int0("i", "interval", "<ms>", "new telemetry period instead of a rate");
+    rate_args.end = arg_end(2);
+    const esp_console_cmd_t rate_cmd = {
+        .command = "rate",
+        .help = "Show or set the telemetry rate; applies from the next cycle",
+        .hint = NULL,
+        .func = &cmd_rate,
+        .argtable = &rate_args
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&rate_cmd));
+
+    tasks_args.window = arg_int0("w", "window", "<ms>", "measurement window (default 1000)");
+    tasks_args.end = arg_end(1);
+    const esp_console_cmd_t tasks_cmd = {
+        .command = "tasks",
+        .help = "Per-task CPU use, priority and free stack",
+        .hint = NULL,
+        .func = &cmd_tasks,
+        .argtable = &tasks_args
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&tasks_cmd));
+
+    const esp_console_cmd_t subs_cmd = {
+        .command = "subs",
+        .help = "/out subscribers: flow-control mode, credit, effective rate and lag ('!': over two periods)",
+        .hint = NULL,
+        .func = &cmd_subs,
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&subs_cmd));
+
+    trace_args.action = arg_str0(NULL, NULL, "<start|stop|dump>", "without one, show the capture state");
+    trace_args.events = arg_int0("n", "events", "<n>", "stop after n events (default: buffer size)");
+    trace_args.duration = arg_int0("d", "duration", "<ms>", "stop after ms (default: when full)");
+    trace_args.end = arg_end(3);
+    const esp_console_cmd_t trace_cmd = {
+        .command = "trace",
+        .help = "Capture an event trace of the telemetry and dispatch paths",
+        .hint = NULL,
+        .func = &cmd_trace,
+        .argtable = &trace_args
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&trace_cmd));
+
+    latency_args.action = arg_str0(NULL, NULL, "reset", "clear every histogram");
+    latency_args.buckets = arg_lit0("b", "buckets", "print the buckets too");
+    latency_args.end = arg_end(2);
+    const esp_console_cmd_t latency_cmd = {
+        .command = "latency",
+        .help = "Latency histograms since boot or the last reset",
+        .hint = NULL,
+        .func = &cmd_latency,
+        .argtable = &latency_args
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&latency_cmd));
+}
+
+esp_err_t grid_console_start(const grid_console_ops_t *ops)
+{
+    console_ops = ops;
+
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "griddy>";
+
+    esp_err_t ret;
+#if CONFIG_IDF_TARGET_LINUX
+    ret = esp_console_new_repl_stdio(&repl_config, &repl);
+#elif CONFIG_ESP_CONSOLE_UART_DEFAULT || CONFIG_ESP_CONSOLE_UART_CUSTOM
+    esp_console_dev_uart_config_t uart_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+    ret = esp_console_new_repl_uart(&uart_config, &repl_config, &repl);
+#elif CONFIG_ESP_CONSOLE_USB_CDC
+    esp_console_dev_usb_cdc_config_t cdc_config = ESP_CONSOLE_DEV_CDC_CONFIG_DEFAULT();
+    ret = esp_console_new_repl_usb_cdc(&cdc_config, &repl_config, &repl);
+#elif CONFIG_ESP_CONSOLE_USB_SERIAL_JTAG
+    esp_console_dev_usb_serial_jtag_config_t jtag_config = ESP_CONSOLE_DEV_USB_SERIAL_JTAG_CONFIG_DEFAULT();
+    ret = esp_console_new_repl_usb_serial_jtag(&jtag_config, &repl_config, &repl);
+#else
+    (void)repl_config;
+    ret = ESP_ERR_NOT_SUPPORTED;    // CONFIG_ESP_CONSOLE_NONE
+#endif
+    if (ret != ESP_OK) {
+        ESP_LOGW(GRID_CONSOLE_TAG, "No console: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    esp_console_register_help_command();
+    register_commands();
+    return esp_console_start_repl(repl);
+}
@@ -0,0 +1,59 @@
+#ifndef GRID_CONSOLE_H
+#define GRID_CONSOLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "out_flow.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Field console: esp_console commands on the UART (or USB) console of a
+ * chip, or on stdin/stdout for the Linux target.
+ *
+ *   rate [<hz>] [-i <ms>]            show or set the telemetry rate
+ *   tasks [-w <ms>]                  per-task CPU use over a window
+ *   subs                             /out subscribers: credit, decimation, lag
+ *   trace [start|stop|dump] [-n <events>] [-d <ms>]
+ *                                    event trace of the telemetry and dispatch paths
+ *   latency [reset]                  latency histograms (latency_hist.h)
+ *
+ * The commands run in the REPL task, below the telemetry and control
+ * priorities. State owned by power_grid.c is reached through the ops.
+ */
+
+typedef struct {
+    int slot;
+    bool json;                      // Subscribed on /out.json
+    out_flow_stats_t flow;
+    uint32_t since_sent_ms;         // Since its last frame went out; UINT32_MAX if none yet
+} grid_console_subscriber_t;
+
+typedef struct {
+    uint32_t (*get_interval_ms)(void);
+    /**
+     * Applies from the next telemetry cycle; the send task is woken so a
+     * long old period does not delay it.
+     */
+    void (*set_interval_ms)(uint32_t interval_ms);
+    /**
+     * Fill up to max connected /out subscribers; returns how many.
+     */
+    int (*get_subscribers)(grid_console_subscriber_t *subscribers, int max);
+} grid_console_ops_t;
+
+/**
+ * @brief Register the commands and start the REPL task
+ *
+ * @param ops Must stay valid; used from the REPL task
+ */
+esp_err_t grid_console_start(const grid_console_ops_t *ops);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GRID_CONSOLE_H
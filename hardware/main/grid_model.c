@@ -0,0 +1,352 @@
+#include "grid_model.h"
+#include "telemetry_json.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// xorshift32: deterministic per seed so simulated fleets are reproducible
+static uint32_t next_random(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static float random_unit(uint32_t *state)
+{
+    return (next_random(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+void grid_model_init(grid_model_t *model, const uint8_t *node_ids, int count, uint32_t seed)
+{
+    uint32_t state = seed ? seed : 0x9E3779B9u;
+
+    if (count < 0) count = 0;
+    if (count > GRID_MODEL_MAX_NODES) count = GRID_MODEL_MAX_NODES;
+
+    memset(model, 0, sizeof(*model));
+    model->wave_scale = 1.0f;
+    model->node_count = count;
+    model->exception.keyframe_interval = 1;
+    model->exception.keyframe_due = 1;
+
+    for (int i = 0; i < count; i++) {
+        model->nodes[i] = (grid_node_t){
+            .id = node_ids[i],
+            .type = NODE_TYPE_CONSUMER,
+            .demand = 2.0f + (i * 0.3f),
+            .fulfillment = 0.88f + (i * 0.02f)
+        };
+
+        grid_node_phase_t *phase = &model->phases[i];
+        phase->demand_phase = random_unit(&state) * 2.0f * M_PI;
+        phase->fulfillment_phase = random_unit(&state) * 2.0f * M_PI;
+        phase->freq_variation = 0.9f + random_unit(&state) * 0.2f;
+
+        model->reports[i] = (grid_node_report_t){ .demand_deadband = -1.0f, .fulfillment_deadband = -1.0f };
+        model->plant_state[i] = (grid_node_plant_t){ .demand_target = model->nodes[i].demand };
+    }
+}
+
+int grid_model_add_node(grid_model_t *model, uint16_t id, uint8_t type, uint32_t seed)
+{
+    uint32_t state = seed ? seed : 0x9E3779B9u;
+    int slot = model->node_count;
+
+    if (slot >= GRID_MODEL_MAX_NODES) {
+        return -1;
+    }
+
+    model->nodes[slot] = (grid_node_t){
+        .id = id,
+        .type = type,
+        .demand = type == NODE_TYPE_CONSUMER ? 2.0f : 0.0f,
+        .fulfillment = 0.88f
+    };
+
+    grid_node_phase_t *phase = &model->phases[slot];
+    phase->demand_phase = random_unit(&state) * 2.0f * M_PI;
+    phase->fulfillment_phase = random_unit(&state) * 2.0f * M_PI;
+    phase->freq_variation = 0.9f + random_unit(&state) * 0.2f;
+
+    model->reports[slot] = (grid_node_report_t){ .demand_deadband = -1.0f, .fulfillment_deadband = -1.0f };
+    model->plant_state[slot] = (grid_node_plant_t){ .demand_target = model->nodes[slot].demand };
+    model->node_count++;
+    return slot;
+}
+
+void grid_model_remove_node(grid_model_t *model, int slot)
+{
+    if (slot < 0 || slot >= model->node_count) {
+        return;
+    }
+
+    int last = model->node_count - 1;
+    model->nodes[slot] = model->nodes[last];
+    model->phases[slot] = model->phases[last];
+    model->reports[slot] = model->reports[last];
+    model->plant_state[slot] = model->plant_state[last];
+    model->node_count--;
+
+    // Receivers only drop a node when a keyframe no longer lists it
+    model->exception.keyframe_due = 1;
+}
+
+void grid_model_set_plant(grid_model_t *model, const grid_plant_config_t *plant)
+{
+    model->closed_loop = plant != NULL;
+    model->plant_started = 0;
+    if (!plant) {
+        return;
+    }
+    model->plant = *plant;
+    for (int i = 0; i < model->node_count; i++) {
+        model->plant_state[i].delivered = 0.0f;
+        model->plant_state[i].demand_target = model->nodes[i].demand;
+    }
+}
+
+void grid_model_set_supply(grid_model_t *model, int slot, float duty)
+{
+    if (slot < 0 || slot >= model->node_count) {
+        return;
+    }
+    model->plant_state[slot].duty = duty < 0.0f ? 0.0f : duty > 1.0f ? 1.0f : duty;
+}
+
+// Step response of a first-order lag over dt
+static float lag_alpha(float dt_s, float tau_s)
+{
+    if (tau_s <= 0.0f) {
+        return 1.0f;
+    }
+    return dt_s > 0.0f ? 1.0f - expf(-dt_s / tau_s) : 0.0f;
+}
+
+// Advance the closed loop by dt: duties are held over the step, so the lags
+// are exact whatever the update rate
+static void plant_step(grid_model_t *model, float dt_s)
+{
+    const grid_plant_config_t *plant = &model->plant;
+    float demand_alpha = model->plant_started ? lag_alpha(dt_s, plant->demand_tau_s) : 1.0f;
+    float supply_alpha = model->plant_started ? lag_alpha(dt_s, plant->supply_tau_s) : 0.0f;
+    model->plant_started = 1;
+
+    float requested = 0.0f;
+    for (int i = 0; i < model->node_count; i++) {
+        if (model->nodes[i].type == NODE_TYPE_CONSUMER) {
+            requested += model->plant_state[i].duty * plant->output_max;
+        }
+    }
+    float scale = requested > plant->source_capacity ? plant->source_capacity / requested : 1.0f;
+    float utilization = plant->source_capacity > 0.0f ? requested * scale / plant->source_capacity : 0.0f;
+
+    for (int i = 0; i < model->node_count; i++) {
+        grid_node_t *node = &model->nodes[i];
+        grid_node_plant_t *state = &model->plant_state[i];
+
+        if (node->type != NODE_TYPE_CONSUMER) {
+            node->demand = 0.0f;
+            node->fulfillment = utilization;
+            continue;
+        }
+        node->demand += (state->demand_target - node->demand) * demand_alpha;
+
+        float current = state->duty * plant->output_max * scale;
+        float loss = plant->output_max > 0.0f ? plant->line_loss * current / plant->output_max : 0.0f;
+        float target = current * (1.0f - (loss < 1.0f ? loss : 1.0f));
+        state->delivered += (target - state->delivered) * supply_alpha;
+
+        // Below 10 mA of demand a node counts as fully served
+        node->fulfillment = node->demand > 0.01f ? state->delivered / node->demand : 1.0f;
+    }
+}
+
+void grid_model_update(grid_model_t *model, int64_t time_us)
+{
+    float time_s = time_us / 1000000.0f;
+    int64_t elapsed_us = time_us - (int64_t)model->timestamp_us;
+    float dt_s = elapsed_us > 0 ? elapsed_us * 1e-6f : 0.0f;
+
+    model->timestamp_us = (uint64_t)time_us;
+
+    for (int i = 0; i < model->node_count; i++) {
+        grid_node_t *node = &model->nodes[i];
+        const grid_node_phase_t *phase = &model->phases[i];
+
+        node->fields = 0;
+        if (node->type == NODE_TYPE_CONSUMER) {
+            // Demand varies sinusoidally between 0.5 and 4.0
+            float base_demand = 2.25f;
+            float demand_amplitude = 1.75f;
+            float demand_freq = 0.2f * phase->freq_variation;
+            float demand = base_demand + model->demand_offset +
+                           model->wave_scale * demand_amplitude * sinf(2.0f * M_PI * demand_freq * time_s + phase->demand_phase);
+            if (model->closed_loop) {
+                model->plant_state[i].demand_target = demand;
+                continue;
+            }
+            node->demand = demand;
+
+            // Fulfillment varies between 0.7 and 1.0 with independent phase and frequency
+            float base_ff = 0.85f;
+            float ff_amplitude = 0.15f;
+            float ff_freq = 0.12f * phase->freq_variation;
+            node->fulfillment = base_ff +
+                                model->wave_scale * ff_amplitude * sinf(2.0f * M_PI * ff_freq * time_s + phase->fulfillment_phase);
+        } else if (!model->closed_loop) {
+            // Power generators have zero demand
+            node->demand = 0.0f;
+
+            // Generator fulfillment varies between 0.8 and 1.0
+            float base_ff = 0.9f;
+            float ff_amplitude = 0.1f;
+            float ff_freq = 0.06f * phase->freq_variation;
+            node->fulfillment = base_ff +
+                                model->wave_scale * ff_amplitude * sinf(2.0f * M_PI * ff_freq * time_s + phase->fulfillment_phase);
+        }
+    }
+
+    if (model->closed_loop) {
+        plant_step(model, dt_s);
+    }
+}
+
+static void copy_node(telemetry_node_t *dst, const grid_node_t *src)
+{
+    dst->id = src->id;
+    dst->type = src->type;
+    dst->demand = src->demand;
+    dst->fulfillment = src->fulfillment;
+    dst->fields = src->fields;
+    memcpy(dst->field, src->field, sizeof(dst->field));
+}
+
+size_t grid_model_encode(const grid_model_t *model, uint8_t *buffer)
+{
+    telemetry_packet_t packet;
+
+    if (model->node_count > MAX_NODES_PER_PACKET) {
+        return 0;
+    }
+
+    packet.magic = TELEMETRY_MAGIC;
+    packet.timestamp_us = model->timestamp_us;
+    packet.node_count = (uint8_t)model->node_count;
+
+    for (int i = 0; i < model->node_count; i++) {
+        copy_node(&packet.nodes[i], &model->nodes[i]);
+    }
+
+    return encode_telemetry(&packet, buffer);
+}
+
+size_t grid_model_encode_json(const grid_node_t *nodes, int node_count, uint64_t timestamp_us, char *buffer,
+                              size_t size)
+{
+    telemetry_json_t json;
+
+    telemetry_json_begin(&json, buffer, size, timestamp_us);
+    for (int i = 0; i < node_count; i++) {
+        const grid_node_t *node = &nodes[i];
+        telemetry_json_node(&json, node->id, node->type, node->demand, node->fulfillment, node->fields, node->field);
+    }
+    return telemetry_json_end(&json);
+}
+
+void grid_model_set_exception(grid_model_t *model, float demand_deadband, float fulfillment_deadband,
+                              uint16_t keyframe_interval)
+{
+    model->exception.demand_deadband = demand_deadband;
+    model->exception.fulfillment_deadband = fulfillment_deadband;
+    model->exception.keyframe_interval = keyframe_interval ? keyframe_interval : 1;
+    model->exception.keyframe_due = 1;
+}
+
+void grid_model_set_deadband(grid_model_t *model, int slot, float demand_deadband, float fulfillment_deadband)
+{
+    if (slot < 0 || slot >= model->node_count) {
+        return;
+    }
+    model->reports[slot].demand_deadband = demand_deadband;
+    model->reports[slot].fulfillment_deadband = fulfillment_deadband;
+}
+
+size_t grid_model_encode_exception(grid_model_t *model, uint8_t *buffer)
+{
+    grid_model_exception_t *ex = &model->exception;
+    telemetry_packet_t packet;
+
+    if (model->node_count > MAX_NODES_PER_PACKET) {
+        return 0;
+    }
+
+    bool keyframe = ex->keyframe_due || ++ex->since_keyframe >= ex->keyframe_interval;
+    if (keyframe) {
+        ex->keyframe_due = 0;
+        ex->since_keyframe = 0;
+    }
+    ex->started = 1;
+
+    packet.magic = TELEMETRY_DELTA_MAGIC;
+    packet.timestamp_us = model->timestamp_us;
+    packet.seq = ex->seq++;
+    packet.flags = keyframe ? TELEMETRY_DELTA_KEYFRAME : 0;
+    packet.node_count = 0;
+
+    for (int i = 0; i < model->node_count; i++) {
+        const grid_node_t *node = &model->nodes[i];
+        grid_node_report_t *report = &model->reports[i];
+        float demand_band = report->demand_deadband >= 0.0f ? report->demand_deadband : ex->demand_deadband;
+        float ff_band = report->fulfillment_deadband >= 0.0f ? report->fulfillment_deadband : ex->fulfillment_deadband;
+
+        if (!keyframe && report->reported &&
+            fabsf(node->demand - report->demand) <= demand_band &&
+            fabsf(node->fulfillment - report->fulfillment) <= ff_band) {
+            continue;
+        }
+
+        copy_node(&packet.nodes[packet.node_count++], node);
+        report->demand = node->demand;
+        report->fulfillment = node->fulfillment;
+        report->reported = 1;
+    }
+
+    return encode_telemetry(&packet, buffer);
+}
+
+size_t grid_model_encode_resync(const grid_model_t *model, uint8_t *buffer)
+{
+    const grid_model_exception_t *ex = &model->exception;
+    telemetry_packet_t packet;
+
+    if (model->node_count > MAX_NODES_PER_PACKET || !ex->started) {
+        return 0;
+    }
+
+    packet.magic = TELEMETRY_DELTA_MAGIC;
+    packet.timestamp_us = model->timestamp_us;
+    packet.seq = (uint16_t)(ex->seq - 1);
+    packet.flags = TELEMETRY_DELTA_KEYFRAME;
+    packet.node_count = 0;
+
+    // Only what was reported: a node added since the last frame arrives in
+    // the next delta like it does for everyone else
+    for (int i = 0; i < model->node_count; i++) {
+        if (!model->reports[i].reported) {
+            continue;
+        }
+        telemetry_node_t *dst = &packet.nodes[packet.node_count++];
+        copy_node(dst, &model->nodes[i]);
+        dst->demand = model->reports[i].demand;
+        dst->fulfillment = model->reports[i].fulfillment;
+    }
+
+    return encode_telemetry(&packet, buffer);
+}
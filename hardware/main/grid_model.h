@@ -0,0 +1,227 @@
+#ifndef GRID_MODEL_H
+#define GRID_MODEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "binary_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Dummy node model shared by the firmware and the host fleet simulator.
+ *
+ * Consumers draw a sinusoidal demand between 0.5 and 4.0 A with an
+ * independent fulfillment wave between 0.7 and 1.0; generators report zero
+ * demand. Every node gets a random phase and a ±10% frequency variation so a
+ * grid does not move in lockstep. The model has no platform dependencies:
+ * callers supply the time and the random seed.
+ *
+ * With a plant configured (grid_model_set_plant) the loop is closed:
+ * fulfillment follows the duty cycles actually applied to the outputs
+ * instead of a wave of its own.
+ *   - Each consumer's output draws duty * output_max from one source.
+ *   - When the outputs together ask for more than source_capacity, every
+ *     output is scaled down alike (brownout).
+ *   - Line loss grows with the current carried: line_loss at full output
+ *     current (I²R), less in proportion below it.
+ *   - Delivered current follows that target with a first-order lag
+ *     (supply_tau_s). Demand keeps its wave but settles after a change with
+ *     demand_tau_s, like a load's inrush and ramp.
+ *   - Fulfillment is delivered / demand and exceeds 1 when a node is
+ *     oversupplied, so a controller can see waste as well as shortfall.
+ *   - Generators report the source's utilization as their fulfillment.
+ */
+
+#ifndef GRID_MODEL_MAX_NODES
+#define GRID_MODEL_MAX_NODES 8      // Host tools build with 255
+#endif
+
+typedef struct {
+    uint16_t id;
+    uint8_t type;               // NODE_TYPE_POWER / NODE_TYPE_CONSUMER
+    float demand;               // Amps
+    float fulfillment;          // Fraction of demand met
+    uint8_t fields;             // TELEMETRY_FIELD_* set in field[] since the last update
+    float field[TELEMETRY_FIELD_COUNT];  // Sensed min, max, mean, rms (amps)
+} grid_node_t;
+
+typedef struct {
+    float demand_phase;         // Phase offset for demand sine wave
+    float fulfillment_phase;    // Phase offset for fulfillment sine wave
+    float freq_variation;       // Frequency multiplier (0.9 to 1.1)
+} grid_node_phase_t;
+
+typedef struct {
+    float source_capacity;      // Amps the source delivers across all outputs
+    float output_max;           // Amps one output carries at full duty
+    float line_loss;            // Fraction lost at output_max, proportional to current
+    float supply_tau_s;         // Delivered current lag behind a duty change
+    float demand_tau_s;         // Load settling after a demand change
+} grid_plant_config_t;
+
+// Closed-loop state per node
+typedef struct {
+    float duty;                 // Applied duty, 0..1
+    float delivered;            // Amps reaching the load
+    float demand_target;        // Demand the load settles towards
+} grid_node_plant_t;
+
+// Report-by-exception bookkeeping per node
+typedef struct {
+    float demand;               // Values sent in the node's last report
+    float fulfillment;
+    float demand_deadband;      // Amps; negative = model default
+    float fulfillment_deadband; // Fraction; negative = model default
+    uint8_t reported;           // 0 until the node is first reported
+} grid_node_report_t;
+
+typedef struct {
+    float demand_deadband;      // Default deadbands
+    float fulfillment_deadband;
+    uint16_t keyframe_interval; // A keyframe every this many frames (1 = always)
+    uint16_t since_keyframe;
+    uint16_t seq;               // Sequence number of the next delta frame
+    uint8_t keyframe_due;       // Next frame must be a keyframe (start, removal, new subscriber)
+    uint8_t started;            // A frame has been encoded
+} grid_model_exception_t;
+
+typedef struct {
+    uint64_t timestamp_us;      // Microseconds, from the last update
+    float demand_offset;        // Amps added to every consumer's demand (step tests)
+    float wave_scale;           // Sine amplitude multiplier: 1 = normal, 0 = flat demand
+    int node_count;
+    grid_node_t nodes[GRID_MODEL_MAX_NODES];
+    grid_node_phase_t phases[GRID_MODEL_MAX_NODES];
+    grid_node_report_t reports[GRID_MODEL_MAX_NODES];
+    grid_model_exception_t exception;
+    uint8_t closed_loop;        // A plant is configured
+    uint8_t plant_started;      // The plant has been stepped once
+    grid_plant_config_t plant;
+    grid_node_plant_t plant_state[GRID_MODEL_MAX_NODES];
+} grid_model_t;
+
+/**
+ * @brief Initialize a model with consumer nodes
+ *
+ * Base demand and fulfillment are staggered by slot, matching the original
+ * firmware grid (2.0, 2.3, 2.6 ... A and 88, 90, 92 ... %).
+ *
+ * @param model Model to initialize
+ * @param node_ids Node ids, one per slot
+ * @param count Number of nodes (clamped to GRID_MODEL_MAX_NODES)
+ * @param seed Seed for phase randomization; 0 is replaced by a fixed value
+ */
+void grid_model_init(grid_model_t *model, const uint8_t *node_ids, int count, uint32_t seed);
+
+/**
+ * @brief Append a node at runtime
+ *
+ * @param model Model to extend
+ * @param id Node id
+ * @param type NODE_TYPE_POWER / NODE_TYPE_CONSUMER
+ * @param seed Seed for the node's phase and frequency variation
+ * @return Slot of the new node, or -1 if the model is full
+ */
+int grid_model_add_node(grid_model_t *model, uint16_t id, uint8_t type, uint32_t seed);
+
+/**
+ * @brief Remove the node in a slot; the last node moves into it
+ *
+ * @param model Model to shrink
+ * @param slot Slot to remove
+ */
+void grid_model_remove_node(grid_model_t *model, int slot);
+
+/**
+ * @brief Advance every node to the given time
+ *
+ * Clears the optional fields; the caller sets them for the new period.
+ *
+ * @param model Model to update
+ * @param time_us Monotonic time in microseconds
+ */
+void grid_model_update(grid_model_t *model, int64_t time_us);
+
+/**
+ * @brief Close the loop with a plant, or open it again with NULL
+ *
+ * Delivered current starts at zero, so nodes start unserved until duties
+ * are applied.
+ */
+void grid_model_set_plant(grid_model_t *model, const grid_plant_config_t *plant);
+
+/**
+ * @brief Record the duty applied to a node's output (0..1)
+ *
+ * Takes effect from the next grid_model_update(). Kept in open loop too,
+ * so a plant configured later starts from the duties already applied.
+ */
+void grid_model_set_supply(grid_model_t *model, int slot, float duty);
+
+/**
+ * @brief Encode the current model state as a telemetry frame
+ *
+ * @param model Model to encode
+ * @param buffer Output buffer, at least telemetry_max_packet_size(node_count) bytes
+ * @return Encoded size in bytes, or 0 on error
+ */
+size_t grid_model_encode(const grid_model_t *model, uint8_t *buffer);
+
+/**
+ * @brief Write nodes as a JSON telemetry frame (see telemetry_json.h)
+ *
+ * Takes nodes rather than the model, so the firmware can write a snapshot
+ * copied out under its lock.
+ *
+ * @param buffer Output buffer, at least telemetry_json_max_size(node_count) bytes
+ * @return Frame length, or 0 if it did not fit
+ */
+size_t grid_model_encode_json(const grid_node_t *nodes, int node_count, uint64_t timestamp_us, char *buffer,
+                              size_t size);
+
+/**
+ * @brief Configure report-by-exception encoding
+ *
+ * @param demand_deadband Default demand deadband in amps
+ * @param fulfillment_deadband Default fulfillment deadband (fraction)
+ * @param keyframe_interval Frames per keyframe, at least 1
+ */
+void grid_model_set_exception(grid_model_t *model, float demand_deadband, float fulfillment_deadband,
+                              uint16_t keyframe_interval);
+
+/**
+ * @brief Set one node's deadbands; negative values select the default
+ */
+void grid_model_set_deadband(grid_model_t *model, int slot, float demand_deadband, float fulfillment_deadband);
+
+/**
+ * @brief Encode a report-by-exception (GRDD) frame and record what it reported
+ *
+ * Keyframes carry every node; other frames carry the nodes whose demand or
+ * fulfillment moved beyond their deadband since their last report, and new
+ * nodes. A frame is produced even with no nodes, so receivers see the
+ * sequence advance.
+ *
+ * @param buffer Output buffer, at least telemetry_max_packet_size(node_count) bytes
+ * @return Encoded size in bytes, or 0 on error
+ */
+size_t grid_model_encode_exception(grid_model_t *model, uint8_t *buffer);
+
+/**
+ * @brief Encode a keyframe of the last reported values, without advancing
+ *
+ * For a subscriber that missed frames: the keyframe has the sequence number
+ * of the last frame sent, so the next delta follows it, and carries exactly
+ * the state every in-sync receiver holds.
+ *
+ * @return Encoded size in bytes, or 0 before the first frame
+ */
+size_t grid_model_encode_resync(const grid_model_t *model, uint8_t *buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // GRID_MODEL_H
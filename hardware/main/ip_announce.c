@@ -0,0 +1,188 @@
+#include "ip_announce.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_system.h"
+#include "esp_http_client.h"
+#include "sdkconfig.h"
+#include "boot_trace.h"
+
+#ifndef CONFIG_POWER_GRID_IP_PUBLISH_URL
+#define CONFIG_POWER_GRID_IP_PUBLISH_URL "http://kv.wfeng.dev/hackmit25:ip"
+#endif
+#ifndef CONFIG_POWER_GRID_IP_PUBLISH_TIMEOUT_MS
+#define CONFIG_POWER_GRID_IP_PUBLISH_TIMEOUT_MS 5000
+#endif
+#ifndef CONFIG_POWER_GRID_IP_PUBLISH_BACKOFF_MAX_MS
+#define CONFIG_POWER_GRID_IP_PUBLISH_BACKOFF_MAX_MS 60000
+#endif
+#ifndef CONFIG_POWER_GRID_MDNS
+#define CONFIG_POWER_GRID_MDNS 0
+#endif
+
+#if CONFIG_POWER_GRID_MDNS
+#include "mdns.h"
+#endif
+
+#define IP_ANNOUNCE_TAG "ip_announce"
+#define IP_ANNOUNCE_BACKOFF_MIN_MS 1000
+#define IP_ANNOUNCE_TASK_PRIORITY 2  // Below httpd and the telemetry task
+#define IP_ANNOUNCE_STACK_SIZE 4096
+
+static TaskHandle_t announce_task = NULL;
+static uint32_t pending_ip = 0;  // Latest station address from IP_EVENT_STA_GOT_IP
+static ip_announce_stats_t stats;
+static portMUX_TYPE announce_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void on_got_ip(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    const ip_event_got_ip_t *event = (const ip_event_got_ip_t *)data;
+
+    portENTER_CRITICAL(&announce_lock);
+    pending_ip = event->ip_info.ip.addr;
+    portEXIT_CRITICAL(&announce_lock);
+
+    boot_trace_mark(BOOT_PHASE_NETIF_UP);
+    xTaskNotifyGive(announce_task);
+}
+
+// One POST of the dotted address; true on a 2xx answer
+static bool post_ip(uint32_t ip)
+{
+    esp_ip4_addr_t addr = { .addr = ip };
+    char ip_str[16];
+    snprintf(ip_str, sizeof(ip_str), IPSTR, IP2STR(&addr));
+
+    esp_http_client_config_t config = {
+        .url = CONFIG_POWER_GRID_IP_PUBLISH_URL,
+        .method = HTTP_METHOD_POST,
+        .timeout_ms = CONFIG_POWER_GRID_IP_PUBLISH_TIMEOUT_MS,
+    };
+
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (!client) {
+        return false;
+    }
+    esp_http_client_set_post_field(client, ip_str, strlen(ip_str));
+    esp_http_client_set_header(client, "Content-Type", "text/plain");
+
+    esp_err_t err = esp_http_client_perform(client);
+    int status = (err == ESP_OK) ? esp_http_client_get_status_code(client) : -1;
+    esp_http_client_cleanup(client);
+
+    bool ok = status >= 200 && status < 300;
+
+    portENTER_CRITICAL(&announce_lock);
+    stats.attempts++;
+    stats.last_status = status;
+    if (ok) {
+        stats.published++;
+        stats.last_ip = ip;
+    }
+    portEXIT_CRITICAL(&announce_lock);
+
+    if (ok) {
+        ESP_LOGI(IP_ANNOUNCE_TAG, "IP address %s posted successfully, status: %d", ip_str, status);
+    } else if (err != ESP_OK) {
+        ESP_LOGW(IP_ANNOUNCE_TAG, "Failed to post IP address %s: %s", ip_str, esp_err_to_name(err));
+    } else {
+        ESP_LOGW(IP_ANNOUNCE_TAG, "IP address %s rejected, status: %d", ip_str, status);
+    }
+    return ok;
+}
+
+#if CONFIG_POWER_GRID_MDNS
+// Advertise <hostname>.local and a _griddy._tcp service for the WebSocket server.
+// mDNS follows later address changes on its own.
+static bool start_mdns(void)
+{
+    esp_err_t err = mdns_init();
+    if (err == ESP_OK) {
+        err = mdns_hostname_set(CONFIG_POWER_GRID_MDNS_HOSTNAME);
+    }
+    if (err == ESP_OK) {
+        mdns_txt_item_t txt[] = {
+            {"out", "/out"},
+            {"in", "/in"},
+        };
+        err = mdns_service_add(NULL, "_griddy", "_tcp", 80, txt, sizeof(txt) / sizeof(txt[0]));
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGW(IP_ANNOUNCE_TAG, "mDNS advertisement failed: %s", esp_err_to_name(err));
+        return false;
+    }
+    boot_trace_mark(BOOT_PHASE_MDNS_READY);
+    ESP_LOGI(IP_ANNOUNCE_TAG, "mDNS: %s.local, service _griddy._tcp", CONFIG_POWER_GRID_MDNS_HOSTNAME);
+    return true;
+}
+#endif
+
+static void ip_announce_task(void *pvParameters)
+{
+    uint32_t published_ip = 0;
+#if CONFIG_POWER_GRID_MDNS
+    bool mdns_started = false;
+#endif
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+#if CONFIG_POWER_GRID_MDNS
+        if (!mdns_started) {
+            mdns_started = start_mdns();
+        }
+#endif
+
+        uint32_t backoff_ms = IP_ANNOUNCE_BACKOFF_MIN_MS;
+        while (CONFIG_POWER_GRID_IP_PUBLISH_URL[0] != '\0') {
+            portENTER_CRITICAL(&announce_lock);
+            uint32_t ip = pending_ip;
+            portEXIT_CRITICAL(&announce_lock);
+
+            if (ip == 0 || ip == published_ip) {
+                break;
+            }
+            if (post_ip(ip)) {
+                published_ip = ip;
+                boot_trace_mark(BOOT_PHASE_IP_PUBLISHED);
+                break;
+            }
+
+            // Jittered so a fleet rebooting together does not retry in lockstep.
+            // A new address cuts the wait short.
+            uint32_t delay_ms = backoff_ms + esp_random() % (backoff_ms / 4 + 1);
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(delay_ms));
+            backoff_ms *= 2;
+            if (backoff_ms > CONFIG_POWER_GRID_IP_PUBLISH_BACKOFF_MAX_MS) {
+                backoff_ms = CONFIG_POWER_GRID_IP_PUBLISH_BACKOFF_MAX_MS;
+            }
+        }
+    }
+}
+
+esp_err_t ip_announce_start(void)
+{
+    if (announce_task) {
+        return ESP_OK;
+    }
+
+    if (xTaskCreate(ip_announce_task, "ip_announce", IP_ANNOUNCE_STACK_SIZE, NULL,
+                    IP_ANNOUNCE_TASK_PRIORITY, &announce_task) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    return esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, on_got_ip, NULL);
+}
+
+void ip_announce_get_stats(ip_announce_stats_t *out)
+{
+    portENTER_CRITICAL(&announce_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&announce_lock);
+}
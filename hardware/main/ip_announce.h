@@ -0,0 +1,48 @@
+#ifndef IP_ANNOUNCE_H
+#define IP_ANNOUNCE_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Background IP announcement.
+ *
+ * A low-priority task publishes the station IP to the key-value store the
+ * backend reads (CONFIG_POWER_GRID_IP_PUBLISH_URL) and, if enabled, advertises
+ * the WebSocket server over mDNS. It wakes on every IP_EVENT_STA_GOT_IP, so an
+ * address change after a reconnect is republished. Failed posts are retried
+ * with capped exponential backoff plus jitter; nothing on the telemetry or
+ * dispatch path ever waits for it.
+ */
+
+typedef struct {
+    uint32_t attempts;      // HTTP posts tried
+    uint32_t published;     // Posts answered with a 2xx status
+    uint32_t last_ip;       // Last address published (network byte order), 0 if none
+    int last_status;        // HTTP status of the last post, or -1 on transport error
+} ip_announce_stats_t;
+
+/**
+ * @brief Start the announce task and subscribe to IP_EVENT_STA_GOT_IP
+ *
+ * Call after esp_event_loop_create_default() and before the station connects,
+ * so the first address is not missed.
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t ip_announce_start(void);
+
+/**
+ * @brief Snapshot announce counters
+ */
+void ip_announce_get_stats(ip_announce_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IP_ANNOUNCE_H
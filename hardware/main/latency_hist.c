@@ -0,0 +1,92 @@
+#include "latency_hist.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+
+#define LATENCY_PATH_NAME_ENTRY(id, name) name,
+static const char *const path_names[LATENCY_PATH_COUNT] = {
+    LATENCY_PATHS(LATENCY_PATH_NAME_ENTRY)
+};
+#undef LATENCY_PATH_NAME_ENTRY
+
+static latency_hist_t hists[LATENCY_PATH_COUNT];
+static portMUX_TYPE latency_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int bucket_of(uint32_t us)
+{
+    if (us == 0) {
+        return 0;
+    }
+    int bucket = 32 - __builtin_clz(us);
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+void latency_record(latency_path_t path, int64_t us)
+{
+    if ((unsigned)path >= LATENCY_PATH_COUNT) {
+        return;
+    }
+    uint32_t sample = us <= 0 ? 0 : us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+    int bucket = bucket_of(sample);
+
+    // 64-bit adds are not atomic on Xtensa
+    portENTER_CRITICAL(&latency_lock);
+    latency_hist_t *h = &hists[path];
+    h->count++;
+    h->sum_us += sample;
+    if (sample > h->max_us) {
+        h->max_us = sample;
+    }
+    h->buckets[bucket]++;
+    portEXIT_CRITICAL(&latency_lock);
+}
+
+void latency_snapshot(latency_path_t path, latency_hist_t *hist)
+{
+    if ((unsigned)path >= LATENCY_PATH_COUNT) {
+        memset(hist, 0, sizeof(*hist));
+        return;
+    }
+    portENTER_CRITICAL(&latency_lock);
+    *hist = hists[path];
+    portEXIT_CRITICAL(&latency_lock);
+}
+
+void latency_reset(void)
+{
+    portENTER_CRITICAL(&latency_lock);
+    memset(hists, 0, sizeof(hists));
+    portEXIT_CRITICAL(&latency_lock);
+}
+
+const char *latency_path_name(latency_path_t path)
+{
+    return (unsigned)path < LATENCY_PATH_COUNT ? path_names[path] : "?";
+}
+
+uint32_t latency_bucket_limit_us(int bucket)
+{
+    if (bucket < 0) {
+        return 0;
+    }
+    return bucket < LATENCY_BUCKETS - 1 ? (uint32_t)1 << bucket : UINT32_MAX;
+}
+
+uint32_t latency_percentile_us(const latency_hist_t *hist, float fraction)
+{
+    if (hist->count == 0) {
+        return 0;
+    }
+    uint32_t rank = (uint32_t)(fraction * hist->count + 0.5f);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint32_t seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += hist->buckets[b];
+        if (seen >= rank) {
+            uint32_t limit = latency_bucket_limit_us(b);
+            return limit < hist->max_us ? limit : hist->max_us;
+        }
+    }
+    return hist->max_us;
+}
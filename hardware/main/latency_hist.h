@@ -0,0 +1,79 @@
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Latency histograms for the telemetry and dispatch paths.
+ *
+ * Each path keeps a count, sum, maximum and power-of-two buckets in
+ * microseconds: bucket 0 holds 0 µs, bucket b holds [2^(b-1), 2^b) µs and the
+ * last bucket everything from 2^(LATENCY_BUCKETS-2) µs (about 4 s) up.
+ * Recording is a few increments under a spinlock, cheap enough to leave on
+ * in the field.
+ */
+
+// X(id, name)
+#define LATENCY_PATHS(X) \
+    X(LATENCY_CYCLE_WAKE,       "cycle_wake")       /* Telemetry task woken past its period */ \
+    X(LATENCY_TELEMETRY_BUILD,  "telemetry_build")  /* Model update and encode, under node_lock */ \
+    X(LATENCY_TELEMETRY_FANOUT, "telemetry_fanout") /* Sends to every /out subscriber */ \
+    X(LATENCY_DISPATCH_APPLY,   "dispatch_apply")   /* /in message received to duties latched */
+
+#define LATENCY_PATH_ENUM_ENTRY(id, name) id,
+typedef enum {
+    LATENCY_PATHS(LATENCY_PATH_ENUM_ENTRY)
+    LATENCY_PATH_COUNT
+} latency_path_t;
+#undef LATENCY_PATH_ENUM_ENTRY
+
+#define LATENCY_BUCKETS 24
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t buckets[LATENCY_BUCKETS];
+} latency_hist_t;
+
+/**
+ * @brief Add one sample (any task, not ISR); negative samples count as 0
+ */
+void latency_record(latency_path_t path, int64_t us);
+
+/**
+ * @brief Consistent copy of one path's histogram
+ */
+void latency_snapshot(latency_path_t path, latency_hist_t *hist);
+
+/**
+ * @brief Clear every path
+ */
+void latency_reset(void);
+
+const char *latency_path_name(latency_path_t path);
+
+/**
+ * @brief Exclusive upper bound of a bucket in µs (UINT32_MAX for the last)
+ */
+uint32_t latency_bucket_limit_us(int bucket);
+
+/**
+ * @brief Upper bound of the bucket holding the given fraction of samples
+ *
+ * Capped at the recorded maximum, so p100 is exact.
+ *
+ * @param fraction 0..1, e.g. 0.99 for p99
+ * @return 0 if the histogram is empty
+ */
+uint32_t latency_percentile_us(const latency_hist_t *hist, float fraction);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LATENCY_HIST_H
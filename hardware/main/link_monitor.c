@@ -0,0 +1,105 @@
+#include "link_monitor.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "esp_event.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+
+#define LINK_MONITOR_TAG "link"
+
+static link_stats_t stats;
+static bool connected_once = false;
+static volatile bool awaiting_frame = false;  // Outage over, recovery not yet timed
+static portMUX_TYPE link_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void on_disconnected(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&link_lock);
+    bool lost = stats.online;
+    if (lost) {
+        stats.online = false;
+        stats.outages++;
+        stats.down_since_us = now;
+    }
+    portEXIT_CRITICAL(&link_lock);
+
+    if (lost) {
+        ESP_LOGW(LINK_MONITOR_TAG, "Link lost (outage #%u); holding outputs and buffering telemetry",
+                 (unsigned)stats.outages);
+    }
+}
+
+static void on_got_ip(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t outage = 0;
+
+    portENTER_CRITICAL(&link_lock);
+    if (!stats.online && connected_once && stats.down_since_us) {
+        outage = now - stats.down_since_us;
+        stats.last_outage_us = outage;
+        stats.total_outage_us += outage;
+        if (outage > stats.max_outage_us) {
+            stats.max_outage_us = outage;
+        }
+        awaiting_frame = true;
+    } else {
+        stats.down_since_us = 0;
+    }
+    stats.online = true;
+    connected_once = true;
+    portEXIT_CRITICAL(&link_lock);
+
+    if (outage) {
+        ESP_LOGI(LINK_MONITOR_TAG, "Link restored after %lld ms", (long long)(outage / 1000));
+    }
+}
+
+esp_err_t link_monitor_start(void)
+{
+    esp_err_t err = esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, on_disconnected, NULL);
+    if (err == ESP_OK) {
+        err = esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, on_got_ip, NULL);
+    }
+    return err;
+}
+
+bool link_monitor_online(void)
+{
+    return stats.online;
+}
+
+void link_monitor_frame_sent(void)
+{
+    if (!awaiting_frame) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    int64_t recover = 0;
+
+    portENTER_CRITICAL(&link_lock);
+    if (awaiting_frame && stats.down_since_us) {
+        recover = now - stats.down_since_us;
+        stats.last_recover_us = recover;
+        if (recover > stats.max_recover_us) {
+            stats.max_recover_us = recover;
+        }
+        stats.down_since_us = 0;
+    }
+    awaiting_frame = false;
+    portEXIT_CRITICAL(&link_lock);
+
+    if (recover) {
+        ESP_LOGI(LINK_MONITOR_TAG, "Telemetry flowing again %lld ms after link loss", (long long)(recover / 1000));
+    }
+}
+
+void link_monitor_get_stats(link_stats_t *out)
+{
+    portENTER_CRITICAL(&link_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&link_lock);
+}
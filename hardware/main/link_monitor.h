@@ -0,0 +1,61 @@
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Station link monitor.
+ *
+ * Tracks whether the station holds an IPv4 address and times each outage
+ * after the first connect: from the first STA_DISCONNECTED to the next
+ * STA_GOT_IP (outage), and on to the first telemetry frame delivered to a
+ * subscriber again (recovery, which includes the backend reconnecting).
+ * Reconnecting itself is left to the Wi-Fi layer.
+ */
+
+typedef struct {
+    bool online;                // Station currently has an address
+    uint32_t outages;           // Link losses since boot
+    int64_t down_since_us;      // Start of the current outage until a frame is delivered, else 0
+    int64_t last_outage_us;     // Duration of the last outage
+    int64_t max_outage_us;
+    int64_t total_outage_us;
+    int64_t last_recover_us;    // Link loss to first delivered frame, last outage
+    int64_t max_recover_us;
+} link_stats_t;
+
+/**
+ * @brief Subscribe to Wi-Fi and IP events
+ *
+ * Call after esp_event_loop_create_default() and before the station connects.
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t link_monitor_start(void);
+
+/**
+ * @brief True while the station holds an address
+ */
+bool link_monitor_online(void);
+
+/**
+ * @brief Note a telemetry frame delivered to a subscriber (hot path, cheap)
+ */
+void link_monitor_frame_sent(void);
+
+/**
+ * @brief Snapshot link counters
+ */
+void link_monitor_get_stats(link_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LINK_MONITOR_H
@@ -0,0 +1,91 @@
+#include "node_table.h"
+#include <string.h>
+
+_Static_assert(NODE_TABLE_MAX_NODES * 2 <= NODE_TABLE_INDEX_SIZE, "index must stay at most half full");
+_Static_assert(NODE_TABLE_MAX_NODES < 255, "index stores slot + 1 in a byte");
+
+#define INDEX_MASK (NODE_TABLE_INDEX_SIZE - 1)
+
+// Fibonacci hashing: consecutive ids spread across the whole index
+static inline unsigned home(uint16_t id)
+{
+    return ((uint16_t)(id * 40503u) >> (16 - NODE_TABLE_INDEX_BITS)) & INDEX_MASK;
+}
+
+// Index position holding id, or -1
+static int locate(const node_table_t *table, uint16_t id)
+{
+    for (unsigned pos = home(id);; pos = (pos + 1) & INDEX_MASK) {
+        uint8_t ref = table->index[pos];
+        if (ref == 0) {
+            return -1;
+        }
+        if (table->entries[ref - 1].id == id) {
+            return (int)pos;
+        }
+    }
+}
+
+void node_table_init(node_table_t *table)
+{
+    memset(table, 0, sizeof(*table));
+}
+
+int node_table_find(const node_table_t *table, uint16_t id)
+{
+    int pos = locate(table, id);
+    return pos < 0 ? -1 : table->index[pos] - 1;
+}
+
+int node_table_add(node_table_t *table, uint16_t id, uint8_t type, uint8_t channel)
+{
+    if (table->count >= NODE_TABLE_MAX_NODES || locate(table, id) >= 0) {
+        return -1;
+    }
+    if (channel != NODE_TABLE_NO_CHANNEL) {
+        for (int i = 0; i < table->count; i++) {
+            if (table->entries[i].channel == channel) {
+                return -1;
+            }
+        }
+    }
+
+    int slot = table->count++;
+    table->entries[slot] = (node_entry_t){ .id = id, .type = type, .channel = channel };
+
+    unsigned pos = home(id);
+    while (table->index[pos] != 0) {
+        pos = (pos + 1) & INDEX_MASK;
+    }
+    table->index[pos] = (uint8_t)(slot + 1);
+    return slot;
+}
+
+int node_table_remove(node_table_t *table, uint16_t id)
+{
+    int pos = locate(table, id);
+    if (pos < 0) {
+        return -1;
+    }
+    int slot = table->index[pos] - 1;
+
+    // Backward-shift deletion: pull later probes into the hole unless they
+    // would move before their home position
+    unsigned hole = (unsigned)pos;
+    for (unsigned next = (hole + 1) & INDEX_MASK; table->index[next] != 0; next = (next + 1) & INDEX_MASK) {
+        unsigned want = home(table->entries[table->index[next] - 1].id);
+        if (((next - want) & INDEX_MASK) >= ((next - hole) & INDEX_MASK)) {
+            table->index[hole] = table->index[next];
+            hole = next;
+        }
+    }
+    table->index[hole] = 0;
+
+    // Move the last entry into the freed slot and repoint its index
+    int last = --table->count;
+    if (slot != last) {
+        table->entries[slot] = table->entries[last];
+        table->index[locate(table, table->entries[slot].id)] = (uint8_t)(slot + 1);
+    }
+    return slot;
+}
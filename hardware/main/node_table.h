@@ -0,0 +1,70 @@
+#ifndef NODE_TABLE_H
+#define NODE_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Runtime node table.
+ *
+ * Maps arbitrary 16-bit node ids to dense slots (the grid model's node
+ * order) and each slot to an actuator output. An open-addressing index with
+ * linear probing resolves an id in O(1); removal uses backward-shift
+ * deletion, so there are no tombstones, and moves the last entry into the
+ * freed slot exactly like grid_model_remove_node(), keeping both in step.
+ *
+ * No platform dependencies and no locking: callers serialize access.
+ */
+
+#ifndef NODE_TABLE_MAX_NODES
+#define NODE_TABLE_MAX_NODES 64
+#endif
+
+#define NODE_TABLE_INDEX_BITS 7
+#define NODE_TABLE_INDEX_SIZE (1 << NODE_TABLE_INDEX_BITS)  // Load factor <= 1/2
+
+#define NODE_TABLE_NO_CHANNEL 0xFF     // Same as NODE_CHANNEL_NONE on the wire
+
+typedef struct {
+    uint16_t id;
+    uint8_t type;           // NODE_TYPE_*
+    uint8_t channel;        // Actuator output index or NODE_TABLE_NO_CHANNEL
+} node_entry_t;
+
+typedef struct {
+    int count;
+    node_entry_t entries[NODE_TABLE_MAX_NODES];
+    uint8_t index[NODE_TABLE_INDEX_SIZE];   // Slot + 1; 0 = empty
+} node_table_t;
+
+void node_table_init(node_table_t *table);
+
+/**
+ * @brief Slot of a node id, or -1 if unknown
+ */
+int node_table_find(const node_table_t *table, uint16_t id);
+
+/**
+ * @brief Append a node
+ *
+ * @return Slot of the new node, or -1 if the table is full, the id exists
+ *         or the channel is already driven by another node
+ */
+int node_table_add(node_table_t *table, uint16_t id, uint8_t type, uint8_t channel);
+
+/**
+ * @brief Remove a node; the last entry moves into its slot
+ *
+ * @return Slot the node occupied, or -1 if unknown
+ */
+int node_table_remove(node_table_t *table, uint16_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NODE_TABLE_H
@@ -0,0 +1,132 @@
+#include "out_flow.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+
+typedef struct {
+    out_flow_stats_t stats;
+    uint8_t tick;           // Telemetry ticks since the last send opportunity
+    uint8_t window_ticks;   // Send opportunities in the current window
+    uint8_t window_starved; // ...of which found no credit
+} out_flow_slot_t;
+
+static out_flow_slot_t slots[OUT_FLOW_SLOTS];
+static portMUX_TYPE flow_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Caller holds flow_lock
+static void adapt(out_flow_slot_t *s)
+{
+    if (++s->window_ticks < OUT_FLOW_WINDOW) {
+        return;
+    }
+
+    if (s->window_starved > OUT_FLOW_WINDOW / 4) {
+        s->stats.decimation = s->stats.decimation * 2 > OUT_FLOW_MAX_DECIMATION ?
+                              OUT_FLOW_MAX_DECIMATION : s->stats.decimation * 2;
+    } else if (s->window_starved == 0 && s->stats.decimation > 1) {
+        s->stats.decimation--;
+    }
+    s->window_ticks = 0;
+    s->window_starved = 0;
+}
+
+void out_flow_reset(int slot)
+{
+    if (slot < 0 || slot >= OUT_FLOW_SLOTS) {
+        return;
+    }
+
+    portENTER_CRITICAL(&flow_lock);
+    memset(&slots[slot], 0, sizeof(slots[slot]));
+    slots[slot].stats.decimation = 1;
+    portEXIT_CRITICAL(&flow_lock);
+}
+
+bool out_flow_tick(int slot, bool *resync)
+{
+    *resync = false;
+    if (slot < 0 || slot >= OUT_FLOW_SLOTS) {
+        return false;
+    }
+
+    bool send = false;
+    portENTER_CRITICAL(&flow_lock);
+    out_flow_slot_t *s = &slots[slot];
+    if (!s->stats.credit_mode) {
+        send = true;
+    } else if (++s->tick < s->stats.decimation) {
+        s->stats.stale = true;  // Decimated away: a delta is lost all the same
+    } else {
+        s->tick = 0;
+        if (s->stats.credit > 0) {
+            s->stats.credit--;
+            send = true;
+        } else {
+            s->stats.stale = true;
+            s->stats.coalesced++;
+            s->window_starved++;
+        }
+        adapt(s);
+    }
+    if (send) {
+        *resync = s->stats.stale;
+        s->stats.stale = false;
+        s->stats.sent++;
+    }
+    portEXIT_CRITICAL(&flow_lock);
+
+    return send;
+}
+
+bool out_flow_grant(int slot, uint16_t credits)
+{
+    if (slot < 0 || slot >= OUT_FLOW_SLOTS) {
+        return false;
+    }
+
+    bool send_now = false;
+    portENTER_CRITICAL(&flow_lock);
+    out_flow_slot_t *s = &slots[slot];
+    uint32_t total = (uint32_t)s->stats.credit + credits;
+    s->stats.credit = total > OUT_FLOW_MAX_CREDIT ? OUT_FLOW_MAX_CREDIT : (uint16_t)total;
+    s->stats.granted += credits;
+    s->stats.credit_mode = true;
+    if (s->stats.stale && s->stats.credit > 0) {
+        s->stats.credit--;
+        s->stats.stale = false;
+        s->stats.sent++;
+        send_now = true;
+    }
+    portEXIT_CRITICAL(&flow_lock);
+
+    return send_now;
+}
+
+void out_flow_refund(int slot)
+{
+    if (slot < 0 || slot >= OUT_FLOW_SLOTS) {
+        return;
+    }
+
+    portENTER_CRITICAL(&flow_lock);
+    out_flow_slot_t *s = &slots[slot];
+    if (s->stats.credit_mode && s->stats.credit < OUT_FLOW_MAX_CREDIT) {
+        s->stats.credit++;
+    }
+    s->stats.stale = true;
+    if (s->stats.sent > 0) {
+        s->stats.sent--;
+    }
+    portEXIT_CRITICAL(&flow_lock);
+}
+
+void out_flow_get_stats(int slot, out_flow_stats_t *out)
+{
+    if (slot < 0 || slot >= OUT_FLOW_SLOTS) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+
+    portENTER_CRITICAL(&flow_lock);
+    *out = slots[slot].stats;
+    portEXIT_CRITICAL(&flow_lock);
+}
@@ -0,0 +1,84 @@
+#ifndef OUT_FLOW_H
+#define OUT_FLOW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Credit-based flow control for /out subscribers.
+ *
+ * A subscriber that sends a CRED frame switches its slot to credit mode:
+ * each telemetry frame consumes one credit, and a frame produced while the
+ * slot has none is dropped and the slot marked stale instead of queueing in
+ * the socket. The next grant then sends the newest frame right away, so a
+ * slow consumer always works on current data.
+ *
+ * The effective rate adapts per slot: every OUT_FLOW_WINDOW send
+ * opportunities the decimation (send every Nth tick) doubles if the slot was
+ * starved of credit more than a quarter of the time, and steps back down by
+ * one after a window without starvation. Subscribers that never grant
+ * credit receive every frame, as before.
+ *
+ * A slot that missed a frame for any reason (no credit, decimation, a
+ * failed send) is stale; its next frame must then be a keyframe, since
+ * report-by-exception deltas only apply on top of the frame before them.
+ */
+
+#define OUT_FLOW_SLOTS 4            // Matches MAX_OUT_CLIENTS
+#define OUT_FLOW_WINDOW 10          // Send opportunities per adaptation step
+#define OUT_FLOW_MAX_DECIMATION 16
+#define OUT_FLOW_MAX_CREDIT 1000    // Outstanding grants are capped here
+
+typedef struct {
+    bool credit_mode;       // Subscriber has granted credit at least once
+    bool stale;             // A frame was skipped or failed since the last send
+    uint16_t credit;        // Frames the subscriber will still accept
+    uint8_t decimation;     // Send every Nth telemetry tick (1 = full rate)
+    uint32_t sent;          // Frames delivered
+    uint32_t coalesced;     // Frames dropped for lack of credit
+    uint32_t granted;       // Credits received
+} out_flow_stats_t;
+
+/**
+ * @brief Reset a slot for a new subscriber (legacy mode, full rate)
+ */
+void out_flow_reset(int slot);
+
+/**
+ * @brief Telemetry tick for a slot; true if it should get this frame
+ *
+ * Consumes one credit when returning true in credit mode.
+ *
+ * @param resync Set when returning true for a stale slot: send a keyframe
+ *               instead of this tick's delta
+ */
+bool out_flow_tick(int slot, bool *resync);
+
+/**
+ * @brief Add credit from a CRED frame
+ *
+ * @return true if the slot was stale and should get the newest frame now;
+ *         one credit has then already been consumed for it
+ */
+bool out_flow_grant(int slot, uint16_t credits);
+
+/**
+ * @brief Undo the credit taken for a frame that failed to send; marks the
+ *        slot stale
+ */
+void out_flow_refund(int slot);
+
+/**
+ * @brief Snapshot a slot's counters
+ */
+void out_flow_get_stats(int slot, out_flow_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OUT_FLOW_H
@@ -1,11 +1,13 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <time.h>
 #include <math.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
+#include "freertos/semphr.h"
 #include "esp_timer.h"
 #include "esp_log.h"
 #include "esp_http_server.h"
@@ -14,277 +16,616 @@
 #include "esp_system.h"
 #include "nvs_flash.h"
 #include "esp_netif.h"
+#include "lwip/sockets.h"
 #include "protocol_examples_common.h"
-#include "driver/ledc.h"
-#include "cJSON.h"
-#include "esp_http_client.h"
 #include "binary_protocol.h"
+#include "deferred_log.h"
+#include "grid_model.h"
+#include "boot_trace.h"
+#include "ip_announce.h"
+#include "link_monitor.h"
+#include "telemetry_history.h"
+#include "warm_state.h"
+#include "out_flow.h"
+#include "node_table.h"
+#include "actuator.h"
+#include "adc_sense.h"
+#include "telemetry_json.h"
+#include "frame_pool.h"
+#include "latency_hist.h"
+#include "trace_capture.h"
+#if CONFIG_POWER_GRID_CONSOLE
+#include "grid_console.h"
+#endif
+#if CONFIG_POWER_GRID_SHM_RING
+#include "shm_ring.h"
+#endif
 
 #define POWER_GRID_TAG "power_grid"
 #define DATA_SEND_INTERVAL_MS 100  // 10 Hz = 100ms
-#define MAX_NODES 8
-#define MAX_JSON_BUFFER 2048
 
-#define LEDC_MODE LEDC_LOW_SPEED_MODE
-#define LEDC_DUTY_RES LEDC_TIMER_13_BIT
-#define LEDC_FREQUENCY 1000
-#define MAX_DUTY (1 << LEDC_DUTY_RES) - 1
-
-#define NUM_OUTPUT_PINS 4
-#define MAX_WS_BUFFER 512
-
-typedef struct {
-    int id;
-    char type[16];
-    float demand;
-    float fulfillment;
-} power_node_t;
-
-typedef struct {
-    int timestamp;
-    power_node_t nodes[MAX_NODES];
-    int node_count;
-} power_grid_data_t;
-
-typedef struct {
-    int node_id;
-    int gpio_pin;
-    ledc_channel_t channel;
-} output_pin_map_t;
-
-static const output_pin_map_t output_pins[NUM_OUTPUT_PINS] = {
-    {1, 14, LEDC_CHANNEL_0},
-    {2, 27, LEDC_CHANNEL_1},
-    {3, 26, LEDC_CHANNEL_2},
-    {4, 33, LEDC_CHANNEL_3}
-};
+// The telemetry encoders build a telemetry_packet_t on the caller's stack,
+// about 28 bytes per CONFIG_POWER_GRID_MAX_NODES node (1.8 KB at 64). The
+// send task and the main server, whose /out handler runs the catch-up
+// resync encode, size their stacks to match.
+#define DATA_SEND_TASK_STACK (3840 + sizeof(telemetry_packet_t))
+#define HTTPD_TASK_STACK (7808 + sizeof(telemetry_packet_t))
+
+#ifndef CONFIG_POWER_GRID_DISPATCH_ACK
+#define CONFIG_POWER_GRID_DISPATCH_ACK 0
+#endif
+#ifndef CONFIG_POWER_GRID_CONTROL_PORT
+#define CONFIG_POWER_GRID_CONTROL_PORT 81
+#endif
+#ifndef CONFIG_POWER_GRID_CONTROL_TASK_PRIORITY
+#define CONFIG_POWER_GRID_CONTROL_TASK_PRIORITY 7
+#endif
+#ifndef CONFIG_POWER_GRID_TELEMETRY_TASK_PRIORITY
+#define CONFIG_POWER_GRID_TELEMETRY_TASK_PRIORITY 5
+#endif
+#ifndef CONFIG_POWER_GRID_CONTROL_SNDBUF
+#define CONFIG_POWER_GRID_CONTROL_SNDBUF 512
+#endif
+#ifndef CONFIG_POWER_GRID_TELEMETRY_SNDBUF
+#define CONFIG_POWER_GRID_TELEMETRY_SNDBUF 8192
+#endif
+#ifndef CONFIG_POWER_GRID_ACTUATOR_GPIOS
+#define CONFIG_POWER_GRID_ACTUATOR_GPIOS "14,27,26,33"
+#endif
+#ifndef CONFIG_POWER_GRID_ACTUATOR_PWM_HZ
+#define CONFIG_POWER_GRID_ACTUATOR_PWM_HZ 1000
+#endif
+#ifndef CONFIG_POWER_GRID_PCA9685_SDA
+#define CONFIG_POWER_GRID_PCA9685_SDA 21
+#endif
+#ifndef CONFIG_POWER_GRID_PCA9685_SCL
+#define CONFIG_POWER_GRID_PCA9685_SCL 22
+#endif
+#ifndef CONFIG_POWER_GRID_PCA9685_ADDRESS
+#define CONFIG_POWER_GRID_PCA9685_ADDRESS 0x40
+#endif
+#ifndef CONFIG_POWER_GRID_PCA9685_SCL_HZ
+#define CONFIG_POWER_GRID_PCA9685_SCL_HZ 400000
+#endif
+#ifndef CONFIG_POWER_GRID_SENSE_FIELDS
+#define CONFIG_POWER_GRID_SENSE_FIELDS 0
+#endif
+#ifndef CONFIG_POWER_GRID_TELEMETRY_RBE
+#define CONFIG_POWER_GRID_TELEMETRY_RBE 0
+#endif
+#ifndef CONFIG_POWER_GRID_RBE_DEMAND_DEADBAND_MA
+#define CONFIG_POWER_GRID_RBE_DEMAND_DEADBAND_MA 50
+#endif
+#ifndef CONFIG_POWER_GRID_RBE_FULFILLMENT_DEADBAND
+#define CONFIG_POWER_GRID_RBE_FULFILLMENT_DEADBAND 5
+#endif
+#ifndef CONFIG_POWER_GRID_RBE_KEYFRAME_INTERVAL
+#define CONFIG_POWER_GRID_RBE_KEYFRAME_INTERVAL 24
+#endif
+#ifndef CONFIG_POWER_GRID_JSON_OUT
+#define CONFIG_POWER_GRID_JSON_OUT 0
+#endif
+#ifndef CONFIG_POWER_GRID_POOL_TELEMETRY_BLOCKS
+#define CONFIG_POWER_GRID_POOL_TELEMETRY_BLOCKS 4
+#endif
+#ifndef CONFIG_POWER_GRID_POOL_JSON_BLOCKS
+#define CONFIG_POWER_GRID_POOL_JSON_BLOCKS 1
+#endif
+#ifndef CONFIG_POWER_GRID_PLANT_MODEL
+#define CONFIG_POWER_GRID_PLANT_MODEL 0
+#endif
+#ifndef CONFIG_POWER_GRID_PLANT_SOURCE_MA
+#define CONFIG_POWER_GRID_PLANT_SOURCE_MA 12000
+#endif
+#ifndef CONFIG_POWER_GRID_PLANT_OUTPUT_MA
+#define CONFIG_POWER_GRID_PLANT_OUTPUT_MA 5000
+#endif
+#ifndef CONFIG_POWER_GRID_PLANT_LINE_LOSS
+#define CONFIG_POWER_GRID_PLANT_LINE_LOSS 80
+#endif
+#ifndef CONFIG_POWER_GRID_PLANT_SUPPLY_TAU_MS
+#define CONFIG_POWER_GRID_PLANT_SUPPLY_TAU_MS 150
+#endif
+#ifndef CONFIG_POWER_GRID_PLANT_DEMAND_TAU_MS
+#define CONFIG_POWER_GRID_PLANT_DEMAND_TAU_MS 300
+#endif
+#ifndef CONFIG_POWER_GRID_SHM_RING
+#define CONFIG_POWER_GRID_SHM_RING 0
+#endif
+#ifndef CONFIG_POWER_GRID_CONSOLE
+#define CONFIG_POWER_GRID_CONSOLE 0
+#endif
+#ifndef CONFIG_POWER_GRID_POOL_CONTROL_BLOCKS
+#define CONFIG_POWER_GRID_POOL_CONTROL_BLOCKS 3
+#endif
+
+#define DSCP_EF_TOS (46 << 2)  // Expedited Forwarding, WMM voice queue on Wi-Fi
 
 static httpd_handle_t server_handle = NULL;
 #define MAX_OUT_CLIENTS 4
 static int ws_out_fds[MAX_OUT_CLIENTS] = {-1, -1, -1, -1};
+static bool ws_out_json[MAX_OUT_CLIENTS];  // Slot subscribed on /out.json
+static uint32_t ws_out_sent_ms[MAX_OUT_CLIENTS];  // Last frame sent to the slot, for the console lag
 static int ws_in_fd = -1;
 static TaskHandle_t data_task = NULL;
 static volatile bool should_send_data = false;
-static power_grid_data_t grid_data;
-static uint8_t ws_buffer[MAX_WS_BUFFER];
-static uint8_t binary_buffer[256];  // Buffer for binary protocol
-static ledc_channel_t node_to_channel[MAX_NODES] = {0};
-// Phase randomization for realistic load patterns
-typedef struct {
-    float demand_phase;      // Phase offset for demand sine wave
-    float fulfillment_phase; // Phase offset for fulfillment sine wave  
-    float freq_variation;    // Small frequency variation (±10%)
-} node_phase_t;
-
-static node_phase_t node_phases[MAX_NODES]; // Random phase data for each node
+static grid_model_t grid_data;
+// telemetry_max_packet_size(GRID_MODEL_MAX_NODES), as a constant expression
+#define TELEMETRY_FRAME_MAX (TELEMETRY_DELTA_HEADER_SIZE + GRID_MODEL_MAX_NODES * (12 + 4 * TELEMETRY_FIELD_COUNT))
+#define TELEMETRY_JSON_FRAME_MAX (CONFIG_POWER_GRID_JSON_OUT ? telemetry_json_max_size(GRID_MODEL_MAX_NODES) : 1)
+// Largest unfragmented WebSocket frame accepted on /in: a full 255-node
+// dispatch frame
+#define IN_CHUNK_BYTES (DISPATCH_HEADER_SIZE + 255 * DISPATCH_NODE_SIZE)
+
+// Frame pools: binary telemetry (encode, fan-out, latest frame, catch-up),
+// JSON telemetry, and inbound control frames on /in and /out
+static frame_t telemetry_frames[CONFIG_POWER_GRID_POOL_TELEMETRY_BLOCKS];
+static uint8_t telemetry_storage[CONFIG_POWER_GRID_POOL_TELEMETRY_BLOCKS][TELEMETRY_FRAME_MAX];
+static frame_pool_t telemetry_pool;
+static frame_t json_frames[CONFIG_POWER_GRID_POOL_JSON_BLOCKS];
+static uint8_t json_storage[CONFIG_POWER_GRID_POOL_JSON_BLOCKS][TELEMETRY_JSON_FRAME_MAX];
+static frame_pool_t json_pool;
+static frame_t control_frames[CONFIG_POWER_GRID_POOL_CONTROL_BLOCKS];
+static uint8_t control_storage[CONFIG_POWER_GRID_POOL_CONTROL_BLOCKS][IN_CHUNK_BYTES];
+static frame_pool_t control_pool;
+
+#if CONFIG_POWER_GRID_SHM_RING
+// Linux target: live frames for co-located readers, with or without /out
+// subscribers
+static shm_ring_t telemetry_ring;
+#define telemetry_ring_active() (telemetry_ring.header != NULL)
+#else
+#define telemetry_ring_active() false
+#endif
+
+static frame_t *latest_frame = NULL;  // Newest telemetry frame, for credit-triggered sends
+static portMUX_TYPE latest_lock = portMUX_INITIALIZER_UNLOCKED;
+// JSON telemetry: nodes are copied under node_lock, then written once per
+// frame for every /out.json subscriber outside the lock
+static grid_node_t json_nodes[GRID_MODEL_MAX_NODES];
+static int json_node_count = 0;
+static uint64_t json_timestamp = 0;
+// Runtime node id -> slot/output map; slots match grid_data's node order.
+// node_lock guards both, so a NODE control frame never races a telemetry
+// encode. It is a mutex, not a spinlock: the model update and encode under
+// it scale with the node count and must not mask interrupts (the ADC DMA
+// ISR among them). Neither is touched from an ISR.
+static node_table_t node_table;
+static SemaphoreHandle_t node_lock;
+static actuator_driver_t actuator;
+static SemaphoreHandle_t actuator_lock;  // apply() runs from both /in server tasks
+static uint32_t dispatch_seq = 0;  // Dispatch frames received, echoed in acks; atomic (two /in servers)
+static uint32_t send_interval_ms = DATA_SEND_INTERVAL_MS;
+
+_Static_assert(ACTUATOR_MAX_OUTPUTS <= WARM_STATE_MAX_NODES, "warm state must cover every output");
+_Static_assert(NODE_TABLE_MAX_NODES >= GRID_MODEL_MAX_NODES, "node table slots mirror model slots");
+_Static_assert(GRID_MODEL_MAX_NODES <= MAX_NODES_PER_PACKET, "every node must fit a telemetry frame");
+_Static_assert(offsetof(telemetry_packet_t, nodes) == TELEMETRY_DELTA_HEADER_SIZE,
+               "TELEMETRY_FRAME_MAX must cover the largest frame header");
+_Static_assert(MAX_OUT_CLIENTS == OUT_FLOW_SLOTS, "one flow slot per /out client");
+_Static_assert(ACTUATOR_DUTY_BITS == DISPATCH_DUTY_BITS, "dense dispatch duties are in actuator steps");
 
 // Removed complex async queueing - use simple direct send
 
-static void init_pwm_outputs(void)
+// Outputs start at the warm-restored setpoints (0 after a cold boot), so a
+// reset does not drop the loads while the backend reconnects
+static void init_actuators(void)
 {
-    ledc_timer_config_t timer_config = {
-        .speed_mode = LEDC_MODE,
-        .duty_resolution = LEDC_DUTY_RES,
-        .timer_num = LEDC_TIMER_0,
-        .freq_hz = LEDC_FREQUENCY,
-        .clk_cfg = LEDC_AUTO_CLK
+    uint16_t initial[ACTUATOR_MAX_OUTPUTS];
+    for (int i = 0; i < ACTUATOR_MAX_OUTPUTS; i++) {
+        initial[i] = (uint16_t)(warm_state_supply(i + 1) * ACTUATOR_DUTY_MAX);
+    }
+    actuator_lock = xSemaphoreCreateMutex();
+    node_lock = xSemaphoreCreateMutex();
+
+#if CONFIG_POWER_GRID_ACTUATOR_PCA9685
+    actuator_expander_config_t config = {
+        .sda_gpio = CONFIG_POWER_GRID_PCA9685_SDA,
+        .scl_gpio = CONFIG_POWER_GRID_PCA9685_SCL,
+        .address = CONFIG_POWER_GRID_PCA9685_ADDRESS,
+        .scl_hz = CONFIG_POWER_GRID_PCA9685_SCL_HZ,
+        .pwm_hz = CONFIG_POWER_GRID_ACTUATOR_PWM_HZ
     };
-    ESP_ERROR_CHECK(ledc_timer_config(&timer_config));
-
-    for (int i = 0; i < NUM_OUTPUT_PINS; i++) {
-        ledc_channel_config_t channel_config = {
-            .speed_mode = LEDC_MODE,
-            .channel = output_pins[i].channel,
-            .timer_sel = LEDC_TIMER_0,
-            .intr_type = LEDC_INTR_DISABLE,
-            .gpio_num = output_pins[i].gpio_pin,
-            .duty = 0,
-            .hpoint = 0
-        };
-        ESP_ERROR_CHECK(ledc_channel_config(&channel_config));
+    bool ok = actuator_expander_init(&actuator, &config, initial);
+    ESP_LOGI(POWER_GRID_TAG, "%d %s outputs initialized at I2C 0x%02x", actuator.outputs, actuator.name,
+             CONFIG_POWER_GRID_PCA9685_ADDRESS);
+#else
+    // Comma-separated pin list, one output per pin in order
+    int gpios[ACTUATOR_MAX_OUTPUTS];
+    int count = 0;
+    const char *p = CONFIG_POWER_GRID_ACTUATOR_GPIOS;
+    while (*p && count < ACTUATOR_MAX_OUTPUTS) {
+        char *end;
+        long gpio = strtol(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        gpios[count++] = (int)gpio;
+        p = end + strspn(end, ", ");
     }
 
-    // Log all initialized pins dynamically
-    char pin_list[64] = "";
-    for (int i = 0; i < NUM_OUTPUT_PINS; i++) {
-        char pin_str[8];
-        snprintf(pin_str, sizeof(pin_str), "%s%d", (i > 0) ? ", " : "", output_pins[i].gpio_pin);
-        strcat(pin_list, pin_str);
+#if CONFIG_POWER_GRID_ACTUATOR_MCPWM
+    bool ok = actuator_mcpwm_init(&actuator, gpios, count, CONFIG_POWER_GRID_ACTUATOR_PWM_HZ, initial);
+#else
+    bool ok = actuator_ledc_init(&actuator, gpios, count, CONFIG_POWER_GRID_ACTUATOR_PWM_HZ, initial);
+#endif
+    ESP_LOGI(POWER_GRID_TAG, "%d %s outputs initialized on pins %s", actuator.outputs, actuator.name,
+             CONFIG_POWER_GRID_ACTUATOR_GPIOS);
+#endif
+
+    // Booting without outputs would leave every node unactuated with no
+    // other sign of it; the driver has logged why
+    if (!ok || actuator.outputs == 0) {
+        ESP_LOGE(POWER_GRID_TAG, "Actuator init failed, check the Actuators config");
+        abort();
     }
-    ESP_LOGI(POWER_GRID_TAG, "PWM outputs initialized on pins %s", pin_list);
 }
 
-static void set_output_pwm(int node_id, float supply)
+// Output index driven by a node, or -1 if the node is unknown or has none
+static int node_output(uint16_t node_id)
 {
-    if (supply < 0.0f) supply = 0.0f;
-    if (supply > 1.0f) supply = 1.0f;
+    int output = -1;
 
-    // Direct lookup - node_id is 1-based, array is 0-based
-    if (node_id >= 1 && node_id <= MAX_NODES && node_to_channel[node_id - 1] != 0) {
-        uint32_t duty = (uint32_t)(supply * MAX_DUTY);
-        ledc_set_duty(LEDC_MODE, node_to_channel[node_id - 1], duty);
-        ledc_update_duty(LEDC_MODE, node_to_channel[node_id - 1]);
+    xSemaphoreTake(node_lock, portMAX_DELAY);
+    int slot = node_table_find(&node_table, node_id);
+    if (slot >= 0 && node_table.entries[slot].channel < actuator.outputs) {
+        output = node_table.entries[slot].channel;
     }
+    xSemaphoreGive(node_lock);
+
+    return output;
 }
 
-static void init_phase_randomization(void)
+// Setpoints are saved per output (1-based), so they follow the hardware
+// rather than whichever node id is bound to it
+static void apply_setpoints(const actuator_setpoint_t *setpoints, int count)
 {
-    // Initialize random number generator with hardware entropy
-    srand(esp_random());
-    
-    // Generate comprehensive random phase data for each node
-    for (int i = 0; i < MAX_NODES; i++) {
-        node_phases[i].demand_phase = ((float)rand() / RAND_MAX) * 2.0f * M_PI;
-        node_phases[i].fulfillment_phase = ((float)rand() / RAND_MAX) * 2.0f * M_PI;
-        // Frequency variation: ±10% (0.9 to 1.1 multiplier)
-        node_phases[i].freq_variation = 0.9f + ((float)rand() / RAND_MAX) * 0.2f;
+    if (count <= 0) {
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        warm_state_set_supply(setpoints[i].output + 1, setpoints[i].duty * (1.0f / ACTUATOR_DUTY_MAX));
+    }
+
+    xSemaphoreTake(actuator_lock, portMAX_DELAY);
+    actuator_apply(&actuator, setpoints, count);
+    xSemaphoreGive(actuator_lock);
+
+    // The plant model follows the duties as latched, through each node's output
+    if (CONFIG_POWER_GRID_PLANT_MODEL) {
+        xSemaphoreTake(node_lock, portMAX_DELAY);
+        for (int slot = 0; slot < grid_data.node_count; slot++) {
+            for (int i = 0; i < count; i++) {
+                if (setpoints[i].output == node_table.entries[slot].channel) {
+                    grid_model_set_supply(&grid_data, slot, setpoints[i].duty * (1.0f / ACTUATOR_DUTY_MAX));
+                }
+            }
+        }
+        xSemaphoreGive(node_lock);
     }
-    
-    ESP_LOGI(POWER_GRID_TAG, "Initialized randomized phase offsets and frequency variations for realistic load patterns");
 }
 
 static void init_dummy_nodes(void)
 {
-    // Initialize random phase offsets first
-    init_phase_randomization();
-    
-    // Dynamically set node count based on output_pins array
-    grid_data.node_count = NUM_OUTPUT_PINS;
-
-    // Initialize all nodes as consumers based on output_pins configuration
-    for (int i = 0; i < NUM_OUTPUT_PINS; i++) {
-        int node_id = output_pins[i].node_id;
-        grid_data.nodes[i] = (power_node_t){
-            .id = node_id,
-            .type = "consumer",
-            .demand = 2.0f + (i * 0.3f),  // Varying base demands: 2.0, 2.3, 2.6, 2.9...
-            .fulfillment = 0.88f + (i * 0.02f)  // Varying fulfillment: 88%, 90%, 92%, 94%...
-        };
+    // One boot node per output, ids 1..N
+    int boot_nodes = actuator.outputs < GRID_MODEL_MAX_NODES ? actuator.outputs : GRID_MODEL_MAX_NODES;
+    uint8_t node_ids[ACTUATOR_MAX_OUTPUTS];
+    for (int i = 0; i < boot_nodes; i++) {
+        node_ids[i] = (uint8_t)(i + 1);
     }
 
-    // Initialize node-to-channel mapping
-    memset(node_to_channel, 0, sizeof(node_to_channel));
-    for (int i = 0; i < NUM_OUTPUT_PINS; i++) {
-        int node_idx = output_pins[i].node_id - 1; // Convert to 0-based
-        if (node_idx >= 0 && node_idx < MAX_NODES) {
-            node_to_channel[node_idx] = output_pins[i].channel;
+    // Seed phase randomization with hardware entropy; a warm restart keeps
+    // the previous seed so the simulated load profile carries on
+    uint32_t seed = warm_state_model_seed(esp_random());
+    warm_state_set_model_seed(seed);
+    grid_model_init(&grid_data, node_ids, boot_nodes, seed);
+    grid_model_set_exception(&grid_data, CONFIG_POWER_GRID_RBE_DEMAND_DEADBAND_MA * 1e-3f,
+                             CONFIG_POWER_GRID_RBE_FULFILLMENT_DEADBAND * 1e-3f,
+                             CONFIG_POWER_GRID_RBE_KEYFRAME_INTERVAL);
+    ESP_LOGI(POWER_GRID_TAG, "Initialized randomized phase offsets and frequency variations for realistic load patterns");
+
+    if (CONFIG_POWER_GRID_PLANT_MODEL) {
+        grid_plant_config_t plant = {
+            .source_capacity = CONFIG_POWER_GRID_PLANT_SOURCE_MA * 1e-3f,
+            .output_max = CONFIG_POWER_GRID_PLANT_OUTPUT_MA * 1e-3f,
+            .line_loss = CONFIG_POWER_GRID_PLANT_LINE_LOSS * 1e-3f,
+            .supply_tau_s = CONFIG_POWER_GRID_PLANT_SUPPLY_TAU_MS * 1e-3f,
+            .demand_tau_s = CONFIG_POWER_GRID_PLANT_DEMAND_TAU_MS * 1e-3f
+        };
+        grid_model_set_plant(&grid_data, &plant);
+        // Boot node i drives output i, which init_actuators() set from warm state
+        for (int i = 0; i < boot_nodes; i++) {
+            grid_model_set_supply(&grid_data, i, warm_state_supply(i + 1));
         }
+        ESP_LOGI(POWER_GRID_TAG, "Closed-loop plant: %.1f A source, %.1f A per output",
+                 plant.source_capacity, plant.output_max);
+    }
+
+    // Boot nodes take slots 0..boot_nodes-1, matching the model
+    node_table_init(&node_table);
+    for (int i = 0; i < boot_nodes; i++) {
+        node_table_add(&node_table, node_ids[i], NODE_TYPE_CONSUMER, (uint8_t)i);
     }
 }
 
-static void update_dummy_data(void)
+// Add or remove a node in both the table and the model, or set its
+// deadbands; returns true if anything changed
+static bool apply_node_control(const node_control_t *control)
 {
-    int64_t time_us = esp_timer_get_time();
-    float time_s = time_us / 1000000.0f;
-
-    grid_data.timestamp = (int)(time_us / 1000);
+    bool changed = false;
+    int released = -1;  // Output left without a node, to be switched off
+
+    if (control->op == NODE_CONTROL_DEADBAND) {
+        float demand = control->type == NODE_DEADBAND_DEFAULT ? -1.0f : control->type * 0.01f;
+        float fulfillment = control->channel == NODE_DEADBAND_DEFAULT ? -1.0f : control->channel * 0.001f;
+        xSemaphoreTake(node_lock, portMAX_DELAY);
+        int slot = node_table_find(&node_table, control->id);
+        grid_model_set_deadband(&grid_data, slot, demand, fulfillment);
+        xSemaphoreGive(node_lock);
+        return slot >= 0;
+    }
 
-    for (int i = 0; i < grid_data.node_count; i++) {
-        power_node_t *node = &grid_data.nodes[i];
+    if (control->op == NODE_CONTROL_ADD && control->channel != NODE_CHANNEL_NONE &&
+        control->channel >= actuator.outputs) {
+        return false;
+    }
 
-        // Get randomized phase data for this node (node_id is 1-based)
-        node_phase_t *phase_data = &node_phases[node->id - 1];
+    xSemaphoreTake(node_lock, portMAX_DELAY);
+    if (control->op == NODE_CONTROL_ADD) {
+        int slot = node_table_add(&node_table, control->id, control->type, control->channel);
+        if (slot >= 0 && grid_model_add_node(&grid_data, control->id, control->type,
+                                             warm_state_model_seed(0) ^ control->id) != slot) {
+            node_table_remove(&node_table, control->id);  // Model full
+            slot = -1;
+        }
+        if (slot >= 0 && control->channel != NODE_CHANNEL_NONE) {
+            // The output keeps whatever duty it last latched
+            grid_model_set_supply(&grid_data, slot, warm_state_supply(control->channel + 1));
+        }
+        changed = slot >= 0;
+    } else {
+        int slot = node_table_find(&node_table, control->id);
+        if (slot >= 0) {
+            released = node_table.entries[slot].channel;
+            node_table_remove(&node_table, control->id);
+            grid_model_remove_node(&grid_data, slot);
+            changed = true;
+        }
+    }
+    xSemaphoreGive(node_lock);
 
-        if (strcmp(node->type, "consumer") == 0) {
-            // Demand varies sinusoidally between 0.5 and 4.0
-            float base_demand = 2.25f; // midpoint
-            float demand_amplitude = 1.75f; // amplitude
-            float demand_freq = 0.2f * phase_data->freq_variation; // Varied frequency
-            node->demand = base_demand + demand_amplitude * sinf(2.0f * M_PI * demand_freq * time_s + phase_data->demand_phase);
+    if (released >= 0 && released < actuator.outputs) {
+        actuator_setpoint_t off = { .output = (uint16_t)released, .duty = 0 };
+        apply_setpoints(&off, 1);
+    }
+    return changed;
+}
 
-            // Fulfillment varies between 0.7 and 1.0 with independent phase and frequency
-            float base_ff = 0.85f;
-            float ff_amplitude = 0.15f;
-            float ff_freq = 0.12f * phase_data->freq_variation; // Varied frequency
-            node->fulfillment = base_ff + ff_amplitude * sinf(2.0f * M_PI * ff_freq * time_s + phase_data->fulfillment_phase);
-        } else {
-            // Power generators have zero demand
-            node->demand = 0.0;
-
-            // Generator fulfillment varies between 0.8 and 1.0
-            float base_ff = 0.9f;
-            float ff_amplitude = 0.1f;
-            float ff_freq = 0.06f * phase_data->freq_variation; // Varied frequency
-            node->fulfillment = base_ff + ff_amplitude * sinf(2.0f * M_PI * ff_freq * time_s + phase_data->fulfillment_phase);
+// Caller holds node_lock
+static void publish_measured(const sense_window_t *window)
+{
+    for (int slot = 0; slot < node_table.count && slot < grid_data.node_count; slot++) {
+        uint8_t channel = node_table.entries[slot].channel;
+        if (channel < window->channels && window->samples[channel] > 0) {
+            grid_node_t *node = &grid_data.nodes[slot];
+            node->demand = window->rms_amps[channel];
+            if (CONFIG_POWER_GRID_SENSE_FIELDS) {
+                node->fields = TELEMETRY_FIELDS_ALL;
+                node->field[0] = window->min_amps[channel];
+                node->field[1] = window->max_amps[channel];
+                node->field[2] = window->mean_amps[channel];
+                node->field[3] = window->rms_amps[channel];
+            }
         }
     }
 }
 
-static size_t generate_binary_telemetry(uint8_t *buffer, size_t buffer_size)
+// Keyframe of the last reported state for a subscriber that missed deltas;
+// NULL if the pool is empty
+static frame_t *encode_resync_frame(void)
 {
-    telemetry_packet_t packet;
-    
-    // Fill packet header
-    packet.magic = TELEMETRY_MAGIC;
-    packet.timestamp = grid_data.timestamp;
-    packet.node_count = grid_data.node_count;
-    
-    // Fill node data
-    for (int i = 0; i < grid_data.node_count && i < MAX_NODES_PER_PACKET; i++) {
-        power_node_t *src_node = &grid_data.nodes[i];
-        telemetry_node_t *dst_node = &packet.nodes[i];
-        
-        dst_node->id = src_node->id;
-        dst_node->type = (strcmp(src_node->type, "consumer") == 0) ? NODE_TYPE_CONSUMER : NODE_TYPE_POWER;
-        dst_node->demand = src_node->demand;
-        dst_node->fulfillment = src_node->fulfillment;
+    frame_t *frame = frame_pool_alloc(&telemetry_pool);
+    if (frame) {
+        xSemaphoreTake(node_lock, portMAX_DELAY);
+        frame->len = grid_model_encode_resync(&grid_data, frame->data);
+        xSemaphoreGive(node_lock);
+    } else {
+        DLOG(DLOG_POOL_EXHAUSTED, DLOG_S(telemetry_pool.name));
     }
-    
-    // Encode to binary buffer
-    return encode_telemetry(&packet, buffer);
+    return frame;
 }
 
-
 static void data_send_task(void *pvParameters)
 {
     vTaskDelay(pdMS_TO_TICKS(100)); // Give connection time to establish
 
     while (1) {
-        if (should_send_data && server_handle) {
-            update_dummy_data();
+        int64_t cycle_us = esp_timer_get_time();
+        trace_event(TRACE_CYCLE_START, send_interval_ms);
+
+        // While the link is down keep sampling into the history ring so the
+        // backend can backfill the gap; outputs hold their last duty
+        bool offline = !link_monitor_online();
+
+        if ((should_send_data || offline || telemetry_ring_active()) && server_handle) {
+            // Measured current replaces the modelled demand of nodes with a
+            // sensed output; the window spans one telemetry period
+            sense_window_t window;
+            bool sensed = adc_sense_take_window(&window);
+
+            bool json_wanted = false;
+            for (int i = 0; CONFIG_POWER_GRID_JSON_OUT && !offline && i < MAX_OUT_CLIENTS; i++) {
+                json_wanted |= ws_out_fds[i] >= 0 && ws_out_json[i];
+            }
 
-            // Use binary protocol for efficiency
-            size_t binary_len = generate_binary_telemetry(binary_buffer, sizeof(binary_buffer));
-            if (binary_len > 0) {
+            // The encoder writes straight into a pool block, which the
+            // subscribers and the latest-frame slot then share by reference
+            frame_t *frame = frame_pool_alloc(&telemetry_pool);
+            if (!frame) {
+                DLOG(DLOG_POOL_EXHAUSTED, DLOG_S(telemetry_pool.name));
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(send_interval_ms));
+                continue;
+            }
+
+            // Use binary protocol for efficiency. History frames are
+            // replayed one by one, so they stay full; the first live frame
+            // after an outage is a keyframe
+            xSemaphoreTake(node_lock, portMAX_DELAY);
+            grid_model_update(&grid_data, esp_timer_get_time());
+            if (sensed) {
+                publish_measured(&window);
+            }
+            if (CONFIG_POWER_GRID_TELEMETRY_RBE && !offline) {
+                frame->len = grid_model_encode_exception(&grid_data, frame->data);
+            } else {
+                frame->len = grid_model_encode(&grid_data, frame->data);
+                grid_data.exception.keyframe_due = 1;
+            }
+            if (json_wanted) {
+                // JSON frames are always full, whatever the binary mode
+                json_node_count = grid_data.node_count;
+                json_timestamp = grid_data.timestamp_us;
+                memcpy(json_nodes, grid_data.nodes, json_node_count * sizeof(grid_node_t));
+            }
+            xSemaphoreGive(node_lock);
+            size_t binary_len = frame->len;
+            int64_t built_us = esp_timer_get_time();
+            latency_record(LATENCY_TELEMETRY_BUILD, built_us - cycle_us);
+            trace_event(TRACE_FRAME_ENCODED, binary_len);
+#if CONFIG_POWER_GRID_SHM_RING
+            if (binary_len > 0 && !offline && telemetry_ring_active()) {
+                shm_ring_publish(&telemetry_ring, frame->data, binary_len);
+            }
+#endif
+            if (binary_len > 0 && offline) {
+                telemetry_history_append(frame->data, binary_len);
+            } else if (binary_len > 0) {
                 httpd_ws_frame_t ws_frame = {
                     .final = true,
                     .fragmented = false,
                     .type = HTTPD_WS_TYPE_BINARY,
-                    .payload = binary_buffer,
+                    .payload = frame->data,
                     .len = binary_len
                 };
 
-                // Send to all connected /out clients - simple direct approach
+                frame_t *json = json_wanted ? frame_pool_alloc(&json_pool) : NULL;
+                if (json) {
+                    json->len = grid_model_encode_json(json_nodes, json_node_count, json_timestamp,
+                                                       (char *)json->data, json_pool.block_size);
+                } else if (json_wanted) {
+                    DLOG(DLOG_POOL_EXHAUSTED, DLOG_S(json_pool.name));
+                }
+                size_t json_len = json ? json->len : 0;
+                httpd_ws_frame_t json_frame = {
+                    .final = true,
+                    .fragmented = false,
+                    .type = HTTPD_WS_TYPE_TEXT,
+                    .payload = json ? json->data : NULL,
+                    .len = json_len
+                };
+
+                // The slot keeps its own reference; the previous frame goes
+                // back to the pool once a catch-up send still using it is done
+                frame_ref(frame);
+                portENTER_CRITICAL(&latest_lock);
+                frame_t *previous = latest_frame;
+                latest_frame = frame;
+                portEXIT_CRITICAL(&latest_lock);
+                if (previous) {
+                    frame_release(previous);
+                }
+
+                // Send to all connected /out clients; subscribers out of
+                // credit skip this frame and get the newest one on their
+                // next grant. A binary subscriber that skipped deltas gets a
+                // keyframe in place of this tick's delta.
                 int active_clients = 0;
+                int sent_clients = 0;
+                int json_clients = 0;
                 for (int i = 0; i < MAX_OUT_CLIENTS; i++) {
-                    if (ws_out_fds[i] >= 0) {
-                        esp_err_t ret = httpd_ws_send_frame_async(server_handle, ws_out_fds[i], &ws_frame);
-                        if (ret != ESP_OK) {
-                            ESP_LOGW(POWER_GRID_TAG, "WebSocket send failed to client %d: %s", i, esp_err_to_name(ret));
-                            if (ret == ESP_ERR_INVALID_ARG || ret == ESP_ERR_INVALID_STATE) {
-                                ESP_LOGI(POWER_GRID_TAG, "Output client %d disconnected", i);
-                                ws_out_fds[i] = -1;
+                    if (ws_out_fds[i] < 0) {
+                        continue;
+                    }
+                    bool as_json = ws_out_json[i];
+                    bool resync = false;
+                    if ((as_json && json_len == 0) || !out_flow_tick(i, &resync)) {
+                        trace_event(TRACE_FRAME_SKIPPED, i);
+                        active_clients++;
+                        continue;
+                    }
+                    httpd_ws_frame_t *out_frame = as_json ? &json_frame : &ws_frame;
+                    httpd_ws_frame_t keyframe_ws = ws_frame;
+                    frame_t *keyframe = NULL;
+                    if (resync && CONFIG_POWER_GRID_TELEMETRY_RBE && !as_json) {
+                        keyframe = encode_resync_frame();
+                        if (!keyframe || keyframe->len == 0) {
+                            // Still behind; retried on the next tick
+                            out_flow_refund(i);
+                            if (keyframe) {
+                                frame_release(keyframe);
                             }
-                        } else {
+                            trace_event(TRACE_FRAME_SKIPPED, i);
                             active_clients++;
+                            continue;
                         }
+                        keyframe_ws.payload = keyframe->data;
+                        keyframe_ws.len = keyframe->len;
+                        out_frame = &keyframe_ws;
+                    }
+                    esp_err_t ret = httpd_ws_send_frame_async(server_handle, ws_out_fds[i], out_frame);
+                    if (keyframe) {
+                        frame_release(keyframe);
+                    }
+                    if (ret != ESP_OK) {
+                        DLOG(DLOG_WS_SEND_FAILED, DLOG_I(i), DLOG_S(esp_err_to_name(ret)));
+                        trace_event(TRACE_SEND_FAILED, i);
+                        out_flow_refund(i);
+                        if (ret == ESP_ERR_INVALID_ARG || ret == ESP_ERR_INVALID_STATE) {
+                            DLOG(DLOG_OUT_CLIENT_GONE, DLOG_I(i));
+                            ws_out_fds[i] = -1;
+                        }
+                    } else {
+                        active_clients++;
+                        sent_clients++;
+                        json_clients += as_json;
+                        ws_out_sent_ms[i] = (uint32_t)(esp_timer_get_time() / 1000);
+                        trace_event(TRACE_FRAME_SENT, i);
                     }
                 }
+                latency_record(LATENCY_TELEMETRY_FANOUT, esp_timer_get_time() - built_us);
+
+                if (sent_clients > 0) {
+                    link_monitor_frame_sent();
+                }
+                if (sent_clients > 0 && boot_trace_get(BOOT_PHASE_FIRST_FRAME) == 0) {
+                    boot_trace_mark(BOOT_PHASE_FIRST_FRAME);
+                    ESP_LOGI(POWER_GRID_TAG, "First telemetry frame %lld ms after boot",
+                             (long long)(boot_trace_get(BOOT_PHASE_FIRST_FRAME) / 1000));
+                }
 
                 // Update should_send_data based on active clients
-                if (active_clients == 0) {
+                if (active_clients == 0 && should_send_data) {
                     should_send_data = false;
                     ESP_LOGI(POWER_GRID_TAG, "No active /out clients, stopping data transmission");
                 }
 
-                // Log efficiency gain occasionally
-                static int log_counter = 0;
-                if (++log_counter % 100 == 0) {  // Log every 10 seconds at 10Hz
-                    ESP_LOGI(POWER_GRID_TAG, "Binary telemetry: %d bytes to %d clients (vs ~150 JSON)", binary_len, active_clients);
+                // Aggregated by the deferred logger to one line per 10 s
+                DLOG(DLOG_TELEMETRY_STATS, DLOG_I(binary_len), DLOG_I(sent_clients - json_clients),
+                     DLOG_I(json_len), DLOG_I(json_clients));
+                if (json) {
+                    frame_release(json);
                 }
             }
+            frame_release(frame);
+        }
+
+        // A rate change from the console cuts the wait short, so the new
+        // period applies from the next cycle
+        uint32_t interval_ms = send_interval_ms;
+        int64_t due_us = esp_timer_get_time() + (int64_t)interval_ms * 1000;
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(interval_ms)) == 0) {
+            latency_record(LATENCY_CYCLE_WAKE, esp_timer_get_time() - due_us);
         }
-        vTaskDelay(pdMS_TO_TICKS(DATA_SEND_INTERVAL_MS));
     }
 }
 
@@ -307,20 +648,301 @@ static esp_err_t power_grid_ws_out_handler(httpd_req_t *req)
             return ESP_FAIL;
         }
 
+        // /out.json registers with a user_ctx; JSON frames are always full
+        bool json = req->user_ctx != NULL;
+        out_flow_reset(client_slot);
+        if (!json) {
+            xSemaphoreTake(node_lock, portMAX_DELAY);
+            grid_data.exception.keyframe_due = 1;   // The new subscriber has no state yet
+            xSemaphoreGive(node_lock);
+        }
+        ws_out_json[client_slot] = json;
         ws_out_fds[client_slot] = httpd_req_to_sockfd(req);
         should_send_data = true;
-        ESP_LOGI(POWER_GRID_TAG, "Added /out client %d (fd=%d)", client_slot, ws_out_fds[client_slot]);
+        boot_trace_mark(BOOT_PHASE_FIRST_SUBSCRIBER);
+        ESP_LOGI(POWER_GRID_TAG, "Added /out%s client %d (fd=%d)", json ? ".json" : "", client_slot,
+                 ws_out_fds[client_slot]);
 
         if (data_task == NULL) {
-            xTaskCreate(data_send_task, "data_send", 4096, NULL, 5, &data_task);
+            xTaskCreate(data_send_task, "data_send", DATA_SEND_TASK_STACK, NULL, CONFIG_POWER_GRID_TELEMETRY_TASK_PRIORITY, &data_task);
             ESP_LOGI(POWER_GRID_TAG, "Started data send task at 10 Hz");
         }
 
         return ESP_OK;
     }
 
-    // /out is send-only - we don't expect to receive data from clients
-    // Just return OK and let data_send_task handle all outgoing frames
+    // Inbound /out frames are CRED grants and TSYN clock sync pings;
+    // telemetry itself goes out from data_send_task. The ping's receive time
+    // is taken before the frame is read.
+    int64_t received_us = esp_timer_get_time();
+    httpd_ws_frame_t ws_pkt;
+    memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
+    if (httpd_ws_recv_frame(req, &ws_pkt, 0) != ESP_OK) {
+        return ESP_OK;
+    }
+
+    uint8_t payload[16];
+    if (ws_pkt.len > sizeof(payload)) {
+        // Drain anything unexpected so the socket stays in sync
+        frame_t *drain = frame_pool_alloc(&control_pool);
+        if (drain && ws_pkt.len <= control_pool.block_size) {
+            ws_pkt.payload = drain->data;
+            httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len);
+        }
+        if (drain) {
+            frame_release(drain);
+        }
+        return ESP_OK;
+    }
+    ws_pkt.payload = payload;
+    if (ws_pkt.len > 0 && httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len) != ESP_OK) {
+        return ESP_OK;
+    }
+
+    int fd = httpd_req_to_sockfd(req);
+    int slot = -1;
+    for (int i = 0; i < MAX_OUT_CLIENTS; i++) {
+        if (ws_out_fds[i] == fd) {
+            slot = i;
+            break;
+        }
+    }
+
+    if (ws_pkt.type == HTTPD_WS_TYPE_CLOSE) {
+        if (slot >= 0) {
+            DLOG(DLOG_OUT_CLIENT_GONE, DLOG_I(slot));
+            ws_out_fds[slot] = -1;
+        }
+        return ESP_OK;
+    }
+
+    // Answered on the telemetry clock, so subscribers can map frame
+    // timestamps to their own time
+    time_sync_t sync;
+    if (slot >= 0 && ws_pkt.type == HTTPD_WS_TYPE_BINARY && decode_time_sync(payload, ws_pkt.len, &sync) &&
+        sync.magic == TIME_SYNC_MAGIC) {
+        uint8_t reply[TIME_SYNC_REPLY_SIZE];
+        sync.magic = TIME_SYNC_REPLY_MAGIC;
+        sync.receive_us = (uint64_t)received_us;
+        sync.transmit_us = (uint64_t)esp_timer_get_time();
+        httpd_ws_frame_t ws_frame = {
+            .final = true,
+            .fragmented = false,
+            .type = HTTPD_WS_TYPE_BINARY,
+            .payload = reply,
+            .len = encode_time_sync(&sync, reply)
+        };
+        esp_err_t ret = httpd_ws_send_frame(req, &ws_frame);
+        if (ret != ESP_OK) {
+            DLOG(DLOG_WS_SEND_FAILED, DLOG_I(slot), DLOG_S(esp_err_to_name(ret)));
+        }
+        return ESP_OK;
+    }
+
+    flow_credit_t credit;
+    if (slot < 0 || ws_pkt.type != HTTPD_WS_TYPE_BINARY ||
+        !decode_flow_credit(payload, ws_pkt.len, &credit)) {
+        return ESP_OK;
+    }
+
+    trace_event(TRACE_CREDIT_GRANT, slot);
+    if (!out_flow_grant(slot, credit.credits)) {
+        return ESP_OK;
+    }
+    if (ws_out_json[slot]) {
+        // JSON frames are not kept past their tick, so a JSON subscriber
+        // that ran dry gets the next tick's frame instead
+        out_flow_refund(slot);
+    } else {
+        // The subscriber ran dry and missed frames: catch it up with the
+        // newest one instead of waiting for the next tick. With deltas it
+        // missed changes too, so it gets a keyframe of the reported state.
+        // The latest frame is sent by reference, without a copy.
+        frame_t *frame;
+        if (CONFIG_POWER_GRID_TELEMETRY_RBE) {
+            frame = encode_resync_frame();
+        } else {
+            portENTER_CRITICAL(&latest_lock);
+            frame = latest_frame;
+            if (frame) {
+                frame_ref(frame);
+            }
+            portEXIT_CRITICAL(&latest_lock);
+        }
+
+        size_t len = frame ? frame->len : 0;
+        httpd_ws_frame_t ws_frame = {
+            .final = true,
+            .fragmented = false,
+            .type = HTTPD_WS_TYPE_BINARY,
+            .payload = frame ? frame->data : NULL,
+            .len = len
+        };
+        esp_err_t ret = len ? httpd_ws_send_frame(req, &ws_frame) : ESP_ERR_INVALID_SIZE;
+        if (ret != ESP_OK) {
+            out_flow_refund(slot);
+            if (len) {
+                DLOG(DLOG_WS_SEND_FAILED, DLOG_I(slot), DLOG_S(esp_err_to_name(ret)));
+                trace_event(TRACE_SEND_FAILED, slot);
+            }
+        } else {
+            ws_out_sent_ms[slot] = (uint32_t)(esp_timer_get_time() / 1000);
+            trace_event(TRACE_FRAME_SENT, slot);
+        }
+        if (frame) {
+            frame_release(frame);
+        }
+    }
+
+    return ESP_OK;
+}
+
+// Per /in session: dispatch message being decoded across fragments
+typedef struct {
+    dispatch_stream_t stream;
+    bool active;            // A message has started and not yet ended
+    int64_t received_us;    // First frame of the current message arrived
+    uint32_t bytes;         // Payload bytes of the current message
+    uint32_t seq;           // dispatch_seq taken when the current message started
+    actuator_setpoint_t pending[ACTUATOR_MAX_OUTPUTS];  // Decoded, not yet applied
+    int pending_count;
+} in_session_t;
+
+static void flush_setpoints(in_session_t *session)
+{
+    apply_setpoints(session->pending, session->pending_count);
+    session->pending_count = 0;
+}
+
+static void queue_setpoint(in_session_t *session, uint16_t node_id, uint32_t duty)
+{
+    int output = node_output(node_id);
+    if (output < 0) {
+        return;
+    }
+    if (session->pending_count == ACTUATOR_MAX_OUTPUTS) {
+        flush_setpoints(session);
+    }
+    session->pending[session->pending_count++] = (actuator_setpoint_t){
+        .output = (uint16_t)output,
+        .duty = (uint16_t)(duty > ACTUATOR_DUTY_MAX ? ACTUATOR_DUTY_MAX : duty)
+    };
+}
+
+static void apply_dispatch_node(const dispatch_node_t *node, void *ctx)
+{
+    float supply = node->supply < 0.0f ? 0.0f : node->supply > 1.0f ? 1.0f : node->supply;
+    queue_setpoint(ctx, node->id, (uint32_t)(supply * ACTUATOR_DUTY_MAX));
+    DLOG(DLOG_DISPATCH_APPLIED, DLOG_I(node->id), DLOG_F(node->supply), DLOG_I(node->source));
+}
+
+// Dense dispatch path: the duty is already in actuator steps, so no float math
+static void apply_dispatch_duty(uint16_t node_id, uint16_t duty, void *ctx)
+{
+    queue_setpoint(ctx, node_id, duty);
+}
+
+// Ack each dispatch frame on the /in socket it arrived on, after the duties
+// are latched, so clients can measure dispatch-to-apply latency
+static void send_dispatch_ack(httpd_req_t *req, uint32_t seq, uint8_t status, uint8_t applied)
+{
+#if CONFIG_POWER_GRID_DISPATCH_ACK
+    uint8_t buffer[DISPATCH_ACK_SIZE];
+    dispatch_ack_t ack = {
+        .seq = seq,
+        .status = status,
+        .applied = applied
+    };
+    httpd_ws_frame_t ws_frame = {
+        .final = true,
+        .fragmented = false,
+        .type = HTTPD_WS_TYPE_BINARY,
+        .payload = buffer,
+        .len = encode_dispatch_ack(&ack, buffer)
+    };
+    esp_err_t ret = httpd_ws_send_frame(req, &ws_frame);
+    if (ret != ESP_OK) {
+        DLOG(DLOG_WS_SEND_FAILED, DLOG_I(httpd_req_to_sockfd(req)), DLOG_S(esp_err_to_name(ret)));
+    }
+#endif
+}
+
+// One complete /in WebSocket frame, already read into chunk; received_us
+// is when its header arrived
+static esp_err_t handle_in_frame(httpd_req_t *req, const httpd_ws_frame_t *ws_pkt, const uint8_t *chunk,
+                                 int64_t received_us)
+{
+    if (ws_pkt->type == HTTPD_WS_TYPE_CLOSE) {
+        ESP_LOGI(POWER_GRID_TAG, "WebSocket /in connection closed by client");
+        ws_in_fd = -1;
+        return ESP_OK;
+    }
+    if (ws_pkt->type == HTTPD_WS_TYPE_TEXT) {
+        // JSON protocol removed - binary only
+        ESP_LOGW(POWER_GRID_TAG, "Text/JSON messages not supported - use binary protocol only");
+        return ESP_OK;
+    }
+    if (ws_pkt->type != HTTPD_WS_TYPE_BINARY && ws_pkt->type != HTTPD_WS_TYPE_CONTINUE) {
+        return ESP_OK;
+    }
+
+    // Node control messages are single frames; acked like a dispatch with
+    // applied = 1 if the node table changed
+    node_control_t control;
+    if (ws_pkt->type == HTTPD_WS_TYPE_BINARY && ws_pkt->final &&
+        decode_node_control(chunk, ws_pkt->len, &control)) {
+        bool changed = apply_node_control(&control);
+        DLOG(DLOG_NODE_CONTROL, DLOG_I(control.op), DLOG_I(control.id), DLOG_I(changed));
+        send_dispatch_ack(req, __atomic_load_n(&dispatch_seq, __ATOMIC_RELAXED),
+                          changed ? DISPATCH_ACK_APPLIED : DISPATCH_ACK_INVALID, changed ? 1 : 0);
+        return ESP_OK;
+    }
+
+    // Decoder state lives with the session (freed by httpd on close), so a
+    // message may span any number of continuation frames
+    in_session_t *session = req->sess_ctx;
+    if (!session) {
+        session = calloc(1, sizeof(in_session_t));
+        if (!session) {
+            return ESP_ERR_NO_MEM;
+        }
+        req->sess_ctx = session;
+    }
+
+    if (ws_pkt->type == HTTPD_WS_TYPE_BINARY) {
+        dispatch_stream_begin(&session->stream, apply_dispatch_node, apply_dispatch_duty, session);
+        session->active = true;
+        session->received_us = received_us;
+        session->bytes = 0;
+        session->seq = __atomic_add_fetch(&dispatch_seq, 1, __ATOMIC_RELAXED);
+    } else if (!session->active) {
+        return ESP_OK;  // Continuation without a message start
+    }
+
+    // Nodes are decoded straight out of the receive buffer and their
+    // setpoints handed to the actuator driver as one batch per frame
+    session->bytes += ws_pkt->len;
+    trace_event(TRACE_DISPATCH_RECEIVED, ws_pkt->len);
+    dispatch_stream_feed(&session->stream, chunk, ws_pkt->len);
+    flush_setpoints(session);
+    if (!ws_pkt->final) {
+        return ESP_OK;
+    }
+
+    session->active = false;
+    uint16_t applied = session->stream.nodes_done;
+    latency_record(LATENCY_DISPATCH_APPLY, esp_timer_get_time() - session->received_us);
+    trace_event(TRACE_DISPATCH_APPLIED, applied);
+    if (applied > 0) {
+        warm_state_commit(session->seq);
+    }
+    if (dispatch_stream_end(&session->stream) == DISPATCH_STREAM_DONE) {
+        send_dispatch_ack(req, session->seq, DISPATCH_ACK_APPLIED, applied > 255 ? 255 : (uint8_t)applied);
+        boot_trace_mark(BOOT_PHASE_FIRST_DISPATCH);
+    } else {
+        DLOG(DLOG_DISPATCH_INVALID, DLOG_I(session->bytes));
+        send_dispatch_ack(req, session->seq, DISPATCH_ACK_INVALID, applied > 255 ? 255 : (uint8_t)applied);
+    }
 
     return ESP_OK;
 }
@@ -333,26 +955,21 @@ static esp_err_t power_grid_ws_in_handler(httpd_req_t *req)
         return ESP_OK;
     }
 
+    int64_t received_us = esp_timer_get_time();
     httpd_ws_frame_t ws_pkt;
     memset(&ws_pkt, 0, sizeof(httpd_ws_frame_t));
 
     esp_err_t ret = httpd_ws_recv_frame(req, &ws_pkt, 0);
     if (ret != ESP_OK) {
-        static int error_count = 0;
-        static int64_t last_error_time = 0;
-        int64_t now = esp_timer_get_time() / 1000;
+        // Error lines are aggregated by the deferred logger; this only tracks
+        // consecutive failures for the disconnect decision
+        static int consecutive_errors = 0;
 
-        error_count++;
-
-        if (now - last_error_time > 5000 || error_count >= 10) {
-            ESP_LOGW(POWER_GRID_TAG, "WebSocket /in recv errors: %d in last %.1fs, latest: %s",
-                    error_count, (now - last_error_time) / 1000.0f, esp_err_to_name(ret));
-            error_count = 0;
-            last_error_time = now;
-        }
+        DLOG(DLOG_IN_RECV_ERROR, DLOG_S(esp_err_to_name(ret)));
 
-        if (ret == ESP_ERR_INVALID_STATE && error_count >= 10) {
+        if (ret == ESP_ERR_INVALID_STATE && ++consecutive_errors >= 10) {
             ESP_LOGE(POWER_GRID_TAG, "Persistent WebSocket /in errors, disconnecting");
+            consecutive_errors = 0;
             ws_in_fd = -1;
         }
 
@@ -361,42 +978,307 @@ static esp_err_t power_grid_ws_in_handler(httpd_req_t *req)
 
     ESP_LOGD(POWER_GRID_TAG, "WebSocket /in frame: type=%d, len=%d, fin=%d", ws_pkt.type, ws_pkt.len, ws_pkt.final);
 
-    if (ws_pkt.len > 0 && ws_pkt.len < MAX_WS_BUFFER - 1) {
-        ws_pkt.payload = ws_buffer;
-        ret = httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len);
-
-        if (ret == ESP_OK) {
-            if (ws_pkt.type == HTTPD_WS_TYPE_CLOSE) {
-                ESP_LOGI(POWER_GRID_TAG, "WebSocket /in connection closed by client");
-                ws_in_fd = -1;
-            } else if (ws_pkt.type == HTTPD_WS_TYPE_BINARY) {
-                // Binary dispatch protocol
-                dispatch_packet_t dispatch_packet;
-                if (decode_dispatch(ws_buffer, ws_pkt.len, &dispatch_packet)) {
-                    for (int i = 0; i < dispatch_packet.node_count; i++) {
-                        dispatch_node_t *node = &dispatch_packet.nodes[i];
-                        set_output_pwm(node->id, node->supply);
-
-                        // Log occasionally for debugging
-                        static int log_counter = 0;
-                        if (++log_counter % 100 == 0) {  // Every 10 seconds
-                            ESP_LOGI(POWER_GRID_TAG, "Binary dispatch: node %d gets %.3f supply from source %d",
-                                    node->id, node->supply, node->source);
-                        }
-                    }
-                } else {
-                    ESP_LOGW(POWER_GRID_TAG, "Invalid binary dispatch received (%d bytes)", ws_pkt.len);
-                }
-            } else if (ws_pkt.type == HTTPD_WS_TYPE_TEXT) {
-                // JSON protocol removed - binary only
-                ESP_LOGW(POWER_GRID_TAG, "Text/JSON messages not supported - use binary protocol only");
-            }
+    // /in is served by both the main and the control server tasks, so each
+    // frame is read into its own control pool block.
+    // httpd only reads whole WebSocket frames, so a frame must fit a block;
+    // longer messages have to be fragmented by the sender. Unread payload
+    // would desynchronise the socket, so close it instead.
+    frame_t *chunk = frame_pool_alloc(&control_pool);
+    if (!chunk || ws_pkt.len > control_pool.block_size) {
+        if (chunk) {
+            DLOG(DLOG_DISPATCH_INVALID, DLOG_I(ws_pkt.len));
+            frame_release(chunk);
+        } else {
+            DLOG(DLOG_POOL_EXHAUSTED, DLOG_S(control_pool.name));
+        }
+        in_session_t *session = req->sess_ctx;
+        uint32_t seq = session && session->active ? session->seq : __atomic_load_n(&dispatch_seq, __ATOMIC_RELAXED);
+        send_dispatch_ack(req, seq, DISPATCH_ACK_INVALID, 0);
+        ws_in_fd = -1;
+        return ESP_FAIL;
+    }
+    if (ws_pkt.len > 0) {
+        ws_pkt.payload = chunk->data;
+        if (httpd_ws_recv_frame(req, &ws_pkt, ws_pkt.len) != ESP_OK) {
+            frame_release(chunk);
+            return ESP_OK;
         }
     }
 
-    return ESP_OK;
+    ret = handle_in_frame(req, &ws_pkt, chunk->data, received_us);
+    frame_release(chunk);
+    return ret;
 }
 
+// GET /boot: boot-phase timestamps (µs since reset), IP publish state and Wi-Fi connect phases
+static esp_err_t power_grid_boot_handler(httpd_req_t *req)
+{
+    char json[768];
+    ip_announce_stats_t announce;
+    ip_announce_get_stats(&announce);
+
+    size_t len = snprintf(json, sizeof(json), "{\"phases_us\":");
+    len += boot_trace_to_json(json + len, sizeof(json) - len);
+    if (len < sizeof(json)) {
+        len += snprintf(json + len, sizeof(json) - len,
+                        ",\"ip_publish\":{\"attempts\":%u,\"published\":%u,\"last_status\":%d}",
+                        (unsigned)announce.attempts, (unsigned)announce.published, announce.last_status);
+    }
+#if CONFIG_EXAMPLE_CONNECT_WIFI
+    example_wifi_connect_timing_t wifi;
+    example_wifi_get_connect_timing(&wifi);
+    if (len < sizeof(json)) {
+        len += snprintf(json + len, sizeof(json) - len,
+                        ",\"wifi_us\":{\"start\":%lld,\"started\":%lld,\"connect\":%lld,\"associated\":%lld,"
+                        "\"got_ip\":%lld,\"fast_path\":%s,\"cached_lease\":%s,\"fallbacks\":%u}",
+                        (long long)wifi.start_us, (long long)wifi.started_us, (long long)wifi.connect_us,
+                        (long long)wifi.associated_us, (long long)wifi.got_ip_us,
+                        wifi.fast_path ? "true" : "false", wifi.cached_lease ? "true" : "false",
+                        (unsigned)wifi.fallbacks);
+    }
+#endif
+    if (len < sizeof(json)) {
+        len += snprintf(json + len, sizeof(json) - len, "}");
+    }
+    if (len >= sizeof(json)) {
+        len = sizeof(json) - 1;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
+// GET /history: telemetry buffered while offline, as [uint16 len][GRID frame]...
+static esp_err_t power_grid_history_handler(httpd_req_t *req)
+{
+    telemetry_history_stats_t history;
+    telemetry_history_get_stats(&history);
+
+    uint8_t *buffer = history.bytes ? malloc(history.bytes) : NULL;
+    size_t len = buffer ? telemetry_history_copy(buffer, history.bytes) : 0;
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    esp_err_t ret = httpd_resp_send(req, (const char *)buffer, len);
+    free(buffer);
+    return ret;
+}
+
+// GET /link: outage and recovery metrics plus history ring state
+static esp_err_t power_grid_link_handler(httpd_req_t *req)
+{
+    char json[384];
+    link_stats_t link;
+    telemetry_history_stats_t history;
+    link_monitor_get_stats(&link);
+    telemetry_history_get_stats(&history);
+
+    int len = snprintf(json, sizeof(json),
+                       "{\"online\":%s,\"outages\":%u,\"down_since_us\":%lld,"
+                       "\"last_outage_us\":%lld,\"max_outage_us\":%lld,\"total_outage_us\":%lld,"
+                       "\"last_recover_us\":%lld,\"max_recover_us\":%lld,"
+                       "\"history\":{\"frames\":%u,\"bytes\":%u,\"recorded\":%u,\"overwritten\":%u}}",
+                       link.online ? "true" : "false", (unsigned)link.outages, (long long)link.down_since_us,
+                       (long long)link.last_outage_us, (long long)link.max_outage_us, (long long)link.total_outage_us,
+                       (long long)link.last_recover_us, (long long)link.max_recover_us,
+                       (unsigned)history.frames, (unsigned)history.bytes,
+                       (unsigned)history.recorded, (unsigned)history.overwritten);
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
+// GET /warm: warm-restart outcome, persisted setpoints and dispatch trajectory
+static esp_err_t power_grid_warm_handler(httpd_req_t *req)
+{
+    char json[1536];
+    size_t len = warm_state_to_json(json, sizeof(json));
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
+// GET /sense: continuous ADC state and the last window per sense channel
+static esp_err_t power_grid_sense_handler(httpd_req_t *req)
+{
+    char json[768];
+    size_t len = adc_sense_to_json(json, sizeof(json));
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
+// GET /sense/bench: CPU cycles per sample of the sensing pipeline at 1, 4
+// and 8 channels (the filter bank always computes all 8 lanes)
+static esp_err_t power_grid_sense_bench_handler(httpd_req_t *req)
+{
+    static const int channel_counts[] = {1, 4, SENSE_MAX_CHANNELS};
+    char json[512];
+    size_t len = 0;
+
+    json[len++] = '[';
+    for (size_t i = 0; i < sizeof(channel_counts) / sizeof(channel_counts[0]); i++) {
+        if (i > 0) {
+            json[len++] = ',';
+        }
+        len += adc_sense_bench_to_json(json + len, sizeof(json) - len - 1, channel_counts[i]);
+    }
+    json[len++] = ']';
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
+// GET /flow: per-subscriber credit, effective rate and coalesced frames
+static esp_err_t power_grid_flow_handler(httpd_req_t *req)
+{
+    char json[768];
+    uint32_t interval_ms = send_interval_ms ? send_interval_ms : DATA_SEND_INTERVAL_MS;
+    int len = snprintf(json, sizeof(json), "{\"interval_ms\":%u,\"subscribers\":[", (unsigned)interval_ms);
+
+    bool first = true;
+    for (int i = 0; i < MAX_OUT_CLIENTS && len < (int)sizeof(json); i++) {
+        if (ws_out_fds[i] < 0) {
+            continue;
+        }
+        out_flow_stats_t flow;
+        out_flow_get_stats(i, &flow);
+        len += snprintf(json + len, sizeof(json) - len,
+                        "%s{\"slot\":%d,\"format\":\"%s\",\"credit_mode\":%s,\"credit\":%u,\"decimation\":%u,"
+                        "\"rate_hz\":%.2f,\"stale\":%s,\"sent\":%u,\"coalesced\":%u,\"granted\":%u}",
+                        first ? "" : ",", i, ws_out_json[i] ? "json" : "binary", flow.credit_mode ? "true" : "false", (unsigned)flow.credit,
+                        (unsigned)flow.decimation, 1000.0 / (interval_ms * (flow.decimation ? flow.decimation : 1)),
+                        flow.stale ? "true" : "false", (unsigned)flow.sent, (unsigned)flow.coalesced,
+                        (unsigned)flow.granted);
+        first = false;
+    }
+    if (len < (int)sizeof(json)) {
+        len += snprintf(json + len, sizeof(json) - len, "]}");
+    }
+    if (len >= (int)sizeof(json)) {
+        len = sizeof(json) - 1;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
+static esp_err_t power_grid_pools_handler(httpd_req_t *req)
+{
+    const frame_pool_t *pools[] = {&telemetry_pool, &json_pool, &control_pool};
+    char json[512];
+    size_t len = 0;
+
+    json[len++] = '[';
+    for (size_t i = 0; i < sizeof(pools) / sizeof(pools[0]); i++) {
+        if (i > 0) {
+            json[len++] = ',';
+        }
+        len += frame_pool_to_json(pools[i], json + len, sizeof(json) - len - 1);
+    }
+    json[len++] = ']';
+
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_send(req, json, len);
+}
+
+#if CONFIG_POWER_GRID_CONSOLE
+static uint32_t console_get_interval_ms(void)
+{
+    return send_interval_ms;
+}
+
+// Saved with the warm state like any other period; the send task is woken
+// so the new period starts now rather than after the old one runs out
+static void console_set_interval_ms(uint32_t interval_ms)
+{
+    send_interval_ms = interval_ms;
+    warm_state_set_send_interval_ms(interval_ms);
+    trace_event(TRACE_RATE_CHANGED, interval_ms);
+    if (data_task) {
+        xTaskNotifyGive(data_task);
+    }
+}
+
+static int console_get_subscribers(grid_console_subscriber_t *subscribers, int max)
+{
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    int count = 0;
+    for (int i = 0; i < MAX_OUT_CLIENTS && count < max; i++) {
+        if (ws_out_fds[i] < 0) {
+            continue;
+        }
+        grid_console_subscriber_t *sub = &subscribers[count++];
+        sub->slot = i;
+        sub->json = ws_out_json[i];
+        out_flow_get_stats(i, &sub->flow);
+        sub->since_sent_ms = sub->flow.sent ? now_ms - ws_out_sent_ms[i] : UINT32_MAX;
+    }
+    return count;
+}
+
+static const grid_console_ops_t console_ops = {
+    .get_interval_ms = console_get_interval_ms,
+    .set_interval_ms = console_set_interval_ms,
+    .get_subscribers = console_get_subscribers,
+};
+#endif
+
+static const httpd_uri_t power_grid_flow_uri = {
+    .uri = "/flow",
+    .method = HTTP_GET,
+    .handler = power_grid_flow_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t power_grid_pools_uri = {
+    .uri = "/pools",
+    .method = HTTP_GET,
+    .handler = power_grid_pools_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t power_grid_sense_uri = {
+    .uri = "/sense",
+    .method = HTTP_GET,
+    .handler = power_grid_sense_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t power_grid_sense_bench_uri = {
+    .uri = "/sense/bench",
+    .method = HTTP_GET,
+    .handler = power_grid_sense_bench_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t power_grid_warm_uri = {
+    .uri = "/warm",
+    .method = HTTP_GET,
+    .handler = power_grid_warm_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t power_grid_history_uri = {
+    .uri = "/history",
+    .method = HTTP_GET,
+    .handler = power_grid_history_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t power_grid_link_uri = {
+    .uri = "/link",
+    .method = HTTP_GET,
+    .handler = power_grid_link_handler,
+    .user_ctx = NULL
+};
+
+static const httpd_uri_t power_grid_boot_uri = {
+    .uri = "/boot",
+    .method = HTTP_GET,
+    .handler = power_grid_boot_handler,
+    .user_ctx = NULL
+};
+
 static const httpd_uri_t power_grid_ws_out_uri = {
     .uri = "/out",
     .method = HTTP_GET,
@@ -405,6 +1287,15 @@ static const httpd_uri_t power_grid_ws_out_uri = {
     .is_websocket = true
 };
 
+// Same handler and slots as /out; a non-NULL user_ctx selects JSON text frames
+static const httpd_uri_t power_grid_ws_out_json_uri = {
+    .uri = "/out.json",
+    .method = HTTP_GET,
+    .handler = power_grid_ws_out_handler,
+    .user_ctx = "json",
+    .is_websocket = true
+};
+
 static const httpd_uri_t power_grid_ws_in_uri = {
     .uri = "/in",
     .method = HTTP_GET,
@@ -421,6 +1312,17 @@ esp_err_t register_power_grid_handler(httpd_handle_t server)
 
     esp_err_t ret1 = httpd_register_uri_handler(server, &power_grid_ws_out_uri);
     esp_err_t ret2 = httpd_register_uri_handler(server, &power_grid_ws_in_uri);
+    if (CONFIG_POWER_GRID_JSON_OUT) {
+        httpd_register_uri_handler(server, &power_grid_ws_out_json_uri);
+    }
+    httpd_register_uri_handler(server, &power_grid_boot_uri);
+    httpd_register_uri_handler(server, &power_grid_history_uri);
+    httpd_register_uri_handler(server, &power_grid_link_uri);
+    httpd_register_uri_handler(server, &power_grid_warm_uri);
+    httpd_register_uri_handler(server, &power_grid_flow_uri);
+    httpd_register_uri_handler(server, &power_grid_sense_uri);
+    httpd_register_uri_handler(server, &power_grid_sense_bench_uri);
+    httpd_register_uri_handler(server, &power_grid_pools_uri);
 
     if (ret1 == ESP_OK && ret2 == ESP_OK) {
         ESP_LOGI(POWER_GRID_TAG, "Power grid WebSocket handlers registered at /out and /in");
@@ -437,6 +1339,7 @@ void power_grid_cleanup(void)
     should_send_data = false;
     for (int i = 0; i < MAX_OUT_CLIENTS; i++) {
         ws_out_fds[i] = -1;
+        ws_out_json[i] = false;
     }
     ws_in_fd = -1;
     server_handle = NULL;
@@ -446,37 +1349,27 @@ void power_grid_cleanup(void)
     }
 }
 
-static void post_ip_address(void)
+// Socket options are best effort: lwIP only honours SO_SNDBUF when built
+// with LWIP_SO_SNDBUF, and a failed setsockopt must not refuse the client
+static esp_err_t telemetry_sock_open(httpd_handle_t hd, int sockfd)
 {
-    esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-    esp_netif_ip_info_t ip_info;
-
-    if (esp_netif_get_ip_info(netif, &ip_info) == ESP_OK) {
-        char ip_str[16];
-        snprintf(ip_str, sizeof(ip_str), IPSTR, IP2STR(&ip_info.ip));
-        ESP_LOGI(POWER_GRID_TAG, "Local IP address: %s", ip_str);
-
-        esp_http_client_config_t config = {
-            .url = "http://kv.wfeng.dev/hackmit25:ip",
-            .method = HTTP_METHOD_POST,
-        };
-
-        esp_http_client_handle_t client = esp_http_client_init(&config);
-        esp_http_client_set_post_field(client, ip_str, strlen(ip_str));
-        esp_http_client_set_header(client, "Content-Type", "text/plain");
-
-        esp_err_t err = esp_http_client_perform(client);
-        if (err == ESP_OK) {
-            int status_code = esp_http_client_get_status_code(client);
-            ESP_LOGI(POWER_GRID_TAG, "IP address posted successfully, status: %d", status_code);
-        } else {
-            ESP_LOGE(POWER_GRID_TAG, "Failed to post IP address: %s", esp_err_to_name(err));
-        }
+    int sndbuf = CONFIG_POWER_GRID_TELEMETRY_SNDBUF;
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    return ESP_OK;
+}
 
-        esp_http_client_cleanup(client);
-    } else {
-        ESP_LOGE(POWER_GRID_TAG, "Failed to get IP address");
-    }
+// Dispatch frames and acks are tiny and latency-bound: no Nagle delay,
+// low-delay DSCP marking, and a small send buffer so acks never sit
+// behind bulk data
+static esp_err_t control_sock_open(httpd_handle_t hd, int sockfd)
+{
+    int nodelay = 1;
+    int tos = DSCP_EF_TOS;
+    int sndbuf = CONFIG_POWER_GRID_CONTROL_SNDBUF;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    setsockopt(sockfd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    return ESP_OK;
 }
 
 static httpd_handle_t start_webserver(void)
@@ -489,7 +1382,9 @@ static httpd_handle_t start_webserver(void)
     config.send_wait_timeout = 10;
     config.max_resp_headers = 16;
     config.max_uri_handlers = 16;
-    config.stack_size = 8192;  // Increase stack size for WebSocket handling
+    config.stack_size = HTTPD_TASK_STACK;  // WebSocket handling plus the resync encode
+    config.task_priority = CONFIG_POWER_GRID_TELEMETRY_TASK_PRIORITY;
+    config.open_fn = telemetry_sock_open;
 
     if (httpd_start(&server, &config) == ESP_OK) {
         register_power_grid_handler(server);
@@ -498,31 +1393,130 @@ static httpd_handle_t start_webserver(void)
     return NULL;
 }
 
+// /in on its own listener and task, above the telemetry server, so /out
+// sends and slow handshakes never delay dispatch. /in stays registered on
+// the main port too for clients that do not know the control port.
+static httpd_handle_t start_control_server(void)
+{
+#if CONFIG_POWER_GRID_CONTROL_PORT
+    httpd_handle_t server = NULL;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+
+    config.server_port = CONFIG_POWER_GRID_CONTROL_PORT;
+    config.ctrl_port = ESP_HTTPD_DEF_CTRL_PORT + 1;
+    config.task_priority = CONFIG_POWER_GRID_CONTROL_TASK_PRIORITY;
+    config.stack_size = 6144;
+    config.max_open_sockets = 3;
+    config.max_uri_handlers = 2;
+    config.recv_wait_timeout = 10;
+    config.send_wait_timeout = 2;   // A stalled peer must not hold the control task
+    config.open_fn = control_sock_open;
+
+    if (httpd_start(&server, &config) != ESP_OK) {
+        ESP_LOGE(POWER_GRID_TAG, "Failed to start control server on port %d; /in stays on the main port",
+                 CONFIG_POWER_GRID_CONTROL_PORT);
+        return NULL;
+    }
+    httpd_register_uri_handler(server, &power_grid_ws_in_uri);
+    return server;
+#else
+    return NULL;
+#endif
+}
+
 void app_main(void)
 {
-    ESP_LOGI(POWER_GRID_TAG, "Starting Power Grid Node");
+    boot_trace_mark(BOOT_PHASE_APP_MAIN);
+
+    // Before anything else touches the outputs: restore the last setpoints
+    bool warm = warm_state_restore();
+    init_actuators();
+    boot_trace_mark(BOOT_PHASE_PWM_READY);
+    adc_sense_start();
+    if (warm) {
+        boot_trace_mark(BOOT_PHASE_OUTPUT_RESTORED);
+        dispatch_seq = warm_state_dispatch_seq();
+        send_interval_ms = warm_state_send_interval_ms(DATA_SEND_INTERVAL_MS);
+    }
 
-    init_pwm_outputs();
+    ESP_LOGI(POWER_GRID_TAG, "Starting Power Grid Node");
+    ESP_ERROR_CHECK(dlog_init());
+
+    warm_state_info_t warm_info;
+    warm_state_get_info(&warm_info);
+    if (warm) {
+        ESP_LOGI(POWER_GRID_TAG, "Warm restart #%u: restored setpoints (%u ms old) %lld us after boot",
+                 (unsigned)warm_info.warm_restarts, (unsigned)warm_info.age_ms,
+                 (long long)boot_trace_get(BOOT_PHASE_OUTPUT_RESTORED));
+    } else {
+        ESP_LOGI(POWER_GRID_TAG, "Cold start (%s)", warm_info.discarded);
+    }
 
     ESP_ERROR_CHECK(nvs_flash_init());
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
+    // Publishes the address from IP_EVENT_STA_GOT_IP in the background, so
+    // it must be subscribed before the station connects
+    ESP_ERROR_CHECK(ip_announce_start());
+
+    // Outage tracking and the offline history ring; the Wi-Fi layer
+    // reconnects with backoff and never gives up, so nothing here reboots
+    ESP_ERROR_CHECK(link_monitor_start());
+    if (telemetry_history_init() != ESP_OK) {
+        ESP_LOGW(POWER_GRID_TAG, "No memory for telemetry history; outages will leave gaps");
+    }
+
+    // Every frame buffer the servers and the send task use comes from here
+    frame_pool_init(&telemetry_pool, "telemetry", telemetry_frames, &telemetry_storage[0][0], TELEMETRY_FRAME_MAX,
+                    CONFIG_POWER_GRID_POOL_TELEMETRY_BLOCKS);
+    frame_pool_init(&json_pool, "json", json_frames, &json_storage[0][0], TELEMETRY_JSON_FRAME_MAX,
+                    CONFIG_POWER_GRID_POOL_JSON_BLOCKS);
+    frame_pool_init(&control_pool, "control", control_frames, &control_storage[0][0], IN_CHUNK_BYTES,
+                    CONFIG_POWER_GRID_POOL_CONTROL_BLOCKS);
+
+#if CONFIG_POWER_GRID_SHM_RING
+    // Readers on the same host get frames from boot, so the send task runs
+    // without waiting for a first /out subscriber
+    if (shm_ring_create(&telemetry_ring, CONFIG_POWER_GRID_SHM_RING_NAME, CONFIG_POWER_GRID_SHM_RING_SLOTS,
+                        TELEMETRY_FRAME_MAX)) {
+        ESP_LOGI(POWER_GRID_TAG, "Telemetry ring %s: %u frames of %u bytes", CONFIG_POWER_GRID_SHM_RING_NAME,
+                 (unsigned)telemetry_ring.header->slots, (unsigned)TELEMETRY_FRAME_MAX);
+        xTaskCreate(data_send_task, "data_send", DATA_SEND_TASK_STACK, NULL, CONFIG_POWER_GRID_TELEMETRY_TASK_PRIORITY, &data_task);
+    } else {
+        ESP_LOGW(POWER_GRID_TAG, "Telemetry ring %s unavailable; /out only", CONFIG_POWER_GRID_SHM_RING_NAME);
+    }
+#endif
+
+    // The server binds to any address, so it can start before the station
+    // connects; /out and /in are live as soon as an IP arrives
+    httpd_handle_t server = start_webserver();
+    if (server) {
+        boot_trace_mark(BOOT_PHASE_HTTPD_READY);
+        ESP_LOGI(POWER_GRID_TAG, "WebSocket server started on /out and /in");
+    }
+    if (start_control_server()) {
+        ESP_LOGI(POWER_GRID_TAG, "Control server started: /in on port %d", CONFIG_POWER_GRID_CONTROL_PORT);
+    }
+
+#if CONFIG_POWER_GRID_CONSOLE && !CONFIG_EXAMPLE_WIFI_SSID_PWD_FROM_STDIN
+    // Before the connect, so the console also works while the network is down
+    grid_console_start(&console_ops);
+#endif
+
     ESP_LOGI(POWER_GRID_TAG, "Connecting to network...");
     ESP_ERROR_CHECK(example_connect());
+#if CONFIG_POWER_GRID_CONSOLE && CONFIG_EXAMPLE_WIFI_SSID_PWD_FROM_STDIN
+    // The credentials are read from stdin until the connect is done
+    grid_console_start(&console_ops);
+#endif
     
     // Disable WiFi power save to improve stability
     ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_NONE));
     ESP_LOGI(POWER_GRID_TAG, "WiFi power save disabled for stability");
     
-    ESP_LOGI(POWER_GRID_TAG, "Network connected");
-
-    post_ip_address();
-
-    httpd_handle_t server = start_webserver();
-    if (server) {
-        ESP_LOGI(POWER_GRID_TAG, "WebSocket server started on /out and /in");
-    }
+    ESP_LOGI(POWER_GRID_TAG, "Network connected %lld ms after boot",
+             (long long)(boot_trace_get(BOOT_PHASE_NETIF_UP) / 1000));
 
     while (1) {
         vTaskDelay(pdMS_TO_TICKS(1000));
@@ -0,0 +1,74 @@
+#include "sense.h"
+#include <string.h>
+
+_Static_assert(SENSE_MAX_CHANNELS <= FILTER_BANK_LANES, "filter bank has too few lanes");
+
+void sense_init(sense_t *sense, const uint8_t *adc_channels, int count, int32_t zero_code, float amps_per_code,
+                int decimation)
+{
+    if (count < 0) count = 0;
+    if (count > SENSE_MAX_CHANNELS) count = SENSE_MAX_CHANNELS;
+
+    memset(sense, 0, sizeof(*sense));
+    memset(sense->index_of, -1, sizeof(sense->index_of));
+    sense->channels = count;
+    sense->zero_code = zero_code;
+    sense->amps_per_code = amps_per_code;
+    for (int i = 0; i < count; i++) {
+        sense->index_of[adc_channels[i] & 0x0F] = (int8_t)i;
+    }
+    filter_bank_init(&sense->bank, count, decimation);
+}
+
+static void flush_block(sense_t *sense)
+{
+    filter_bank_feed(&sense->bank, (const int32_t (*)[FILTER_BANK_LANES])sense->block, (size_t)sense->block_len);
+    sense->block_len = 0;
+}
+
+void sense_feed(sense_t *sense, const uint8_t *frame, size_t len)
+{
+    int last = sense->channels - 1;
+
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        uint16_t word = (uint16_t)(frame[i] | frame[i + 1] << 8);
+        int index = sense->index_of[word >> 12];
+        if (index < 0) {
+            sense->stray++;
+            continue;
+        }
+        sense->scan[index] = (int32_t)(word & 0x0FFF) - sense->zero_code;
+        sense->count[index]++;
+
+        // The conversion pattern ends a scan with the last channel; after a
+        // lost frame the first partial scan reuses the previous codes
+        if (index == last) {
+            memcpy(sense->block[sense->block_len], sense->scan, sizeof(sense->scan));
+            if (++sense->block_len == SENSE_BLOCK_SCANS) {
+                flush_block(sense);
+            }
+        }
+    }
+    flush_block(sense);
+}
+
+void sense_take_window(sense_t *sense, sense_window_t *window)
+{
+    filter_bank_window_t filtered;
+    float k = sense->amps_per_code;
+
+    filter_bank_take(&sense->bank, &filtered);
+
+    memset(window, 0, sizeof(*window));
+    window->channels = sense->channels;
+    for (int i = 0; i < sense->channels; i++) {
+        if (filtered.outputs > 0) {
+            window->samples[i] = sense->count[i];
+            window->mean_amps[i] = filtered.mean[i] * k;
+            window->rms_amps[i] = filtered.rms[i] * k;
+            window->min_amps[i] = filtered.min[i] * k;
+            window->max_amps[i] = filtered.max[i] * k;
+        }
+        sense->count[i] = 0;
+    }
+}
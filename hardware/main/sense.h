@@ -0,0 +1,85 @@
+#ifndef SENSE_H
+#define SENSE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "filter_bank.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Current sensing windows.
+ *
+ * Consumes continuous-ADC DMA frames in the ESP32's TYPE1 layout (16-bit
+ * little-endian words: 12-bit code, 4-bit channel in the top bits). Words
+ * are collected into scans (one zero-relative code per channel) and run in
+ * blocks through the decimating filter bank (filter_bank.h). A telemetry
+ * tick takes the window: min, max, mean (DC) and RMS current per channel of
+ * the decimated signal since the previous take, then starts a new one.
+ *
+ * No platform dependencies and no locking; the firmware wrapper (adc_sense.c)
+ * and the host replay benchmark both feed it whole DMA frames.
+ */
+
+#define SENSE_MAX_CHANNELS 8
+#define SENSE_ADC_CHANNELS 16       // Range of the 4-bit channel field
+#define SENSE_BLOCK_SCANS 64        // Scans batched per filter bank call
+
+typedef struct {
+    int channels;
+    float mean_amps[SENSE_MAX_CHANNELS];
+    float rms_amps[SENSE_MAX_CHANNELS];
+    float min_amps[SENSE_MAX_CHANNELS];
+    float max_amps[SENSE_MAX_CHANNELS];
+    uint32_t samples[SENSE_MAX_CHANNELS];   // Raw samples; 0 if no decimated output yet
+} sense_window_t;
+
+typedef struct {
+    int channels;
+    int8_t index_of[SENSE_ADC_CHANNELS];    // ADC channel -> sense index, -1 if unused
+    int32_t zero_code;                      // ADC code at zero current
+    float amps_per_code;
+    uint32_t count[SENSE_MAX_CHANNELS];
+    uint32_t stray;                         // Words for channels not configured
+    int block_len;
+    int32_t block[SENSE_BLOCK_SCANS][FILTER_BANK_LANES];    // Completed scans
+    int32_t scan[FILTER_BANK_LANES];                        // Scan being collected
+    filter_bank_t bank;
+} sense_t;
+
+/**
+ * @brief Configure the channels; sense index i reads adc_channels[i]
+ *
+ * @param count Number of channels (clamped to SENSE_MAX_CHANNELS)
+ * @param zero_code ADC code at zero current (mid-rail for a bidirectional sensor)
+ * @param amps_per_code Sensor gain
+ * @param decimation Scans per decimated output (see filter_bank_init())
+ */
+void sense_init(sense_t *sense, const uint8_t *adc_channels, int count, int32_t zero_code, float amps_per_code,
+                int decimation);
+
+/**
+ * @brief Accumulate one DMA frame (len / 2 words; a trailing odd byte is ignored)
+ */
+void sense_feed(sense_t *sense, const uint8_t *frame, size_t len);
+
+/**
+ * @brief Close the current window into *window and start the next one
+ */
+void sense_take_window(sense_t *sense, sense_window_t *window);
+
+/**
+ * @brief Pack one sample as a TYPE1 DMA word, for replaying recorded data
+ */
+static inline uint16_t sense_pack_word(uint8_t adc_channel, uint16_t code)
+{
+    return (uint16_t)((adc_channel & 0x0F) << 12 | (code & 0x0FFF));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SENSE_H
@@ -0,0 +1,344 @@
+#include "shm_ring.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#define CACHE_LINE 64
+
+_Static_assert(sizeof(shm_ring_header_t) == 2 * CACHE_LINE, "header is two cache lines");
+
+typedef struct {
+    uint64_t seq;               // Atomic: 2n+1 while frame n is written, 2n+2 once complete
+    uint32_t len;
+    uint32_t reserved;
+} slot_header_t;
+
+_Static_assert(sizeof(slot_header_t) == SHM_RING_SLOT_HEADER_SIZE, "slot header size");
+
+static inline slot_header_t *slot_at(shm_ring_header_t *header, uint64_t n)
+{
+    uint8_t *base = (uint8_t *)header + sizeof(*header);
+    return (slot_header_t *)(base + (size_t)(n & (header->slots - 1)) * header->slot_stride);
+}
+
+static inline uint8_t *slot_payload(slot_header_t *slot)
+{
+    return (uint8_t *)slot + sizeof(*slot);
+}
+
+// Shared (not FUTEX_PRIVATE) operations: the word is in another process too
+static void futex_wake_all(uint32_t *word)
+{
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static void futex_wait(uint32_t *word, uint32_t expected, const struct timespec *timeout)
+{
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, timeout, NULL, 0);
+}
+
+static int64_t monotonic_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void close_ring(shm_ring_header_t *header)
+{
+    __atomic_store_n(&header->closed, 1, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&header->futex, 1, __ATOMIC_SEQ_CST);
+    futex_wake_all(&header->futex);
+}
+
+// Tell readers of a segment left by an earlier writer that it is gone
+static void close_stale(const char *name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return;
+    }
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size >= (off_t)sizeof(shm_ring_header_t)) {
+        void *map = mmap(NULL, sizeof(shm_ring_header_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+            shm_ring_header_t *header = map;
+            if (header->magic == SHM_RING_MAGIC) {
+                close_ring(header);
+            }
+            munmap(map, sizeof(shm_ring_header_t));
+        }
+    }
+    close(fd);
+    shm_unlink(name);
+}
+
+bool shm_ring_create(shm_ring_t *ring, const char *name, uint32_t slots, uint32_t slot_size)
+{
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+    if (slots == 0 || slots > (1u << 20) || slot_size == 0 || strlen(name) >= sizeof(ring->name)) {
+        return false;
+    }
+    uint32_t rounded = 1;
+    while (rounded < slots) {
+        rounded <<= 1;
+    }
+    uint32_t stride = (uint32_t)((SHM_RING_SLOT_HEADER_SIZE + slot_size + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1));
+    size_t map_size = sizeof(shm_ring_header_t) + (size_t)rounded * stride;
+
+    close_stale(name);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (ftruncate(fd, (off_t)map_size) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+    void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        shm_unlink(name);
+        return false;
+    }
+
+    // ftruncate zero-fills, so every slot starts at sequence 0 (never valid)
+    shm_ring_header_t *header = map;
+    header->version = SHM_RING_VERSION;
+    header->slots = rounded;
+    header->slot_size = slot_size;
+    header->slot_stride = stride;
+    header->writer_pid = (uint32_t)getpid();
+    // Readers check the magic last, so they never see a half-built header
+    __atomic_store_n(&header->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+
+    ring->header = header;
+    ring->map_size = map_size;
+    ring->fd = fd;
+    strcpy(ring->name, name);
+    return true;
+}
+
+void shm_ring_destroy(shm_ring_t *ring)
+{
+    if (!ring->header) {
+        return;
+    }
+    close_ring(ring->header);
+    munmap(ring->header, ring->map_size);
+    close(ring->fd);
+    shm_unlink(ring->name);
+    ring->header = NULL;
+    ring->fd = -1;
+}
+
+uint8_t *shm_ring_begin(shm_ring_t *ring)
+{
+    shm_ring_header_t *header = ring->header;
+    uint64_t n = __atomic_load_n(&header->head, __ATOMIC_RELAXED);
+    slot_header_t *slot = slot_at(header, n);
+
+    // Mark the slot before touching its payload: a reader that copied the
+    // old frame sees the change on its second look
+    __atomic_store_n(&slot->seq, 2 * n + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return slot_payload(slot);
+}
+
+void shm_ring_commit(shm_ring_t *ring, size_t len)
+{
+    shm_ring_header_t *header = ring->header;
+    if (len == 0 || len > header->slot_size) {
+        return;
+    }
+    uint64_t n = __atomic_load_n(&header->head, __ATOMIC_RELAXED);
+    slot_header_t *slot = slot_at(header, n);
+
+    __atomic_store_n(&slot->len, (uint32_t)len, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, 2 * n + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&header->head, n + 1, __ATOMIC_RELEASE);
+
+    // Pairs with the waiter count in shm_ring_wait(): either the reader sees
+    // the new head before sleeping or the writer sees the reader and wakes it
+    __atomic_fetch_add(&header->futex, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&header->waiters, __ATOMIC_SEQ_CST) > 0) {
+        futex_wake_all(&header->futex);
+    }
+}
+
+bool shm_ring_publish(shm_ring_t *ring, const void *data, size_t len)
+{
+    if (len > ring->header->slot_size) {
+        return false;
+    }
+    memcpy(shm_ring_begin(ring), data, len);
+    shm_ring_commit(ring, len);
+    return true;
+}
+
+bool shm_ring_reader_open(shm_ring_reader_t *reader, const char *name)
+{
+    memset(reader, 0, sizeof(*reader));
+    reader->fd = -1;
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        return false;
+    }
+    off_t size = lseek(fd, 0, SEEK_END);
+    if (size < (off_t)sizeof(shm_ring_header_t)) {
+        close(fd);
+        return false;
+    }
+    // Read-write: sleeping readers count themselves in the header
+    void *map = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    shm_ring_header_t *header = map;
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHM_RING_MAGIC ||
+        header->version != SHM_RING_VERSION ||
+        sizeof(*header) + (size_t)header->slots * header->slot_stride > (size_t)size) {
+        munmap(map, (size_t)size);
+        close(fd);
+        return false;
+    }
+
+    reader->header = header;
+    reader->map_size = (size_t)size;
+    reader->fd = fd;
+    reader->next = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+    return true;
+}
+
+void shm_ring_reader_close(shm_ring_reader_t *reader)
+{
+    if (!reader->header) {
+        return;
+    }
+    munmap(reader->header, reader->map_size);
+    close(reader->fd);
+    reader->header = NULL;
+    reader->fd = -1;
+}
+
+const uint8_t *shm_ring_peek(shm_ring_reader_t *reader, size_t *len, uint64_t *seq)
+{
+    shm_ring_header_t *header = reader->header;
+
+    while (1) {
+        uint64_t head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+        if (reader->next >= head) {
+            return NULL;
+        }
+        // The slot of frame head - slots may already be taken by the writer
+        // for frame head, so the oldest safe frame is one later
+        uint64_t oldest = head >= header->slots ? head - header->slots + 1 : 0;
+        if (reader->next < oldest) {
+            reader->lost += oldest - reader->next;
+            reader->next = oldest;
+        }
+
+        slot_header_t *slot = slot_at(header, reader->next);
+        uint64_t expected = 2 * reader->next + 2;
+        uint64_t seen = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seen != expected) {
+            // Lapped between the head load and here: catch up and retry
+            reader->lost++;
+            reader->next++;
+            continue;
+        }
+        reader->peeked = seen;
+        if (len) {
+            uint32_t bytes = __atomic_load_n(&slot->len, __ATOMIC_RELAXED);
+            *len = bytes <= header->slot_size ? bytes : header->slot_size;
+        }
+        if (seq) {
+            *seq = reader->next;
+        }
+        return slot_payload(slot);
+    }
+}
+
+bool shm_ring_consume(shm_ring_reader_t *reader)
+{
+    slot_header_t *slot = slot_at(reader->header, reader->next);
+
+    // Order the caller's payload reads before the second look at the word
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint64_t seen = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    reader->next++;
+    if (seen != reader->peeked) {
+        reader->lost++;
+        return false;
+    }
+    return true;
+}
+
+bool shm_ring_wait(shm_ring_reader_t *reader, int timeout_ms)
+{
+    shm_ring_header_t *header = reader->header;
+    int64_t deadline = timeout_ms >= 0 ? monotonic_ms() + timeout_ms : 0;
+
+    while (1) {
+        uint32_t word = __atomic_load_n(&header->futex, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&header->head, __ATOMIC_ACQUIRE) > reader->next) {
+            return true;
+        }
+        if (__atomic_load_n(&header->closed, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+
+        struct timespec ts;
+        const struct timespec *timeout = NULL;
+        if (timeout_ms >= 0) {
+            int64_t left = deadline - monotonic_ms();
+            if (left <= 0) {
+                return false;
+            }
+            ts.tv_sec = left / 1000;
+            ts.tv_nsec = (left % 1000) * 1000000;
+            timeout = &ts;
+        }
+
+        __atomic_fetch_add(&header->waiters, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&header->head, __ATOMIC_SEQ_CST) <= reader->next) {
+            // Returns at once if a publish bumped the word since it was read
+            futex_wait(&header->futex, word, timeout);
+        }
+        __atomic_fetch_sub(&header->waiters, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+int shm_ring_read(shm_ring_reader_t *reader, void *buffer, size_t size, int timeout_ms)
+{
+    while (1) {
+        size_t len;
+        const uint8_t *frame = shm_ring_peek(reader, &len, NULL);
+        if (!frame) {
+            if (shm_ring_wait(reader, timeout_ms)) {
+                continue;
+            }
+            return __atomic_load_n(&reader->header->closed, __ATOMIC_ACQUIRE) ? -1 : 0;
+        }
+        if (len > size) {
+            // Too big for the caller: skip it rather than stall the reader
+            reader->next++;
+            reader->lost++;
+            continue;
+        }
+        memcpy(buffer, frame, len);
+        if (shm_ring_consume(reader)) {
+            return (int)len;
+        }
+    }
+}
@@ -0,0 +1,158 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Shared-memory frame ring for co-located consumers (Linux only).
+ *
+ * One writer publishes encoded frames, byte for byte what /out sends, into
+ * a POSIX shared-memory segment; any number of reader processes map it and
+ * take frames in place, with no socket and no copy.
+ *
+ * Frame n (counting from 0) lives in slot n % slots. Each slot carries a
+ * sequence word: 2n+1 while the writer fills it, 2n+2 once frame n is
+ * complete. A reader checks the word before and after it looks at the
+ * payload (a seqlock), so it never waits on the writer and the writer
+ * never waits on a reader. A reader that falls more than a ring behind
+ * loses the oldest frames, counts them and carries on from the oldest one
+ * still intact.
+ *
+ * Idle readers sleep on a futex word that the writer bumps on every
+ * publish; the wake syscall is skipped while no reader is asleep, so a
+ * publish costs one copy and a few atomics.
+ *
+ * The segment layout is fixed-width and host-endian, so readers must run
+ * on the same machine as the writer (which is the point).
+ */
+
+#define SHM_RING_MAGIC 0x4D485347   // "GSHM"
+#define SHM_RING_VERSION 1
+#define SHM_RING_SLOT_HEADER_SIZE 16
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;             // Power of two
+    uint32_t slot_size;         // Payload bytes per slot
+    uint32_t slot_stride;       // Slot header plus payload, cache-line aligned
+    uint32_t writer_pid;
+    uint32_t closed;            // Atomic: set once the writer has gone
+    uint8_t reserved[36];
+    // Writer-updated words on their own cache line
+    uint64_t head;              // Atomic: frames published so far
+    uint32_t futex;             // Atomic: bumped on every publish
+    uint32_t waiters;           // Atomic: readers asleep on futex
+    uint8_t reserved2[48];
+} shm_ring_header_t;
+
+typedef struct {
+    shm_ring_header_t *header;
+    size_t map_size;
+    int fd;
+    char name[64];
+} shm_ring_t;
+
+typedef struct {
+    shm_ring_header_t *header;
+    size_t map_size;
+    int fd;
+    uint64_t next;              // Sequence of the next frame to read
+    uint64_t lost;              // Frames overwritten before this reader got to them
+    uint64_t peeked;            // Slot sequence word seen by the last peek
+} shm_ring_reader_t;
+
+/**
+ * @brief Create (or replace) the named segment and map it for writing
+ *
+ * A segment left behind under the same name is unlinked first; readers
+ * still mapping it see it closed.
+ *
+ * @param name POSIX shm name, e.g. "/griddy"
+ * @param slots Rounded up to a power of two
+ * @param slot_size Largest frame the writer will publish
+ */
+bool shm_ring_create(shm_ring_t *ring, const char *name, uint32_t slots, uint32_t slot_size);
+
+/**
+ * @brief Mark the ring closed, wake every reader, unmap and unlink it
+ */
+void shm_ring_destroy(shm_ring_t *ring);
+
+/**
+ * @brief Payload of the next slot, for encoding a frame in place
+ *
+ * The slot is marked in progress: readers skip it until the commit. A
+ * begin without a commit is harmless; the next begin reuses the slot.
+ *
+ * @return slot_size bytes
+ */
+uint8_t *shm_ring_begin(shm_ring_t *ring);
+
+/**
+ * @brief Publish the frame written since shm_ring_begin() and wake readers
+ *
+ * @param len Frame bytes, at most slot_size; 0 abandons the slot
+ */
+void shm_ring_commit(shm_ring_t *ring, size_t len);
+
+/**
+ * @brief Copy a frame into the next slot and publish it
+ *
+ * @return false if len is above slot_size
+ */
+bool shm_ring_publish(shm_ring_t *ring, const void *data, size_t len);
+
+/**
+ * @brief Map an existing segment, positioned at the next frame
+ */
+bool shm_ring_reader_open(shm_ring_reader_t *reader, const char *name);
+
+void shm_ring_reader_close(shm_ring_reader_t *reader);
+
+/**
+ * @brief The next frame, in place in the segment
+ *
+ * The writer may overwrite the slot at any time; check the frame with
+ * shm_ring_consume() before acting on anything read from it.
+ *
+ * @param seq Frame sequence number, may be NULL
+ * @return NULL if no frame is ready
+ */
+const uint8_t *shm_ring_peek(shm_ring_reader_t *reader, size_t *len, uint64_t *seq);
+
+/**
+ * @brief Step past the peeked frame
+ *
+ * @return false if the writer overwrote it meanwhile (counted as lost)
+ */
+bool shm_ring_consume(shm_ring_reader_t *reader);
+
+/**
+ * @brief Sleep until a frame is ready, the ring closes or the timeout runs out
+ *
+ * @param timeout_ms -1 waits indefinitely
+ * @return true if a frame is ready
+ */
+bool shm_ring_wait(shm_ring_reader_t *reader, int timeout_ms);
+
+/**
+ * @brief Copy the next frame out, waiting for it if needed
+ *
+ * A frame larger than size is skipped and counted as lost.
+ *
+ * @return Frame length, 0 on timeout, -1 once the ring is closed and drained
+ */
+int shm_ring_read(shm_ring_reader_t *reader, void *buffer, size_t size, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SHM_RING_H
@@ -0,0 +1,125 @@
+#include "telemetry_history.h"
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+#ifndef CONFIG_POWER_GRID_HISTORY_BYTES
+#define CONFIG_POWER_GRID_HISTORY_BYTES 16384
+#endif
+
+#define HISTORY_LEN_BYTES 2
+
+static uint8_t *ring = NULL;
+static size_t ring_head = 0;    // Next byte to write
+static size_t ring_tail = 0;    // Oldest record
+static telemetry_history_stats_t stats;
+static SemaphoreHandle_t history_lock = NULL;
+
+static void ring_put(size_t pos, const uint8_t *data, size_t len)
+{
+    size_t first = CONFIG_POWER_GRID_HISTORY_BYTES - pos;
+    if (first > len) first = len;
+    memcpy(ring + pos, data, first);
+    memcpy(ring, data + first, len - first);
+}
+
+static void ring_get(size_t pos, uint8_t *data, size_t len)
+{
+    size_t first = CONFIG_POWER_GRID_HISTORY_BYTES - pos;
+    if (first > len) first = len;
+    memcpy(data, ring + pos, first);
+    memcpy(data + first, ring, len - first);
+}
+
+static size_t ring_advance(size_t pos, size_t len)
+{
+    return (pos + len) % CONFIG_POWER_GRID_HISTORY_BYTES;
+}
+
+esp_err_t telemetry_history_init(void)
+{
+    if (ring) {
+        return ESP_OK;
+    }
+
+    history_lock = xSemaphoreCreateMutex();
+    ring = malloc(CONFIG_POWER_GRID_HISTORY_BYTES);
+    if (!history_lock || !ring) {
+        free(ring);
+        ring = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void telemetry_history_append(const uint8_t *frame, size_t len)
+{
+    size_t need = len + HISTORY_LEN_BYTES;
+
+    if (!ring || len > UINT16_MAX || need > CONFIG_POWER_GRID_HISTORY_BYTES) {
+        return;
+    }
+
+    xSemaphoreTake(history_lock, portMAX_DELAY);
+
+    while (CONFIG_POWER_GRID_HISTORY_BYTES - stats.bytes < need) {
+        uint8_t prefix[HISTORY_LEN_BYTES];
+        ring_get(ring_tail, prefix, sizeof(prefix));
+        size_t old = HISTORY_LEN_BYTES + (prefix[0] | (prefix[1] << 8));
+        ring_tail = ring_advance(ring_tail, old);
+        stats.bytes -= old;
+        stats.frames--;
+        stats.overwritten++;
+    }
+
+    uint8_t prefix[HISTORY_LEN_BYTES] = { len & 0xFF, len >> 8 };
+    ring_put(ring_head, prefix, sizeof(prefix));
+    ring_put(ring_advance(ring_head, HISTORY_LEN_BYTES), frame, len);
+    ring_head = ring_advance(ring_head, need);
+    stats.bytes += need;
+    stats.frames++;
+    stats.recorded++;
+
+    xSemaphoreGive(history_lock);
+}
+
+size_t telemetry_history_copy(uint8_t *out, size_t size)
+{
+    size_t written = 0;
+
+    if (!ring) {
+        return 0;
+    }
+
+    xSemaphoreTake(history_lock, portMAX_DELAY);
+
+    size_t pos = ring_tail;
+    for (uint32_t i = 0; i < stats.frames; i++) {
+        uint8_t prefix[HISTORY_LEN_BYTES];
+        ring_get(pos, prefix, sizeof(prefix));
+        size_t record = HISTORY_LEN_BYTES + (prefix[0] | (prefix[1] << 8));
+        if (written + record > size) {
+            break;
+        }
+        ring_get(pos, out + written, record);
+        written += record;
+        pos = ring_advance(pos, record);
+    }
+
+    xSemaphoreGive(history_lock);
+    return written;
+}
+
+void telemetry_history_get_stats(telemetry_history_stats_t *out)
+{
+    if (!ring) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+
+    xSemaphoreTake(history_lock, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(history_lock);
+}
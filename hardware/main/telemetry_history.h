@@ -0,0 +1,60 @@
+#ifndef TELEMETRY_HISTORY_H
+#define TELEMETRY_HISTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Telemetry history ring.
+ *
+ * Holds encoded telemetry frames that could not be delivered, e.g. while the
+ * link is down, so the backend can backfill the gap after it reconnects. The
+ * ring is CONFIG_POWER_GRID_HISTORY_BYTES long and stores each frame behind a
+ * little-endian uint16 length; when full, the oldest frames are dropped.
+ * telemetry_history_copy() returns the same [len][frame]... layout that
+ * GET /history serves.
+ */
+
+typedef struct {
+    uint32_t recorded;      // Frames appended
+    uint32_t overwritten;   // Oldest frames dropped to make room
+    uint32_t frames;        // Frames currently held
+    uint32_t bytes;         // Bytes currently held, including length prefixes
+} telemetry_history_stats_t;
+
+/**
+ * @brief Allocate the ring
+ *
+ * @return ESP_OK on success, ESP_ERR_NO_MEM if the ring cannot be allocated
+ */
+esp_err_t telemetry_history_init(void);
+
+/**
+ * @brief Append one encoded frame, dropping the oldest frames if needed
+ */
+void telemetry_history_append(const uint8_t *frame, size_t len);
+
+/**
+ * @brief Copy all held frames, oldest first, as [uint16 len][frame] records
+ *
+ * @param out Output buffer
+ * @param size Buffer size; records that do not fit are left out
+ * @return Bytes written
+ */
+size_t telemetry_history_copy(uint8_t *out, size_t size);
+
+/**
+ * @brief Snapshot ring counters
+ */
+void telemetry_history_get_stats(telemetry_history_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEMETRY_HISTORY_H
@@ -0,0 +1,199 @@
+#include "telemetry_json.h"
+#include <string.h>
+
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const struct {
+    const char *text;
+    uint8_t len;
+} field_keys[TELEMETRY_FIELD_COUNT] = {
+    {"\"min\":", 6}, {"\"max\":", 6}, {"\"mean\":", 7}, {"\"rms\":", 6}
+};
+
+static char *put_str(char *p, const char *s, size_t n)
+{
+    memcpy(p, s, n);
+    return p + n;
+}
+
+#define PUT_LITERAL(p, s) put_str((p), (s), sizeof(s) - 1)
+
+// Decimal digits of v, two at a time from the right
+static char *put_u32(char *p, uint32_t v)
+{
+    char tmp[10];
+    char *t = tmp + sizeof(tmp);
+
+    while (v >= 100) {
+        uint32_t pair = (v % 100) * 2;
+        v /= 100;
+        *--t = digit_pairs[pair + 1];
+        *--t = digit_pairs[pair];
+    }
+    if (v >= 10) {
+        *--t = digit_pairs[v * 2 + 1];
+        *--t = digit_pairs[v * 2];
+    } else {
+        *--t = (char)('0' + v);
+    }
+    return put_str(p, t, (size_t)(tmp + sizeof(tmp) - t));
+}
+
+// 64-bit timestamps: the low 8 digits, zero padded, after the rest
+static char *put_u64(char *p, uint64_t v)
+{
+    if (v <= UINT32_MAX) {
+        return put_u32(p, (uint32_t)v);
+    }
+    p = put_u64(p, v / 100000000u);
+    uint32_t low = (uint32_t)(v % 100000000u);
+    for (int i = 3; i >= 0; i--) {
+        uint32_t pair = (low % 100) * 2;
+        low /= 100;
+        p[i * 2] = digit_pairs[pair];
+        p[i * 2 + 1] = digit_pairs[pair + 1];
+    }
+    return p + 8;
+}
+
+// Fixed point with 4 decimals, trailing zeros trimmed: 2.407, 0.8463, 0
+static char *put_fixed4(char *p, float v)
+{
+    if (!(v == v)) {
+        v = 0.0f;
+    }
+    if (v < 0.0f) {
+        v = -v;
+        if (v >= 0.00005f) {
+            *p++ = '-';
+        }
+    }
+    if (v > TELEMETRY_JSON_VALUE_MAX) {
+        v = TELEMETRY_JSON_VALUE_MAX;
+    }
+
+    // Integer part first: v - whole is exact, so the decimals keep their
+    // precision however large v is
+    uint32_t whole = (uint32_t)v;
+    uint32_t frac = (uint32_t)((v - (float)whole) * 10000.0f + 0.5f);
+    if (frac >= 10000) {
+        whole++;
+        frac -= 10000;
+    }
+    p = put_u32(p, whole);
+    if (frac == 0) {
+        return p;
+    }
+
+    char d[4];
+    d[0] = digit_pairs[(frac / 100) * 2];
+    d[1] = digit_pairs[(frac / 100) * 2 + 1];
+    d[2] = digit_pairs[(frac % 100) * 2];
+    d[3] = digit_pairs[(frac % 100) * 2 + 1];
+    size_t n = 4;
+    while (d[n - 1] == '0') {
+        n--;
+    }
+    *p++ = '.';
+    return put_str(p, d, n);
+}
+
+void telemetry_json_begin(telemetry_json_t *json, char *buf, size_t size, uint64_t timestamp_us)
+{
+    json->buf = buf;
+    json->size = size;
+    json->len = 0;
+    json->nodes = 0;
+    json->overflow = size < TELEMETRY_JSON_HEADER_MAX;
+    if (json->overflow) {
+        return;
+    }
+
+    char *p = PUT_LITERAL(buf, "{\"timestamp\":");
+    p = put_u64(p, timestamp_us / 1000);
+    p = PUT_LITERAL(p, ",\"timestamp_us\":");
+    p = put_u64(p, timestamp_us);
+    p = PUT_LITERAL(p, ",\"nodes\":[");
+    json->len = (size_t)(p - buf);
+}
+
+void telemetry_json_node(telemetry_json_t *json, uint16_t id, uint8_t type, float demand, float fulfillment,
+                         uint8_t fields, const float *field)
+{
+    // Header space for "]}" and the NUL is reserved by TELEMETRY_JSON_HEADER_MAX
+    if (json->overflow || json->size - json->len < TELEMETRY_JSON_NODE_MAX + 3) {
+        json->overflow = true;
+        return;
+    }
+
+    char *p = json->buf + json->len;
+    if (json->nodes++ > 0) {
+        *p++ = ',';
+    }
+    p = PUT_LITERAL(p, "{\"id\":");
+    p = put_u32(p, id);
+    if (type == NODE_TYPE_CONSUMER) {
+        p = PUT_LITERAL(p, ",\"type\":\"consumer\",\"demand\":");
+    } else {
+        p = PUT_LITERAL(p, ",\"type\":\"power\",\"demand\":");
+    }
+    p = put_fixed4(p, demand);
+    p = PUT_LITERAL(p, ",\"ff\":");
+    p = put_fixed4(p, fulfillment);
+
+    if (fields & TELEMETRY_FIELDS_ALL) {
+        p = PUT_LITERAL(p, ",\"sensed\":{");
+        bool first = true;
+        for (int k = 0; k < TELEMETRY_FIELD_COUNT; k++) {
+            if (!(fields & (1u << k))) {
+                continue;
+            }
+            if (!first) {
+                *p++ = ',';
+            }
+            first = false;
+            p = put_str(p, field_keys[k].text, field_keys[k].len);
+            p = put_fixed4(p, field[k]);
+        }
+        *p++ = '}';
+    }
+    *p++ = '}';
+    json->len = (size_t)(p - json->buf);
+}
+
+size_t telemetry_json_end(telemetry_json_t *json)
+{
+    if (json->overflow || json->size - json->len < 3) {
+        return 0;
+    }
+    char *p = json->buf + json->len;
+    *p++ = ']';
+    *p++ = '}';
+    *p = '\0';
+    json->len += 2;
+    return json->len;
+}
+
+size_t telemetry_json_encode(const telemetry_packet_t *packet, char *buf, size_t size)
+{
+    telemetry_json_t json;
+
+    telemetry_json_begin(&json, buf, size, packet->timestamp_us);
+    for (int i = 0; i < packet->node_count; i++) {
+        const telemetry_node_t *node = &packet->nodes[i];
+        float field[TELEMETRY_FIELD_COUNT];
+        memcpy(field, node->field, sizeof(field));  // Packed struct: no pointer into it
+        telemetry_json_node(&json, node->id, node->type, node->demand, node->fulfillment, node->fields, field);
+    }
+    return telemetry_json_end(&json);
+}
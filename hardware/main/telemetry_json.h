@@ -0,0 +1,75 @@
+#ifndef TELEMETRY_JSON_H
+#define TELEMETRY_JSON_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "binary_protocol.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Streaming JSON writer for telemetry, in the original dashboard format:
+ *
+ *   {"timestamp":21199,"timestamp_us":21199467,"nodes":[{"id":3,"type":"consumer","demand":0.8682,...},...]}
+ *
+ * "timestamp" stays in milliseconds for dashboards; "timestamp_us" is the
+ * binary frames' microsecond clock.
+ * Nodes with sensed fields add "sensed":{"min":..,"max":..,"mean":..,"rms":..}
+ * as binary_protocol.py does. The writer fills a caller-owned buffer and
+ * never allocates. Each node checks the worst-case space once and is then
+ * written without bounds checks. Numbers are formatted from a scaled
+ * integer with 4 decimals, trailing zeros trimmed and no printf. Values are
+ * clamped to +/-TELEMETRY_JSON_VALUE_MAX and NaN is written as 0.
+ */
+
+#define TELEMETRY_JSON_VALUE_MAX 399999.9999f
+#define TELEMETRY_JSON_HEADER_MAX 80    // {"timestamp":<17 digits>,"timestamp_us":<20 digits>,"nodes":[ ... ]}
+#define TELEMETRY_JSON_NODE_MAX 160     // Every field at full width, sensed fields, comma
+
+// Buffer size that always fits node_count nodes
+#define telemetry_json_max_size(node_count) (TELEMETRY_JSON_HEADER_MAX + (size_t)(node_count) * TELEMETRY_JSON_NODE_MAX)
+
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    int nodes;
+    bool overflow;          // A node did not fit; end() returns 0
+} telemetry_json_t;
+
+/**
+ * @brief Start a frame in buf
+ */
+void telemetry_json_begin(telemetry_json_t *json, char *buf, size_t size, uint64_t timestamp_us);
+
+/**
+ * @brief Append one node
+ *
+ * @param fields TELEMETRY_FIELD_* bits present in field[]
+ * @param field Sensed min, max, mean, rms (amps); may be NULL when fields is 0
+ */
+void telemetry_json_node(telemetry_json_t *json, uint16_t id, uint8_t type, float demand, float fulfillment,
+                         uint8_t fields, const float *field);
+
+/**
+ * @brief Close the frame
+ *
+ * @return Frame length without the terminating NUL, or 0 if it did not fit
+ */
+size_t telemetry_json_end(telemetry_json_t *json);
+
+/**
+ * @brief Write a whole decoded packet; deltas are written as the nodes they carry
+ *
+ * @return Frame length, or 0 if it did not fit
+ */
+size_t telemetry_json_encode(const telemetry_packet_t *packet, char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TELEMETRY_JSON_H
@@ -0,0 +1,139 @@
+#include "trace_capture.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+// Only the console starts captures
+#ifndef CONFIG_POWER_GRID_TRACE_EVENTS
+#define CONFIG_POWER_GRID_TRACE_EVENTS 1
+#endif
+
+#define TRACE_EVENT_NAME_ENTRY(id, name) name,
+static const char *const event_names[TRACE_EVENT_COUNT] = {
+    TRACE_EVENTS(TRACE_EVENT_NAME_ENTRY)
+};
+#undef TRACE_EVENT_NAME_ENTRY
+
+typedef struct {
+    uint32_t offset_us;
+    uint16_t event;
+    uint16_t reserved;
+    uint32_t arg;
+    char task[8];           // Truncated, not terminated when 8 long
+} trace_record_t;
+
+uint32_t trace_capture_armed = 0;
+
+static trace_record_t records[CONFIG_POWER_GRID_TRACE_EVENTS];
+static uint32_t recorded = 0;
+static uint32_t limit = 0;
+static uint32_t duration_ms = 0;
+static int64_t start_us = 0;
+static int64_t stop_us = 0;
+static portMUX_TYPE trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Caller holds trace_lock
+static void disarm(int64_t now)
+{
+    if (trace_capture_armed) {
+        __atomic_store_n(&trace_capture_armed, 0, __ATOMIC_RELAXED);
+        stop_us = now;
+    }
+}
+
+// Caller holds trace_lock
+static void expire(int64_t now)
+{
+    if (trace_capture_armed && duration_ms && now - start_us >= (int64_t)duration_ms * 1000) {
+        disarm(start_us + (int64_t)duration_ms * 1000);
+    }
+}
+
+void trace_capture_record(trace_event_t event, uint32_t arg)
+{
+    const char *task = pcTaskGetName(NULL);
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&trace_lock);
+    expire(now);
+    if (trace_capture_armed && recorded < limit) {
+        trace_record_t *r = &records[recorded++];
+        r->offset_us = (uint32_t)(now - start_us);
+        r->event = (uint16_t)event;
+        r->arg = arg;
+        strncpy(r->task, task ? task : "?", sizeof(r->task));
+        if (recorded == limit) {
+            disarm(now);
+        }
+    }
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+void trace_capture_start(uint32_t max_events, uint32_t duration)
+{
+    if (max_events == 0 || max_events > CONFIG_POWER_GRID_TRACE_EVENTS) {
+        max_events = CONFIG_POWER_GRID_TRACE_EVENTS;
+    }
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&trace_lock);
+    recorded = 0;
+    limit = max_events;
+    duration_ms = duration;
+    start_us = now;
+    stop_us = now;
+    __atomic_store_n(&trace_capture_armed, 1, __ATOMIC_RELAXED);
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+void trace_capture_stop(void)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&trace_lock);
+    expire(now);
+    disarm(now);
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+uint32_t trace_capture_capacity(void)
+{
+    return CONFIG_POWER_GRID_TRACE_EVENTS;
+}
+
+void trace_capture_get_info(trace_capture_info_t *info)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&trace_lock);
+    expire(now);
+    info->armed = trace_capture_armed != 0;
+    info->events = recorded;
+    info->limit = limit;
+    info->duration_ms = duration_ms;
+    info->elapsed_ms = (uint32_t)(((info->armed ? now : stop_us) - start_us) / 1000);
+    portEXIT_CRITICAL(&trace_lock);
+}
+
+uint32_t trace_capture_dump(FILE *out)
+{
+    trace_capture_info_t info;
+    trace_capture_get_info(&info);
+
+    // Records below the count are complete; copy each out so printing
+    // happens outside the lock
+    uint32_t printed = 0;
+    uint32_t previous_us = 0;
+    for (uint32_t i = 0; i < info.events; i++) {
+        trace_record_t r;
+        portENTER_CRITICAL(&trace_lock);
+        r = records[i];
+        portEXIT_CRITICAL(&trace_lock);
+
+        const char *name = r.event < TRACE_EVENT_COUNT ? event_names[r.event] : "?";
+        fprintf(out, "%10u us %+9d  %-8.8s %-18s %u\n", (unsigned)r.offset_us,
+                i ? (int)(r.offset_us - previous_us) : 0, r.task, name, (unsigned)r.arg);
+        previous_us = r.offset_us;
+        printed++;
+    }
+    return printed;
+}
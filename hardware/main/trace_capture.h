@@ -0,0 +1,91 @@
+#ifndef TRACE_CAPTURE_H
+#define TRACE_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * On-demand event trace of the telemetry and dispatch paths.
+ *
+ * Idle, a trace point costs one load of the armed flag. A capture is armed
+ * for at most a number of events and a duration; while armed, every trace
+ * point appends {µs since start, event, argument, task} to a static buffer
+ * and the capture stops itself at whichever limit comes first. The buffer
+ * is kept until the next capture starts, so it can be dumped afterwards.
+ */
+
+// X(id, name)
+#define TRACE_EVENTS(X) \
+    X(TRACE_CYCLE_START,       "cycle_start")       /* arg: telemetry period, ms */ \
+    X(TRACE_FRAME_ENCODED,     "frame_encoded")     /* arg: frame bytes */ \
+    X(TRACE_FRAME_SENT,        "frame_sent")        /* arg: /out slot */ \
+    X(TRACE_FRAME_SKIPPED,     "frame_skipped")     /* arg: /out slot, decimated or out of credit */ \
+    X(TRACE_SEND_FAILED,       "send_failed")       /* arg: /out slot */ \
+    X(TRACE_CREDIT_GRANT,      "credit_grant")      /* arg: /out slot */ \
+    X(TRACE_DISPATCH_RECEIVED, "dispatch_received") /* arg: frame bytes */ \
+    X(TRACE_DISPATCH_APPLIED,  "dispatch_applied")  /* arg: nodes applied */ \
+    X(TRACE_RATE_CHANGED,      "rate_changed")      /* arg: new telemetry period, ms */
+
+#define TRACE_EVENT_ENUM_ENTRY(id, name) id,
+typedef enum {
+    TRACE_EVENTS(TRACE_EVENT_ENUM_ENTRY)
+    TRACE_EVENT_COUNT
+} trace_event_t;
+#undef TRACE_EVENT_ENUM_ENTRY
+
+typedef struct {
+    bool armed;
+    uint32_t events;        // Recorded so far
+    uint32_t limit;         // Events this capture stops at
+    uint32_t duration_ms;   // Time this capture stops at
+    uint32_t elapsed_ms;    // Since the capture started, frozen once it stops
+} trace_capture_info_t;
+
+extern uint32_t trace_capture_armed;    // Atomic; read by trace_event() only
+
+void trace_capture_record(trace_event_t event, uint32_t arg);
+
+/**
+ * @brief Trace point (any task, not ISR)
+ */
+static inline void trace_event(trace_event_t event, uint32_t arg)
+{
+    if (__atomic_load_n(&trace_capture_armed, __ATOMIC_RELAXED)) {
+        trace_capture_record(event, arg);
+    }
+}
+
+/**
+ * @brief Discard the previous capture and arm a new one
+ *
+ * @param max_events Clamped to the buffer size (CONFIG_POWER_GRID_TRACE_EVENTS)
+ * @param duration_ms 0 runs until the buffer fills or trace_capture_stop()
+ */
+void trace_capture_start(uint32_t max_events, uint32_t duration_ms);
+
+void trace_capture_stop(void);
+
+/**
+ * @brief Buffer size in events
+ */
+uint32_t trace_capture_capacity(void);
+
+void trace_capture_get_info(trace_capture_info_t *info);
+
+/**
+ * @brief Print the captured events, one per line, oldest first
+ *
+ * @return Events printed
+ */
+uint32_t trace_capture_dump(FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_CAPTURE_H
@@ -0,0 +1,236 @@
+#include "warm_state.h"
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_rom_crc.h"
+#include "sdkconfig.h"
+
+#ifndef CONFIG_POWER_GRID_WARM_RESTART
+#define CONFIG_POWER_GRID_WARM_RESTART 0
+#endif
+#ifndef CONFIG_POWER_GRID_WARM_STATE_MAX_AGE_MS
+#define CONFIG_POWER_GRID_WARM_STATE_MAX_AGE_MS 30000
+#endif
+
+#define WARM_STATE_MAGIC 0x4D524157  // "WARM"
+#define WARM_STATE_VERSION 2
+
+typedef struct {
+    int64_t wall_us;
+    uint32_t seq;
+    float supply[WARM_STATE_MAX_NODES];
+} warm_dispatch_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    int64_t sealed_wall_us;     // RTC wall time of the last seal
+    uint32_t dispatch_seq;
+    uint32_t send_interval_ms;  // 0 = not set
+    uint32_t model_seed;        // 0 = not set
+    uint32_t warm_restarts;
+    float supply[WARM_STATE_MAX_NODES];
+    uint32_t trajectory_head;   // Next slot to write
+    uint32_t trajectory_count;
+    warm_dispatch_t trajectory[WARM_STATE_TRAJECTORY_LEN];
+    uint32_t crc;               // CRC32 of everything above
+} warm_block_t;
+
+static RTC_NOINIT_ATTR warm_block_t block;
+static warm_state_info_t info;
+static portMUX_TYPE warm_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Survives software, watchdog and panic resets; starts over at power-on
+static int64_t wall_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static uint32_t block_crc(void)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)&block, offsetof(warm_block_t, crc));
+}
+
+// Caller holds warm_lock
+static void seal(int64_t now)
+{
+    block.sealed_wall_us = now;
+    block.crc = block_crc();
+}
+
+bool warm_state_restore(void)
+{
+    int64_t now = wall_us();
+    const char *why = NULL;
+
+    if (!CONFIG_POWER_GRID_WARM_RESTART) {
+        why = "disabled";
+    } else if (block.magic != WARM_STATE_MAGIC || block.version != WARM_STATE_VERSION ||
+               block.size != sizeof(block)) {
+        why = "no state";
+    } else if (block.crc != block_crc()) {
+        why = "checksum";
+    } else if (now < block.sealed_wall_us ||
+               now - block.sealed_wall_us > (int64_t)CONFIG_POWER_GRID_WARM_STATE_MAX_AGE_MS * 1000) {
+        why = "stale";
+    }
+
+    portENTER_CRITICAL(&warm_lock);
+    memset(&info, 0, sizeof(info));
+    if (why) {
+        memset(&block, 0, sizeof(block));
+        block.magic = WARM_STATE_MAGIC;
+        block.version = WARM_STATE_VERSION;
+        block.size = sizeof(block);
+        info.discarded = why;
+    } else {
+        block.warm_restarts++;
+        info.restored = true;
+        info.age_ms = (uint32_t)((now - block.sealed_wall_us) / 1000);
+    }
+    info.warm_restarts = block.warm_restarts;
+    seal(now);
+    portEXIT_CRITICAL(&warm_lock);
+
+    return info.restored;
+}
+
+float warm_state_supply(int node_id)
+{
+    if (node_id < 1 || node_id > WARM_STATE_MAX_NODES) {
+        return 0.0f;
+    }
+    return block.supply[node_id - 1];
+}
+
+uint32_t warm_state_dispatch_seq(void)
+{
+    return block.dispatch_seq;
+}
+
+uint32_t warm_state_send_interval_ms(uint32_t fallback_ms)
+{
+    return block.send_interval_ms ? block.send_interval_ms : fallback_ms;
+}
+
+uint32_t warm_state_model_seed(uint32_t fallback)
+{
+    return block.model_seed ? block.model_seed : fallback;
+}
+
+void warm_state_set_supply(int node_id, float supply)
+{
+    if (node_id >= 1 && node_id <= WARM_STATE_MAX_NODES) {
+        block.supply[node_id - 1] = supply;
+    }
+}
+
+void warm_state_set_send_interval_ms(uint32_t interval_ms)
+{
+    int64_t now = wall_us();
+    portENTER_CRITICAL(&warm_lock);
+    block.send_interval_ms = interval_ms;
+    seal(now);
+    portEXIT_CRITICAL(&warm_lock);
+}
+
+void warm_state_set_model_seed(uint32_t seed)
+{
+    int64_t now = wall_us();
+    portENTER_CRITICAL(&warm_lock);
+    block.model_seed = seed;
+    seal(now);
+    portEXIT_CRITICAL(&warm_lock);
+}
+
+void warm_state_commit(uint32_t dispatch_seq)
+{
+    int64_t now = wall_us();
+
+    portENTER_CRITICAL(&warm_lock);
+    warm_dispatch_t *slot = &block.trajectory[block.trajectory_head % WARM_STATE_TRAJECTORY_LEN];
+    slot->wall_us = now;
+    slot->seq = dispatch_seq;
+    memcpy(slot->supply, block.supply, sizeof(slot->supply));
+    block.trajectory_head = (block.trajectory_head + 1) % WARM_STATE_TRAJECTORY_LEN;
+    if (block.trajectory_count < WARM_STATE_TRAJECTORY_LEN) {
+        block.trajectory_count++;
+    }
+    // Both /in servers commit; keep the newest so a restart resumes past it
+    if ((int32_t)(dispatch_seq - block.dispatch_seq) > 0) {
+        block.dispatch_seq = dispatch_seq;
+    }
+    seal(now);
+    portEXIT_CRITICAL(&warm_lock);
+}
+
+void warm_state_get_info(warm_state_info_t *out)
+{
+    portENTER_CRITICAL(&warm_lock);
+    *out = info;
+    portEXIT_CRITICAL(&warm_lock);
+}
+
+static size_t append_supplies(char *buffer, size_t size, size_t len, const float *supply)
+{
+    for (int i = 0; i < WARM_STATE_MAX_NODES && len < size; i++) {
+        len += snprintf(buffer + len, size - len, "%s%.3f", i ? "," : "[", supply[i]);
+    }
+    if (len < size) {
+        len += snprintf(buffer + len, size - len, "]");
+    }
+    return len;
+}
+
+size_t warm_state_to_json(char *buffer, size_t size)
+{
+    warm_block_t snapshot;
+    warm_state_info_t restore;
+    int64_t now = wall_us();
+    size_t len = 0;
+
+    if (size == 0) {
+        return 0;
+    }
+
+    portENTER_CRITICAL(&warm_lock);
+    snapshot = block;
+    restore = info;
+    portEXIT_CRITICAL(&warm_lock);
+
+    len += snprintf(buffer + len, size - len,
+                    "{\"restored\":%s,\"age_ms\":%u,\"warm_restarts\":%u,\"discarded\":%s%s%s,"
+                    "\"dispatch_seq\":%u,\"send_interval_ms\":%u,\"supply\":",
+                    restore.restored ? "true" : "false", (unsigned)restore.age_ms,
+                    (unsigned)restore.warm_restarts,
+                    restore.discarded ? "\"" : "", restore.discarded ? restore.discarded : "null",
+                    restore.discarded ? "\"" : "",
+                    (unsigned)snapshot.dispatch_seq, (unsigned)snapshot.send_interval_ms);
+    len = append_supplies(buffer, size, len, snapshot.supply);
+
+    // Oldest first
+    if (len < size) {
+        len += snprintf(buffer + len, size - len, ",\"trajectory\":[");
+    }
+    uint32_t count = snapshot.trajectory_count;
+    for (uint32_t i = 0; i < count && len < size; i++) {
+        uint32_t index = (snapshot.trajectory_head + WARM_STATE_TRAJECTORY_LEN - count + i) % WARM_STATE_TRAJECTORY_LEN;
+        const warm_dispatch_t *entry = &snapshot.trajectory[index];
+        len += snprintf(buffer + len, size - len, "%s{\"seq\":%u,\"age_ms\":%lld,\"supply\":",
+                        i ? "," : "", (unsigned)entry->seq, (long long)((now - entry->wall_us) / 1000));
+        len = append_supplies(buffer, size, len, entry->supply);
+        if (len < size) {
+            len += snprintf(buffer + len, size - len, "}");
+        }
+    }
+    if (len < size) {
+        len += snprintf(buffer + len, size - len, "]}");
+    }
+
+    return len < size ? len : size - 1;
+}
@@ -0,0 +1,92 @@
+#ifndef WARM_STATE_H
+#define WARM_STATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Warm-restart state.
+ *
+ * Last-applied setpoints, a short trajectory of recent dispatches, the
+ * telemetry period, the dispatch sequence counter and the node model seed
+ * live in RTC no-init memory, which survives software, watchdog and panic
+ * resets. A CRC seals the block after every dispatch; on boot it is
+ * restored only if the CRC matches and it was sealed less than
+ * CONFIG_POWER_GRID_WARM_STATE_MAX_AGE_MS ago (RTC wall time, which keeps
+ * running across such resets but starts over at power-on).
+ *
+ * Setters are cheap RAM writes; warm_state_commit() seals them.
+ */
+
+#define WARM_STATE_MAX_NODES 16         // Actuator outputs 1..WARM_STATE_MAX_NODES
+#define WARM_STATE_TRAJECTORY_LEN 8     // Dispatches kept, newest last
+
+typedef struct {
+    bool restored;          // Valid state was found at boot
+    uint32_t age_ms;        // Age of the restored state
+    uint32_t warm_restarts; // Consecutive boots restored from this state
+    const char *discarded;  // Why state was not restored, or NULL
+} warm_state_info_t;
+
+/**
+ * @brief Validate the RTC block; call first thing in app_main
+ *
+ * Resets the block to defaults (all setpoints 0) if it is invalid or stale.
+ *
+ * @return true if state was restored
+ */
+bool warm_state_restore(void);
+
+/**
+ * @brief Restored or last-set supply of an output (1-based, 0..1); 0 if unknown
+ */
+float warm_state_supply(int node_id);
+
+/**
+ * @brief Restored dispatch sequence counter (0 after a cold boot)
+ */
+uint32_t warm_state_dispatch_seq(void);
+
+/**
+ * @brief Restored telemetry period, or fallback_ms if none was saved
+ */
+uint32_t warm_state_send_interval_ms(uint32_t fallback_ms);
+
+/**
+ * @brief Restored node model seed, or fallback if none was saved
+ */
+uint32_t warm_state_model_seed(uint32_t fallback);
+
+void warm_state_set_supply(int node_id, float supply);
+void warm_state_set_send_interval_ms(uint32_t interval_ms);
+void warm_state_set_model_seed(uint32_t seed);
+
+/**
+ * @brief Append the current setpoints to the trajectory and seal the block
+ *
+ * @param dispatch_seq Sequence number of the dispatch just applied
+ */
+void warm_state_commit(uint32_t dispatch_seq);
+
+/**
+ * @brief Boot-time restore outcome
+ */
+void warm_state_get_info(warm_state_info_t *info);
+
+/**
+ * @brief Write restore info, current setpoints and the trajectory as JSON
+ *
+ * @return Length of the JSON text (truncated to size - 1)
+ */
+size_t warm_state_to_json(char *buffer, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WARM_STATE_H
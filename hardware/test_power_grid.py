@@ -62,7 +62,7 @@ async def test_out_endpoint_only(esp_ip):
                         if isinstance(data, bytes):
                             packet = BinaryProtocol.decode_telemetry(data)
                             if packet:
-                                log(f"[{elapsed:4.1f}s] Received #{receive_count}: {len(data)} bytes, ts={packet.timestamp}")
+                                log(f"[{elapsed:4.1f}s] Received #{receive_count}: {len(data)} bytes, ts={packet.timestamp_us}us")
                                 for node in packet.nodes:
                                     node_type = "consumer" if node.type == 1 else "power"
                                     log(f"  Node {node.id} ({node_type}): demand={node.demand:.2f}A, ff={node.fulfillment:.1f}%")
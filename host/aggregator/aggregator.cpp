@@ -0,0 +1,700 @@
+#include "aggregator.hpp"
+#include "net.hpp"
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace griddy {
+
+#define AGGREGATOR_TAG "[aggregator]"
+
+namespace {
+
+// Samples kept per controller: enough to bracket an epoch held back by a
+// few controller periods
+constexpr int HISTORY = 4;
+
+struct snapshot {
+    int64_t t_us = 0;                       // Sample time on the aggregator clock
+    std::vector<telemetry_node_t> nodes;    // Ids below node_stride only
+};
+
+struct client_state {
+    bool optimizer = false;
+    size_t index = 0;           // Position in subscribers_
+    int32_t credits = -1;       // CRED flow control, -1 until the first grant
+    bool owed = false;          // An epoch was skipped for lack of credit
+};
+
+client_state &state_of(ws_connection &conn)
+{
+    return *static_cast<client_state *>(conn.user.get());
+}
+
+template <typename T>
+uint8_t *put(uint8_t *p, T value)
+{
+    memcpy(p, &value, sizeof(value));
+    return p + sizeof(value);
+}
+
+const telemetry_node_t *find_node(const snapshot &s, size_t hint, uint16_t id)
+{
+    if (hint < s.nodes.size() && s.nodes[hint].id == id) {
+        return &s.nodes[hint];
+    }
+    for (const telemetry_node_t &n : s.nodes) {
+        if (n.id == id) {
+            return &n;
+        }
+    }
+    return nullptr;
+}
+
+struct dispatch_split {
+    uint16_t stride;
+    uint16_t *duties;
+    uint8_t *touched;
+    uint8_t *controller_touched;
+    std::vector<int> *touched_list;
+    size_t controllers;
+    uint32_t unrouted = 0;
+};
+
+void split_duty(uint16_t id, uint16_t duty, void *ctx)
+{
+    dispatch_split &split = *static_cast<dispatch_split *>(ctx);
+    size_t controller = id / split.stride;
+    if (controller >= split.controllers) {
+        split.unrouted++;
+        return;
+    }
+    if (!split.controller_touched[controller]) {
+        split.controller_touched[controller] = 1;
+        split.touched_list->push_back((int)controller);
+    }
+    split.duties[id] = duty;
+    split.touched[id] = 1;
+}
+
+void split_node(const dispatch_node_t *node, void *ctx)
+{
+    float supply = std::min(1.0f, std::max(0.0f, node->supply));
+    split_duty(node->id, (uint16_t)(supply * DISPATCH_DUTY_MAX), ctx);
+}
+
+} // namespace
+
+struct aggregator::controller {
+    int id;
+    std::string host;
+    uint16_t port;
+    ws_connection::ptr out;
+    ws_connection::ptr in;
+    bool out_open = false;
+    bool in_open = false;
+    int64_t out_backoff_us = 0;
+    int64_t in_backoff_us = 0;
+    event_loop::timer_id sync_timer = 0;
+
+    telemetry_state_t state;
+    clock_sync clock;
+    snapshot ring[HISTORY];
+    int head = 0;               // Next slot to write
+    int samples = 0;
+
+    // Forward times, the device acks in order. Dropped once older than
+    // ack_timeout_us or beyond max_pending_acks; an ack that still arrives
+    // for one is skipped rather than timed against the next forward
+    std::deque<int64_t> pending_acks;
+    uint64_t acks_owed = 0;
+
+    const snapshot &newest(int i) const { return ring[(head + HISTORY - 1 - i) % HISTORY]; }
+};
+
+aggregator::aggregator(aggregator_config config) : config_(std::move(config)) {}
+
+aggregator::~aggregator()
+{
+    stop();
+    if (listen_fd_ >= 0) {
+        close(listen_fd_);
+    }
+}
+
+bool aggregator::start()
+{
+    if (started_) {
+        return true;
+    }
+    if (config_.controllers.empty() || config_.node_stride == 0 || config_.epoch_hz <= 0 ||
+        config_.controllers.size() * config_.node_stride > 65536) {
+        fprintf(stderr, AGGREGATOR_TAG " need 1+ controllers and controllers * node stride <= 65536\n");
+        return false;
+    }
+
+    for (size_t i = 0; i < config_.controllers.size(); i++) {
+        auto ctl = std::make_unique<controller>();
+        ctl->id = (int)i;
+        if (!parse_host_port(config_.controllers[i], 80, ctl->host, ctl->port)) {
+            fprintf(stderr, AGGREGATOR_TAG " bad controller address '%s'\n", config_.controllers[i].c_str());
+            return false;
+        }
+        telemetry_state_init(&ctl->state);
+        controllers_.push_back(std::move(ctl));
+    }
+
+    // Scratch sized once: a controller contributes at most stride (and 255) nodes
+    size_t per_controller = std::min<size_t>(config_.node_stride, 255);
+    frame_.resize(AGGREGATE_HEADER_SIZE +
+                  controllers_.size() * (AGGREGATE_BLOCK_SIZE + per_controller * AGGREGATE_NODE_SIZE));
+    duties_.assign(controllers_.size() * config_.node_stride, 0);
+    touched_.assign(duties_.size(), 0);
+    controller_touched_.assign(controllers_.size(), 0);
+    epoch_period_us_ = (int64_t)(1e6 / config_.epoch_hz);
+
+    listen_fd_ = tcp_listen(config_.port, false);
+    if (listen_fd_ < 0) {
+        perror(AGGREGATOR_TAG " listen");
+        return false;
+    }
+    bound_port_ = local_port(listen_fd_);
+    loop_.add(listen_fd_, EPOLLIN, [this](uint32_t) { accept_all(); });
+
+    for (auto &ctl : controllers_) {
+        controller *cp = ctl.get();
+        loop_.post([this, cp]() {
+            connect_out(*cp);
+            connect_in(*cp);
+        });
+    }
+
+    loop_.post([this]() { schedule_epoch(); });
+    if (config_.verbose) {
+        loop_.post([this]() {
+            loop_.add_timer(5000000, 5000000, [this]() {
+                fprintf(stderr, AGGREGATOR_TAG " %s\n", stats_json().c_str());
+            });
+        });
+    }
+    thread_ = std::thread([this]() { loop_.run(); });
+
+    fprintf(stderr, AGGREGATOR_TAG " %zu controller(s), %.1f Hz epochs, hold %lld us, port %u\n",
+            controllers_.size(), config_.epoch_hz, (long long)config_.hold_us, bound_port_);
+    started_ = true;
+    return true;
+}
+
+void aggregator::stop()
+{
+    if (!started_) {
+        return;
+    }
+    started_ = false;
+    loop_.stop();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void aggregator::schedule_reconnect(controller &ctl, bool out)
+{
+    int64_t &backoff = out ? ctl.out_backoff_us : ctl.in_backoff_us;
+    backoff = backoff == 0 ? config_.reconnect_min_us : std::min(backoff * 2, config_.reconnect_max_us);
+    controller *cp = &ctl;
+    loop_.add_timer(backoff, 0, [this, cp, out]() {
+        if (out) {
+            connect_out(*cp);
+        } else {
+            connect_in(*cp);
+        }
+    });
+}
+
+void aggregator::connect_out(controller &ctl)
+{
+    controller *cp = &ctl;
+    ws_connection::handlers h;
+    h.on_open = [this, cp](ws_connection &) {
+        cp->out_open = true;
+        cp->out_backoff_us = 0;
+        stats_.connected++;
+        // The controller may have rebooted: new clock, new node set
+        telemetry_state_init(&cp->state);
+        cp->clock = clock_sync();
+        cp->samples = 0;
+        if (config_.sync_hz > 0) {
+            // Spread over one period so the pings do not go out in a burst
+            int64_t period = (int64_t)(1e6 / config_.sync_hz);
+            int64_t delay = period * cp->id / (int64_t)controllers_.size();
+            send_sync(*cp);
+            cp->sync_timer = loop_.add_timer(delay + 1, period, [this, cp]() { send_sync(*cp); });
+        }
+        if (config_.verbose) {
+            fprintf(stderr, AGGREGATOR_TAG " controller %d /out connected (%s:%u)\n", cp->id, cp->host.c_str(),
+                    cp->port);
+        }
+        return true;
+    };
+    h.on_message = [this, cp](ws_connection &, uint8_t op, const uint8_t *data, size_t len) {
+        if (op == ws::OP_BINARY) {
+            on_telemetry(*cp, data, len);
+        }
+    };
+    h.on_close = [this, cp](ws_connection &) {
+        if (cp->out_open) {
+            cp->out_open = false;
+            stats_.connected--;
+            fprintf(stderr, AGGREGATOR_TAG " controller %d /out lost, reconnecting\n", cp->id);
+        }
+        if (cp->sync_timer) {
+            loop_.cancel_timer(cp->sync_timer);
+            cp->sync_timer = 0;
+        }
+        cp->samples = 0;
+        cp->out.reset();
+        schedule_reconnect(*cp, true);
+    };
+
+    ctl.out = ws_connection::connect(loop_, ctl.host, ctl.port, "/out", std::move(h));
+    if (!ctl.out) {
+        schedule_reconnect(ctl, true);
+    }
+}
+
+void aggregator::connect_in(controller &ctl)
+{
+    controller *cp = &ctl;
+    ws_connection::handlers h;
+    h.on_open = [cp](ws_connection &) {
+        cp->in_open = true;
+        cp->in_backoff_us = 0;
+        return true;
+    };
+    h.on_message = [this, cp](ws_connection &, uint8_t op, const uint8_t *data, size_t len) {
+        if (op == ws::OP_BINARY) {
+            on_dispatch_ack(*cp, data, len);
+        }
+    };
+    h.on_close = [this, cp](ws_connection &) {
+        cp->in_open = false;
+        cp->in.reset();
+        cp->pending_acks.clear();
+        cp->acks_owed = 0;
+        schedule_reconnect(*cp, false);
+    };
+
+    ctl.in = ws_connection::connect(loop_, ctl.host, ctl.port, "/in", std::move(h));
+    if (!ctl.in) {
+        schedule_reconnect(ctl, false);
+    }
+}
+
+void aggregator::send_sync(controller &ctl)
+{
+    if (!ctl.out_open) {
+        return;
+    }
+    time_sync_t ping = {};
+    uint8_t buf[TIME_SYNC_SIZE];
+    ping.magic = TIME_SYNC_MAGIC;
+    ping.origin_us = (uint64_t)now_us();
+    ctl.out->send_binary(buf, encode_time_sync(&ping, buf));
+}
+
+void aggregator::on_telemetry(controller &ctl, const uint8_t *data, size_t len)
+{
+    int64_t arrival = now_us();
+    time_sync_t sync;
+    if (decode_time_sync(data, len, &sync)) {
+        if (sync.magic == TIME_SYNC_REPLY_MAGIC) {
+            ctl.clock.add(sync, arrival);
+        }
+        return;
+    }
+
+    telemetry_packet_t packet;
+    if (!decode_telemetry(data, len, &packet)) {
+        stats_.frames_invalid++;
+        return;
+    }
+    stats_.frames_in++;
+    if (!telemetry_state_apply(&ctl.state, &packet)) {
+        return;  // Delta after a gap: wait for the keyframe
+    }
+
+    // Until the first sync reply, a sample is as old as its arrival
+    int64_t t = ctl.clock.synced() ? ctl.clock.to_local(ctl.state.packet.timestamp_us) : arrival;
+    if (ctl.samples > 0 && t <= ctl.newest(0).t_us) {
+        t = ctl.newest(0).t_us + 1;  // Keep the ring ordered across estimate updates
+    }
+    snapshot &s = ctl.ring[ctl.head];
+    ctl.head = (ctl.head + 1) % HISTORY;
+    ctl.samples = std::min(ctl.samples + 1, HISTORY);
+    s.t_us = t;
+    s.nodes.clear();
+    for (int i = 0; i < ctl.state.packet.node_count; i++) {
+        const telemetry_node_t &n = ctl.state.packet.nodes[i];
+        if (n.id < config_.node_stride) {
+            s.nodes.push_back(n);
+        } else {
+            stats_.nodes_out_of_range++;
+        }
+    }
+}
+
+void aggregator::on_dispatch_ack(controller &ctl, const uint8_t *data, size_t len)
+{
+    dispatch_ack_t ack;
+    if (!decode_dispatch_ack(data, len, &ack)) {
+        return;
+    }
+    int64_t now = now_us();
+    expire_acks(ctl, now);
+    if (ctl.acks_owed > 0) {
+        ctl.acks_owed--;
+        return;
+    }
+    if (ctl.pending_acks.empty()) {
+        return;
+    }
+    stats_.ack_us.record(now - ctl.pending_acks.front());
+    ctl.pending_acks.pop_front();
+    stats_.dispatch_acked++;
+    if (ack.status != DISPATCH_ACK_APPLIED) {
+        stats_.dispatch_rejected++;
+    }
+}
+
+void aggregator::expire_acks(controller &ctl, int64_t now)
+{
+    while (!ctl.pending_acks.empty() && now - ctl.pending_acks.front() > config_.ack_timeout_us) {
+        ctl.pending_acks.pop_front();
+        ctl.acks_owed++;
+        stats_.dispatch_ack_expired++;
+    }
+}
+
+uint8_t *aggregator::merge_controller(controller &ctl, int64_t epoch_us, uint8_t *p)
+{
+    uint8_t *block = p;
+    uint8_t flags = 0;
+    uint32_t age = AGGREGATE_AGE_UNKNOWN;
+    uint8_t count = 0;
+    p += AGGREGATE_BLOCK_SIZE;
+
+    // Newest sample at or before the epoch, and the oldest one after it
+    const snapshot *before = nullptr;
+    const snapshot *after = nullptr;
+    for (int i = 0; i < ctl.samples; i++) {
+        const snapshot &s = ctl.newest(i);
+        if (s.t_us <= epoch_us) {
+            before = &s;
+            break;
+        }
+        after = &s;
+    }
+
+    if (!ctl.out_open || ctl.samples == 0) {
+        flags = AGGREGATE_OFFLINE;
+        stats_.offline++;
+    } else {
+        if (!ctl.clock.synced()) {
+            flags |= AGGREGATE_UNSYNCED;
+        }
+        const snapshot *base = before ? before : after;
+        float w = 0.0f;
+        if (before) {
+            age = (uint32_t)std::min<int64_t>(epoch_us - before->t_us, AGGREGATE_AGE_UNKNOWN - 1);
+            stats_.age_us.record(epoch_us - before->t_us);
+        } else {
+            age = 0;  // Every sample is newer: the epoch predates this controller's data
+        }
+        if (before && after) {
+            flags |= AGGREGATE_INTERPOLATED;
+            w = (float)(epoch_us - before->t_us) / (float)(after->t_us - before->t_us);
+            stats_.interpolated++;
+        } else if (before && epoch_us - before->t_us > config_.stale_us) {
+            flags |= AGGREGATE_STALE;
+            stats_.stale++;
+        } else {
+            stats_.held++;
+        }
+
+        // The node set is the one in force at the epoch; nodes added in the
+        // next sample are held until it is at or before an epoch
+        for (size_t i = 0; i < base->nodes.size(); i++) {
+            const telemetry_node_t &n = base->nodes[i];
+            float demand = n.demand;
+            float fulfillment = n.fulfillment;
+            if (flags & AGGREGATE_INTERPOLATED) {
+                const telemetry_node_t *next = find_node(*after, i, n.id);
+                if (next) {
+                    demand += (next->demand - demand) * w;
+                    fulfillment += (next->fulfillment - fulfillment) * w;
+                }
+            }
+            p = put<uint16_t>(p, (uint16_t)(ctl.id * config_.node_stride + n.id));
+            p = put<uint8_t>(p, n.type);
+            p = put<float>(p, demand);
+            p = put<float>(p, fulfillment);
+            count++;
+        }
+    }
+
+    block = put<uint16_t>(block, (uint16_t)ctl.id);
+    block = put<uint8_t>(block, flags);
+    block = put<uint32_t>(block, age);
+    put<uint8_t>(block, count);
+    return p;
+}
+
+void aggregator::schedule_epoch()
+{
+    // Epochs sit on a fixed grid of the aggregator clock, each built hold_us
+    // late. One-shot timers aimed at the next grid point keep the phase after
+    // a stall, where a periodic timer would re-base to the stall's end.
+    int64_t now = now_us();
+    int64_t next = ((now - config_.hold_us) / epoch_period_us_ + 1) * epoch_period_us_ + config_.hold_us;
+    loop_.add_timer(next - now, 0, [this]() { emit_epoch(); });
+}
+
+void aggregator::emit_epoch()
+{
+    int64_t start = now_us();
+    int64_t epoch_us = (start - config_.hold_us) / epoch_period_us_ * epoch_period_us_;
+    schedule_epoch();
+    if (epoch_us <= last_epoch_us_) {
+        return;
+    }
+    last_epoch_us_ = epoch_us;
+    stats_.lateness_us.record(start - (epoch_us + config_.hold_us));
+
+    uint8_t *p = frame_.data();
+    p = put<uint32_t>(p, AGGREGATE_MAGIC);
+    p = put<uint64_t>(p, (uint64_t)epoch_us);
+    p = put<uint32_t>(p, (uint32_t)(epoch_us / epoch_period_us_));
+    p = put<uint16_t>(p, (uint16_t)controllers_.size());
+    p = put<uint16_t>(p, config_.node_stride);
+    for (auto &ctl : controllers_) {
+        p = merge_controller(*ctl, epoch_us, p);
+    }
+    stats_.epochs++;
+
+    latest_ = ws_connection::encode_shared(ws_connection::framing::websocket, ws::OP_BINARY, frame_.data(),
+                                           (size_t)(p - frame_.data()));
+    // Walk backwards: a failed write closes only the current connection, and
+    // its swap-remove pulls in an element that has already been visited
+    for (size_t i = subscribers_.size(); i-- > 0;) {
+        ws_connection::ptr conn = subscribers_[i];
+        client_state &st = state_of(*conn);
+        if (st.credits == 0) {
+            st.owed = true;
+            continue;
+        }
+        if (conn->send_encoded(latest_)) {
+            if (st.credits > 0) {
+                st.credits--;
+            }
+        } else {
+            stats_.epochs_dropped++;
+        }
+    }
+    stats_.build_us.record(now_us() - start);
+}
+
+void aggregator::accept_all()
+{
+    while (true) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && config_.verbose) {
+                perror(AGGREGATOR_TAG " accept");
+            }
+            return;
+        }
+        set_nodelay(fd);
+        ws_connection::handlers h;
+        h.on_open = [this](ws_connection &conn) { return on_client_open(conn); };
+        h.on_message = [this](ws_connection &conn, uint8_t op, const uint8_t *data, size_t len) {
+            on_client_message(conn, op, data, len);
+        };
+        h.on_close = [this](ws_connection &conn) { on_client_close(conn); };
+        ws_connection::ptr conn = ws_connection::accept(loop_, fd, ws_connection::framing::websocket, std::move(h));
+        conn->set_max_queue(config_.max_client_queue);
+    }
+}
+
+bool aggregator::on_client_open(ws_connection &conn)
+{
+    const std::string &path = conn.target().path;
+    auto st = std::make_shared<client_state>();
+    if (path == "/in") {
+        st->optimizer = true;
+        conn.user = st;
+        return true;
+    }
+    if (path != "/out") {
+        return false;
+    }
+    st->index = subscribers_.size();
+    conn.user = st;
+    subscribers_.push_back(conn.shared_from_this());
+    stats_.subscribers++;
+    return true;
+}
+
+void aggregator::on_client_message(ws_connection &conn, uint8_t op, const uint8_t *data, size_t len)
+{
+    int64_t received = now_us();
+    client_state &st = state_of(conn);
+    if (op != ws::OP_BINARY) {
+        return;
+    }
+    if (st.optimizer) {
+        route_dispatch(conn, data, len);
+        return;
+    }
+
+    // /out takes the same inbound frames as a controller: TSYN and CRED
+    time_sync_t sync;
+    flow_credit_t credit;
+    if (decode_time_sync(data, len, &sync) && sync.magic == TIME_SYNC_MAGIC) {
+        uint8_t reply[TIME_SYNC_REPLY_SIZE];
+        sync.magic = TIME_SYNC_REPLY_MAGIC;
+        sync.receive_us = (uint64_t)received;
+        sync.transmit_us = (uint64_t)now_us();
+        conn.send_binary(reply, encode_time_sync(&sync, reply));
+    } else if (decode_flow_credit(data, len, &credit)) {
+        st.credits = std::min<int32_t>(std::max(st.credits, 0) + credit.credits, 0xFFFF);
+        if (st.owed && st.credits > 0 && latest_) {
+            st.owed = false;
+            if (conn.send_encoded(latest_)) {
+                st.credits--;
+            }
+        }
+    }
+}
+
+void aggregator::on_client_close(ws_connection &conn)
+{
+    if (!conn.user) {
+        return;
+    }
+    client_state &st = state_of(conn);
+    if (st.optimizer) {
+        return;
+    }
+    // Swap-remove, keeping the moved subscriber's index current
+    if (st.index < subscribers_.size() && subscribers_[st.index].get() == &conn) {
+        subscribers_[st.index] = subscribers_.back();
+        state_of(*subscribers_[st.index]).index = st.index;
+        subscribers_.pop_back();
+        stats_.subscribers--;
+    }
+}
+
+void aggregator::route_dispatch(ws_connection &conn, const uint8_t *data, size_t len)
+{
+    stats_.dispatch_in++;
+    dispatch_split split;
+    split.stride = config_.node_stride;
+    split.duties = duties_.data();
+    split.touched = touched_.data();
+    split.controller_touched = controller_touched_.data();
+    split.touched_list = &touched_list_;
+    split.controllers = controllers_.size();
+
+    dispatch_stream_t stream;
+    dispatch_stream_begin(&stream, split_node, split_duty, &split);
+    dispatch_stream_feed(&stream, data, len);
+    bool valid = dispatch_stream_end(&stream) == DISPATCH_STREAM_DONE;
+    if (!valid) {
+        stats_.dispatch_invalid++;
+    }
+
+    // Nodes decoded before an error are still forwarded, as the firmware
+    // applies them as they arrive
+    uint32_t routed = 0;
+    size_t stride = config_.node_stride;
+    std::vector<uint8_t> changed((stride + 7) / 8);
+    std::vector<uint8_t> buf(DISPATCH_DENSE_HEADER_SIZE + changed.size() + 2 * stride);
+    for (int id : touched_list_) {
+        controller &ctl = *controllers_[(size_t)id];
+        uint16_t *duties = &duties_[(size_t)id * stride];
+        uint8_t *touched = &touched_[(size_t)id * stride];
+        controller_touched_[(size_t)id] = 0;
+
+        size_t lo = 0, hi = stride - 1, nodes = 0;
+        while (!touched[lo]) lo++;
+        while (!touched[hi]) hi--;
+        std::fill(changed.begin(), changed.end(), 0);
+        for (size_t i = lo; i <= hi; i++) {
+            if (touched[i]) {
+                changed[(i - lo) / 8] |= (uint8_t)(1u << ((i - lo) % 8));
+                nodes++;
+            }
+            touched[i] = 0;
+        }
+        bool all = nodes == hi - lo + 1;
+        size_t n = encode_dispatch_dense((uint16_t)lo, duties + lo, (uint16_t)(hi - lo + 1),
+                                         all ? nullptr : changed.data(), buf.data(), buf.size());
+        if (n == 0 || !ctl.in_open || !ctl.in->send_binary(buf.data(), n)) {
+            stats_.dispatch_unrouted += nodes;
+            continue;
+        }
+        int64_t now = now_us();
+        expire_acks(ctl, now);
+        while (!ctl.pending_acks.empty() && ctl.pending_acks.size() >= config_.max_pending_acks) {
+            ctl.pending_acks.pop_front();
+            ctl.acks_owed++;
+            stats_.dispatch_ack_expired++;
+        }
+        ctl.pending_acks.push_back(now);
+        stats_.dispatch_forwarded++;
+        routed += (uint32_t)nodes;
+    }
+    touched_list_.clear();
+    stats_.dispatch_unrouted += split.unrouted;
+
+    dispatch_ack_t ack;
+    uint8_t reply[DISPATCH_ACK_SIZE];
+    ack.magic = DISPATCH_ACK_MAGIC;
+    ack.seq = ++dispatch_seq_;
+    ack.status = valid ? DISPATCH_ACK_APPLIED : DISPATCH_ACK_INVALID;
+    ack.applied = (uint8_t)std::min<uint32_t>(routed, 255);
+    conn.send_binary(reply, encode_dispatch_ack(&ack, reply));
+}
+
+std::string aggregator::stats_json() const
+{
+    char buf[768];
+    snprintf(buf, sizeof(buf),
+             "{\"controllers\":%zu,\"connected\":%lld,\"subscribers\":%lld,\"frames_in\":%llu,"
+             "\"frames_invalid\":%llu,\"nodes_out_of_range\":%llu,\"epochs\":%llu,\"epochs_dropped\":%llu,"
+             "\"interpolated\":%llu,\"held\":%llu,\"stale\":%llu,\"offline\":%llu,"
+             "\"dispatch_in\":%llu,\"dispatch_invalid\":%llu,\"dispatch_forwarded\":%llu,"
+             "\"dispatch_unrouted\":%llu,\"dispatch_acked\":%llu,\"dispatch_rejected\":%llu,"
+             "\"dispatch_ack_expired\":%llu,",
+             controllers_.size(), (long long)stats_.connected, (long long)stats_.subscribers,
+             (unsigned long long)stats_.frames_in, (unsigned long long)stats_.frames_invalid,
+             (unsigned long long)stats_.nodes_out_of_range, (unsigned long long)stats_.epochs,
+             (unsigned long long)stats_.epochs_dropped, (unsigned long long)stats_.interpolated,
+             (unsigned long long)stats_.held, (unsigned long long)stats_.stale,
+             (unsigned long long)stats_.offline, (unsigned long long)stats_.dispatch_in,
+             (unsigned long long)stats_.dispatch_invalid, (unsigned long long)stats_.dispatch_forwarded,
+             (unsigned long long)stats_.dispatch_unrouted, (unsigned long long)stats_.dispatch_acked,
+             (unsigned long long)stats_.dispatch_rejected, (unsigned long long)stats_.dispatch_ack_expired);
+    std::string out = buf;
+    out += "\"build_us\":" + stats_.build_us.to_json();
+    out += ",\"lateness_us\":" + stats_.lateness_us.to_json();
+    out += ",\"age_us\":" + stats_.age_us.to_json();
+    out += ",\"ack_us\":" + stats_.ack_us.to_json() + "}";
+    return out;
+}
+
+} // namespace griddy
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "binary_protocol.h"
+#include "clock_sync.hpp"
+#include "event_loop.hpp"
+#include "histogram.hpp"
+#include "ws_connection.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace griddy {
+
+// Merged telemetry frame (aggregator → optimizer on /out), one per epoch:
+//   magic u32, timestamp u64 (epoch time on the aggregator clock, µs),
+//   epoch u32, controller count u16, node stride u16, then per controller:
+//   id u16, flags u8, age_us u32, node count u8, GRDW node records.
+// Node ids are global: controller id * stride + the controller's node id.
+// The aggregator answers TSYN pings on /out with the same clock.
+constexpr uint32_t AGGREGATE_MAGIC = 0x41445247;    // "GRDA"
+constexpr size_t AGGREGATE_HEADER_SIZE = 20;
+constexpr size_t AGGREGATE_BLOCK_SIZE = 8;
+constexpr size_t AGGREGATE_NODE_SIZE = 11;
+
+constexpr uint8_t AGGREGATE_INTERPOLATED = 0x01;    // Between the samples either side of the epoch
+constexpr uint8_t AGGREGATE_STALE = 0x02;           // Last sample held for longer than stale_us
+constexpr uint8_t AGGREGATE_OFFLINE = 0x04;         // /out down or no sample yet; no nodes
+constexpr uint8_t AGGREGATE_UNSYNCED = 0x08;        // Sample times are arrival times (no clock sync yet)
+constexpr uint32_t AGGREGATE_AGE_UNKNOWN = 0xFFFFFFFFu;
+
+struct aggregator_config {
+    std::vector<std::string> controllers;   // "host[:port]", index = controller id
+    uint16_t port = 9200;                   // /out merged frames, /in dispatch
+    double epoch_hz = 24.0;
+    int64_t hold_us = 60000;                // Epoch T is built at T + hold_us, when late frames are in
+    int64_t stale_us = 250000;              // Held samples older than this are flagged stale
+    uint16_t node_stride = 64;              // Controller node ids must be below this
+    double sync_hz = 1.0;                   // TSYN pings per controller per second
+    size_t max_client_queue = 1 << 20;      // Per-subscriber queued bytes before dropping epochs
+    size_t max_pending_acks = 1024;         // Per-controller forwards awaiting a device ack
+    int64_t ack_timeout_us = 5000000;       // Forget a forward not acked within this
+    int64_t reconnect_min_us = 250000;
+    int64_t reconnect_max_us = 5000000;
+    bool verbose = false;
+};
+
+// Updated on the loop thread only; read them after stop()
+struct aggregator_stats {
+    uint64_t frames_in = 0;             // Telemetry frames from controllers
+    uint64_t frames_invalid = 0;        // Upstream frames that failed decode
+    uint64_t nodes_out_of_range = 0;    // Controller node ids >= node_stride, left out
+    uint64_t epochs = 0;
+    uint64_t epochs_dropped = 0;        // Merged frames not queued to a slow subscriber
+    uint64_t interpolated = 0;          // Controller-epochs by flag
+    uint64_t held = 0;
+    uint64_t stale = 0;
+    uint64_t offline = 0;
+    uint64_t dispatch_in = 0;           // Dispatch frames from optimizers
+    uint64_t dispatch_invalid = 0;
+    uint64_t dispatch_forwarded = 0;    // DDSP frames written to a controller /in
+    uint64_t dispatch_unrouted = 0;     // Nodes for unknown or disconnected controllers
+    uint64_t dispatch_acked = 0;        // Controller acks
+    uint64_t dispatch_rejected = 0;     // Controller acks with DISPATCH_ACK_INVALID
+    uint64_t dispatch_ack_expired = 0;  // Forwards given up on before an ack
+    int64_t subscribers = 0;
+    int64_t connected = 0;              // Controllers with a live /out
+    histogram build_us;                 // Merge, encode and queue one epoch
+    histogram lateness_us;              // Epoch built after T + hold_us
+    histogram age_us;                   // Epoch time minus the newest sample at or before it
+    histogram ack_us;                   // Controller dispatch ack latency
+};
+
+/**
+ * Multi-controller telemetry aggregator.
+ *
+ * Holds one /out subscription and one /in connection per controller and
+ * pings each controller's clock (TSYN), so every sample gets a time on the
+ * aggregator's clock. Each epoch T on a fixed grid is built once, hold_us
+ * after T:
+ *   - a controller with samples either side of T is interpolated linearly
+ *     per node,
+ *   - one whose newest sample is older than T is held at that sample, with
+ *     its age, and flagged stale past stale_us,
+ *   - one with no sample is flagged offline.
+ * The merged frame is encoded once and queued to every /out subscriber.
+ * Dispatch on /in (DISP or DDSP, global node ids) is split per controller
+ * into DDSP frames, and acked to the optimizer once forwarded.
+ *
+ * Everything runs on one event loop thread: per epoch the work is linear
+ * in the node count and never waits on a controller.
+ */
+class aggregator {
+public:
+    explicit aggregator(aggregator_config config);
+    ~aggregator();
+
+    bool start();
+    void stop();
+
+    const aggregator_stats &stats() const { return stats_; }
+    uint16_t port() const { return bound_port_; }
+
+    /**
+     * @brief One-line JSON snapshot of the counters and histograms
+     */
+    std::string stats_json() const;
+
+    struct controller;
+
+private:
+    void connect_out(controller &ctl);
+    void connect_in(controller &ctl);
+    void schedule_reconnect(controller &ctl, bool out);
+    void on_telemetry(controller &ctl, const uint8_t *data, size_t len);
+    void send_sync(controller &ctl);
+    void on_dispatch_ack(controller &ctl, const uint8_t *data, size_t len);
+    void expire_acks(controller &ctl, int64_t now);
+
+    void accept_all();
+    bool on_client_open(ws_connection &conn);
+    void on_client_message(ws_connection &conn, uint8_t op, const uint8_t *data, size_t len);
+    void on_client_close(ws_connection &conn);
+    void route_dispatch(ws_connection &conn, const uint8_t *data, size_t len);
+
+    void schedule_epoch();
+    void emit_epoch();
+    uint8_t *merge_controller(controller &ctl, int64_t epoch_us, uint8_t *p);
+
+    aggregator_config config_;
+    aggregator_stats stats_;
+    uint16_t bound_port_ = 0;
+    int listen_fd_ = -1;
+    int64_t epoch_period_us_ = 0;
+    int64_t last_epoch_us_ = 0;
+
+    event_loop loop_;
+    std::thread thread_;
+    std::vector<std::unique_ptr<controller>> controllers_;
+    std::vector<ws_connection::ptr> subscribers_;
+    std::vector<uint8_t> frame_;            // Merged frame scratch
+    ws_connection::buffer latest_;          // Last epoch, for subscribers owed one on a credit grant
+
+    // Dispatch split scratch, indexed by global node id / controller id
+    std::vector<uint16_t> duties_;
+    std::vector<uint8_t> touched_;
+    std::vector<uint8_t> controller_touched_;
+    std::vector<int> touched_list_;
+    uint32_t dispatch_seq_ = 0;
+    bool started_ = false;
+};
+
+} // namespace griddy
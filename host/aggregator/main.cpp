@@ -0,0 +1,131 @@
+// griddy_aggregator: merge many controllers' telemetry into one time-aligned stream.
+//
+//   griddy_aggregator --controller 192.168.1.50 [--controller host:port ...]
+//                     [--controller-file FILE] [--port 9200] [--epoch-rate HZ]
+//                     [--hold-ms MS] [--stale-ms MS] [--node-stride N]
+//                     [--sync-rate HZ] [--max-queue BYTES] [--ack-timeout MS]
+//                     [--duration SECONDS] [--verbose]
+
+#include "aggregator.hpp"
+#include "net.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int)
+{
+    stop_requested = 1;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s --controller HOST[:PORT] [--controller ...] [--controller-file FILE]\n"
+            "          [--port N] [--epoch-rate HZ] [--hold-ms MS] [--stale-ms MS] [--node-stride N]\n"
+            "          [--sync-rate HZ] [--max-queue BYTES] [--ack-timeout MS] [--duration SECONDS]\n"
+            "          [--verbose]\n",
+            argv0);
+}
+
+// One "host[:port]" per line; blank lines and # comments are skipped
+static bool read_controller_file(const char *path, std::vector<std::string> &out)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        std::string s = line;
+        size_t end = s.find_first_of("#\r\n");
+        s = s.substr(0, end);
+        while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+            s.pop_back();
+        }
+        if (!s.empty()) {
+            out.push_back(s);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    griddy::aggregator_config config;
+    double duration_s = 0.0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+
+        if (!strcmp(arg, "--verbose")) {
+            config.verbose = true;
+            continue;
+        }
+        if (!strcmp(arg, "--controller") && value) {
+            config.controllers.push_back(value);
+        } else if (!strcmp(arg, "--controller-file") && value) {
+            ok = read_controller_file(value, config.controllers);
+        } else if (!strcmp(arg, "--port") && value) {
+            config.port = (uint16_t)atoi(value);
+        } else if (!strcmp(arg, "--epoch-rate") && value) {
+            config.epoch_hz = atof(value);
+            ok = config.epoch_hz > 0;
+        } else if (!strcmp(arg, "--hold-ms") && value) {
+            config.hold_us = (int64_t)(atof(value) * 1000);
+            ok = config.hold_us >= 0;
+        } else if (!strcmp(arg, "--stale-ms") && value) {
+            config.stale_us = (int64_t)(atof(value) * 1000);
+        } else if (!strcmp(arg, "--node-stride") && value) {
+            int stride = atoi(value);
+            ok = stride >= 1 && stride <= 65535;
+            config.node_stride = (uint16_t)stride;
+        } else if (!strcmp(arg, "--sync-rate") && value) {
+            config.sync_hz = atof(value);
+        } else if (!strcmp(arg, "--max-queue") && value) {
+            config.max_client_queue = (size_t)strtoull(value, nullptr, 10);
+        } else if (!strcmp(arg, "--ack-timeout") && value) {
+            config.ack_timeout_us = (int64_t)(atof(value) * 1000);
+            ok = config.ack_timeout_us > 0;
+        } else if (!strcmp(arg, "--duration") && value) {
+            duration_s = atof(value);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+    if (config.controllers.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    griddy::raise_fd_limit(65536);
+
+    griddy::aggregator agg(config);
+    if (!agg.start()) {
+        return 1;
+    }
+    int64_t start = griddy::now_us();
+    while (!stop_requested && (duration_s <= 0 || griddy::now_us() - start < (int64_t)(duration_s * 1e6))) {
+        usleep(50000);
+    }
+    agg.stop();
+    printf("%s\n", agg.stats_json().c_str());
+    return 0;
+}
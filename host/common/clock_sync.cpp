@@ -0,0 +1,96 @@
+#include "clock_sync.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace griddy {
+
+bool clock_sync::add(const time_sync_t &reply, int64_t arrival_us)
+{
+    int64_t origin = (int64_t)reply.origin_us;
+    int64_t receive = (int64_t)reply.receive_us;
+    int64_t transmit = (int64_t)reply.transmit_us;
+    int64_t delay = (arrival_us - origin) - (transmit - receive);
+    if (delay < 0 || transmit < receive) {
+        return false;
+    }
+
+    sample s;
+    s.local_us = origin + (arrival_us - origin) / 2;
+    s.offset_us = ((double)(receive - origin) + (double)(transmit - arrival_us)) / 2.0;
+    s.delay_us = delay;
+    samples_.push_back(s);
+    if (samples_.size() > window_) {
+        samples_.pop_front();
+    }
+    exchanges_++;
+    fit();
+    return true;
+}
+
+void clock_sync::fit()
+{
+    std::vector<int64_t> delays;
+    delays.reserve(samples_.size());
+    for (const sample &s : samples_) {
+        delays.push_back(s.delay_us);
+    }
+    std::nth_element(delays.begin(), delays.begin() + delays.size() / 2, delays.end());
+    int64_t median = delays[delays.size() / 2];
+    min_delay_ = *std::min_element(delays.begin(), delays.end());
+
+    // Least squares over the faster half, about the newest kept exchange
+    double n = 0, sum_t = 0, sum_o = 0, sum_tt = 0, sum_to = 0;
+    int64_t first = 0, last = 0;
+    const sample *best = nullptr;
+    for (const sample &s : samples_) {
+        if (s.delay_us > median) {
+            continue;
+        }
+        if (n == 0) {
+            first = s.local_us;
+        }
+        last = s.local_us;
+        if (!best || s.delay_us < best->delay_us) {
+            best = &s;
+        }
+        n++;
+    }
+    ref_us_ = last;
+    for (const sample &s : samples_) {
+        if (s.delay_us > median) {
+            continue;
+        }
+        double t = (double)(s.local_us - ref_us_);
+        sum_t += t;
+        sum_o += s.offset_us;
+        sum_tt += t * t;
+        sum_to += t * s.offset_us;
+    }
+
+    double denominator = n * sum_tt - sum_t * sum_t;
+    if (n < 2 || last - first < 1000000 || denominator <= 0.0) {
+        ref_us_ = best->local_us;
+        offset_ = best->offset_us;
+        slope_ = 0.0;
+        return;
+    }
+    slope_ = (n * sum_to - sum_t * sum_o) / denominator;
+    offset_ = (sum_o - slope_ * sum_t) / n;
+}
+
+int64_t clock_sync::to_local(uint64_t controller_us) const
+{
+    // local = controller - offset(local); one refinement step is exact to
+    // well under a microsecond for any realistic drift
+    double local = (double)controller_us - offset_;
+    local = (double)controller_us - offset_at((int64_t)local);
+    return (int64_t)local;
+}
+
+uint64_t clock_sync::to_controller(int64_t local_us) const
+{
+    return (uint64_t)((double)local_us + offset_at(local_us));
+}
+
+} // namespace griddy
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "binary_protocol.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+namespace griddy {
+
+/**
+ * Controller clock estimate from TSYN ping/reply exchanges (NTP style).
+ *
+ * Each exchange gives an offset (controller - local clock) good to within
+ * half its round trip. The estimate keeps the last `window` exchanges, drops
+ * those slower than the median round trip (queued behind telemetry), and
+ * fits offset against local time by least squares, so it tracks drift as
+ * well as offset. With fewer than two kept exchanges, or less than a second
+ * between them, drift is taken as 0.
+ *
+ * Local times are whatever monotonic µs clock the caller uses (now_us()).
+ */
+class clock_sync {
+public:
+    explicit clock_sync(size_t window = 64) : window_(window) {}
+
+    /**
+     * @brief Add one exchange
+     *
+     * @param reply Decoded TIME_SYNC_REPLY_MAGIC message; origin_us is the
+     *              local send time the ping carried
+     * @param arrival_us Local time the reply arrived
+     * @return false if the reply is inconsistent (negative round trip)
+     */
+    bool add(const time_sync_t &reply, int64_t arrival_us);
+
+    bool synced() const { return !samples_.empty(); }
+
+    /**
+     * @brief Controller timestamp (µs since its boot) to local time
+     */
+    int64_t to_local(uint64_t controller_us) const;
+
+    /**
+     * @brief Local time to the controller clock
+     */
+    uint64_t to_controller(int64_t local_us) const;
+
+    double offset_us() const { return offset_; }           // Controller - local, at the newest exchange
+    double drift_ppm() const { return slope_ * 1e6; }      // Controller rate error against the local clock
+    int64_t min_delay_us() const { return min_delay_; }    // Fastest round trip in the window
+    double uncertainty_us() const { return min_delay_ / 2.0; }
+    uint64_t exchanges() const { return exchanges_; }
+
+private:
+    struct sample {
+        int64_t local_us;   // Midpoint of ping send and reply arrival
+        double offset_us;
+        int64_t delay_us;
+    };
+
+    void fit();
+    double offset_at(int64_t local_us) const { return offset_ + slope_ * (double)(local_us - ref_us_); }
+
+    size_t window_;
+    std::deque<sample> samples_;
+    uint64_t exchanges_ = 0;
+    int64_t min_delay_ = 0;
+    int64_t ref_us_ = 0;
+    double offset_ = 0.0;
+    double slope_ = 0.0;
+};
+
+} // namespace griddy
@@ -0,0 +1,166 @@
+#include "event_loop.hpp"
+#include "net.hpp"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+namespace griddy {
+
+event_loop::event_loop()
+{
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wake_fd_ < 0) {
+        perror("event_loop");
+        abort();
+    }
+    add(wake_fd_, EPOLLIN, [this](uint32_t) {
+        uint64_t value;
+        while (read(wake_fd_, &value, sizeof(value)) > 0) {
+        }
+        drain_posted();
+    });
+}
+
+event_loop::~event_loop()
+{
+    close(wake_fd_);
+    close(epoll_fd_);
+}
+
+bool event_loop::add(int fd, uint32_t events, io_handler handler)
+{
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        return false;
+    }
+    handlers_[fd] = std::make_shared<io_handler>(std::move(handler));
+    return true;
+}
+
+bool event_loop::modify(int fd, uint32_t events)
+{
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.fd = fd;
+    return epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+void event_loop::remove(int fd)
+{
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    handlers_.erase(fd);
+}
+
+void event_loop::post(task fn)
+{
+    bool was_empty;
+    {
+        std::lock_guard<std::mutex> lock(post_mutex_);
+        was_empty = posted_.empty();
+        posted_.push_back(std::move(fn));
+    }
+    if (was_empty) {
+        uint64_t one = 1;
+        ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void event_loop::drain_posted()
+{
+    std::vector<task> batch;
+    {
+        std::lock_guard<std::mutex> lock(post_mutex_);
+        batch.swap(posted_);
+    }
+    for (auto &fn : batch) {
+        fn();
+    }
+}
+
+event_loop::timer_id event_loop::add_timer(int64_t delay_us, int64_t period_us, task fn)
+{
+    timer_id id = next_timer_id_++;
+    timers_[id] = timer_state{period_us, std::move(fn)};
+    timer_heap_.push(timer_entry{now_us() + delay_us, id});
+    return id;
+}
+
+void event_loop::cancel_timer(timer_id id)
+{
+    // Heap entry is discarded lazily when it reaches the top
+    timers_.erase(id);
+}
+
+int event_loop::run_timers()
+{
+    int64_t now = now_us();
+    while (!timer_heap_.empty()) {
+        timer_entry top = timer_heap_.top();
+        auto it = timers_.find(top.id);
+        if (it == timers_.end()) {
+            timer_heap_.pop();
+            continue;
+        }
+        if (top.deadline_us > now) {
+            int64_t wait_ms = (top.deadline_us - now + 999) / 1000;
+            return wait_ms > 1000 ? 1000 : (int)wait_ms;
+        }
+        timer_heap_.pop();
+
+        task fn = it->second.fn;
+        if (it->second.period_us > 0) {
+            // Schedule from the previous deadline so periodic timers do not drift
+            int64_t next = top.deadline_us + it->second.period_us;
+            if (next <= now) {
+                next = now + it->second.period_us;
+            }
+            timer_heap_.push(timer_entry{next, top.id});
+        } else {
+            timers_.erase(it);
+        }
+        fn();
+        now = now_us();
+    }
+    return 1000;
+}
+
+void event_loop::run()
+{
+    running_ = true;
+    std::vector<struct epoll_event> events(256);
+
+    while (running_) {
+        int timeout_ms = run_timers();
+        int n = epoll_wait(epoll_fd_, events.data(), (int)events.size(), timeout_ms);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            auto it = handlers_.find(events[i].data.fd);
+            if (it == handlers_.end()) {
+                continue;
+            }
+            // Hold a reference: the handler may remove itself
+            std::shared_ptr<io_handler> handler = it->second;
+            (*handler)(events[i].events);
+        }
+    }
+}
+
+void event_loop::stop()
+{
+    post([this]() { running_ = false; });
+}
+
+} // namespace griddy
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <sys/epoll.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace griddy {
+
+/**
+ * Single-threaded epoll loop.
+ *
+ * Everything except post() and stop() must be called from the loop thread.
+ * Timers live in a heap and drive the epoll_wait timeout, so thousands of
+ * them cost no file descriptors.
+ */
+class event_loop {
+public:
+    using io_handler = std::function<void(uint32_t events)>;
+    using task = std::function<void()>;
+    using timer_id = uint64_t;
+
+    event_loop();
+    ~event_loop();
+
+    event_loop(const event_loop &) = delete;
+    event_loop &operator=(const event_loop &) = delete;
+
+    bool add(int fd, uint32_t events, io_handler handler);
+    bool modify(int fd, uint32_t events);
+    void remove(int fd);
+
+    /**
+     * @brief Queue a task onto the loop thread (thread-safe)
+     */
+    void post(task fn);
+
+    /**
+     * @brief Run fn after delay_us, then every period_us if non-zero
+     */
+    timer_id add_timer(int64_t delay_us, int64_t period_us, task fn);
+    void cancel_timer(timer_id id);
+
+    /**
+     * @brief Dispatch events until stop() is called
+     */
+    void run();
+
+    /**
+     * @brief Ask run() to return (thread-safe)
+     */
+    void stop();
+
+private:
+    struct timer_entry {
+        int64_t deadline_us;
+        timer_id id;
+        bool operator>(const timer_entry &other) const { return deadline_us > other.deadline_us; }
+    };
+    struct timer_state {
+        int64_t period_us;
+        task fn;
+    };
+
+    void drain_posted();
+    int run_timers();
+
+    int epoll_fd_;
+    int wake_fd_;
+    bool running_ = false;
+    std::unordered_map<int, std::shared_ptr<io_handler>> handlers_;
+
+    std::mutex post_mutex_;
+    std::vector<task> posted_;
+
+    std::priority_queue<timer_entry, std::vector<timer_entry>, std::greater<timer_entry>> timer_heap_;
+    std::unordered_map<timer_id, timer_state> timers_;
+    timer_id next_timer_id_ = 1;
+};
+
+} // namespace griddy
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace griddy {
+
+/**
+ * Log-linear latency histogram (16 sub-buckets per power of two, ~6%
+ * worst-case error). Values are unitless; the tools record microseconds.
+ */
+class histogram {
+public:
+    static constexpr int SUB_BUCKETS = 16;
+    static constexpr int BUCKETS = 64 * SUB_BUCKETS;
+
+    void record(int64_t value)
+    {
+        uint64_t v = value < 0 ? 0 : (uint64_t)value;
+        counts_[index_of(v)]++;
+        count_++;
+        sum_ += (double)v;
+        if (v > max_) max_ = v;
+        if (count_ == 1 || v < min_) min_ = v;
+    }
+
+    void merge(const histogram &other)
+    {
+        for (int i = 0; i < BUCKETS; i++) {
+            counts_[i] += other.counts_[i];
+        }
+        if (other.count_ && (count_ == 0 || other.min_ < min_)) min_ = other.min_;
+        if (other.max_ > max_) max_ = other.max_;
+        count_ += other.count_;
+        sum_ += other.sum_;
+    }
+
+    void reset() { *this = histogram(); }
+
+    uint64_t count() const { return count_; }
+    double mean() const { return count_ ? sum_ / (double)count_ : 0.0; }
+    uint64_t min() const { return min_; }
+    uint64_t max() const { return max_; }
+
+    /**
+     * @brief Value at quantile q (0..1), reported as the bucket upper bound
+     */
+    uint64_t percentile(double q) const
+    {
+        if (count_ == 0) {
+            return 0;
+        }
+        uint64_t rank = (uint64_t)std::ceil(q * (double)count_);
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            seen += counts_[i];
+            if (seen >= rank) {
+                uint64_t upper = value_of(i + 1) - 1;
+                return upper > max_ ? max_ : upper;
+            }
+        }
+        return max_;
+    }
+
+    /**
+     * @brief JSON object with count/mean/min/p50/p90/p99/p999/max
+     */
+    std::string to_json() const
+    {
+        char buf[256];
+        snprintf(buf, sizeof(buf),
+                 "{\"count\":%llu,\"mean\":%.1f,\"min\":%llu,\"p50\":%llu,\"p90\":%llu,"
+                 "\"p99\":%llu,\"p999\":%llu,\"max\":%llu}",
+                 (unsigned long long)count_, mean(), (unsigned long long)min_,
+                 (unsigned long long)percentile(0.50), (unsigned long long)percentile(0.90),
+                 (unsigned long long)percentile(0.99), (unsigned long long)percentile(0.999),
+                 (unsigned long long)max_);
+        return buf;
+    }
+
+private:
+    static int index_of(uint64_t v)
+    {
+        if (v < SUB_BUCKETS) {
+            return (int)v;
+        }
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - 4;
+        return (shift + 1) * SUB_BUCKETS + (int)((v >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    static uint64_t value_of(int index)
+    {
+        if (index < SUB_BUCKETS) {
+            return (uint64_t)index;
+        }
+        int shift = index / SUB_BUCKETS - 1;
+        int sub = index % SUB_BUCKETS;
+        return (uint64_t)(SUB_BUCKETS + sub) << shift;
+    }
+
+    uint64_t counts_[BUCKETS] = {};
+    uint64_t count_ = 0;
+    uint64_t min_ = 0;
+    uint64_t max_ = 0;
+    double sum_ = 0.0;
+};
+
+} // namespace griddy
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace griddy {
+
+/**
+ * @brief Monotonic clock in microseconds
+ */
+int64_t now_us();
+
+/**
+ * @brief Put a socket into non-blocking mode
+ */
+bool set_nonblocking(int fd);
+
+/**
+ * @brief Disable Nagle on a TCP socket
+ */
+bool set_nodelay(int fd);
+
+/**
+ * @brief Open a non-blocking listening socket on all interfaces
+ *
+ * @param port TCP port (0 picks an ephemeral port)
+ * @param reuse_port Set SO_REUSEPORT so several loops can share the port
+ * @param backlog listen() backlog
+ * @return Socket fd, or -1 on error
+ */
+int tcp_listen(uint16_t port, bool reuse_port, int backlog = 1024);
+
+/**
+ * @brief Local port a listening socket is bound to
+ */
+uint16_t local_port(int fd);
+
+/**
+ * @brief Start a non-blocking connect
+ *
+ * Completion is signalled by EPOLLOUT; check with connect_result().
+ *
+ * @return Socket fd, or -1 if the address could not be resolved
+ */
+int tcp_connect(const std::string &host, uint16_t port);
+
+/**
+ * @brief Pending error of a non-blocking connect (0 when connected)
+ */
+int connect_result(int fd);
+
+/**
+ * @brief Split "host:port", using default_port when no port is given
+ */
+bool parse_host_port(const std::string &spec, uint16_t default_port,
+                     std::string &host, uint16_t &port);
+
+/**
+ * @brief Raise RLIMIT_NOFILE soft limit towards the hard limit
+ *
+ * @return The resulting soft limit
+ */
+uint64_t raise_fd_limit(uint64_t wanted);
+
+} // namespace griddy
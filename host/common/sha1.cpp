@@ -0,0 +1,105 @@
+#include "sha1.hpp"
+
+#include <cstring>
+
+namespace griddy {
+
+static inline uint32_t rol(uint32_t value, int bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+static void sha1_block(uint32_t state[5], const uint8_t block[64])
+{
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+               ((uint32_t)block[i * 4 + 2] << 8) | (uint32_t)block[i * 4 + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t temp = rol(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rol(b, 30);
+        b = a;
+        a = temp;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+void sha1(const uint8_t *data, size_t len, uint8_t digest[20])
+{
+    uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    size_t full = len / 64;
+    for (size_t i = 0; i < full; i++) {
+        sha1_block(state, data + i * 64);
+    }
+
+    // Final block(s): remainder + 0x80 + zero pad + 64-bit big-endian bit length
+    uint8_t tail[128];
+    size_t rem = len - full * 64;
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, data + full * 64, rem);
+    tail[rem] = 0x80;
+    size_t tail_len = (rem + 9 <= 64) ? 64 : 128;
+    uint64_t bits = (uint64_t)len * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[tail_len - 1 - i] = (uint8_t)(bits >> (i * 8));
+    }
+    sha1_block(state, tail);
+    if (tail_len == 128) {
+        sha1_block(state, tail + 64);
+    }
+
+    for (int i = 0; i < 5; i++) {
+        digest[i * 4] = (uint8_t)(state[i] >> 24);
+        digest[i * 4 + 1] = (uint8_t)(state[i] >> 16);
+        digest[i * 4 + 2] = (uint8_t)(state[i] >> 8);
+        digest[i * 4 + 3] = (uint8_t)state[i];
+    }
+}
+
+std::string base64_encode(const uint8_t *data, size_t len)
+{
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((len + 2) / 3 * 4);
+
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t chunk = (uint32_t)data[i] << 16;
+        if (i + 1 < len) chunk |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < len) chunk |= data[i + 2];
+
+        out.push_back(table[(chunk >> 18) & 0x3F]);
+        out.push_back(table[(chunk >> 12) & 0x3F]);
+        out.push_back(i + 1 < len ? table[(chunk >> 6) & 0x3F] : '=');
+        out.push_back(i + 2 < len ? table[chunk & 0x3F] : '=');
+    }
+    return out;
+}
+
+} // namespace griddy
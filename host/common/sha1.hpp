@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace griddy {
+
+/**
+ * @brief SHA-1 digest (only used for the WebSocket handshake)
+ */
+void sha1(const uint8_t *data, size_t len, uint8_t digest[20]);
+
+std::string base64_encode(const uint8_t *data, size_t len);
+
+} // namespace griddy
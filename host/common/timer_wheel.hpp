@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace griddy {
+
+/**
+ * Hashed timer wheel for many periodic items on one thread.
+ *
+ * Deadlines hash into tick-sized slots; advance() only visits the slots
+ * between the previous and current tick, so scheduling is O(1) and a tick
+ * costs the number of items in its slot rather than a heap operation per
+ * item. Items whose deadline lies more than one revolution ahead stay in
+ * their slot until a later pass. Not thread-safe.
+ */
+template <typename T>
+class timer_wheel {
+public:
+    timer_wheel(int64_t tick_us, size_t slots, int64_t start_us)
+        : tick_us_(tick_us), slots_(slots), current_tick_(start_us / tick_us)
+    {
+    }
+
+    void schedule(int64_t deadline_us, T item)
+    {
+        int64_t tick = deadline_us / tick_us_;
+        if (tick < current_tick_) {
+            tick = current_tick_;
+        }
+        slots_[(size_t)tick % slots_.size()].push_back(entry{deadline_us, std::move(item)});
+        size_++;
+    }
+
+    /**
+     * @brief Fire every item due at now_us as fire(item, deadline_us)
+     *
+     * fire() may schedule() again; items rescheduled at or before now_us
+     * fire on the next advance().
+     */
+    template <typename F>
+    void advance(int64_t now_us, F &&fire)
+    {
+        int64_t now_tick = now_us / tick_us_;
+        int64_t last = now_tick;
+        if (last - current_tick_ >= (int64_t)slots_.size()) {
+            last = current_tick_ + (int64_t)slots_.size() - 1;
+        }
+
+        for (int64_t tick = current_tick_; tick <= last; tick++) {
+            std::vector<entry> &slot = slots_[(size_t)tick % slots_.size()];
+            if (slot.empty()) {
+                continue;
+            }
+            scratch_.clear();
+            scratch_.swap(slot);
+            for (entry &e : scratch_) {
+                if (e.deadline_us <= now_us) {
+                    size_--;
+                    fire(e.item, e.deadline_us);
+                } else {
+                    slot.push_back(std::move(e));
+                }
+            }
+        }
+        if (now_tick > current_tick_) {
+            current_tick_ = now_tick;
+        }
+    }
+
+    size_t size() const { return size_; }
+    int64_t tick_us() const { return tick_us_; }
+
+private:
+    struct entry {
+        int64_t deadline_us;
+        T item;
+    };
+
+    int64_t tick_us_;
+    std::vector<std::vector<entry>> slots_;
+    std::vector<entry> scratch_;
+    int64_t current_tick_;
+    size_t size_ = 0;
+};
+
+} // namespace griddy
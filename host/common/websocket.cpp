@@ -0,0 +1,273 @@
+#include "websocket.hpp"
+#include "sha1.hpp"
+
+#include <sys/types.h>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <random>
+
+namespace griddy {
+namespace ws {
+
+static const char *WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+size_t encode_header(uint8_t *out, uint8_t op, size_t payload_len, bool fin, const uint8_t *mask_key)
+{
+    size_t pos = 0;
+    out[pos++] = (uint8_t)((fin ? 0x80 : 0x00) | (op & 0x0F));
+
+    uint8_t mask_bit = mask_key ? 0x80 : 0x00;
+    if (payload_len < 126) {
+        out[pos++] = (uint8_t)(mask_bit | payload_len);
+    } else if (payload_len <= 0xFFFF) {
+        out[pos++] = (uint8_t)(mask_bit | 126);
+        out[pos++] = (uint8_t)(payload_len >> 8);
+        out[pos++] = (uint8_t)payload_len;
+    } else {
+        out[pos++] = (uint8_t)(mask_bit | 127);
+        for (int i = 7; i >= 0; i--) {
+            out[pos++] = (uint8_t)((uint64_t)payload_len >> (i * 8));
+        }
+    }
+
+    if (mask_key) {
+        memcpy(out + pos, mask_key, 4);
+        pos += 4;
+    }
+    return pos;
+}
+
+std::vector<uint8_t> encode_frame(uint8_t op, const uint8_t *payload, size_t len, bool mask)
+{
+    static thread_local std::mt19937 rng{std::random_device{}()};
+
+    uint8_t header[MAX_HEADER_SIZE];
+    uint8_t mask_key[4];
+    if (mask) {
+        uint32_t r = rng();
+        memcpy(mask_key, &r, 4);
+    }
+    size_t header_len = encode_header(header, op, len, true, mask ? mask_key : nullptr);
+
+    std::vector<uint8_t> frame(header_len + len);
+    memcpy(frame.data(), header, header_len);
+    if (len) {
+        memcpy(frame.data() + header_len, payload, len);
+    }
+    if (mask) {
+        uint8_t *p = frame.data() + header_len;
+        for (size_t i = 0; i < len; i++) {
+            p[i] ^= mask_key[i & 3];
+        }
+    }
+    return frame;
+}
+
+ssize_t frame_parser::parse(uint8_t *data, size_t len, const message_handler &handler)
+{
+    size_t consumed = 0;
+
+    while (len - consumed >= 2) {
+        uint8_t *p = data + consumed;
+        size_t avail = len - consumed;
+
+        bool fin = (p[0] & 0x80) != 0;
+        uint8_t op = p[0] & 0x0F;
+        bool masked = (p[1] & 0x80) != 0;
+        uint64_t payload_len = p[1] & 0x7F;
+        size_t header_len = 2;
+
+        if (payload_len == 126) {
+            if (avail < 4) break;
+            payload_len = ((uint64_t)p[2] << 8) | p[3];
+            header_len = 4;
+        } else if (payload_len == 127) {
+            if (avail < 10) break;
+            payload_len = 0;
+            for (int i = 0; i < 8; i++) {
+                payload_len = (payload_len << 8) | p[2 + i];
+            }
+            header_len = 10;
+        }
+        if (payload_len > max_message_) {
+            return -1;
+        }
+
+        const uint8_t *mask_key = nullptr;
+        if (masked) {
+            if (avail < header_len + 4) break;
+            mask_key = p + header_len;
+            header_len += 4;
+        }
+        if (avail < header_len + payload_len) {
+            break;
+        }
+
+        uint8_t *payload = p + header_len;
+        if (mask_key) {
+            for (size_t i = 0; i < payload_len; i++) {
+                payload[i] ^= mask_key[i & 3];
+            }
+        }
+        consumed += header_len + payload_len;
+
+        if (op >= OP_CLOSE) {
+            // Control frames may interleave with fragments
+            handler(op, payload, (size_t)payload_len);
+        } else if (op == OP_CONTINUATION) {
+            if (fragment_op_ == 0) {
+                return -1;
+            }
+            if (fragments_.size() + payload_len > max_message_) {
+                return -1;
+            }
+            fragments_.insert(fragments_.end(), payload, payload + payload_len);
+            if (fin) {
+                handler(fragment_op_, fragments_.data(), fragments_.size());
+                fragments_.clear();
+                fragment_op_ = 0;
+            }
+        } else if (!fin) {
+            fragment_op_ = op;
+            fragments_.assign(payload, payload + payload_len);
+        } else {
+            handler(op, payload, (size_t)payload_len);
+        }
+    }
+    return (ssize_t)consumed;
+}
+
+std::string request_target::get(const std::string &key, const std::string &fallback) const
+{
+    auto it = query.find(key);
+    return it == query.end() ? fallback : it->second;
+}
+
+request_target parse_target(const std::string &target)
+{
+    request_target out;
+    size_t q = target.find('?');
+    out.path = target.substr(0, q);
+    if (q == std::string::npos) {
+        return out;
+    }
+
+    std::string rest = target.substr(q + 1);
+    size_t start = 0;
+    while (start <= rest.size()) {
+        size_t amp = rest.find('&', start);
+        std::string pair = rest.substr(start, amp == std::string::npos ? std::string::npos : amp - start);
+        if (!pair.empty()) {
+            size_t eq = pair.find('=');
+            if (eq == std::string::npos) {
+                out.query[pair] = "";
+            } else {
+                out.query[pair.substr(0, eq)] = pair.substr(eq + 1);
+            }
+        }
+        if (amp == std::string::npos) {
+            break;
+        }
+        start = amp + 1;
+    }
+    return out;
+}
+
+static std::string trim(const std::string &s)
+{
+    size_t b = s.find_first_not_of(" \t\r");
+    size_t e = s.find_last_not_of(" \t\r");
+    return b == std::string::npos ? "" : s.substr(b, e - b + 1);
+}
+
+bool parse_http_request(const std::string &head, http_request &req)
+{
+    size_t line_end = head.find("\r\n");
+    if (line_end == std::string::npos) {
+        return false;
+    }
+
+    std::string request_line = head.substr(0, line_end);
+    size_t sp1 = request_line.find(' ');
+    size_t sp2 = request_line.find(' ', sp1 + 1);
+    if (sp1 == std::string::npos || sp2 == std::string::npos) {
+        return false;
+    }
+    req.method = request_line.substr(0, sp1);
+    req.target = request_line.substr(sp1 + 1, sp2 - sp1 - 1);
+
+    size_t pos = line_end + 2;
+    while (pos < head.size()) {
+        size_t end = head.find("\r\n", pos);
+        if (end == std::string::npos) {
+            end = head.size();
+        }
+        std::string line = head.substr(pos, end - pos);
+        pos = end + 2;
+        if (line.empty()) {
+            break;
+        }
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+        req.headers[name] = trim(line.substr(colon + 1));
+    }
+    return true;
+}
+
+std::string accept_key(const std::string &client_key)
+{
+    std::string input = client_key + WS_GUID;
+    uint8_t digest[20];
+    sha1((const uint8_t *)input.data(), input.size(), digest);
+    return base64_encode(digest, sizeof(digest));
+}
+
+std::string server_handshake(const std::string &client_key)
+{
+    return "HTTP/1.1 101 Switching Protocols\r\n"
+           "Upgrade: websocket\r\n"
+           "Connection: Upgrade\r\n"
+           "Sec-WebSocket-Accept: " + accept_key(client_key) + "\r\n\r\n";
+}
+
+std::string client_handshake(const std::string &host, uint16_t port, const std::string &target,
+                             std::string &key_out)
+{
+    static thread_local std::mt19937 rng{std::random_device{}()};
+    uint8_t nonce[16];
+    for (auto &b : nonce) {
+        b = (uint8_t)rng();
+    }
+    key_out = base64_encode(nonce, sizeof(nonce));
+
+    return "GET " + target + " HTTP/1.1\r\n"
+           "Host: " + host + ":" + std::to_string(port) + "\r\n"
+           "Upgrade: websocket\r\n"
+           "Connection: Upgrade\r\n"
+           "Sec-WebSocket-Key: " + key_out + "\r\n"
+           "Sec-WebSocket-Version: 13\r\n\r\n";
+}
+
+bool check_server_handshake(const std::string &head, const std::string &key)
+{
+    if (head.compare(0, 12, "HTTP/1.1 101") != 0) {
+        return false;
+    }
+    std::string expected = accept_key(key);
+    std::string lower = head;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    size_t pos = lower.find("sec-websocket-accept:");
+    if (pos == std::string::npos) {
+        return false;
+    }
+    size_t end = head.find("\r\n", pos);
+    return trim(head.substr(pos + 21, end - pos - 21)) == expected;
+}
+
+} // namespace ws
+} // namespace griddy
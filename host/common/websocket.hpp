@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace griddy {
+namespace ws {
+
+enum opcode : uint8_t {
+    OP_CONTINUATION = 0x0,
+    OP_TEXT = 0x1,
+    OP_BINARY = 0x2,
+    OP_CLOSE = 0x8,
+    OP_PING = 0x9,
+    OP_PONG = 0xA,
+};
+
+constexpr size_t MAX_HEADER_SIZE = 14;
+
+/**
+ * @brief Write a frame header
+ *
+ * @param out At least MAX_HEADER_SIZE bytes
+ * @param mask_key Client frames pass a 4-byte key; server frames pass nullptr
+ * @return Header length in bytes
+ */
+size_t encode_header(uint8_t *out, uint8_t op, size_t payload_len, bool fin, const uint8_t *mask_key);
+
+/**
+ * @brief Build a complete frame (header + payload, masked when mask is true)
+ */
+std::vector<uint8_t> encode_frame(uint8_t op, const uint8_t *payload, size_t len, bool mask);
+
+/**
+ * Incremental frame parser. Payloads are unmasked in place and fragmented
+ * messages are reassembled; control frames are delivered as they arrive.
+ */
+class frame_parser {
+public:
+    using message_handler = std::function<void(uint8_t op, const uint8_t *data, size_t len)>;
+
+    explicit frame_parser(size_t max_message = 1 << 20) : max_message_(max_message) {}
+
+    /**
+     * @brief Consume complete frames from data
+     *
+     * @return Bytes consumed, or -1 on protocol error
+     */
+    ssize_t parse(uint8_t *data, size_t len, const message_handler &handler);
+
+private:
+    size_t max_message_;
+    uint8_t fragment_op_ = 0;
+    std::vector<uint8_t> fragments_;
+};
+
+struct request_target {
+    std::string path;
+    std::map<std::string, std::string> query;
+
+    std::string get(const std::string &key, const std::string &fallback = "") const;
+};
+
+request_target parse_target(const std::string &target);
+
+struct http_request {
+    std::string method;
+    std::string target;
+    std::map<std::string, std::string> headers;  // Lower-case names
+};
+
+/**
+ * @brief Parse an HTTP/1.1 request head (up to the blank line)
+ */
+bool parse_http_request(const std::string &head, http_request &req);
+
+std::string accept_key(const std::string &client_key);
+std::string server_handshake(const std::string &client_key);
+std::string client_handshake(const std::string &host, uint16_t port, const std::string &target,
+                             std::string &key_out);
+bool check_server_handshake(const std::string &head, const std::string &key);
+
+} // namespace ws
+} // namespace griddy
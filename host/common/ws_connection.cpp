@@ -0,0 +1,372 @@
+#include "ws_connection.hpp"
+#include "net.hpp"
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+#include <cstring>
+
+namespace griddy {
+
+static constexpr size_t READ_CHUNK = 16384;
+static constexpr size_t MAX_HANDSHAKE = 8192;
+
+ws_connection::ws_connection(event_loop &loop, int fd, framing mode, bool client, handlers h)
+    : loop_(loop), fd_(fd), mode_(mode), client_(client),
+      state_(client ? state::connecting : state::handshake), handlers_(std::move(h))
+{
+}
+
+ws_connection::~ws_connection()
+{
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+ws_connection::ptr ws_connection::accept(event_loop &loop, int fd, framing mode, handlers h)
+{
+    set_nonblocking(fd);
+    set_nodelay(fd);
+    ptr conn(new ws_connection(loop, fd, mode, false, std::move(h)));
+    conn->register_io(EPOLLIN | EPOLLRDHUP);
+    return conn;
+}
+
+ws_connection::ptr ws_connection::connect(event_loop &loop, const std::string &host, uint16_t port,
+                                          const std::string &target, handlers h)
+{
+    int fd = tcp_connect(host, port);
+    if (fd < 0) {
+        return nullptr;
+    }
+    set_nodelay(fd);
+    ptr conn(new ws_connection(loop, fd, framing::websocket, true, std::move(h)));
+    conn->host_ = host;
+    conn->port_ = port;
+    conn->target_ = ws::parse_target(target);
+    conn->request_ = target;
+    conn->register_io(EPOLLOUT | EPOLLRDHUP);
+    return conn;
+}
+
+void ws_connection::register_io(uint32_t events)
+{
+    ptr self = shared_from_this();
+    loop_.add(fd_, events, [self](uint32_t ev) { self->on_io(ev); });
+}
+
+ws_connection::buffer ws_connection::encode_shared(framing mode, uint8_t op, const uint8_t *data, size_t len)
+{
+    if (mode == framing::length_prefixed) {
+        auto out = std::make_shared<std::vector<uint8_t>>(4 + len);
+        uint32_t n = (uint32_t)len;
+        memcpy(out->data(), &n, 4);
+        if (len) {
+            memcpy(out->data() + 4, data, len);
+        }
+        return out;
+    }
+    return std::make_shared<const std::vector<uint8_t>>(ws::encode_frame(op, data, len, false));
+}
+
+bool ws_connection::send(uint8_t op, const uint8_t *data, size_t len)
+{
+    if (state_ != state::open) {
+        return false;
+    }
+    if (client_) {
+        return queue(std::make_shared<const std::vector<uint8_t>>(ws::encode_frame(op, data, len, true)));
+    }
+    return queue(encode_shared(mode_, op, data, len));
+}
+
+bool ws_connection::send_encoded(const buffer &frame)
+{
+    if (state_ != state::open || client_) {
+        return false;
+    }
+    return queue(frame);
+}
+
+bool ws_connection::queue(buffer data)
+{
+    if (queued_bytes_ + data->size() > max_queue_) {
+        return false;
+    }
+    queued_bytes_ += data->size();
+    wqueue_.push_back(segment{std::move(data), 0});
+    if (!want_write_) {
+        // Try to write immediately; only arm EPOLLOUT if the socket is full
+        if (!flush()) {
+            return false;
+        }
+        update_interest();
+    }
+    return true;
+}
+
+bool ws_connection::flush()
+{
+    while (!wqueue_.empty()) {
+        struct iovec iov[16];
+        int count = 0;
+        for (auto it = wqueue_.begin(); it != wqueue_.end() && count < 16; ++it, ++count) {
+            iov[count].iov_base = (void *)(it->data->data() + it->offset);
+            iov[count].iov_len = it->data->size() - it->offset;
+        }
+
+        ssize_t n = writev(fd_, iov, count);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            close();
+            return false;
+        }
+
+        bytes_sent_ += (uint64_t)n;
+        queued_bytes_ -= (size_t)n;
+        size_t left = (size_t)n;
+        while (left > 0) {
+            segment &front = wqueue_.front();
+            size_t remaining = front.data->size() - front.offset;
+            if (left >= remaining) {
+                left -= remaining;
+                wqueue_.pop_front();
+            } else {
+                front.offset += left;
+                left = 0;
+            }
+        }
+    }
+    return true;
+}
+
+void ws_connection::update_interest()
+{
+    if (state_ == state::closed) {
+        return;
+    }
+    bool want = !wqueue_.empty();
+    if (want != want_write_) {
+        want_write_ = want;
+        loop_.modify(fd_, EPOLLIN | EPOLLRDHUP | (want ? (uint32_t)EPOLLOUT : 0u));
+    }
+}
+
+void ws_connection::close()
+{
+    if (state_ == state::closed) {
+        return;
+    }
+    bool was_open = state_ == state::open;
+    state_ = state::closed;
+
+    ptr self = shared_from_this();  // Keep alive until the end of this call
+    loop_.remove(fd_);
+    ::shutdown(fd_, SHUT_RDWR);
+    wqueue_.clear();
+    queued_bytes_ = 0;
+
+    if (handlers_.on_close && (was_open || client_)) {
+        handlers_.on_close(*this);
+    }
+}
+
+void ws_connection::on_io(uint32_t events)
+{
+    if (state_ == state::connecting) {
+        if (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) {
+            on_connected();
+        }
+        return;
+    }
+    if (events & EPOLLIN) {
+        on_readable();
+    }
+    if (state_ == state::closed) {
+        return;
+    }
+    if (events & EPOLLOUT) {
+        if (flush()) {
+            update_interest();
+        }
+    }
+    if (state_ != state::closed && (events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) && !(events & EPOLLIN)) {
+        close();
+    }
+}
+
+void ws_connection::on_connected()
+{
+    if (connect_result(fd_) != 0) {
+        close();
+        return;
+    }
+    state_ = state::handshake;
+    std::string req = ws::client_handshake(host_, port_, request_, client_key_);
+    ssize_t n = ::send(fd_, req.data(), req.size(), MSG_NOSIGNAL);
+    if (n != (ssize_t)req.size()) {
+        close();
+        return;
+    }
+    loop_.modify(fd_, EPOLLIN | EPOLLRDHUP);
+}
+
+void ws_connection::on_readable()
+{
+    while (state_ != state::closed) {
+        size_t old_size = rbuf_.size();
+        rbuf_.resize(old_size + READ_CHUNK);
+        ssize_t n = ::recv(fd_, rbuf_.data() + old_size, READ_CHUNK, 0);
+        if (n <= 0) {
+            rbuf_.resize(old_size);
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            close();
+            return;
+        }
+        rbuf_.resize(old_size + (size_t)n);
+        bytes_received_ += (uint64_t)n;
+
+        if (state_ == state::handshake && !process_handshake()) {
+            continue;
+        }
+        if (state_ == state::open) {
+            process_frames();
+        }
+        if ((size_t)n < READ_CHUNK) {
+            break;
+        }
+    }
+}
+
+bool ws_connection::process_handshake()
+{
+    std::string head;
+    size_t consumed = 0;
+
+    if (mode_ == framing::length_prefixed) {
+        auto nl = std::find(rbuf_.begin(), rbuf_.end(), (uint8_t)'\n');
+        if (nl == rbuf_.end()) {
+            if (rbuf_.size() > MAX_HANDSHAKE) close();
+            return false;
+        }
+        head.assign(rbuf_.begin(), nl);
+        consumed = (size_t)(nl - rbuf_.begin()) + 1;
+        if (!head.empty() && head.back() == '\r') {
+            head.pop_back();
+        }
+        if (head.compare(0, 4, "SUB ") != 0) {
+            close();
+            return false;
+        }
+        target_ = ws::parse_target(head.substr(4));
+    } else {
+        static const char terminator[] = "\r\n\r\n";
+        auto end = std::search(rbuf_.begin(), rbuf_.end(), terminator, terminator + 4);
+        if (end == rbuf_.end()) {
+            if (rbuf_.size() > MAX_HANDSHAKE) close();
+            return false;
+        }
+        consumed = (size_t)(end - rbuf_.begin()) + 4;
+        head.assign(rbuf_.begin(), rbuf_.begin() + consumed);
+
+        if (client_) {
+            if (!ws::check_server_handshake(head, client_key_)) {
+                close();
+                return false;
+            }
+        } else {
+            ws::http_request req;
+            auto key = req.headers.end();
+            if (ws::parse_http_request(head, req)) {
+                key = req.headers.find("sec-websocket-key");
+            }
+            if (key == req.headers.end()) {
+                static const char bad[] = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+                ssize_t ignored = ::send(fd_, bad, sizeof(bad) - 1, MSG_NOSIGNAL);
+                (void)ignored;
+                close();
+                return false;
+            }
+            target_ = ws::parse_target(req.target);
+            client_key_ = key->second;
+        }
+    }
+
+    rbuf_.erase(rbuf_.begin(), rbuf_.begin() + consumed);
+
+    if (!client_ && handlers_.on_open && !handlers_.on_open(*this)) {
+        if (mode_ == framing::websocket) {
+            static const char reject[] = "HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\n\r\n";
+            ssize_t ignored = ::send(fd_, reject, sizeof(reject) - 1, MSG_NOSIGNAL);
+            (void)ignored;
+        }
+        close();
+        return false;
+    }
+
+    state_ = state::open;
+    if (!client_ && mode_ == framing::websocket) {
+        std::string resp = ws::server_handshake(client_key_);
+        queue(std::make_shared<const std::vector<uint8_t>>(resp.begin(), resp.end()));
+    }
+    if (client_ && handlers_.on_open) {
+        handlers_.on_open(*this);
+    }
+    return true;
+}
+
+void ws_connection::process_frames()
+{
+    ptr self = shared_from_this();
+    size_t consumed = 0;
+
+    if (mode_ == framing::length_prefixed) {
+        while (rbuf_.size() - consumed >= 4 && state_ == state::open) {
+            uint32_t len;
+            memcpy(&len, rbuf_.data() + consumed, 4);
+            if (len > (1u << 20)) {
+                close();
+                return;
+            }
+            if (rbuf_.size() - consumed < 4 + (size_t)len) {
+                break;
+            }
+            if (handlers_.on_message) {
+                handlers_.on_message(*this, ws::OP_BINARY, rbuf_.data() + consumed + 4, len);
+            }
+            consumed += 4 + len;
+        }
+    } else {
+        ssize_t n = parser_.parse(rbuf_.data(), rbuf_.size(), [this](uint8_t op, const uint8_t *data, size_t len) {
+            if (state_ != state::open) {
+                return;
+            }
+            if (op == ws::OP_PING) {
+                send(ws::OP_PONG, data, len);
+            } else if (op == ws::OP_CLOSE) {
+                send(ws::OP_CLOSE, data, len < 2 ? len : 2);
+                close();
+            } else if (op != ws::OP_PONG && handlers_.on_message) {
+                handlers_.on_message(*this, op, data, len);
+            }
+        });
+        if (n < 0) {
+            close();
+            return;
+        }
+        consumed = (size_t)n;
+    }
+
+    if (state_ != state::closed && consumed > 0) {
+        rbuf_.erase(rbuf_.begin(), rbuf_.begin() + consumed);
+    }
+}
+
+} // namespace griddy
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "event_loop.hpp"
+#include "websocket.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace griddy {
+
+/**
+ * One non-blocking stream connection bound to an event_loop.
+ *
+ * Speaks either WebSocket (server or client side) or a raw length-prefixed
+ * framing for plain TCP consumers: the client sends one "SUB <target>\n"
+ * line, then both sides exchange [uint32 LE length][payload] records.
+ *
+ * Outgoing data is a queue of shared, pre-encoded buffers so a frame that
+ * fans out to thousands of connections is encoded exactly once.
+ */
+class ws_connection : public std::enable_shared_from_this<ws_connection> {
+public:
+    enum class framing { websocket, length_prefixed };
+
+    using ptr = std::shared_ptr<ws_connection>;
+    using buffer = std::shared_ptr<const std::vector<uint8_t>>;
+
+    struct handlers {
+        // Server: request target is known, return false to reject.
+        // Client: handshake completed.
+        std::function<bool(ws_connection &)> on_open;
+        std::function<void(ws_connection &, uint8_t op, const uint8_t *data, size_t len)> on_message;
+        std::function<void(ws_connection &)> on_close;
+    };
+
+    static ptr accept(event_loop &loop, int fd, framing mode, handlers h);
+    static ptr connect(event_loop &loop, const std::string &host, uint16_t port,
+                       const std::string &target, handlers h);
+
+    /**
+     * @brief Encode a server-side frame once for sending to many connections
+     */
+    static buffer encode_shared(framing mode, uint8_t op, const uint8_t *data, size_t len);
+
+    bool send(uint8_t op, const uint8_t *data, size_t len);
+    bool send_binary(const uint8_t *data, size_t len) { return send(ws::OP_BINARY, data, len); }
+
+    /**
+     * @brief Queue a buffer from encode_shared() (server side only)
+     */
+    bool send_encoded(const buffer &frame);
+
+    void close();
+
+    bool is_open() const { return state_ == state::open; }
+    framing mode() const { return mode_; }
+    int fd() const { return fd_; }
+    const ws::request_target &target() const { return target_; }
+    size_t queued_bytes() const { return queued_bytes_; }
+    uint64_t bytes_sent() const { return bytes_sent_; }
+    uint64_t bytes_received() const { return bytes_received_; }
+
+    /**
+     * @brief Limit on queued outgoing bytes; send() fails beyond it
+     */
+    void set_max_queue(size_t bytes) { max_queue_ = bytes; }
+
+    // Owner-defined per-connection state
+    std::shared_ptr<void> user;
+
+    ~ws_connection();
+
+private:
+    enum class state { connecting, handshake, open, closed };
+
+    ws_connection(event_loop &loop, int fd, framing mode, bool client, handlers h);
+
+    void register_io(uint32_t events);
+    void on_io(uint32_t events);
+    void on_readable();
+    void on_connected();
+    bool process_handshake();
+    void process_frames();
+    bool queue(buffer data);
+    bool flush();
+    void update_interest();
+
+    event_loop &loop_;
+    int fd_;
+    framing mode_;
+    bool client_;
+    state state_;
+    handlers handlers_;
+
+    ws::request_target target_;
+    std::string client_key_;
+    std::string host_;
+    uint16_t port_ = 0;
+    std::string request_;
+
+    std::vector<uint8_t> rbuf_;
+    ws::frame_parser parser_;
+
+    struct segment {
+        buffer data;
+        size_t offset;
+    };
+    std::deque<segment> wqueue_;
+    size_t queued_bytes_ = 0;
+    size_t max_queue_ = 4 << 20;
+    bool want_write_ = false;
+
+    uint64_t bytes_sent_ = 0;
+    uint64_t bytes_received_ = 0;
+};
+
+} // namespace griddy
@@ -0,0 +1,646 @@
+#include "fleet_sim.hpp"
+#include "actuator.h"
+#include "binary_protocol.h"
+#include "grid_model.h"
+#include "shm_ring.h"
+#include "telemetry_json.h"
+#include "net.hpp"
+#include "timer_wheel.hpp"
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace griddy {
+
+#define FLEET_TAG "[fleet]"
+
+static constexpr size_t WHEEL_SLOTS = 4096;
+static constexpr size_t MAX_REQUEST_PEEK = 2048;
+static constexpr double ACTUATION_FRACTION = 0.10;
+static constexpr double SETTLING_BAND = 0.05;
+
+struct fleet_sim::device {
+    int id = 0;
+    shard *owner = nullptr;
+    int listen_fd = -1;
+    uint16_t port = 0;
+    int64_t period_us = 0;
+    int64_t boot_us = 0;                        // Host time the device clock reads 0
+    double clock_rate = 1.0;                    // Device µs per host µs
+
+    grid_model_t model;
+    std::vector<uint16_t> duties;               // Actuator output per node, index = id - 1
+    actuator_mock_t actuator_mock;
+    actuator_driver_t actuator;                 // Mock driver over duties, batch per frame
+    std::vector<actuator_setpoint_t> pending;   // Setpoints of the frame being decoded
+    std::vector<ws_connection::ptr> out_clients;
+    std::vector<ws_connection::ptr> json_clients;   // /out.json, counted against max_out_clients too
+    std::vector<ws_connection::ptr> in_clients;
+
+    uint32_t dispatch_seq = 0;                  // Echoed in acks, like the firmware
+    int64_t last_frame_us = 0;
+    bool awaiting_dispatch = false;             // Frame sent, no dispatch seen since
+    uint64_t frames_sent = 0;
+    uint64_t dispatches = 0;
+    std::unique_ptr<histogram> dispatch_latency; // Allocated on first dispatch
+    shm_ring_t ring{};                          // Co-located readers; header NULL when off
+
+    // Demand step response
+    int64_t step_sent_us = 0;                   // First frame carrying the step
+    float pre_step_supply = 0.0f;               // Mean supply when the step went out
+    std::vector<std::pair<int64_t, float>> step_trace; // (µs after step, mean supply)
+
+    // The telemetry clock, as esp_timer_get_time() on the firmware
+    uint64_t clock_us(int64_t host_us) const
+    {
+        return (uint64_t)((double)(host_us - boot_us) * clock_rate);
+    }
+
+    float mean_supply() const
+    {
+        float sum = 0.0f;
+        for (uint16_t duty : duties) sum += (float)duty / ACTUATOR_DUTY_MAX;
+        return duties.empty() ? 0.0f : sum / (float)duties.size();
+    }
+
+    ~device()
+    {
+        if (listen_fd >= 0) close(listen_fd);
+        shm_ring_destroy(&ring);
+    }
+};
+
+struct fleet_sim::shard {
+    fleet_sim *owner = nullptr;
+    event_loop loop;
+    std::thread thread;
+    timer_wheel<device *> wheel;
+    std::vector<device *> devices;
+    histogram tick_lateness;                    // Wheel firing time minus due time
+    histogram dispatch_latency;                 // Merged over this shard's devices
+    std::vector<uint8_t> frame;
+    std::vector<char> json_frame;
+
+    shard(int64_t tick_us, int64_t start_us)
+        : wheel(tick_us, WHEEL_SLOTS, start_us), frame(telemetry_max_packet_size(255)),
+          json_frame(telemetry_json_max_size(255))
+    {
+    }
+
+    void accept_all(device &dev)
+    {
+        while (true) {
+            int fd = accept4(dev.listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && owner->config_.verbose) {
+                    perror(FLEET_TAG " accept");
+                }
+                return;
+            }
+            attach(dev, fd);
+        }
+    }
+
+    void attach(device &dev, int fd)
+    {
+        device *dp = &dev;
+        ws_connection::handlers h;
+        h.on_open = [this, dp](ws_connection &conn) { return on_open(*dp, conn); };
+        h.on_message = [this, dp](ws_connection &conn, uint8_t op, const uint8_t *data, size_t len) {
+            if (op == ws::OP_BINARY && conn.target().path == "/in") {
+                on_dispatch(*dp, conn, data, len);
+            } else if (op == ws::OP_BINARY) {
+                on_out_message(*dp, conn, data, len);
+            }
+        };
+        h.on_close = [this, dp](ws_connection &conn) { on_close(*dp, conn); };
+        ws_connection::accept(loop, fd, ws_connection::framing::websocket, std::move(h));
+    }
+
+    bool on_open(device &dev, ws_connection &conn)
+    {
+        const ws::request_target &target = conn.target();
+        if (owner->config_.shared_port && strtol(target.get("device", "-1").c_str(), nullptr, 10) != dev.id) {
+            return false;
+        }
+        ws_connection::ptr self = conn.shared_from_this();
+        if (target.path == "/out" || target.path == "/out.json") {
+            if ((int)(dev.out_clients.size() + dev.json_clients.size()) >= owner->config_.max_out_clients) {
+                return false;
+            }
+            (target.path == "/out" ? dev.out_clients : dev.json_clients).push_back(self);
+            owner->counters_.out_clients++;
+            return true;
+        }
+        if (target.path == "/in") {
+            dev.in_clients.push_back(self);
+            owner->counters_.in_clients++;
+            return true;
+        }
+        return false;
+    }
+
+    void on_close(device &dev, ws_connection &conn)
+    {
+        auto drop = [&conn](std::vector<ws_connection::ptr> &list) {
+            auto it = std::find_if(list.begin(), list.end(),
+                                   [&conn](const ws_connection::ptr &p) { return p.get() == &conn; });
+            if (it == list.end()) {
+                return false;
+            }
+            *it = list.back();
+            list.pop_back();
+            return true;
+        };
+        if (drop(dev.out_clients) || drop(dev.json_clients)) {
+            owner->counters_.out_clients--;
+        } else if (drop(dev.in_clients)) {
+            owner->counters_.in_clients--;
+        }
+    }
+
+    // Credits are not modelled; clock sync pings are answered
+    void on_out_message(device &dev, ws_connection &conn, const uint8_t *data, size_t len)
+    {
+        int64_t received = now_us();
+        time_sync_t sync;
+        if (!decode_time_sync(data, len, &sync) || sync.magic != TIME_SYNC_MAGIC) {
+            return;
+        }
+        uint8_t reply[TIME_SYNC_REPLY_SIZE];
+        sync.magic = TIME_SYNC_REPLY_MAGIC;
+        sync.receive_us = dev.clock_us(received);
+        sync.transmit_us = dev.clock_us(now_us());
+        conn.send_binary(reply, encode_time_sync(&sync, reply));
+        owner->counters_.time_syncs++;
+    }
+
+    void on_dispatch(device &dev, ws_connection &conn, const uint8_t *data, size_t len)
+    {
+        int64_t now = now_us();
+        dispatch_ack_t ack = {};
+        uint8_t ack_buf[DISPATCH_ACK_SIZE];
+
+        // Same streaming decoder as the firmware: DISP and dense DDSP frames,
+        // setpoints collected as nodes decode and applied as one batch
+        dispatch_stream_t stream;
+        dev.pending.clear();
+        dispatch_stream_begin(
+            &stream,
+            [](const dispatch_node_t *node, void *ctx) {
+                float supply = std::min(1.0f, std::max(0.0f, node->supply));
+                static_cast<device *>(ctx)->pending.push_back(
+                    {(uint16_t)(node->id - 1), (uint16_t)(supply * ACTUATOR_DUTY_MAX)});
+            },
+            [](uint16_t node_id, uint16_t duty, void *ctx) {
+                static_cast<device *>(ctx)->pending.push_back({(uint16_t)(node_id - 1), duty});
+            },
+            &dev);
+        dispatch_stream_feed(&stream, data, len);
+        actuator_apply(&dev.actuator, dev.pending.data(), (int)dev.pending.size());
+        for (const actuator_setpoint_t &sp : dev.pending) {
+            grid_model_set_supply(&dev.model, sp.output, sp.duty * (1.0f / ACTUATOR_DUTY_MAX));
+        }
+
+        ack.seq = ++dev.dispatch_seq;
+        ack.applied = stream.nodes_done > 255 ? 255 : (uint8_t)stream.nodes_done;
+        if (dispatch_stream_end(&stream) != DISPATCH_STREAM_DONE) {
+            owner->counters_.dispatch_invalid++;
+            ack.status = DISPATCH_ACK_INVALID;
+            conn.send_binary(ack_buf, encode_dispatch_ack(&ack, ack_buf));
+            return;
+        }
+        owner->counters_.dispatch_received++;
+        dev.dispatches++;
+
+        ack.status = DISPATCH_ACK_APPLIED;
+        conn.send_binary(ack_buf, encode_dispatch_ack(&ack, ack_buf));
+
+        if (dev.step_sent_us) {
+            dev.step_trace.emplace_back(now - dev.step_sent_us, dev.mean_supply());
+        }
+
+        // Only the first dispatch after a frame counts as its response
+        if (dev.awaiting_dispatch) {
+            dev.awaiting_dispatch = false;
+            if (!dev.dispatch_latency) {
+                dev.dispatch_latency = std::make_unique<histogram>();
+            }
+            dev.dispatch_latency->record(now - dev.last_frame_us);
+            dispatch_latency.record(now - dev.last_frame_us);
+        }
+    }
+
+    void on_tick()
+    {
+        int64_t now = now_us();
+        wheel.advance(now, [this, now](device *dev, int64_t due_us) {
+            tick_device(*dev, due_us, now);
+        });
+    }
+
+    void tick_device(device &dev, int64_t due_us, int64_t now)
+    {
+        tick_lateness.record(now - due_us);
+
+        // Keep the device's phase unless the loop fell a whole period behind
+        int64_t next = due_us + dev.period_us;
+        if (next <= now) {
+            owner->counters_.ticks_late++;
+            next = now + dev.period_us;
+        }
+        wheel.schedule(next, &dev);
+
+        bool ring = dev.ring.header != nullptr;
+        if (dev.out_clients.empty() && dev.json_clients.empty() && !ring) {
+            owner->counters_.frames_skipped++;
+            return;
+        }
+
+        const fleet_config &config = owner->config_;
+        bool step_due = config.step_at_s > 0 && now - owner->start_us_ >= (int64_t)(config.step_at_s * 1e6);
+        if (step_due) {
+            dev.model.demand_offset = config.step_amps;
+        }
+        grid_model_update(&dev.model, (int64_t)dev.clock_us(now));
+
+        // Each format is encoded once per tick and shared by its subscribers
+        auto send_all = [&](std::vector<ws_connection::ptr> &clients, uint8_t op, const void *data, size_t len) {
+            if (clients.empty() || len == 0) {
+                return;
+            }
+            ws_connection::buffer encoded = ws_connection::encode_shared(
+                ws_connection::framing::websocket, op, static_cast<const uint8_t *>(data), len);
+            for (size_t i = 0; i < clients.size(); i++) {
+                if (clients[i]->send_encoded(encoded)) {
+                    owner->counters_.frames_sent++;
+                    dev.frames_sent++;
+                } else {
+                    owner->counters_.send_failed++;
+                }
+            }
+        };
+        if (ring) {
+            uint8_t *slot = shm_ring_begin(&dev.ring);
+            size_t len = grid_model_encode(&dev.model, slot);
+            shm_ring_commit(&dev.ring, len);
+            owner->counters_.frames_shm++;
+            send_all(dev.out_clients, ws::OP_BINARY, slot, len);
+        } else if (!dev.out_clients.empty()) {
+            send_all(dev.out_clients, ws::OP_BINARY, frame.data(), grid_model_encode(&dev.model, frame.data()));
+        }
+        if (!dev.json_clients.empty()) {
+            size_t len = grid_model_encode_json(dev.model.nodes, dev.model.node_count, dev.model.timestamp_us,
+                                                json_frame.data(), json_frame.size());
+            send_all(dev.json_clients, ws::OP_TEXT, json_frame.data(), len);
+        }
+        dev.last_frame_us = now;
+        dev.awaiting_dispatch = true;
+        if (step_due && dev.step_sent_us == 0) {
+            dev.step_sent_us = now;
+            dev.pre_step_supply = dev.mean_supply();
+        }
+    }
+};
+
+namespace {
+
+/*
+ * Derive time-to-actuation and settling time from a device's step trace.
+ * The settled level is the mean of the last quarter of the trace, so runs
+ * should last well past the expected settling time.
+ */
+bool step_response(const std::vector<std::pair<int64_t, float>> &trace, float before,
+                   int64_t &actuation_us, int64_t &settling_us)
+{
+    if (trace.size() < 4) {
+        return false;
+    }
+    size_t tail = trace.size() / 4;
+    double settled = 0.0;
+    for (size_t i = trace.size() - tail; i < trace.size(); i++) {
+        settled += trace[i].second;
+    }
+    settled /= (double)tail;
+
+    double delta = settled - before;
+    if (std::fabs(delta) < 1e-3) {
+        return false;  // Supply never moved
+    }
+
+    actuation_us = -1;
+    settling_us = 0;
+    for (const auto &sample : trace) {
+        double moved = (sample.second - before) / delta;
+        if (actuation_us < 0 && moved >= ACTUATION_FRACTION) {
+            actuation_us = sample.first;
+        }
+        if (std::fabs(sample.second - settled) > SETTLING_BAND * std::fabs(delta)) {
+            settling_us = -1;  // Outside the band: settle at the next sample inside
+        } else if (settling_us < 0) {
+            settling_us = sample.first;
+        }
+    }
+    return actuation_us >= 0 && settling_us >= 0;
+}
+
+} // namespace
+
+fleet_sim::fleet_sim(fleet_config config) : config_(std::move(config))
+{
+}
+
+fleet_sim::~fleet_sim()
+{
+    stop();
+    if (shared_listen_fd_ >= 0) {
+        close(shared_listen_fd_);
+    }
+}
+
+uint16_t fleet_sim::port_of(int device) const
+{
+    if (config_.shared_port) {
+        return bound_shared_port_;
+    }
+    return (device >= 0 && device < (int)devices_.size()) ? devices_[device]->port : 0;
+}
+
+bool fleet_sim::start()
+{
+    if (started_) {
+        return true;
+    }
+    if (config_.devices <= 0 || config_.nodes < 1 || config_.nodes > 255 || config_.rate_hz <= 0.0) {
+        fprintf(stderr, FLEET_TAG " need devices > 0, 1 <= nodes <= 255 and rate > 0\n");
+        return false;
+    }
+
+    int shard_count = config_.threads > 0 ? config_.threads : (int)std::thread::hardware_concurrency();
+    shard_count = std::max(1, std::min(shard_count, config_.devices));
+
+    start_us_ = now_us();
+    for (int i = 0; i < shard_count; i++) {
+        auto s = std::make_unique<shard>(config_.tick_us, start_us_);
+        s->owner = this;
+        shards_.push_back(std::move(s));
+    }
+
+    std::vector<uint8_t> node_ids((size_t)config_.nodes);
+    for (int n = 0; n < config_.nodes; n++) {
+        node_ids[(size_t)n] = (uint8_t)(n + 1);
+    }
+
+    int64_t period_us = (int64_t)(1e6 / config_.rate_hz);
+    for (int i = 0; i < config_.devices; i++) {
+        auto dev = std::make_unique<device>();
+        dev->id = i;
+        dev->owner = shards_[(size_t)i % shards_.size()].get();
+        dev->period_us = period_us;
+        // Deterministic per device: boot up to 60 s before the fleet, rate
+        // within +/- clock_drift_ppm
+        uint32_t h = (config_.seed + (uint32_t)i) * 2654435761u;
+        dev->boot_us = start_us_ - (int64_t)(h % 60000000u);
+        dev->clock_rate = 1.0 + config_.clock_drift_ppm * 1e-6 * ((double)((h >> 8) & 0xFFFF) / 32767.5 - 1.0);
+        dev->duties.assign((size_t)config_.nodes, 0);
+        actuator_mock_init(&dev->actuator, &dev->actuator_mock, dev->duties.data(), config_.nodes);
+        grid_model_init(&dev->model, node_ids.data(), config_.nodes, config_.seed + (uint32_t)i);
+        if (config_.flat_demand) {
+            dev->model.wave_scale = 0.0f;
+        }
+        if (config_.plant) {
+            grid_plant_config_t plant = {};
+            plant.source_capacity = (float)(config_.plant_source_amps > 0 ? config_.plant_source_amps
+                                                                          : 3.0 * config_.nodes);
+            plant.output_max = 5.0f;
+            plant.line_loss = 0.08f;
+            plant.supply_tau_s = (float)(config_.plant_supply_tau_ms * 1e-3);
+            plant.demand_tau_s = 0.3f;
+            grid_model_set_plant(&dev->model, &plant);
+        }
+
+        if (!config_.shm_prefix.empty()) {
+            std::string name = config_.shm_prefix + std::to_string(i);
+            if (!shm_ring_create(&dev->ring, name.c_str(), config_.shm_slots,
+                                 (uint32_t)telemetry_max_packet_size((uint8_t)config_.nodes))) {
+                fprintf(stderr, FLEET_TAG " device %d: shm ring %s failed: %s\n", i, name.c_str(), strerror(errno));
+                return false;
+            }
+        }
+
+        if (!config_.shared_port) {
+            uint16_t port = config_.base_port ? (uint16_t)(config_.base_port + i) : 0;
+            dev->listen_fd = tcp_listen(port, false, 16);
+            if (dev->listen_fd < 0) {
+                fprintf(stderr, FLEET_TAG " device %d: listen on port %u failed: %s\n", i, port, strerror(errno));
+                return false;
+            }
+            dev->port = local_port(dev->listen_fd);
+            device *dp = dev.get();
+            dev->owner->loop.add(dev->listen_fd, EPOLLIN, [dp](uint32_t) { dp->owner->accept_all(*dp); });
+        }
+
+        // Spread first ticks over one period; a real fleet is not phase-locked
+        int64_t first_due = start_us_ + period_us * i / config_.devices;
+        dev->owner->wheel.schedule(first_due, dev.get());
+        dev->owner->devices.push_back(dev.get());
+        devices_.push_back(std::move(dev));
+    }
+
+    if (config_.shared_port) {
+        shared_listen_fd_ = tcp_listen(config_.base_port, false);
+        if (shared_listen_fd_ < 0) {
+            perror(FLEET_TAG " listen");
+            return false;
+        }
+        bound_shared_port_ = local_port(shared_listen_fd_);
+        shards_[0]->loop.add(shared_listen_fd_, EPOLLIN, [this](uint32_t) {
+            while (true) {
+                int fd = accept4(shared_listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) {
+                    return;
+                }
+                route_shared(fd);
+            }
+        });
+    }
+
+    for (auto &s : shards_) {
+        shard *sp = s.get();
+        s->loop.add_timer(config_.tick_us, config_.tick_us, [sp]() { sp->on_tick(); });
+        s->thread = std::thread([sp]() { sp->loop.run(); });
+    }
+
+    if (config_.shared_port) {
+        fprintf(stderr, FLEET_TAG " %d device(s) x %d node(s) at %.1f Hz on %zu thread(s), shared port %u\n",
+                config_.devices, config_.nodes, config_.rate_hz, shards_.size(), bound_shared_port_);
+    } else {
+        fprintf(stderr, FLEET_TAG " %d device(s) x %d node(s) at %.1f Hz on %zu thread(s), ports %u-%u\n",
+                config_.devices, config_.nodes, config_.rate_hz, shards_.size(),
+                devices_.front()->port, devices_.back()->port);
+    }
+    started_ = true;
+    return true;
+}
+
+/*
+ * Shared-port mode: the request line names the device, but the connection
+ * must live on the device's shard. Peek (without consuming) until the first
+ * line has arrived, then hand the raw fd to the owning loop, where
+ * ws_connection reads the handshake from the start.
+ */
+void fleet_sim::route_shared(int fd)
+{
+    event_loop &acceptor = shards_[0]->loop;
+    acceptor.add(fd, EPOLLIN | EPOLLRDHUP, [this, fd, &acceptor](uint32_t events) {
+        char buf[MAX_REQUEST_PEEK];
+        ssize_t n = ::recv(fd, buf, sizeof(buf), MSG_PEEK);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        const char *eol = n > 0 ? (const char *)memchr(buf, '\n', (size_t)n) : nullptr;
+        if (!eol && n > 0 && (size_t)n < sizeof(buf) && !(events & (EPOLLRDHUP | EPOLLHUP))) {
+            return;  // Request line still incomplete
+        }
+        acceptor.remove(fd);
+
+        long id = -1;
+        if (eol) {
+            // "GET /out?device=12 HTTP/1.1"
+            std::string line(buf, (size_t)(eol - buf));
+            size_t sp1 = line.find(' ');
+            size_t sp2 = line.find(' ', sp1 == std::string::npos ? 0 : sp1 + 1);
+            if (sp1 != std::string::npos && sp2 != std::string::npos) {
+                ws::request_target target = ws::parse_target(line.substr(sp1 + 1, sp2 - sp1 - 1));
+                id = strtol(target.get("device", "-1").c_str(), nullptr, 10);
+            }
+        }
+        if (id < 0 || id >= (long)devices_.size()) {
+            ::close(fd);
+            return;
+        }
+        device *dp = devices_[(size_t)id].get();
+        dp->owner->loop.post([dp, fd]() { dp->owner->attach(*dp, fd); });
+    });
+}
+
+void fleet_sim::stop()
+{
+    if (!started_) {
+        return;
+    }
+    started_ = false;
+    for (auto &s : shards_) {
+        s->loop.stop();
+    }
+    for (auto &s : shards_) {
+        if (s->thread.joinable()) {
+            s->thread.join();
+        }
+    }
+    stop_us_ = now_us();
+}
+
+std::string fleet_sim::counters_json() const
+{
+    char buf[512];
+    snprintf(buf, sizeof(buf),
+             "{\"frames_sent\":%llu,\"frames_shm\":%llu,\"frames_skipped\":%llu,\"send_failed\":%llu,"
+             "\"dispatch_received\":%llu,\"dispatch_invalid\":%llu,\"ticks_late\":%llu,"
+             "\"time_syncs\":%llu,\"out_clients\":%lld,\"in_clients\":%lld}",
+             (unsigned long long)counters_.frames_sent.load(), (unsigned long long)counters_.frames_shm.load(),
+             (unsigned long long)counters_.frames_skipped.load(),
+             (unsigned long long)counters_.send_failed.load(), (unsigned long long)counters_.dispatch_received.load(),
+             (unsigned long long)counters_.dispatch_invalid.load(), (unsigned long long)counters_.ticks_late.load(),
+             (unsigned long long)counters_.time_syncs.load(), (long long)counters_.out_clients.load(),
+             (long long)counters_.in_clients.load());
+    return buf;
+}
+
+std::string fleet_sim::report_json(bool per_device) const
+{
+    histogram latency;
+    histogram lateness;
+    for (const auto &s : shards_) {
+        latency.merge(s->dispatch_latency);
+        lateness.merge(s->tick_lateness);
+    }
+
+    size_t responding = 0;
+    for (const auto &dev : devices_) {
+        if (dev->dispatches > 0) {
+            responding++;
+        }
+    }
+
+    double duration_s = (double)((stop_us_ ? stop_us_ : now_us()) - start_us_) / 1e6;
+    uint64_t frames = counters_.frames_sent.load();
+    char head[512];
+    snprintf(head, sizeof(head),
+             "{\"devices\":%d,\"nodes\":%d,\"rate_hz\":%.2f,\"threads\":%zu,\"duration_s\":%.2f,"
+             "\"frames_per_s\":%.1f,\"dispatch_per_s\":%.1f,\"devices_with_dispatch\":%zu,",
+             config_.devices, config_.nodes, config_.rate_hz, shards_.size(), duration_s,
+             duration_s > 0 ? (double)frames / duration_s : 0.0,
+             duration_s > 0 ? (double)counters_.dispatch_received.load() / duration_s : 0.0,
+             responding);
+
+    std::string out = head;
+    out += "\"counters\":" + counters_json();
+    out += ",\"dispatch_latency_us\":" + latency.to_json();
+    out += ",\"tick_lateness_us\":" + lateness.to_json();
+
+    if (config_.step_at_s > 0) {
+        histogram actuation, settling;
+        size_t stepped = 0;
+        for (const auto &dev : devices_) {
+            int64_t act_us, settle_us;
+            if (dev->step_sent_us) {
+                stepped++;
+            }
+            if (step_response(dev->step_trace, dev->pre_step_supply, act_us, settle_us)) {
+                actuation.record(act_us);
+                settling.record(settle_us);
+            }
+        }
+        char step[160];
+        snprintf(step, sizeof(step), ",\"step\":{\"at_s\":%.2f,\"amps\":%.3f,\"devices_stepped\":%zu,\"devices_settled\":%llu,",
+                 config_.step_at_s, config_.step_amps, stepped, (unsigned long long)settling.count());
+        out += step;
+        out += "\"time_to_actuation_us\":" + actuation.to_json();
+        out += ",\"settling_us\":" + settling.to_json() + "}";
+    }
+
+    if (per_device) {
+        out += ",\"per_device\":[";
+        bool first = true;
+        for (const auto &dev : devices_) {
+            if (dev->frames_sent == 0 && dev->dispatches == 0) {
+                continue;
+            }
+            char entry[128];
+            snprintf(entry, sizeof(entry), "%s{\"device\":%d,\"port\":%u,\"frames\":%llu,\"dispatches\":%llu,",
+                     first ? "" : ",", dev->id, port_of(dev->id),
+                     (unsigned long long)dev->frames_sent, (unsigned long long)dev->dispatches);
+            out += entry;
+            out += "\"latency_us\":" + (dev->dispatch_latency ? dev->dispatch_latency->to_json() : histogram().to_json());
+            int64_t act_us, settle_us;
+            if (step_response(dev->step_trace, dev->pre_step_supply, act_us, settle_us)) {
+                snprintf(entry, sizeof(entry), ",\"actuation_us\":%lld,\"settling_us\":%lld",
+                         (long long)act_us, (long long)settle_us);
+                out += entry;
+            }
+            out += "}";
+            first = false;
+        }
+        out += "]";
+    }
+    out += "}";
+    return out;
+}
+
+} // namespace griddy
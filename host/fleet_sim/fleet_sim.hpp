@@ -0,0 +1,122 @@
+#pragma once
+
+#include "event_loop.hpp"
+#include "histogram.hpp"
+#include "ws_connection.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace griddy {
+
+struct fleet_config {
+    int devices = 100;
+    int nodes = 8;                  // Nodes per device (1..255), ids 1..nodes
+    double rate_hz = 10.0;          // Telemetry rate per device, like DATA_SEND_INTERVAL_MS
+    int threads = 0;                // Event loop threads (0 = hardware concurrency)
+    uint16_t base_port = 9100;      // Device i listens on base_port + i
+    bool shared_port = false;       // One port for all devices: /out?device=<i>, /in?device=<i>
+    int max_out_clients = 4;        // Per device, like MAX_OUT_CLIENTS
+    uint32_t seed = 1;              // Node phases of device i are seeded with seed + i
+    int64_t tick_us = 1000;         // Timer wheel resolution
+    bool flat_demand = false;       // Hold demand at its midpoint (clean step responses)
+    double step_at_s = 0.0;         // Add step_amps to every consumer at this time (0 = off)
+    float step_amps = 1.0f;
+    double clock_drift_ppm = 0.0;   // Device clocks run fast or slow by up to this much
+    bool plant = false;             // Closed loop: fulfillment follows the dispatched duties
+    double plant_source_amps = 0.0; // Source capacity per device (0 = 3 A per node)
+    double plant_supply_tau_ms = 150.0;
+    std::string shm_prefix;         // Also publish device i's frames to shm ring <prefix><i> (empty = off)
+    uint32_t shm_slots = 64;
+    bool verbose = false;
+};
+
+struct fleet_counters {
+    std::atomic<uint64_t> frames_sent{0};       // Telemetry frames written to subscribers
+    std::atomic<uint64_t> frames_shm{0};        // Telemetry frames published to shm rings
+    std::atomic<uint64_t> time_syncs{0};        // TSYN pings answered
+    std::atomic<uint64_t> frames_skipped{0};    // Ticks with no /out subscriber
+    std::atomic<uint64_t> send_failed{0};       // Subscriber queue full or closed
+    std::atomic<uint64_t> dispatch_received{0};
+    std::atomic<uint64_t> dispatch_invalid{0};
+    std::atomic<uint64_t> ticks_late{0};        // Ticks that fired a whole period late
+    std::atomic<int64_t> out_clients{0};
+    std::atomic<int64_t> in_clients{0};
+};
+
+/**
+ * Fleet of simulated ESP32 controllers.
+ *
+ * Every device runs the firmware's grid_model and binary_protocol encoder
+ * and speaks the firmware's /out, /out.json and /in WebSocket endpoints,
+ * either on its own port or multiplexed on one port by ?device=. Devices are
+ * sharded over a pool of event loops; each loop drives its devices from one
+ * hashed timer wheel, so ten thousand devices cost a handful of timers.
+ *
+ * Each device has its own telemetry clock, counting µs from a boot time up
+ * to a minute before the fleet started, at a rate off by up to
+ * clock_drift_ppm. TSYN pings on /out are answered on that clock like the
+ * firmware does.
+ *
+ * With plant set, each device's model runs the firmware's closed-loop plant
+ * (grid_model_set_plant) fed with the duties its dispatch applied, as the
+ * firmware does with CONFIG_POWER_GRID_PLANT_MODEL.
+ *
+ * With shm_prefix set, each device also publishes every binary frame to its
+ * own shared-memory ring (shm_ring.h), like the Linux-target firmware with
+ * CONFIG_POWER_GRID_SHM_RING. Frames are then encoded into the ring slot and
+ * sent to /out subscribers from there, every tick.
+ *
+ * Dispatch latency is measured per device as the time from sending a
+ * telemetry frame to the arrival of the first valid dispatch after it.
+ *
+ * With a demand step configured, each device also records the mean
+ * dispatched supply after the first frame carrying the step. The report
+ * derives time-to-actuation (first dispatch that moved 10% of the way to the
+ * new level) and settling time (last entry into a ±5% band around it).
+ */
+class fleet_sim {
+public:
+    explicit fleet_sim(fleet_config config);
+    ~fleet_sim();
+
+    bool start();
+    void stop();
+
+    const fleet_counters &counters() const { return counters_; }
+    uint16_t port_of(int device) const;
+
+    /**
+     * @brief One-line JSON snapshot of the counters (thread-safe)
+     */
+    std::string counters_json() const;
+
+    /**
+     * @brief Full JSON report; call after stop()
+     *
+     * @param per_device Include one entry per device with dispatch activity
+     */
+    std::string report_json(bool per_device) const;
+
+    struct device;
+    struct shard;
+
+private:
+    void route_shared(int fd);
+
+    fleet_config config_;
+    fleet_counters counters_;
+    std::vector<std::unique_ptr<shard>> shards_;
+    std::vector<std::unique_ptr<device>> devices_;
+    int shared_listen_fd_ = -1;
+    uint16_t bound_shared_port_ = 0;
+    int64_t start_us_ = 0;
+    int64_t stop_us_ = 0;
+    bool started_ = false;
+};
+
+} // namespace griddy
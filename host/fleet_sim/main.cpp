@@ -0,0 +1,143 @@
+// griddy_fleet_sim: serve thousands of simulated controllers to load-test the backend.
+//
+//   griddy_fleet_sim --devices 2000 [--nodes 8] [--rate 10] [--threads N]
+//                    [--base-port 9100 | --shared-port [--port 9100]]
+//                    [--duration SECONDS] [--report-interval SECONDS]
+//                    [--per-device] [--seed N] [--verbose]
+//                    [--flat-demand] [--step-at SECONDS [--step-amps A]]
+//                    [--clock-drift-ppm PPM] [--shm PREFIX [--shm-slots N]]
+//                    [--plant [--source-amps A] [--supply-tau-ms MS]]
+
+#include "fleet_sim.hpp"
+#include "net.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int)
+{
+    stop_requested = 1;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--devices N] [--nodes N] [--rate HZ] [--threads N]\n"
+            "          [--base-port N | --shared-port [--port N]] [--max-out-clients N]\n"
+            "          [--duration SECONDS] [--report-interval SECONDS] [--per-device]\n"
+            "          [--seed N] [--verbose] [--flat-demand] [--step-at SECONDS [--step-amps A]]\n"
+            "          [--clock-drift-ppm PPM] [--shm PREFIX [--shm-slots N]]\n"
+            "          [--plant [--source-amps A] [--supply-tau-ms MS]]\n",
+            argv0);
+}
+
+int main(int argc, char **argv)
+{
+    griddy::fleet_config config;
+    double duration_s = 0.0;
+    double report_interval_s = 5.0;
+    bool per_device = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (!strcmp(arg, "--devices") && value) {
+            config.devices = atoi(value);
+            i++;
+        } else if (!strcmp(arg, "--nodes") && value) {
+            config.nodes = atoi(value);
+            i++;
+        } else if (!strcmp(arg, "--rate") && value) {
+            config.rate_hz = atof(value);
+            i++;
+        } else if (!strcmp(arg, "--threads") && value) {
+            config.threads = atoi(value);
+            i++;
+        } else if ((!strcmp(arg, "--base-port") || !strcmp(arg, "--port")) && value) {
+            config.base_port = (uint16_t)atoi(value);
+            i++;
+        } else if (!strcmp(arg, "--shared-port")) {
+            config.shared_port = true;
+        } else if (!strcmp(arg, "--max-out-clients") && value) {
+            config.max_out_clients = atoi(value);
+            i++;
+        } else if (!strcmp(arg, "--seed") && value) {
+            config.seed = (uint32_t)strtoul(value, nullptr, 10);
+            i++;
+        } else if (!strcmp(arg, "--duration") && value) {
+            duration_s = atof(value);
+            i++;
+        } else if (!strcmp(arg, "--report-interval") && value) {
+            report_interval_s = atof(value);
+            i++;
+        } else if (!strcmp(arg, "--flat-demand")) {
+            config.flat_demand = true;
+        } else if (!strcmp(arg, "--step-at") && value) {
+            config.step_at_s = atof(value);
+            i++;
+        } else if (!strcmp(arg, "--step-amps") && value) {
+            config.step_amps = (float)atof(value);
+            i++;
+        } else if (!strcmp(arg, "--clock-drift-ppm") && value) {
+            config.clock_drift_ppm = atof(value);
+            i++;
+        } else if (!strcmp(arg, "--plant")) {
+            config.plant = true;
+        } else if (!strcmp(arg, "--source-amps") && value) {
+            config.plant_source_amps = atof(value);
+            i++;
+        } else if (!strcmp(arg, "--supply-tau-ms") && value) {
+            config.plant_supply_tau_ms = atof(value);
+            i++;
+        } else if (!strcmp(arg, "--shm") && value) {
+            config.shm_prefix = value;
+            i++;
+        } else if (!strcmp(arg, "--shm-slots") && value) {
+            config.shm_slots = (uint32_t)strtoul(value, nullptr, 10);
+            i++;
+        } else if (!strcmp(arg, "--per-device")) {
+            per_device = true;
+        } else if (!strcmp(arg, "--verbose")) {
+            config.verbose = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    // Per-device ports need one listener each on top of the client sockets
+    griddy::raise_fd_limit((uint64_t)config.devices * 4 + 1024);
+
+    griddy::fleet_sim fleet(config);
+    if (!fleet.start()) {
+        return 1;
+    }
+
+    int64_t start = griddy::now_us();
+    int64_t next_report = start + (int64_t)(report_interval_s * 1e6);
+    while (!stop_requested) {
+        usleep(100000);
+        int64_t now = griddy::now_us();
+        if (duration_s > 0 && now - start >= (int64_t)(duration_s * 1e6)) {
+            break;
+        }
+        if (report_interval_s > 0 && now >= next_report) {
+            fprintf(stderr, "[fleet] %s\n", fleet.counters_json().c_str());
+            next_report += (int64_t)(report_interval_s * 1e6);
+        }
+    }
+
+    fleet.stop();
+    printf("%s\n", fleet.report_json(per_device).c_str());
+    return 0;
+}
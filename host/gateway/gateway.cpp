@@ -0,0 +1,575 @@
+#include "gateway.hpp"
+#include "net.hpp"
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+
+namespace griddy {
+
+#define GATEWAY_TAG "[gateway]"
+
+struct gateway::frame {
+    int controller;
+    int64_t received_us;
+    telemetry_packet_t packet;
+    ws_connection::buffer ws_encoded;   // WebSocket framing, shared by unfiltered subscribers
+    ws_connection::buffer tcp_encoded;  // Length-prefixed framing
+};
+
+struct gateway::controller {
+    int id;
+    std::string host;
+    uint16_t port;
+    ws_connection::ptr out;
+    ws_connection::ptr in;
+    bool out_open = false;
+    bool in_open = false;
+    int64_t out_backoff_us = 0;
+    int64_t in_backoff_us = 0;
+
+    // Optimizers of forwarded dispatches, in order; the device acks in order.
+    // Its ack seq counts dispatches from every client of the device, so the
+    // gateway cannot predict it and pairs by position. Entries are dropped
+    // once too old or too many (acks disabled, or lost to a device restart);
+    // an ack that still arrives for one is swallowed rather than handed to
+    // the next optimizer.
+    struct pending_ack {
+        std::weak_ptr<ws_connection> origin;
+        event_loop *loop;
+        int64_t sent_us;
+    };
+    std::deque<pending_ack> pending_acks;
+    uint64_t acks_owed = 0;         // Dropped entries whose ack may still arrive
+};
+
+namespace {
+
+struct client_state {
+    bool optimizer = false;
+    int controller = 0;
+    size_t index = 0;               // Position in worker::subscribers[controller]
+    int64_t min_interval_us = 0;
+    int64_t last_sent_us = 0;
+    bool filtered = false;
+    std::string filter_key;         // Normalised "nodes" parameter, used as encode cache key
+    std::vector<uint16_t> nodes;    // Sorted, unique; a frame holds a handful
+};
+
+client_state &state_of(ws_connection &conn)
+{
+    return *static_cast<client_state *>(conn.user.get());
+}
+
+bool parse_node_filter(const std::string &spec, client_state &st)
+{
+    if (spec.empty()) {
+        return true;
+    }
+    size_t start = 0;
+    while (start < spec.size()) {
+        size_t comma = spec.find(',', start);
+        std::string item = spec.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        char *end = nullptr;
+        long id = strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || id < 0 || id > 65535) {
+            return false;
+        }
+        st.nodes.push_back((uint16_t)id);
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    std::sort(st.nodes.begin(), st.nodes.end());
+    st.nodes.erase(std::unique(st.nodes.begin(), st.nodes.end()), st.nodes.end());
+    st.filtered = true;
+    for (uint16_t id : st.nodes) {
+        if (!st.filter_key.empty()) {
+            st.filter_key += ',';
+        }
+        st.filter_key += std::to_string(id);
+    }
+    return true;
+}
+
+} // namespace
+
+struct gateway::worker {
+    gateway *owner = nullptr;
+    event_loop loop;
+    std::thread thread;
+    int ws_listen_fd = -1;
+    int tcp_listen_fd = -1;
+    std::vector<std::vector<ws_connection::ptr>> subscribers;  // Indexed by controller id
+
+    ~worker()
+    {
+        if (ws_listen_fd >= 0) close(ws_listen_fd);
+        if (tcp_listen_fd >= 0) close(tcp_listen_fd);
+    }
+
+    void accept_all(int listen_fd, ws_connection::framing mode)
+    {
+        while (true) {
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && owner->config_.verbose) {
+                    perror(GATEWAY_TAG " accept");
+                }
+                return;
+            }
+            ws_connection::handlers h;
+            h.on_open = [this](ws_connection &conn) { return on_open(conn); };
+            h.on_message = [this](ws_connection &conn, uint8_t op, const uint8_t *data, size_t len) {
+                on_message(conn, op, data, len);
+            };
+            h.on_close = [this](ws_connection &conn) { on_close(conn); };
+            ws_connection::ptr conn = ws_connection::accept(loop, fd, mode, std::move(h));
+            conn->set_max_queue(owner->config_.max_client_queue);
+        }
+    }
+
+    bool on_open(ws_connection &conn)
+    {
+        const ws::request_target &target = conn.target();
+        auto st = std::make_shared<client_state>();
+
+        long controller_id = strtol(target.get("controller", "0").c_str(), nullptr, 10);
+        if (controller_id < 0 || controller_id >= (long)subscribers.size()) {
+            return false;
+        }
+        st->controller = (int)controller_id;
+
+        if (target.path == "/in") {
+            const std::string &token = owner->config_.dispatch_token;
+            if (conn.mode() != ws_connection::framing::websocket || token.empty() ||
+                target.get("token") != token) {
+                owner->stats_.dispatch_rejected++;
+                return false;
+            }
+            st->optimizer = true;
+            conn.user = st;
+            owner->stats_.optimizers++;
+            return true;
+        }
+
+        if (target.path != "/out") {
+            return false;
+        }
+
+        double rate = atof(target.get("rate", "0").c_str());
+        if (rate > 0) {
+            st->min_interval_us = (int64_t)(1e6 / rate);
+        }
+        if (!parse_node_filter(target.get("nodes"), *st)) {
+            return false;
+        }
+
+        auto &list = subscribers[st->controller];
+        st->index = list.size();
+        conn.user = st;
+        list.push_back(conn.shared_from_this());
+        owner->stats_.subscribers++;
+        return true;
+    }
+
+    void on_message(ws_connection &conn, uint8_t op, const uint8_t *data, size_t len)
+    {
+        client_state &st = state_of(conn);
+        if (!st.optimizer || op != ws::OP_BINARY) {
+            return;  // /out is send-only, like the firmware
+        }
+        owner->stats_.dispatch_in++;
+
+        // Validate only (DISP or dense DDSP); the device applies the frame
+        dispatch_stream_t stream;
+        dispatch_stream_begin(&stream, nullptr, nullptr, nullptr);
+        dispatch_stream_feed(&stream, data, len);
+        if (dispatch_stream_end(&stream) != DISPATCH_STREAM_DONE) {
+            owner->stats_.dispatch_rejected++;
+            return;
+        }
+        auto payload = std::make_shared<std::vector<uint8_t>>(data, data + len);
+        int controller_id = st.controller;
+        gateway *gw = owner;
+        std::weak_ptr<ws_connection> origin = conn.shared_from_this();
+        event_loop *origin_loop = &loop;
+        gw->upstream_loop_.post([gw, controller_id, payload, origin, origin_loop]() {
+            gw->forward_dispatch(controller_id, payload, origin, origin_loop);
+        });
+    }
+
+    void on_close(ws_connection &conn)
+    {
+        if (!conn.user) {
+            return;
+        }
+        client_state &st = state_of(conn);
+        if (st.optimizer) {
+            owner->stats_.optimizers--;
+            return;
+        }
+
+        // Swap-remove, keeping the moved subscriber's index current
+        auto &list = subscribers[st.controller];
+        if (st.index < list.size() && list[st.index].get() == &conn) {
+            list[st.index] = list.back();
+            state_of(*list[st.index]).index = st.index;
+            list.pop_back();
+            owner->stats_.subscribers--;
+        }
+    }
+
+    void fan_out(const std::shared_ptr<const gateway::frame> &f)
+    {
+        auto &list = subscribers[f->controller];
+        if (list.empty()) {
+            return;
+        }
+
+        int64_t now = now_us();
+        uint64_t sent = 0, skipped = 0, dropped = 0;
+        std::unordered_map<std::string, std::pair<ws_connection::buffer, ws_connection::buffer>> filtered_cache;
+
+        // Walk backwards: a failed write closes only the current connection, and
+        // its swap-remove pulls in an element that has already been visited
+        for (size_t i = list.size(); i-- > 0;) {
+            ws_connection::ptr conn = list[i];
+            if (!conn->is_open()) {
+                continue;
+            }
+            client_state &st = state_of(*conn);
+
+            // 10% slack so a subscriber asking for the source rate is not aliased by jitter
+            if (st.min_interval_us > 0 && now - st.last_sent_us < st.min_interval_us * 9 / 10) {
+                skipped++;
+                continue;
+            }
+
+            bool tcp = conn->mode() == ws_connection::framing::length_prefixed;
+            const ws_connection::buffer *encoded = tcp ? &f->tcp_encoded : &f->ws_encoded;
+
+            if (st.filtered) {
+                auto it = filtered_cache.find(st.filter_key);
+                if (it == filtered_cache.end()) {
+                    // Delta frames stay deltas with the device's sequence
+                    // numbers; the subset of a keyframe is a keyframe
+                    telemetry_packet_t subset;
+                    subset.magic = f->packet.magic;
+                    subset.timestamp_us = f->packet.timestamp_us;
+                    subset.seq = f->packet.seq;
+                    subset.flags = f->packet.flags;
+                    subset.node_count = 0;
+                    for (int node = 0; node < f->packet.node_count; node++) {
+                        if (std::binary_search(st.nodes.begin(), st.nodes.end(), f->packet.nodes[node].id)) {
+                            subset.nodes[subset.node_count++] = f->packet.nodes[node];
+                        }
+                    }
+                    std::array<uint8_t, GATEWAY_MAX_FRAME> buf;
+                    size_t n = encode_telemetry(&subset, buf.data());
+                    auto ws_buf = ws_connection::encode_shared(ws_connection::framing::websocket, ws::OP_BINARY,
+                                                               buf.data(), n);
+                    auto tcp_buf = ws_connection::encode_shared(ws_connection::framing::length_prefixed, ws::OP_BINARY,
+                                                                buf.data(), n);
+                    it = filtered_cache.emplace(st.filter_key, std::make_pair(ws_buf, tcp_buf)).first;
+                }
+                encoded = tcp ? &it->second.second : &it->second.first;
+            }
+
+            if (conn->send_encoded(*encoded)) {
+                st.last_sent_us = now;
+                sent++;
+            } else {
+                dropped++;
+            }
+        }
+
+        owner->stats_.frames_out += sent;
+        owner->stats_.frames_rate_skipped += skipped;
+        owner->stats_.frames_slow_dropped += dropped;
+    }
+};
+
+gateway::gateway(gateway_config config) : config_(std::move(config)) {}
+
+gateway::~gateway()
+{
+    stop();
+}
+
+bool gateway::start()
+{
+    if (started_) {
+        return true;
+    }
+    if (config_.controllers.empty()) {
+        fprintf(stderr, GATEWAY_TAG " no controllers configured\n");
+        return false;
+    }
+
+    for (size_t i = 0; i < config_.controllers.size(); i++) {
+        auto ctl = std::make_unique<controller>();
+        ctl->id = (int)i;
+        if (!parse_host_port(config_.controllers[i], 80, ctl->host, ctl->port)) {
+            fprintf(stderr, GATEWAY_TAG " bad controller address '%s'\n", config_.controllers[i].c_str());
+            return false;
+        }
+        controllers_.push_back(std::move(ctl));
+    }
+
+    int worker_count = config_.workers > 0 ? config_.workers : (int)std::thread::hardware_concurrency();
+    if (worker_count <= 0) {
+        worker_count = 1;
+    }
+
+    // First listener binds the port (possibly ephemeral); the rest share it via SO_REUSEPORT
+    bound_ws_port_ = config_.ws_port;
+    bound_tcp_port_ = config_.tcp_port;
+    for (int i = 0; i < worker_count; i++) {
+        auto w = std::make_unique<worker>();
+        w->owner = this;
+        w->subscribers.resize(controllers_.size());
+
+        w->ws_listen_fd = tcp_listen(bound_ws_port_, true);
+        if (w->ws_listen_fd < 0) {
+            perror(GATEWAY_TAG " listen");
+            return false;
+        }
+        bound_ws_port_ = local_port(w->ws_listen_fd);
+        worker *wp = w.get();
+        w->loop.add(w->ws_listen_fd, EPOLLIN, [wp](uint32_t) {
+            wp->accept_all(wp->ws_listen_fd, ws_connection::framing::websocket);
+        });
+
+        if (config_.tcp_port != 0) {
+            w->tcp_listen_fd = tcp_listen(bound_tcp_port_, true);
+            if (w->tcp_listen_fd < 0) {
+                perror(GATEWAY_TAG " listen (tcp)");
+                return false;
+            }
+            bound_tcp_port_ = local_port(w->tcp_listen_fd);
+            w->loop.add(w->tcp_listen_fd, EPOLLIN, [wp](uint32_t) {
+                wp->accept_all(wp->tcp_listen_fd, ws_connection::framing::length_prefixed);
+            });
+        }
+        workers_.push_back(std::move(w));
+    }
+
+    for (auto &w : workers_) {
+        worker *wp = w.get();
+        w->thread = std::thread([wp]() { wp->loop.run(); });
+    }
+
+    for (auto &ctl : controllers_) {
+        controller *cp = ctl.get();
+        upstream_loop_.post([this, cp]() { start_upstream(*cp); });
+    }
+    if (config_.verbose) {
+        upstream_loop_.add_timer(5000000, 5000000, [this]() {
+            fprintf(stderr, GATEWAY_TAG " %s\n", stats_json().c_str());
+        });
+    }
+    upstream_thread_ = std::thread([this]() { upstream_loop_.run(); });
+
+    fprintf(stderr, GATEWAY_TAG " %zu controller(s), %d worker(s), ws port %u%s\n",
+            controllers_.size(), worker_count, bound_ws_port_,
+            config_.dispatch_token.empty() ? ", dispatch disabled (no token)" : "");
+    started_ = true;
+    return true;
+}
+
+void gateway::stop()
+{
+    if (!started_) {
+        return;
+    }
+    started_ = false;
+    upstream_loop_.stop();
+    for (auto &w : workers_) {
+        w->loop.stop();
+    }
+    if (upstream_thread_.joinable()) {
+        upstream_thread_.join();
+    }
+    for (auto &w : workers_) {
+        if (w->thread.joinable()) {
+            w->thread.join();
+        }
+    }
+}
+
+void gateway::start_upstream(controller &ctl)
+{
+    connect_out(ctl);
+    connect_in(ctl);
+}
+
+void gateway::schedule_reconnect(controller &ctl, bool out)
+{
+    int64_t &backoff = out ? ctl.out_backoff_us : ctl.in_backoff_us;
+    backoff = backoff == 0 ? config_.reconnect_min_us : std::min(backoff * 2, config_.reconnect_max_us);
+    controller *cp = &ctl;
+    upstream_loop_.add_timer(backoff, 0, [this, cp, out]() {
+        if (out) {
+            connect_out(*cp);
+        } else {
+            connect_in(*cp);
+        }
+    });
+}
+
+void gateway::connect_out(controller &ctl)
+{
+    controller *cp = &ctl;
+    ws_connection::handlers h;
+    h.on_open = [this, cp](ws_connection &) {
+        cp->out_open = true;
+        cp->out_backoff_us = 0;
+        stats_.upstream_connected++;
+        fprintf(stderr, GATEWAY_TAG " controller %d /out connected (%s:%u)\n", cp->id, cp->host.c_str(), cp->port);
+        return true;
+    };
+    h.on_message = [this, cp](ws_connection &, uint8_t op, const uint8_t *data, size_t len) {
+        if (op != ws::OP_BINARY) {
+            return;
+        }
+        auto f = std::make_shared<frame>();
+        if (!decode_telemetry(data, len, &f->packet)) {
+            stats_.frames_invalid++;
+            return;
+        }
+        stats_.frames_in++;
+        f->controller = cp->id;
+        f->received_us = now_us();
+        f->ws_encoded = ws_connection::encode_shared(ws_connection::framing::websocket, ws::OP_BINARY, data, len);
+        f->tcp_encoded = ws_connection::encode_shared(ws_connection::framing::length_prefixed, ws::OP_BINARY, data, len);
+        publish(f);
+    };
+    h.on_close = [this, cp](ws_connection &) {
+        if (cp->out_open) {
+            cp->out_open = false;
+            stats_.upstream_connected--;
+            fprintf(stderr, GATEWAY_TAG " controller %d /out lost, reconnecting\n", cp->id);
+        }
+        cp->out.reset();
+        schedule_reconnect(*cp, true);
+    };
+
+    ctl.out = ws_connection::connect(upstream_loop_, ctl.host, ctl.port, "/out", std::move(h));
+    if (!ctl.out) {
+        schedule_reconnect(ctl, true);
+    }
+}
+
+void gateway::connect_in(controller &ctl)
+{
+    controller *cp = &ctl;
+    ws_connection::handlers h;
+    h.on_open = [cp](ws_connection &) {
+        cp->in_open = true;
+        cp->in_backoff_us = 0;
+        return true;
+    };
+    h.on_message = [this, cp](ws_connection &, uint8_t op, const uint8_t *data, size_t len) {
+        dispatch_ack_t ack;
+        if (op != ws::OP_BINARY || !decode_dispatch_ack(data, len, &ack)) {
+            return;
+        }
+        expire_acks(*cp, now_us());
+        if (cp->acks_owed > 0) {
+            cp->acks_owed--;
+            return;
+        }
+        if (cp->pending_acks.empty()) {
+            return;
+        }
+        controller::pending_ack pending = cp->pending_acks.front();
+        cp->pending_acks.pop_front();
+        stats_.dispatch_acked++;
+
+        // Relay on the optimizer's own worker loop
+        auto reply = std::make_shared<std::vector<uint8_t>>(data, data + len);
+        std::weak_ptr<ws_connection> origin = pending.origin;
+        pending.loop->post([origin, reply]() {
+            if (ws_connection::ptr conn = origin.lock()) {
+                conn->send_binary(reply->data(), reply->size());
+            }
+        });
+    };
+    h.on_close = [this, cp](ws_connection &) {
+        cp->in_open = false;
+        cp->in.reset();
+        cp->pending_acks.clear();
+        cp->acks_owed = 0;
+        schedule_reconnect(*cp, false);
+    };
+
+    ctl.in = ws_connection::connect(upstream_loop_, ctl.host, ctl.port, "/in", std::move(h));
+    if (!ctl.in) {
+        schedule_reconnect(ctl, false);
+    }
+}
+
+void gateway::publish(const std::shared_ptr<const frame> &f)
+{
+    for (auto &w : workers_) {
+        worker *wp = w.get();
+        wp->loop.post([wp, f]() { wp->fan_out(f); });
+    }
+}
+
+void gateway::forward_dispatch(int controller_id, std::shared_ptr<std::vector<uint8_t>> payload,
+                               std::weak_ptr<ws_connection> origin, event_loop *origin_loop)
+{
+    controller &ctl = *controllers_[controller_id];
+    if (!ctl.in_open || !ctl.in->send_binary(payload->data(), payload->size())) {
+        stats_.dispatch_rejected++;
+        return;
+    }
+    int64_t now = now_us();
+    expire_acks(ctl, now);
+    while (!ctl.pending_acks.empty() && ctl.pending_acks.size() >= config_.max_pending_acks) {
+        ctl.pending_acks.pop_front();
+        ctl.acks_owed++;
+        stats_.dispatch_ack_expired++;
+    }
+    ctl.pending_acks.push_back(controller::pending_ack{std::move(origin), origin_loop, now});
+    stats_.dispatch_forwarded++;
+}
+
+void gateway::expire_acks(controller &ctl, int64_t now)
+{
+    while (!ctl.pending_acks.empty() && now - ctl.pending_acks.front().sent_us > config_.ack_timeout_us) {
+        ctl.pending_acks.pop_front();
+        ctl.acks_owed++;
+        stats_.dispatch_ack_expired++;
+    }
+}
+
+std::string gateway::stats_json() const
+{
+    char buf[640];
+    snprintf(buf, sizeof(buf),
+             "{\"upstream_connected\":%lld,\"subscribers\":%lld,\"optimizers\":%lld,"
+             "\"frames_in\":%llu,\"frames_invalid\":%llu,\"frames_out\":%llu,"
+             "\"frames_rate_skipped\":%llu,\"frames_slow_dropped\":%llu,"
+             "\"dispatch_in\":%llu,\"dispatch_forwarded\":%llu,\"dispatch_acked\":%llu,\"dispatch_rejected\":%llu,"
+             "\"dispatch_ack_expired\":%llu}",
+             (long long)stats_.upstream_connected.load(), (long long)stats_.subscribers.load(),
+             (long long)stats_.optimizers.load(),
+             (unsigned long long)stats_.frames_in.load(), (unsigned long long)stats_.frames_invalid.load(),
+             (unsigned long long)stats_.frames_out.load(), (unsigned long long)stats_.frames_rate_skipped.load(),
+             (unsigned long long)stats_.frames_slow_dropped.load(), (unsigned long long)stats_.dispatch_in.load(),
+             (unsigned long long)stats_.dispatch_forwarded.load(), (unsigned long long)stats_.dispatch_acked.load(),
+             (unsigned long long)stats_.dispatch_rejected.load(), (unsigned long long)stats_.dispatch_ack_expired.load());
+    return buf;
+}
+
+} // namespace griddy
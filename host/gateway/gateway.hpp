@@ -0,0 +1,105 @@
+#pragma once
+
+#include "binary_protocol.h"
+#include "event_loop.hpp"
+#include "ws_connection.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace griddy {
+
+// telemetry_max_packet_size(MAX_NODES_PER_PACKET), usable as an array size
+constexpr size_t GATEWAY_MAX_FRAME = TELEMETRY_DELTA_HEADER_SIZE +
+                                     MAX_NODES_PER_PACKET * (12 + 4 * TELEMETRY_FIELD_COUNT);
+
+struct gateway_config {
+    std::vector<std::string> controllers;   // "host[:port]", index = controller id
+    uint16_t ws_port = 9000;                // WebSocket subscribers and optimizers
+    uint16_t tcp_port = 0;                  // Length-prefixed TCP subscribers (0 = off)
+    int workers = 0;                        // Fan-out threads (0 = hardware concurrency)
+    std::string dispatch_token;             // Required ?token= for /in; empty disables dispatch
+    size_t max_client_queue = 256 * 1024;   // Per-subscriber queued bytes before dropping frames
+    size_t max_pending_acks = 1024;         // Per-controller dispatches awaiting a device ack
+    int64_t ack_timeout_us = 5000000;       // Forget a dispatch not acked within this
+    int64_t reconnect_min_us = 250000;
+    int64_t reconnect_max_us = 5000000;
+    bool verbose = false;
+};
+
+struct gateway_stats {
+    std::atomic<uint64_t> frames_in{0};          // Telemetry frames from controllers
+    std::atomic<uint64_t> frames_invalid{0};     // Upstream frames that failed decode
+    std::atomic<uint64_t> frames_out{0};         // Frames queued to subscribers
+    std::atomic<uint64_t> frames_rate_skipped{0};// Frames skipped by per-client rate limits
+    std::atomic<uint64_t> frames_slow_dropped{0};// Frames dropped because a client queue was full
+    std::atomic<uint64_t> dispatch_in{0};        // Dispatch frames from optimizers
+    std::atomic<uint64_t> dispatch_forwarded{0}; // Dispatch frames written to a controller /in
+    std::atomic<uint64_t> dispatch_acked{0};     // Device acks relayed back to the optimizer
+    std::atomic<uint64_t> dispatch_rejected{0};  // Unauthorized, malformed or no upstream
+    std::atomic<uint64_t> dispatch_ack_expired{0};// Forwarded dispatches given up on before an ack
+    std::atomic<int64_t> subscribers{0};
+    std::atomic<int64_t> optimizers{0};
+    std::atomic<int64_t> upstream_connected{0};  // Controllers with a live /out
+};
+
+/**
+ * Telemetry fan-out gateway.
+ *
+ * One upstream thread holds a single /out subscription and a single /in
+ * connection to each controller. Decoded frames are handed to N worker
+ * threads, each owning an SO_REUSEPORT listener and its share of
+ * subscribers, so one ESP32 stream can serve thousands of local clients.
+ *
+ * Subscriber endpoints (WebSocket, or "SUB <target>\n" on the TCP port):
+ *   /out?controller=<id>&rate=<hz>&nodes=<id,id,...>
+ *   /in?controller=<id>&token=<secret>    (optimizer dispatch, WebSocket only)
+ */
+class gateway {
+public:
+    explicit gateway(gateway_config config);
+    ~gateway();
+
+    bool start();
+    void stop();
+
+    const gateway_stats &stats() const { return stats_; }
+    uint16_t ws_port() const { return bound_ws_port_; }
+    uint16_t tcp_port() const { return bound_tcp_port_; }
+
+    /**
+     * @brief One-line JSON snapshot of the counters
+     */
+    std::string stats_json() const;
+
+    struct frame;
+    struct controller;
+    struct worker;
+
+private:
+    void start_upstream(controller &ctl);
+    void connect_out(controller &ctl);
+    void connect_in(controller &ctl);
+    void schedule_reconnect(controller &ctl, bool out);
+    void expire_acks(controller &ctl, int64_t now);
+    void publish(const std::shared_ptr<const frame> &f);
+    void forward_dispatch(int controller_id, std::shared_ptr<std::vector<uint8_t>> payload,
+                          std::weak_ptr<ws_connection> origin, event_loop *origin_loop);
+
+    gateway_config config_;
+    gateway_stats stats_;
+    uint16_t bound_ws_port_ = 0;
+    uint16_t bound_tcp_port_ = 0;
+
+    event_loop upstream_loop_;
+    std::thread upstream_thread_;
+    std::vector<std::unique_ptr<controller>> controllers_;
+    std::vector<std::unique_ptr<worker>> workers_;
+    bool started_ = false;
+};
+
+} // namespace griddy
@@ -0,0 +1,298 @@
+// gateway_bench: load benchmark for the fan-out gateway on one host.
+//
+// Runs a fake controller (serves /out telemetry at --rate with --nodes nodes,
+// encoded with the firmware's encode_telemetry), a gateway in front of it,
+// and --subscribers WebSocket clients spread over --client-threads loops.
+// The telemetry timestamp carries the send time in µs so every subscriber
+// can measure controller-to-client latency.
+//
+// Prints one JSON object on stdout.
+
+#include "binary_protocol.h"
+#include "gateway.hpp"
+#include "histogram.hpp"
+#include "net.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <sys/socket.h>
+#include <vector>
+
+using namespace griddy;
+
+namespace {
+
+struct bench_options {
+    int subscribers = 10000;
+    int workers = 4;
+    int client_threads = 4;
+    int nodes = 8;
+    double rate_hz = 24.0;
+    double duration_s = 10.0;
+    double filter_fraction = 0.0;   // Share of subscribers with a node filter
+    double limited_fraction = 0.0;  // Share of subscribers asking for rate/2
+};
+
+// Minimal controller: /out telemetry at a fixed rate, /in accepted and ignored
+class fake_controller {
+public:
+    fake_controller(int nodes, double rate_hz) : nodes_(nodes), rate_hz_(rate_hz) {}
+
+    uint16_t start()
+    {
+        listen_fd_ = tcp_listen(0, false);
+        port_ = local_port(listen_fd_);
+        loop_.add(listen_fd_, EPOLLIN, [this](uint32_t) { accept_all(); });
+        loop_.add_timer(0, (int64_t)(1e6 / rate_hz_), [this]() { tick(); });
+        thread_ = std::thread([this]() { loop_.run(); });
+        return port_;
+    }
+
+    void stop()
+    {
+        loop_.stop();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    uint64_t frames_sent() const { return frames_sent_.load(); }
+
+private:
+    void accept_all()
+    {
+        while (true) {
+            int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return;
+            ws_connection::handlers h;
+            h.on_open = [this](ws_connection &conn) {
+                if (conn.target().path == "/out") {
+                    outs_.push_back(conn.shared_from_this());
+                }
+                return true;
+            };
+            ws_connection::accept(loop_, fd, ws_connection::framing::websocket, std::move(h));
+        }
+    }
+
+    void tick()
+    {
+        telemetry_packet_t packet;
+        packet.magic = TELEMETRY_MAGIC;
+        packet.timestamp_us = (uint64_t)now_us();
+        packet.node_count = (uint8_t)nodes_;
+        for (int i = 0; i < nodes_; i++) {
+            packet.nodes[i].id = (uint8_t)(i + 1);
+            packet.nodes[i].type = NODE_TYPE_CONSUMER;
+            packet.nodes[i].demand = 2.0f + 0.1f * (float)i;
+            packet.nodes[i].fulfillment = 0.9f;
+            packet.nodes[i].fields = 0;
+        }
+        std::array<uint8_t, GATEWAY_MAX_FRAME> buf;
+        size_t len = encode_telemetry(&packet, buf.data());
+        auto frame = ws_connection::encode_shared(ws_connection::framing::websocket, ws::OP_BINARY, buf.data(), len);
+
+        for (size_t i = 0; i < outs_.size();) {
+            if (!outs_[i]->is_open()) {
+                outs_[i] = outs_.back();
+                outs_.pop_back();
+                continue;
+            }
+            outs_[i]->send_encoded(frame);
+            i++;
+        }
+        frames_sent_++;
+    }
+
+    int nodes_;
+    double rate_hz_;
+    int listen_fd_ = -1;
+    uint16_t port_ = 0;
+    event_loop loop_;
+    std::thread thread_;
+    std::vector<ws_connection::ptr> outs_;
+    std::atomic<uint64_t> frames_sent_{0};
+};
+
+struct client_thread {
+    event_loop loop;
+    std::thread thread;
+    std::vector<ws_connection::ptr> conns;
+    std::atomic<int> connected{0};
+    std::atomic<int> failed{0};
+
+    // Written only on the loop thread; read after stop()
+    histogram latency_us;
+    uint64_t frames = 0;
+    std::vector<uint64_t> per_sub_frames;
+};
+
+std::atomic<bool> measuring{false};
+
+void parse_args(int argc, char **argv, bench_options &opt)
+{
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *k = argv[i];
+        const char *v = argv[i + 1];
+        if (!strcmp(k, "--subscribers")) opt.subscribers = atoi(v);
+        else if (!strcmp(k, "--workers")) opt.workers = atoi(v);
+        else if (!strcmp(k, "--client-threads")) opt.client_threads = atoi(v);
+        else if (!strcmp(k, "--nodes")) opt.nodes = atoi(v);
+        else if (!strcmp(k, "--rate")) opt.rate_hz = atof(v);
+        else if (!strcmp(k, "--duration")) opt.duration_s = atof(v);
+        else if (!strcmp(k, "--filter-fraction")) opt.filter_fraction = atof(v);
+        else if (!strcmp(k, "--limited-fraction")) opt.limited_fraction = atof(v);
+        else {
+            fprintf(stderr, "unknown option %s\n", k);
+            exit(1);
+        }
+    }
+    if (opt.nodes < 1) opt.nodes = 1;
+    if (opt.nodes > 255) opt.nodes = 255;
+    if (opt.client_threads < 1) opt.client_threads = 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    bench_options opt;
+    parse_args(argc, argv, opt);
+    signal(SIGPIPE, SIG_IGN);
+
+    uint64_t fd_limit = raise_fd_limit((uint64_t)opt.subscribers * 2 + 1024);
+    if (fd_limit < (uint64_t)opt.subscribers * 2 + 64) {
+        fprintf(stderr, "[bench] fd limit %llu too low for %d subscribers\n",
+                (unsigned long long)fd_limit, opt.subscribers);
+        return 1;
+    }
+
+    fake_controller controller(opt.nodes, opt.rate_hz);
+    uint16_t controller_port = controller.start();
+
+    gateway_config config;
+    config.controllers.push_back("127.0.0.1:" + std::to_string(controller_port));
+    config.ws_port = 0;
+    config.workers = opt.workers;
+    gateway gw(config);
+    if (!gw.start()) {
+        return 1;
+    }
+
+    // Spread subscribers over client loops; connect in paced batches
+    std::vector<std::unique_ptr<client_thread>> clients;
+    for (int t = 0; t < opt.client_threads; t++) {
+        clients.push_back(std::make_unique<client_thread>());
+    }
+    for (int t = 0; t < opt.client_threads; t++) {
+        client_thread *ct = clients[t].get();
+        int share = opt.subscribers / opt.client_threads + (t < opt.subscribers % opt.client_threads ? 1 : 0);
+        ct->per_sub_frames.assign((size_t)share, 0);
+        auto next = std::make_shared<int>(0);
+        uint16_t port = gw.ws_port();
+
+        ct->loop.add_timer(0, 5000, [ct, next, share, port, &opt, t]() {
+            for (int k = 0; k < 100 && *next < share; k++, (*next)++) {
+                int idx = *next;
+                int global = idx * opt.client_threads + t;
+                std::string target = "/out";
+                double u = (double)(global % 1000) / 1000.0;
+                if (u < opt.filter_fraction) {
+                    target += "?nodes=1,2";
+                } else if (u < opt.filter_fraction + opt.limited_fraction) {
+                    target += "?rate=" + std::to_string(opt.rate_hz / 2);
+                }
+
+                ws_connection::handlers h;
+                h.on_open = [ct](ws_connection &) {
+                    ct->connected++;
+                    return true;
+                };
+                h.on_message = [ct, idx](ws_connection &, uint8_t op, const uint8_t *data, size_t len) {
+                    if (!measuring.load(std::memory_order_relaxed) || len < 12) return;
+                    int64_t ts;
+                    memcpy(&ts, data + 4, 8);
+                    int64_t latency = now_us() - ts;
+                    ct->latency_us.record(latency);
+                    ct->frames++;
+                    ct->per_sub_frames[(size_t)idx]++;
+                };
+                h.on_close = [ct](ws_connection &) { ct->failed++; };
+                auto conn = ws_connection::connect(ct->loop, "127.0.0.1", port, target, std::move(h));
+                if (conn) {
+                    ct->conns.push_back(conn);
+                } else {
+                    ct->failed++;
+                }
+            }
+        });
+        ct->thread = std::thread([ct]() { ct->loop.run(); });
+    }
+
+    // Wait for subscribers to attach (bounded)
+    int64_t connect_start = now_us();
+    int connected = 0;
+    while (now_us() - connect_start < 60000000) {
+        connected = 0;
+        int failed = 0;
+        for (auto &ct : clients) {
+            connected += ct->connected.load();
+            failed += ct->failed.load();
+        }
+        if (connected + failed >= opt.subscribers) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    double connect_s = (double)(now_us() - connect_start) / 1e6;
+    fprintf(stderr, "[bench] %d/%d subscribers connected in %.2fs\n", connected, opt.subscribers, connect_s);
+
+    uint64_t gw_out_before = gw.stats().frames_out.load();
+    uint64_t gw_drop_before = gw.stats().frames_slow_dropped.load();
+    uint64_t sent_before = controller.frames_sent();
+    measuring = true;
+    int64_t t0 = now_us();
+    std::this_thread::sleep_for(std::chrono::microseconds((int64_t)(opt.duration_s * 1e6)));
+    measuring = false;
+    double elapsed = (double)(now_us() - t0) / 1e6;
+    uint64_t sent = controller.frames_sent() - sent_before;
+
+    for (auto &ct : clients) {
+        ct->loop.stop();
+        ct->thread.join();
+    }
+
+    histogram latency;
+    uint64_t frames = 0;
+    uint64_t min_sub = UINT64_MAX;
+    uint64_t starved = 0;
+    for (auto &ct : clients) {
+        latency.merge(ct->latency_us);
+        frames += ct->frames;
+        for (uint64_t n : ct->per_sub_frames) {
+            if (n < min_sub) min_sub = n;
+            if (n == 0) starved++;
+        }
+    }
+    if (min_sub == UINT64_MAX) min_sub = 0;
+
+    printf("{\"bench\":\"gateway\",\"subscribers\":%d,\"connected\":%d,\"workers\":%d,\"client_threads\":%d,"
+           "\"nodes\":%d,\"rate_hz\":%.2f,\"duration_s\":%.2f,\"connect_s\":%.2f,"
+           "\"frames_published\":%llu,\"frames_delivered\":%llu,\"delivered_per_s\":%.0f,"
+           "\"min_frames_per_subscriber\":%llu,\"starved_subscribers\":%llu,"
+           "\"gateway_frames_out\":%llu,\"gateway_slow_dropped\":%llu,\"latency_us\":%s}\n",
+           opt.subscribers, connected, opt.workers, opt.client_threads, opt.nodes, opt.rate_hz, elapsed, connect_s,
+           (unsigned long long)sent, (unsigned long long)frames, (double)frames / elapsed,
+           (unsigned long long)min_sub, (unsigned long long)starved,
+           (unsigned long long)(gw.stats().frames_out.load() - gw_out_before),
+           (unsigned long long)(gw.stats().frames_slow_dropped.load() - gw_drop_before),
+           latency.to_json().c_str());
+
+    gw.stop();
+    controller.stop();
+    return 0;
+}
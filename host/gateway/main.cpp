@@ -0,0 +1,95 @@
+// griddy_gateway: fan one controller stream out to many local subscribers.
+//
+//   griddy_gateway --controller 192.168.1.50 [--controller host:port ...]
+//                  [--port 9000] [--tcp-port 9001] [--workers N]
+//                  [--token SECRET] [--max-queue BYTES] [--ack-timeout MS]
+//                  [--verbose]
+
+#include "gateway.hpp"
+#include "net.hpp"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_signal(int)
+{
+    stop_requested = 1;
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s --controller HOST[:PORT] [--controller ...] [--port N] [--tcp-port N]\n"
+            "          [--workers N] [--token SECRET] [--max-queue BYTES] [--ack-timeout MS]\n"
+            "          [--verbose]\n",
+            argv0);
+}
+
+int main(int argc, char **argv)
+{
+    griddy::gateway_config config;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (!strcmp(arg, "--controller") && value) {
+            config.controllers.push_back(value);
+            i++;
+        } else if (!strcmp(arg, "--port") && value) {
+            config.ws_port = (uint16_t)atoi(value);
+            i++;
+        } else if (!strcmp(arg, "--tcp-port") && value) {
+            config.tcp_port = (uint16_t)atoi(value);
+            i++;
+        } else if (!strcmp(arg, "--workers") && value) {
+            config.workers = atoi(value);
+            i++;
+        } else if (!strcmp(arg, "--token") && value) {
+            config.dispatch_token = value;
+            i++;
+        } else if (!strcmp(arg, "--max-queue") && value) {
+            config.max_client_queue = (size_t)strtoull(value, nullptr, 10);
+            i++;
+        } else if (!strcmp(arg, "--ack-timeout") && value) {
+            config.ack_timeout_us = strtoll(value, nullptr, 10) * 1000;
+            i++;
+        } else if (!strcmp(arg, "--verbose")) {
+            config.verbose = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (config.controllers.empty()) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Env var keeps the secret out of the process list
+    if (config.dispatch_token.empty() && getenv("GRIDDY_GATEWAY_TOKEN")) {
+        config.dispatch_token = getenv("GRIDDY_GATEWAY_TOKEN");
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    griddy::raise_fd_limit(65536);
+
+    griddy::gateway gw(config);
+    if (!gw.start()) {
+        return 1;
+    }
+    while (!stop_requested) {
+        pause();
+    }
+    gw.stop();
+    fprintf(stderr, "[gateway] final %s\n", gw.stats_json().c_str());
+    return 0;
+}
@@ -0,0 +1,207 @@
+// json_bench: cost of the firmware's JSON telemetry writer (telemetry_json.c)
+// against the binary encoder, per frame and node count.
+//
+// Each round samples the grid model into a set of snapshots, then times
+// grid_model_encode() (binary), grid_model_encode_json() and a printf-based
+// JSON writer over the same snapshots. The printf writer stands in for the
+// usual "%.4f" approach. Every JSON frame is checked against it number by
+// number.
+//
+//   json_bench [--nodes N1,N2,...] [--frames N] [--fields] [--seed N]
+//
+// Prints one JSON line per node count.
+
+#include "grid_model.h"
+#include "telemetry_json.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int SNAPSHOTS = 64;
+
+struct bench_options {
+    std::vector<int> nodes{8, 16, 32, 64, 128};
+    int frames = 50000;
+    bool fields = false;
+    uint32_t seed = 1;
+};
+
+void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [--nodes N1,N2,...] [--frames N] [--fields] [--seed N]\n", argv0);
+}
+
+bool parse_list(const char *value, std::vector<int> &out)
+{
+    out.clear();
+    const char *p = value;
+    while (*p) {
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (end == p || v < 1 || v > 255) {
+            return false;
+        }
+        out.push_back((int)v);
+        p = *end == ',' ? end + 1 : end;
+    }
+    return !out.empty();
+}
+
+// The straightforward writer: one snprintf per node
+size_t printf_json(const grid_model_t &model, char *buf, size_t size)
+{
+    int len = snprintf(buf, size, "{\"timestamp\":%llu,\"timestamp_us\":%llu,\"nodes\":[",
+                       (unsigned long long)(model.timestamp_us / 1000), (unsigned long long)model.timestamp_us);
+    for (int i = 0; i < model.node_count && len < (int)size; i++) {
+        const grid_node_t &n = model.nodes[i];
+        len += snprintf(buf + len, size - len, "%s{\"id\":%u,\"type\":\"%s\",\"demand\":%.4f,\"ff\":%.4f",
+                        i ? "," : "", (unsigned)n.id, n.type == NODE_TYPE_CONSUMER ? "consumer" : "power",
+                        n.demand, n.fulfillment);
+        if (n.fields && len < (int)size) {
+            len += snprintf(buf + len, size - len, ",\"sensed\":{\"min\":%.4f,\"max\":%.4f,\"mean\":%.4f,\"rms\":%.4f}",
+                            n.field[0], n.field[1], n.field[2], n.field[3]);
+        }
+        if (len < (int)size) {
+            len += snprintf(buf + len, size - len, "}");
+        }
+    }
+    if (len < (int)size) {
+        len += snprintf(buf + len, size - len, "]}");
+    }
+    return len < (int)size ? (size_t)len : 0;
+}
+
+// Largest difference between the numbers of two frames with the same
+// layout; -1 if the text between numbers differs
+double compare_numbers(const char *a, const char *b)
+{
+    double worst = 0.0;
+    while (*a && *b) {
+        bool num_a = (*a >= '0' && *a <= '9') || *a == '-';
+        bool num_b = (*b >= '0' && *b <= '9') || *b == '-';
+        if (num_a && num_b) {
+            char *end_a, *end_b;
+            double va = strtod(a, &end_a);
+            double vb = strtod(b, &end_b);
+            worst = std::max(worst, std::fabs(va - vb));
+            a = end_a;
+            b = end_b;
+        } else if (*a++ != *b++) {
+            return -1.0;
+        }
+    }
+    return *a == *b ? worst : -1.0;
+}
+
+template <typename F> double time_ns_per_frame(int frames, F encode)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) {
+        encode(f % SNAPSHOTS);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / frames;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    bench_options opt;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = true;
+        if (!strcmp(arg, "--fields")) {
+            opt.fields = true;
+            continue;
+        }
+        if (!strcmp(arg, "--nodes") && value) ok = parse_list(value, opt.nodes);
+        else if (!strcmp(arg, "--frames") && value) ok = (opt.frames = atoi(value)) > 0;
+        else if (!strcmp(arg, "--seed") && value) opt.seed = (uint32_t)strtoul(value, nullptr, 10);
+        else ok = false;
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    std::vector<uint8_t> binary(telemetry_max_packet_size(255));
+    std::vector<char> json(telemetry_json_max_size(255));
+    std::vector<char> reference(telemetry_json_max_size(255) * 2);
+    std::vector<grid_model_t> snapshots(SNAPSHOTS);
+
+    for (int n : opt.nodes) {
+        std::vector<uint8_t> ids((size_t)n);
+        for (int i = 0; i < n; i++) {
+            ids[(size_t)i] = (uint8_t)(i + 1);
+        }
+        grid_model_t model;
+        grid_model_init(&model, ids.data(), n, opt.seed);
+        for (int s = 0; s < SNAPSHOTS; s++) {
+            grid_model_update(&model, (int64_t)s * 41667);  // 24 Hz
+            if (opt.fields) {
+                for (int i = 0; i < n; i++) {
+                    grid_node_t &node = model.nodes[i];
+                    node.fields = TELEMETRY_FIELDS_ALL;
+                    node.field[0] = node.demand * 0.9f;
+                    node.field[1] = node.demand * 1.1f;
+                    node.field[2] = node.demand * 0.01f;
+                    node.field[3] = node.demand;
+                }
+            }
+            snapshots[(size_t)s] = model;
+        }
+
+        // Sizes and correctness over every snapshot
+        size_t binary_bytes = 0, json_bytes = 0, printf_bytes = 0;
+        double max_error = 0.0;
+        for (const grid_model_t &m : snapshots) {
+            binary_bytes += grid_model_encode(&m, binary.data());
+            size_t len = grid_model_encode_json(m.nodes, m.node_count, m.timestamp_us, json.data(), json.size());
+            size_t ref = printf_json(m, reference.data(), reference.size());
+            if (len == 0 || ref == 0) {
+                fprintf(stderr, "[json] frame of %d nodes did not fit\n", n);
+                return 2;
+            }
+            json_bytes += len;
+            printf_bytes += ref;
+            double error = compare_numbers(json.data(), reference.data());
+            if (error < 0) {
+                fprintf(stderr, "[json] layout differs from printf output:\n%s\n%s\n", json.data(), reference.data());
+                return 2;
+            }
+            max_error = std::max(max_error, error);
+        }
+
+        volatile size_t sink = 0;
+        double binary_ns = time_ns_per_frame(opt.frames, [&](int s) {
+            sink = sink + grid_model_encode(&snapshots[(size_t)s], binary.data());
+        });
+        double json_ns = time_ns_per_frame(opt.frames, [&](int s) {
+            const grid_model_t &m = snapshots[(size_t)s];
+            sink = sink + grid_model_encode_json(m.nodes, m.node_count, m.timestamp_us, json.data(), json.size());
+        });
+        double printf_ns = time_ns_per_frame(opt.frames, [&](int s) {
+            sink = sink + printf_json(snapshots[(size_t)s], reference.data(), reference.size());
+        });
+
+        printf("{\"nodes\":%d,\"fields\":%s,\"binary_bytes\":%.1f,\"json_bytes\":%.1f,\"printf_json_bytes\":%.1f,"
+               "\"json_to_binary_bytes\":%.2f,\"binary_ns_per_frame\":%.1f,\"json_ns_per_frame\":%.1f,"
+               "\"printf_json_ns_per_frame\":%.1f,\"json_ns_per_node\":%.2f,\"json_speedup_vs_printf\":%.2f,"
+               "\"max_number_error\":%.6f}\n",
+               n, opt.fields ? "true" : "false", (double)binary_bytes / SNAPSHOTS, (double)json_bytes / SNAPSHOTS,
+               (double)printf_bytes / SNAPSHOTS, (double)json_bytes / (double)binary_bytes, binary_ns, json_ns,
+               printf_ns, json_ns / n, printf_ns / json_ns, max_error);
+    }
+    return 0;
+}
@@ -0,0 +1,654 @@
+// griddy_loadgen: M /out subscribers and K /in dispatchers against one controller.
+//
+//   griddy_loadgen --target 192.168.1.50 [--subscribers M] [--dispatchers K]
+//                  [--sweep-subscribers 1,2,4] [--sweep-dispatchers 0,1,2]
+//                  [--duration S] [--dispatch-rate HZ] [--dispatch-nodes N]
+//                  [--expected-rate HZ] [--query "?device=3"] [--threads N]
+//                  [--connect-interval-ms MS] [--in-target HOST[:PORT]]
+//                  [--churn-rate HZ] [--dense] [--record FILE] [--clock-sync HZ]
+//
+// Works against a real ESP32, griddy_fleet_sim or griddy_gateway. Prints one
+// JSON line per (M, K) combination:
+//   subscribe: per-subscriber delivered rate, inter-arrival time, jitter
+//              (|difference of consecutive inter-arrivals|), and frames lost
+//              according to gaps in the device timestamps
+//   dispatch:  frames sent, acked, rejected and unacked, and the latency
+//              from send to the device's "DACK" (dispatch applied) ack
+//
+// --in-target sends /in to another listener (the firmware's control port) and
+// --churn-rate adds /out connect/disconnect cycles on top of the subscribers,
+// so dispatch latency can be compared with /in on the shared server and on
+// its own under the same /out load. --dense sends DDSP frames (uint16 duties
+// for node ids 1..N) instead of DISP. --record writes every frame the first
+// subscriber receives to FILE as a trace for rbe_bench (the GET /history
+// layout: uint16 length, then the frame). --clock-sync pings the controller
+// clock from every subscriber (TSYN on /out) and adds the estimated offset and
+// drift, and the one-way latency from frame timestamp to arrival, to the
+// subscribe results.
+
+#include "binary_protocol.h"
+#include "clock_sync.hpp"
+#include "event_loop.hpp"
+#include "histogram.hpp"
+#include "net.hpp"
+#include "ws_connection.hpp"
+
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace griddy;
+
+static volatile sig_atomic_t stop_requested = 0;
+static FILE *record_file = nullptr;     // --record; written by the first subscriber only
+
+static void on_signal(int)
+{
+    stop_requested = 1;
+}
+
+namespace {
+
+constexpr size_t LEARN_DELTAS = 16;
+
+struct options {
+    std::string host;
+    uint16_t port = 80;
+    std::string query;                  // Appended to /out and /in, e.g. "?device=3"
+    std::string in_host;                // /in listener, defaults to host:port
+    uint16_t in_port = 0;
+    double churn_rate_hz = 0.0;         // Extra /out handshakes per second
+    bool dense = false;                 // DDSP instead of DISP frames
+    std::vector<int> subscribers{1};
+    std::vector<int> dispatchers{0};
+    int threads = 1;
+    double duration_s = 10.0;
+    double dispatch_rate_hz = 10.0;     // Per dispatcher
+    int dispatch_nodes = 4;
+    double expected_rate_hz = 0.0;      // 0 = learn the period from device timestamps
+    int connect_interval_ms = 0;
+    double clock_sync_hz = 0.0;         // TSYN pings per subscriber per second
+};
+
+struct subscriber {
+    ws_connection::ptr conn;
+    bool open = false;
+    bool failed = false;
+    uint64_t frames = 0;
+    uint64_t decode_errors = 0;
+    uint64_t drops = 0;
+    int64_t first_us = 0;
+    int64_t last_us = 0;
+    int64_t last_interarrival_us = -1;
+    bool have_ts = false;
+    uint64_t last_ts = 0;
+    uint64_t period_us = 0;             // Device frame period, 0 while learning
+    std::vector<uint64_t> learning;     // Timestamp deltas seen before period_us is known
+    bool recorder = false;              // Appends its frames to record_file
+    clock_sync clock;                   // --clock-sync
+};
+
+struct dispatcher {
+    ws_connection::ptr conn;
+    bool open = false;
+    bool failed = false;
+    uint64_t sent = 0;
+    uint64_t send_failed = 0;
+    uint64_t acked = 0;
+    uint64_t rejected = 0;
+    uint64_t unexpected_acks = 0;
+    std::deque<int64_t> inflight;       // Send times, acks arrive in order
+    uint32_t rng = 0;
+};
+
+struct client_thread {
+    event_loop loop;
+    std::thread thread;
+    std::vector<std::unique_ptr<subscriber>> subs;
+    std::vector<std::unique_ptr<dispatcher>> disps;
+    histogram interarrival;
+    histogram jitter;
+    histogram ack_latency;
+    histogram one_way;                  // Frame arrival minus its timestamp on the local clock
+    uint64_t closed_early = 0;
+    uint64_t churned = 0;
+    ws_connection::ptr churn;
+    bool stopping = false;
+};
+
+// A late frame followed by an on-time one stretches one gap to just under two
+// periods, so only gaps of 1.75 periods or more count as lost frames
+uint64_t count_drops(uint64_t delta_us, uint64_t period_us)
+{
+    if (period_us == 0 || delta_us * 4 < period_us * 7) {
+        return 0;
+    }
+    return (delta_us + period_us / 2) / period_us - 1;
+}
+
+void finish_learning(subscriber &s)
+{
+    if (s.learning.empty()) {
+        return;
+    }
+    uint64_t period = UINT64_MAX;
+    for (uint64_t d : s.learning) {
+        if (d > 0 && d < period) period = d;
+    }
+    s.period_us = period == UINT64_MAX ? 0 : period;
+    for (uint64_t d : s.learning) {
+        s.drops += count_drops(d, s.period_us);
+    }
+    s.learning.clear();
+}
+
+void on_telemetry(client_thread &t, subscriber &s, const uint8_t *data, size_t len)
+{
+    int64_t now = now_us();
+    time_sync_t sync;
+    if (decode_time_sync(data, len, &sync)) {
+        if (sync.magic == TIME_SYNC_REPLY_MAGIC) {
+            s.clock.add(sync, now);
+        }
+        return;
+    }
+    telemetry_packet_t packet;
+    if (!decode_telemetry(data, len, &packet)) {
+        s.decode_errors++;
+        return;
+    }
+    if (s.clock.synced()) {
+        t.one_way.record(now - s.clock.to_local(packet.timestamp_us));
+    }
+    if (s.recorder && record_file) {
+        uint16_t n = (uint16_t)len;
+        fwrite(&n, 2, 1, record_file);
+        fwrite(data, 1, len, record_file);
+    }
+
+    if (s.frames > 0) {
+        int64_t ia = now - s.last_us;
+        t.interarrival.record(ia);
+        if (s.last_interarrival_us >= 0) {
+            t.jitter.record(std::llabs(ia - s.last_interarrival_us));
+        }
+        s.last_interarrival_us = ia;
+    } else {
+        s.first_us = now;
+    }
+    s.last_us = now;
+    s.frames++;
+
+    if (s.have_ts) {
+        uint64_t delta = packet.timestamp_us - s.last_ts;
+        if (s.period_us == 0) {
+            s.learning.push_back(delta);
+            if (s.learning.size() >= LEARN_DELTAS) {
+                finish_learning(s);
+            }
+        } else {
+            s.drops += count_drops(delta, s.period_us);
+        }
+    }
+    s.have_ts = true;
+    s.last_ts = packet.timestamp_us;
+}
+
+void open_subscriber(client_thread &t, subscriber &s, const options &opt)
+{
+    subscriber *sp = &s;
+    client_thread *tp = &t;
+    ws_connection::handlers h;
+    h.on_open = [sp](ws_connection &) {
+        sp->open = true;
+        return true;
+    };
+    h.on_message = [tp, sp](ws_connection &, uint8_t op, const uint8_t *data, size_t len) {
+        if (op == ws::OP_BINARY) {
+            on_telemetry(*tp, *sp, data, len);
+        }
+    };
+    h.on_close = [tp, sp](ws_connection &) {
+        if (tp->stopping) {
+            return;
+        }
+        if (sp->open) {
+            tp->closed_early++;
+        } else {
+            sp->failed = true;
+        }
+        sp->open = false;
+    };
+    s.conn = ws_connection::connect(t.loop, opt.host, opt.port, "/out" + opt.query, std::move(h));
+    if (!s.conn) {
+        s.failed = true;
+        return;
+    }
+    if (opt.clock_sync_hz > 0) {
+        int64_t period_us = (int64_t)(1e6 / opt.clock_sync_hz);
+        t.loop.add_timer(period_us, period_us, [sp]() {
+            if (!sp->open) {
+                return;
+            }
+            time_sync_t ping = {};
+            uint8_t buf[TIME_SYNC_SIZE];
+            ping.magic = TIME_SYNC_MAGIC;
+            ping.origin_us = (uint64_t)now_us();
+            sp->conn->send_binary(buf, encode_time_sync(&ping, buf));
+        });
+    }
+}
+
+void send_dispatch(dispatcher &d, const options &opt)
+{
+    if (!d.open) {
+        return;
+    }
+    if (opt.dense) {
+        std::vector<uint16_t> duties((size_t)opt.dispatch_nodes);
+        for (auto &duty : duties) {
+            d.rng = d.rng * 1664525u + 1013904223u;
+            duty = (uint16_t)((d.rng >> 8) % (DISPATCH_DUTY_MAX + 1));
+        }
+        std::vector<uint8_t> frame(DISPATCH_DENSE_HEADER_SIZE + 2 * duties.size());
+        size_t len = encode_dispatch_dense(1, duties.data(), (uint16_t)duties.size(), nullptr,
+                                           frame.data(), frame.size());
+        int64_t now = now_us();
+        if (d.conn->send_binary(frame.data(), len)) {
+            d.sent++;
+            d.inflight.push_back(now);
+        } else {
+            d.send_failed++;
+        }
+        return;
+    }
+    dispatch_packet_t packet;
+    packet.magic = DISPATCH_MAGIC;
+    packet.node_count = (uint8_t)opt.dispatch_nodes;
+    for (int i = 0; i < opt.dispatch_nodes; i++) {
+        d.rng = d.rng * 1664525u + 1013904223u;
+        packet.nodes[i].id = (uint8_t)(i + 1);
+        packet.nodes[i].supply = (float)(d.rng >> 8) / 16777216.0f;
+        packet.nodes[i].source = 1;
+    }
+    uint8_t buffer[5 + 6 * 255];
+    size_t len = encode_dispatch(&packet, buffer);
+    int64_t now = now_us();
+    if (d.conn->send_binary(buffer, len)) {
+        d.sent++;
+        d.inflight.push_back(now);
+    } else {
+        d.send_failed++;
+    }
+}
+
+void open_dispatcher(client_thread &t, dispatcher &d, const options &opt)
+{
+    dispatcher *dp = &d;
+    client_thread *tp = &t;
+    ws_connection::handlers h;
+    h.on_open = [dp](ws_connection &) {
+        dp->open = true;
+        return true;
+    };
+    h.on_message = [tp, dp](ws_connection &, uint8_t op, const uint8_t *data, size_t len) {
+        dispatch_ack_t ack;
+        if (op != ws::OP_BINARY || !decode_dispatch_ack(data, len, &ack)) {
+            return;
+        }
+        if (dp->inflight.empty()) {
+            dp->unexpected_acks++;
+            return;
+        }
+        tp->ack_latency.record(now_us() - dp->inflight.front());
+        dp->inflight.pop_front();
+        if (ack.status == DISPATCH_ACK_APPLIED) {
+            dp->acked++;
+        } else {
+            dp->rejected++;
+        }
+    };
+    h.on_close = [tp, dp](ws_connection &) {
+        if (tp->stopping) {
+            return;
+        }
+        if (dp->open) {
+            tp->closed_early++;
+        } else {
+            dp->failed = true;
+        }
+        dp->open = false;
+    };
+    d.conn = ws_connection::connect(t.loop, opt.in_host, opt.in_port, "/in" + opt.query, std::move(h));
+    if (!d.conn) {
+        d.failed = true;
+        return;
+    }
+    int64_t period_us = (int64_t)(1e6 / opt.dispatch_rate_hz);
+    t.loop.add_timer(period_us, period_us, [dp, &opt]() { send_dispatch(*dp, opt); });
+}
+
+// One short-lived /out connection at a time: each tick drops the previous
+// one and opens a new one, so the device keeps doing WebSocket handshakes
+void churn_subscriber(client_thread &t, const options &opt)
+{
+    if (t.stopping) {
+        return;
+    }
+    if (t.churn) {
+        t.churn->close();
+    }
+    // Counted per attempt: with MAX_OUT_CLIENTS subscribers already
+    // connected the device still does the handshake before refusing it
+    t.churned++;
+    t.churn = ws_connection::connect(t.loop, opt.host, opt.port, "/out" + opt.query, ws_connection::handlers{});
+}
+
+std::string run(const options &opt, int subscribers, int dispatchers)
+{
+    int thread_count = std::max(1, opt.threads);
+    std::vector<std::unique_ptr<client_thread>> threads;
+    for (int i = 0; i < thread_count; i++) {
+        threads.push_back(std::make_unique<client_thread>());
+    }
+    for (int i = 0; i < subscribers; i++) {
+        threads[(size_t)i % threads.size()]->subs.push_back(std::make_unique<subscriber>());
+        threads[(size_t)i % threads.size()]->subs.back()->recorder = i == 0;
+    }
+    for (int i = 0; i < dispatchers; i++) {
+        auto d = std::make_unique<dispatcher>();
+        d->rng = 0x12345u + (uint32_t)i;
+        threads[(size_t)i % threads.size()]->disps.push_back(std::move(d));
+    }
+    for (auto &t : threads) {
+        client_thread *tp = t.get();
+        t->thread = std::thread([tp]() { tp->loop.run(); });
+    }
+
+    // Subscribers first, in the order the backend opens /out and /in
+    int64_t start = now_us();
+    for (int i = 0; i < subscribers + dispatchers && !stop_requested; i++) {
+        bool sub = i < subscribers;
+        int n = sub ? i : i - subscribers;
+        client_thread *tp = threads[(size_t)n % threads.size()].get();
+        size_t slot = (size_t)n / threads.size();
+        if (sub) {
+            subscriber *sp = tp->subs[slot].get();
+            tp->loop.post([tp, sp, &opt]() { open_subscriber(*tp, *sp, opt); });
+        } else {
+            dispatcher *dp = tp->disps[slot].get();
+            tp->loop.post([tp, dp, &opt]() { open_dispatcher(*tp, *dp, opt); });
+        }
+        if (opt.connect_interval_ms > 0) {
+            usleep((useconds_t)opt.connect_interval_ms * 1000);
+        }
+    }
+
+    if (opt.churn_rate_hz > 0) {
+        client_thread *tp = threads[0].get();
+        int64_t period_us = (int64_t)(1e6 / opt.churn_rate_hz);
+        tp->loop.post([tp, period_us, &opt]() {
+            tp->loop.add_timer(period_us, period_us, [tp, &opt]() { churn_subscriber(*tp, opt); });
+        });
+    }
+
+    while (!stop_requested && now_us() - start < (int64_t)(opt.duration_s * 1e6)) {
+        usleep(50000);
+    }
+    for (auto &t : threads) {
+        client_thread *tp = t.get();
+        tp->loop.post([tp]() {
+            tp->stopping = true;
+            for (auto &s : tp->subs) {
+                if (s->conn) s->conn->close();
+            }
+            for (auto &d : tp->disps) {
+                if (d->conn) d->conn->close();
+            }
+            if (tp->churn) tp->churn->close();
+            tp->loop.stop();
+        });
+    }
+    for (auto &t : threads) {
+        t->thread.join();
+    }
+    double elapsed_s = (double)(now_us() - start) / 1e6;
+
+    histogram interarrival, jitter, ack_latency, one_way;
+    const clock_sync *clock = nullptr;  // First synced subscriber
+    uint64_t connected = 0, failed = 0, frames = 0, decode_errors = 0, drops = 0, closed_early = 0;
+    double rate_min = 0.0, rate_max = 0.0, rate_sum = 0.0;
+    uint64_t d_connected = 0, d_failed = 0, sent = 0, send_failed = 0, acked = 0, rejected = 0;
+    uint64_t unacked = 0, unexpected = 0, churned = 0;
+
+    for (auto &t : threads) {
+        interarrival.merge(t->interarrival);
+        jitter.merge(t->jitter);
+        ack_latency.merge(t->ack_latency);
+        one_way.merge(t->one_way);
+        closed_early += t->closed_early;
+        churned += t->churned;
+        for (auto &s : t->subs) {
+            if (s->failed) {
+                failed++;
+                continue;
+            }
+            finish_learning(*s);
+            if (!clock && s->clock.synced()) {
+                clock = &s->clock;
+            }
+            connected++;
+            frames += s->frames;
+            decode_errors += s->decode_errors;
+            drops += s->drops;
+            double rate = s->frames > 1 ? (double)(s->frames - 1) * 1e6 / (double)(s->last_us - s->first_us) : 0.0;
+            if (connected == 1 || rate < rate_min) rate_min = rate;
+            if (rate > rate_max) rate_max = rate;
+            rate_sum += rate;
+        }
+        for (auto &d : t->disps) {
+            if (d->failed) {
+                d_failed++;
+                continue;
+            }
+            d_connected++;
+            sent += d->sent;
+            send_failed += d->send_failed;
+            acked += d->acked;
+            rejected += d->rejected;
+            unacked += d->inflight.size();
+            unexpected += d->unexpected_acks;
+        }
+    }
+
+    // A configured rate overrides the learned period for the drop count
+    if (opt.expected_rate_hz > 0) {
+        drops = 0;
+        uint64_t expected = 0;
+        for (auto &t : threads) {
+            for (auto &s : t->subs) {
+                if (!s->failed && s->frames > 1) {
+                    expected += (uint64_t)std::llround((double)(s->last_us - s->first_us) / 1e6 * opt.expected_rate_hz) + 1;
+                }
+            }
+        }
+        drops = expected > frames ? expected - frames : 0;
+    }
+
+    char buf[1024];
+    snprintf(buf, sizeof(buf),
+             "{\"target\":\"%s:%u%s\",\"in_target\":\"%s:%u\",\"subscribers\":%d,\"dispatchers\":%d,"
+             "\"duration_s\":%.2f,\"churned\":%llu,\"subscribe\":{\"connected\":%llu,\"connect_failed\":%llu,\"closed_early\":%llu,"
+             "\"frames\":%llu,\"decode_errors\":%llu,\"drops\":%llu,\"drop_rate\":%.5f,"
+             "\"rate_hz\":{\"min\":%.2f,\"mean\":%.2f,\"max\":%.2f},",
+             opt.host.c_str(), opt.port, opt.query.c_str(), opt.in_host.c_str(), opt.in_port,
+             subscribers, dispatchers, elapsed_s, (unsigned long long)churned, (unsigned long long)connected, (unsigned long long)failed, (unsigned long long)closed_early,
+             (unsigned long long)frames, (unsigned long long)decode_errors, (unsigned long long)drops,
+             frames + drops ? (double)drops / (double)(frames + drops) : 0.0,
+             rate_min, connected ? rate_sum / (double)connected : 0.0, rate_max);
+    std::string out = buf;
+    out += "\"interarrival_us\":" + interarrival.to_json();
+    out += ",\"jitter_us\":" + jitter.to_json();
+    if (clock) {
+        snprintf(buf, sizeof(buf),
+                 ",\"clock\":{\"exchanges\":%llu,\"offset_us\":%.0f,\"drift_ppm\":%.2f,\"min_rtt_us\":%lld,"
+                 "\"uncertainty_us\":%.0f},",
+                 (unsigned long long)clock->exchanges(), clock->offset_us(), clock->drift_ppm(),
+                 (long long)clock->min_delay_us(), clock->uncertainty_us());
+        out += buf;
+        out += "\"one_way_us\":" + one_way.to_json();
+    }
+    out += "},";
+
+    snprintf(buf, sizeof(buf),
+             "\"dispatch\":{\"connected\":%llu,\"connect_failed\":%llu,\"sent\":%llu,\"send_failed\":%llu,"
+             "\"acked\":%llu,\"rejected\":%llu,\"unacked\":%llu,\"unexpected_acks\":%llu,",
+             (unsigned long long)d_connected, (unsigned long long)d_failed, (unsigned long long)sent,
+             (unsigned long long)send_failed, (unsigned long long)acked, (unsigned long long)rejected,
+             (unsigned long long)unacked, (unsigned long long)unexpected);
+    out += buf;
+    out += "\"ack_latency_us\":" + ack_latency.to_json() + "}}";
+    return out;
+}
+
+bool parse_list(const char *spec, std::vector<int> &out)
+{
+    out.clear();
+    const char *p = spec;
+    while (*p) {
+        char *end = nullptr;
+        long v = strtol(p, &end, 10);
+        if (end == p || v < 0) {
+            return false;
+        }
+        out.push_back((int)v);
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') {
+            return false;
+        }
+    }
+    return !out.empty();
+}
+
+void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s --target HOST[:PORT] [--subscribers M | --sweep-subscribers M1,M2,...]\n"
+            "          [--dispatchers K | --sweep-dispatchers K1,K2,...] [--duration S]\n"
+            "          [--dispatch-rate HZ] [--dispatch-nodes N] [--expected-rate HZ]\n"
+            "          [--query ?device=N] [--threads N] [--connect-interval-ms MS]\n"
+            "          [--in-target HOST[:PORT]] [--churn-rate HZ] [--dense] [--record FILE]\n"
+            "          [--clock-sync HZ]\n",
+            argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    options opt;
+    std::string target;
+    std::string in_target;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+
+        if (!strcmp(arg, "--dense")) {
+            opt.dense = true;
+            continue;
+        }
+        if (!strcmp(arg, "--target") && value) {
+            target = value;
+        } else if ((!strcmp(arg, "--subscribers") || !strcmp(arg, "--sweep-subscribers")) && value) {
+            ok = parse_list(value, opt.subscribers);
+        } else if ((!strcmp(arg, "--dispatchers") || !strcmp(arg, "--sweep-dispatchers")) && value) {
+            ok = parse_list(value, opt.dispatchers);
+        } else if (!strcmp(arg, "--duration") && value) {
+            opt.duration_s = atof(value);
+        } else if (!strcmp(arg, "--dispatch-rate") && value) {
+            opt.dispatch_rate_hz = atof(value);
+            ok = opt.dispatch_rate_hz > 0;
+        } else if (!strcmp(arg, "--dispatch-nodes") && value) {
+            opt.dispatch_nodes = atoi(value);
+            ok = opt.dispatch_nodes >= 1 && opt.dispatch_nodes <= 65535;
+        } else if (!strcmp(arg, "--expected-rate") && value) {
+            opt.expected_rate_hz = atof(value);
+        } else if (!strcmp(arg, "--query") && value) {
+            opt.query = value;
+        } else if (!strcmp(arg, "--threads") && value) {
+            opt.threads = atoi(value);
+        } else if (!strcmp(arg, "--connect-interval-ms") && value) {
+            opt.connect_interval_ms = atoi(value);
+        } else if (!strcmp(arg, "--in-target") && value) {
+            in_target = value;
+        } else if (!strcmp(arg, "--record") && value) {
+            record_file = fopen(value, "wb");
+            ok = record_file != nullptr;
+        } else if (!strcmp(arg, "--churn-rate") && value) {
+            opt.churn_rate_hz = atof(value);
+            ok = opt.churn_rate_hz >= 0;
+        } else if (!strcmp(arg, "--clock-sync") && value) {
+            opt.clock_sync_hz = atof(value);
+            ok = opt.clock_sync_hz >= 0;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+    if (!opt.dense && opt.dispatch_nodes > 255) {
+        fprintf(stderr, "--dispatch-nodes above 255 needs --dense\n");
+        return 1;
+    }
+    if (target.empty() || !parse_host_port(target, 80, opt.host, opt.port)) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (in_target.empty()) {
+        opt.in_host = opt.host;
+        opt.in_port = opt.port;
+    } else if (!parse_host_port(in_target, 81, opt.in_host, opt.in_port)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    int most = 0;
+    for (int m : opt.subscribers) {
+        for (int k : opt.dispatchers) {
+            most = std::max(most, m + k);
+        }
+    }
+    raise_fd_limit((uint64_t)most + 256);
+
+    for (size_t mi = 0; mi < opt.subscribers.size() && !stop_requested; mi++) {
+        for (size_t ki = 0; ki < opt.dispatchers.size() && !stop_requested; ki++) {
+            if (mi + ki > 0) {
+                usleep(500000);  // Let the device reap the previous run's sockets
+            }
+            printf("%s\n", run(opt, opt.subscribers[mi], opt.dispatchers[ki]).c_str());
+            fflush(stdout);
+        }
+    }
+    if (record_file) {
+        fclose(record_file);
+    }
+    return 0;
+}
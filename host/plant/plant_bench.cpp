@@ -0,0 +1,261 @@
+// plant_bench: controller convergence and tracking error against the
+// firmware's closed-loop plant model (grid_model_set_plant).
+//
+// Runs the plant in simulated time at --physics-us steps. A reference
+// controller closes the loop at each --rates entry. It reads telemetry
+// frames through the wire encoder and decoder, adds ki * T * (demand -
+// fulfillment * demand) / output_max to each node's duty, and the new duties
+// reach the plant --delay-ms later, as dispatch would. Demand steps by
+// --step-amps per consumer at --step-at.
+//
+//   plant_bench [--nodes N] [--rates R1,R2,...] [--seconds S] [--step-at S]
+//               [--step-amps A] [--source-amps A] [--output-amps A]
+//               [--line-loss F] [--supply-tau-ms MS] [--demand-tau-ms MS]
+//               [--ki PER_S] [--delay-ms MS] [--wave X] [--band F]
+//               [--physics-us US] [--seed N]
+//
+// Tracking error e(t) is sum |delivered - demand| / sum demand over the
+// consumers, sampled every physics step. Prints one JSON line per rate:
+//   settle_ms       startup: from all outputs off until e stays within --band
+//   step_settle_ms  from the step until e stays within --band (-1: never)
+//   overshoot_pct   peak total delivered over total demand after the step, - 100
+//   steady_error    mean e over the second before the step
+//   step_rms        RMS of e from the step to the end
+//   step_iae_s      integral of e from the step to the end
+
+#include "binary_protocol.h"
+#include "grid_model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct bench_options {
+    int nodes = 8;
+    std::vector<double> rates = {1, 2, 5, 10, 24, 50, 100};
+    double seconds = 20.0;
+    double step_at_s = 10.0;
+    double step_amps = 0.75;
+    double source_amps = 0.0;       // 0 = 4 A per node
+    double output_amps = 5.0;
+    double line_loss = 0.08;
+    double supply_tau_ms = 150.0;
+    double demand_tau_ms = 300.0;
+    double ki = 4.0;                // Integral gain, per second
+    double delay_ms = 0.0;
+    double wave = 0.0;              // Demand wave amplitude scale (0 = flat)
+    double band = 0.02;
+    int64_t physics_us = 1000;
+    uint32_t seed = 1;
+};
+
+struct rate_result {
+    double rate_hz = 0.0;
+    uint64_t dispatches = 0;
+    double settle_ms = -1.0;
+    double step_settle_ms = -1.0;
+    double overshoot_pct = 0.0;
+    double steady_error = 0.0;
+    double step_rms = 0.0;
+    double step_iae_s = 0.0;
+};
+
+void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--nodes N] [--rates R1,R2,...] [--seconds S] [--step-at S] [--step-amps A]\n"
+            "          [--source-amps A] [--output-amps A] [--line-loss F] [--supply-tau-ms MS]\n"
+            "          [--demand-tau-ms MS] [--ki PER_S] [--delay-ms MS] [--wave X] [--band F]\n"
+            "          [--physics-us US] [--seed N]\n",
+            argv0);
+}
+
+bool parse_list(const char *text, std::vector<double> &out)
+{
+    out.clear();
+    while (*text) {
+        char *end;
+        double v = strtod(text, &end);
+        if (end == text || v <= 0) {
+            return false;
+        }
+        out.push_back(v);
+        text = *end == ',' ? end + 1 : end;
+    }
+    return !out.empty();
+}
+
+rate_result run(const bench_options &opt, double rate_hz)
+{
+    rate_result result;
+    result.rate_hz = rate_hz;
+
+    auto model = std::make_unique<grid_model_t>();
+    std::vector<uint8_t> ids((size_t)opt.nodes);
+    for (int n = 0; n < opt.nodes; n++) {
+        ids[(size_t)n] = (uint8_t)(n + 1);
+    }
+    grid_model_init(model.get(), ids.data(), opt.nodes, opt.seed);
+    model->wave_scale = (float)opt.wave;
+
+    grid_plant_config_t plant = {};
+    plant.source_capacity = (float)(opt.source_amps > 0 ? opt.source_amps : 4.0 * opt.nodes);
+    plant.output_max = (float)opt.output_amps;
+    plant.line_loss = (float)opt.line_loss;
+    plant.supply_tau_s = (float)(opt.supply_tau_ms * 1e-3);
+    plant.demand_tau_s = (float)(opt.demand_tau_ms * 1e-3);
+    grid_model_set_plant(model.get(), &plant);
+
+    int64_t period_us = (int64_t)(1e6 / rate_hz);
+    int64_t delay_us = (int64_t)(opt.delay_ms * 1000);
+    int64_t step_us = (int64_t)(opt.step_at_s * 1e6);
+    int64_t end_us = (int64_t)(opt.seconds * 1e6);
+    double k = std::min(1.0, opt.ki / rate_hz);
+
+    std::vector<float> duty((size_t)opt.nodes, 0.0f);
+    std::deque<std::pair<int64_t, std::vector<float>>> in_flight;     // (apply at, duties)
+    std::vector<uint8_t> frame(telemetry_max_packet_size((uint8_t)opt.nodes));
+    telemetry_packet_t packet;
+
+    int64_t next_sample = 0;
+    int64_t last_out_of_band = 0;           // Last step outside the band, before the step
+    int64_t last_out_after_step = -1;
+    double steady_sum = 0.0;
+    uint64_t steady_samples = 0;
+    double sq_sum = 0.0;
+    uint64_t step_samples = 0;
+    double peak_ratio = 0.0;
+
+    for (int64_t t = 0; t <= end_us; t += opt.physics_us) {
+        if (step_us > 0 && t >= step_us) {
+            model->demand_offset = (float)opt.step_amps;
+        }
+        while (!in_flight.empty() && in_flight.front().first <= t) {
+            for (int i = 0; i < opt.nodes; i++) {
+                grid_model_set_supply(model.get(), i, in_flight.front().second[(size_t)i]);
+            }
+            in_flight.pop_front();
+        }
+        grid_model_update(model.get(), t);
+
+        double demand = 0.0;
+        double delivered = 0.0;
+        double abs_error = 0.0;
+        for (int i = 0; i < model->node_count; i++) {
+            double d = model->nodes[i].demand;
+            double a = model->plant_state[i].delivered;
+            demand += d;
+            delivered += a;
+            abs_error += std::fabs(a - d);
+        }
+        double e = demand > 0 ? abs_error / demand : 0.0;
+
+        bool after_step = step_us > 0 && t >= step_us;
+        if (!after_step) {
+            if (e > opt.band) {
+                last_out_of_band = t;
+            }
+            if (t >= step_us - 1000000) {
+                steady_sum += e;
+                steady_samples++;
+            }
+        } else {
+            if (e > opt.band) {
+                last_out_after_step = t;
+            }
+            sq_sum += e * e;
+            step_samples++;
+            result.step_iae_s += e * (double)opt.physics_us * 1e-6;
+            peak_ratio = std::max(peak_ratio, demand > 0 ? delivered / demand : 0.0);
+        }
+
+        if (t >= next_sample) {
+            next_sample += period_us;
+
+            // What the controller sees is what the wire carries
+            size_t len = grid_model_encode(model.get(), frame.data());
+            if (!decode_telemetry(frame.data(), len, &packet)) {
+                continue;
+            }
+            for (int i = 0; i < packet.node_count; i++) {
+                const telemetry_node_t &node = packet.nodes[i];
+                float shortfall = node.demand - node.fulfillment * node.demand;
+                float &d = duty[(size_t)(node.id - 1)];
+                d = std::min(1.0f, std::max(0.0f, d + (float)(k * shortfall / opt.output_amps)));
+            }
+            in_flight.emplace_back(t + delay_us, duty);
+            result.dispatches++;
+        }
+    }
+
+    int64_t pre_end = step_us > 0 ? step_us : end_us;
+    if (last_out_of_band + opt.physics_us < pre_end) {
+        result.settle_ms = (double)(last_out_of_band + opt.physics_us) / 1000.0;
+    }
+    if (step_us > 0) {
+        if (last_out_after_step < 0) {
+            result.step_settle_ms = 0.0;
+        } else if (last_out_after_step + opt.physics_us <= end_us - opt.physics_us) {
+            result.step_settle_ms = (double)(last_out_after_step + opt.physics_us - step_us) / 1000.0;
+        }
+        result.overshoot_pct = (peak_ratio - 1.0) * 100.0;
+        result.step_rms = step_samples ? std::sqrt(sq_sum / (double)step_samples) : 0.0;
+    }
+    result.steady_error = steady_samples ? steady_sum / (double)steady_samples : 0.0;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    bench_options opt;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (!strcmp(arg, "--nodes") && value) ok = (opt.nodes = atoi(value)) >= 1 && opt.nodes <= 255;
+        else if (!strcmp(arg, "--rates") && value) ok = parse_list(value, opt.rates);
+        else if (!strcmp(arg, "--seconds") && value) ok = (opt.seconds = atof(value)) > 0;
+        else if (!strcmp(arg, "--step-at") && value) opt.step_at_s = atof(value);
+        else if (!strcmp(arg, "--step-amps") && value) opt.step_amps = atof(value);
+        else if (!strcmp(arg, "--source-amps") && value) opt.source_amps = atof(value);
+        else if (!strcmp(arg, "--output-amps") && value) ok = (opt.output_amps = atof(value)) > 0;
+        else if (!strcmp(arg, "--line-loss") && value) opt.line_loss = atof(value);
+        else if (!strcmp(arg, "--supply-tau-ms") && value) opt.supply_tau_ms = atof(value);
+        else if (!strcmp(arg, "--demand-tau-ms") && value) opt.demand_tau_ms = atof(value);
+        else if (!strcmp(arg, "--ki") && value) ok = (opt.ki = atof(value)) > 0;
+        else if (!strcmp(arg, "--delay-ms") && value) opt.delay_ms = atof(value);
+        else if (!strcmp(arg, "--wave") && value) opt.wave = atof(value);
+        else if (!strcmp(arg, "--band") && value) opt.band = atof(value);
+        else if (!strcmp(arg, "--physics-us") && value) ok = (opt.physics_us = atoll(value)) > 0;
+        else if (!strcmp(arg, "--seed") && value) opt.seed = (uint32_t)strtoul(value, nullptr, 10);
+        else ok = false;
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+    if (opt.step_at_s >= opt.seconds) {
+        opt.step_at_s = 0.0;
+    }
+
+    for (double rate : opt.rates) {
+        rate_result r = run(opt, rate);
+        printf("{\"rate_hz\":%.1f,\"nodes\":%d,\"ki\":%.2f,\"delay_ms\":%.1f,\"dispatches\":%llu,"
+               "\"settle_ms\":%.1f,\"step_settle_ms\":%.1f,\"overshoot_pct\":%.2f,\"steady_error\":%.4f,"
+               "\"step_rms\":%.4f,\"step_iae_s\":%.4f}\n",
+               r.rate_hz, opt.nodes, opt.ki, opt.delay_ms, (unsigned long long)r.dispatches, r.settle_ms,
+               r.step_settle_ms, r.overshoot_pct, r.steady_error, r.step_rms, r.step_iae_s);
+    }
+    return 0;
+}
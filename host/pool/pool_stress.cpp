@@ -0,0 +1,528 @@
+// pool_stress: the firmware's frame pool (frame_pool.c) under threads, and a
+// simulated soak against a first-fit heap.
+//
+// Stress: producer threads allocate frames, fill them with a pattern, add one
+// reference per consumer and queue them to every consumer thread, like the
+// send task fanning a frame out to subscribers. Consumers check the pattern
+// and release. A block handed out twice, a torn pattern or a block missing
+// from the pool at the end is an error (exit status 2).
+//
+// Soak: replays the firmware's per-tick buffer lifetimes (telemetry frame kept
+// as the latest frame until the next tick, JSON frame, /in control frames)
+// against the same background allocations twice: once with every frame
+// buffer malloc'd at its exact size from a first-fit coalescing heap, once
+// with the frame buffers in pools carved from that heap at boot. Node churn
+// changes the frame sizes. This models the allocator, not the device heap.
+//
+//   pool_stress [--producers N] [--consumers N] [--blocks N] [--block-bytes N]
+//               [--seconds S] [--hours H] [--heap-kb K] [--nodes N] [--seed N]
+//
+// --seconds 0 or --hours 0 skips that part. Prints one JSON line for the
+// stress test and one per allocator for the soak.
+
+#include "frame_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct options {
+    int producers = 2;
+    int consumers = 3;
+    int blocks = 8;
+    int block_bytes = 512;
+    double seconds = 2.0;
+    double hours = 24.0;
+    int heap_kb = 64;
+    int nodes = 16;
+    uint32_t seed = 1;
+};
+
+void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--producers N] [--consumers N] [--blocks N] [--block-bytes N]\n"
+            "          [--seconds S] [--hours H] [--heap-kb K] [--nodes N] [--seed N]\n",
+            argv0);
+}
+
+// ---------------------------------------------------------------------------
+// Stress
+
+struct frame_queue {
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<frame_t *> frames;   // nullptr ends the consumer
+};
+
+uint8_t pattern_byte(uint32_t producer, uint32_t seq, size_t i)
+{
+    return (uint8_t)(producer * 31u + seq * 7u + i);
+}
+
+int run_stress(const options &opt)
+{
+    std::vector<frame_t> frames((size_t)opt.blocks);
+    std::vector<uint8_t> storage((size_t)opt.blocks * (size_t)opt.block_bytes);
+    frame_pool_t pool;
+    if (!frame_pool_init(&pool, "stress", frames.data(), storage.data(), (size_t)opt.block_bytes,
+                         (uint16_t)opt.blocks)) {
+        fprintf(stderr, "[stress] bad pool size\n");
+        return 2;
+    }
+
+    // Set by the producer on allocation and cleared by the last holder;
+    // only the producer adds references, so refs == 1 means sole holder
+    std::unique_ptr<std::atomic<int>[]> owned(new std::atomic<int>[(size_t)opt.blocks]);
+    for (int i = 0; i < opt.blocks; i++) {
+        owned[(size_t)i] = 0;
+    }
+
+    std::vector<frame_queue> queues((size_t)opt.consumers);
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> produced{0}, consumed{0}, double_allocs{0}, corrupt{0}, retries{0};
+
+    auto producer = [&](uint32_t id) {
+        uint32_t seq = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            frame_t *frame = frame_pool_alloc(&pool);
+            if (!frame) {
+                retries++;
+                std::this_thread::yield();
+                continue;
+            }
+            if (owned[frame->index].exchange(1) != 0) {
+                double_allocs++;
+            }
+            size_t len = sizeof(uint32_t) * 2 + (seq % ((uint32_t)opt.block_bytes - 8));
+            memcpy(frame->data, &id, sizeof(id));
+            memcpy(frame->data + 4, &seq, sizeof(seq));
+            for (size_t i = 8; i < len; i++) {
+                frame->data[i] = pattern_byte(id, seq, i);
+            }
+            frame->len = len;
+
+            for (int c = 0; c < opt.consumers; c++) {
+                frame_ref(frame);
+            }
+            for (frame_queue &q : queues) {
+                std::lock_guard<std::mutex> guard(q.lock);
+                q.frames.push_back(frame);
+                q.ready.notify_one();
+            }
+            if (__atomic_load_n(&frame->refs, __ATOMIC_ACQUIRE) == 1) {
+                owned[frame->index] = 0;
+            }
+            frame_release(frame);
+            produced++;
+            seq++;
+        }
+    };
+
+    auto consumer = [&](frame_queue &q) {
+        while (true) {
+            frame_t *frame;
+            {
+                std::unique_lock<std::mutex> guard(q.lock);
+                q.ready.wait(guard, [&] { return !q.frames.empty(); });
+                frame = q.frames.front();
+                q.frames.pop_front();
+            }
+            if (!frame) {
+                return;
+            }
+            uint32_t id, seq;
+            memcpy(&id, frame->data, sizeof(id));
+            memcpy(&seq, frame->data + 4, sizeof(seq));
+            bool ok = frame->len == sizeof(uint32_t) * 2 + (seq % ((uint32_t)opt.block_bytes - 8));
+            for (size_t i = 8; ok && i < frame->len; i++) {
+                ok = frame->data[i] == pattern_byte(id, seq, i);
+            }
+            if (!ok) {
+                corrupt++;
+            }
+            if (__atomic_load_n(&frame->refs, __ATOMIC_ACQUIRE) == 1) {
+                owned[frame->index] = 0;
+            }
+            frame_release(frame);
+            consumed++;
+        }
+    };
+
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> consumer_threads, producer_threads;
+    for (frame_queue &q : queues) {
+        consumer_threads.emplace_back(consumer, std::ref(q));
+    }
+    for (int p = 0; p < opt.producers; p++) {
+        producer_threads.emplace_back(producer, (uint32_t)p);
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(opt.seconds));
+    stop = true;
+    for (std::thread &t : producer_threads) {
+        t.join();
+    }
+    for (frame_queue &q : queues) {
+        std::lock_guard<std::mutex> guard(q.lock);
+        q.frames.push_back(nullptr);
+        q.ready.notify_one();
+    }
+    for (std::thread &t : consumer_threads) {
+        t.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    // Every block back on the free stack exactly once
+    frame_pool_stats_t stats;
+    frame_pool_get_stats(&pool, &stats);
+    std::vector<int> seen((size_t)opt.blocks, 0);
+    int free_blocks = 0;
+    for (uint32_t index = pool.free_head & 0xFFFFu; index != 0xFFFFu && free_blocks <= opt.blocks;
+         index = frames[index].next_free) {
+        seen[index]++;
+        free_blocks++;
+    }
+    bool stack_ok = free_blocks == opt.blocks &&
+                    std::all_of(seen.begin(), seen.end(), [](int n) { return n == 1; });
+
+    printf("{\"test\":\"stress\",\"producers\":%d,\"consumers\":%d,\"blocks\":%d,\"frames\":%llu,"
+           "\"deliveries\":%llu,\"frames_per_s\":%.0f,\"alloc_retries\":%llu,\"exhausted\":%u,\"high_water\":%u,"
+           "\"in_use_after\":%u,\"free_stack_ok\":%s,\"double_allocs\":%llu,\"corrupt\":%llu}\n",
+           opt.producers, opt.consumers, opt.blocks, (unsigned long long)produced.load(),
+           (unsigned long long)consumed.load(), produced.load() / elapsed, (unsigned long long)retries.load(),
+           (unsigned)stats.exhausted, (unsigned)stats.high_water, (unsigned)stats.in_use,
+           stack_ok ? "true" : "false", (unsigned long long)double_allocs.load(),
+           (unsigned long long)corrupt.load());
+
+    bool failed = double_allocs || corrupt || stats.in_use != 0 || !stack_ok ||
+                  consumed.load() != produced.load() * (uint64_t)opt.consumers;
+    return failed ? 2 : 0;
+}
+
+// ---------------------------------------------------------------------------
+// Soak
+
+// First-fit heap with an 8-byte header per block and coalescing on free,
+// the shape of most small-system allocators
+class heap_model {
+public:
+    explicit heap_model(uint32_t size)
+        : size_(size)
+    {
+        free_[0] = size;
+    }
+
+    // Offset of the block, or UINT32_MAX
+    uint32_t alloc(uint32_t bytes)
+    {
+        uint32_t need = ((bytes + 7u) & ~7u) + HEADER;
+        for (auto it = free_.begin(); it != free_.end(); ++it) {
+            if (it->second < need) {
+                continue;
+            }
+            uint32_t offset = it->first;
+            uint32_t rest = it->second - need;
+            free_.erase(it);
+            if (rest >= HEADER + 8) {
+                free_[offset + need] = rest;
+            } else {
+                need += rest;
+            }
+            used_[offset] = need;
+            return offset;
+        }
+        return UINT32_MAX;
+    }
+
+    void release(uint32_t offset)
+    {
+        auto used = used_.find(offset);
+        uint32_t length = used->second;
+        used_.erase(used);
+
+        auto next = free_.lower_bound(offset);
+        if (next != free_.end() && offset + length == next->first) {
+            length += next->second;
+            next = free_.erase(next);
+        }
+        if (next != free_.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                prev->second += length;
+                return;
+            }
+        }
+        free_[offset] = length;
+    }
+
+    uint32_t total_free() const
+    {
+        uint32_t total = 0;
+        for (const auto &block : free_) {
+            total += block.second;
+        }
+        return total;
+    }
+
+    uint32_t largest_free() const
+    {
+        uint32_t largest = 0;
+        for (const auto &block : free_) {
+            largest = std::max(largest, block.second);
+        }
+        return largest;
+    }
+
+    uint32_t size() const { return size_; }
+
+private:
+    static constexpr uint32_t HEADER = 8;
+    uint32_t size_;
+    std::map<uint32_t, uint32_t> free_;   // Offset -> length, address order
+    std::map<uint32_t, uint32_t> used_;
+};
+
+// Frame sizes as the firmware computes them for n nodes
+uint32_t telemetry_bytes(int n) { return 12u + (uint32_t)n * 28u; }
+uint32_t json_bytes(int n) { return 40u + (uint32_t)n * 160u; }
+uint32_t dispatch_bytes(int n) { return 5u + (uint32_t)n * 6u; }
+
+// Firmware defaults: 4 telemetry, 1 JSON and 3 control blocks
+constexpr int TELEMETRY_BLOCKS = 4;
+constexpr int JSON_BLOCKS = 1;
+constexpr int CONTROL_BLOCKS = 3;
+constexpr uint32_t CONTROL_BLOCK_BYTES = 5u + 255u * 6u;
+
+struct soak_result {
+    uint32_t reserved = 0;
+    uint32_t min_largest_free = UINT32_MAX;
+    uint32_t final_largest_free = 0;
+    double max_fragmentation = 0.0;
+    double final_fragmentation = 0.0;
+    uint64_t frame_failures = 0;
+    uint64_t background_failures = 0;
+    uint64_t background_allocs = 0;
+    frame_pool_stats_t pools[3] = {};
+};
+
+soak_result run_soak(const options &opt, bool pools)
+{
+    constexpr int RATE_HZ = 24;
+    const uint64_t ticks = (uint64_t)(opt.hours * 3600.0 * RATE_HZ);
+
+    heap_model heap((uint32_t)opt.heap_kb * 1024u);
+    soak_result result;
+
+    // Pool storage comes out of the heap once, at boot
+    frame_t telemetry_frames[TELEMETRY_BLOCKS], json_frames[JSON_BLOCKS], control_frames[CONTROL_BLOCKS];
+    std::vector<uint8_t> telemetry_storage(TELEMETRY_BLOCKS * telemetry_bytes(opt.nodes));
+    std::vector<uint8_t> json_storage(JSON_BLOCKS * json_bytes(opt.nodes));
+    std::vector<uint8_t> control_storage(CONTROL_BLOCKS * CONTROL_BLOCK_BYTES);
+    frame_pool_t telemetry_pool, json_pool, control_pool;
+    if (pools) {
+        frame_pool_init(&telemetry_pool, "telemetry", telemetry_frames, telemetry_storage.data(),
+                        telemetry_bytes(opt.nodes), TELEMETRY_BLOCKS);
+        frame_pool_init(&json_pool, "json", json_frames, json_storage.data(), json_bytes(opt.nodes), JSON_BLOCKS);
+        frame_pool_init(&control_pool, "control", control_frames, control_storage.data(), CONTROL_BLOCK_BYTES,
+                        CONTROL_BLOCKS);
+        for (size_t bytes : {telemetry_storage.size(), json_storage.size(), control_storage.size()}) {
+            heap.alloc((uint32_t)bytes);
+            result.reserved += (uint32_t)bytes;
+        }
+    }
+
+    // The same background stream for both allocators
+    std::mt19937 rng(opt.seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::multimap<uint64_t, uint32_t> background;   // Expiry tick -> offset
+
+    int nodes = std::min(4, opt.nodes);
+    uint32_t latest_heap = UINT32_MAX;
+    frame_t *latest_frame = nullptr;
+
+    auto sample = [&]() {
+        uint32_t free_bytes = heap.total_free();
+        uint32_t largest = heap.largest_free();
+        double fragmentation = free_bytes ? 1.0 - (double)largest / free_bytes : 0.0;
+        result.min_largest_free = std::min(result.min_largest_free, largest);
+        result.max_fragmentation = std::max(result.max_fragmentation, fragmentation);
+        result.final_largest_free = largest;
+        result.final_fragmentation = fragmentation;
+    };
+
+    for (uint64_t tick = 0; tick < ticks; tick++) {
+        // Node churn about once a minute
+        if (unit(rng) < 1.0 / (60.0 * RATE_HZ)) {
+            nodes = 1 + (int)(rng() % (uint32_t)opt.nodes);
+        }
+
+        // Background: packet buffers, request buffers, the odd long-lived
+        // session
+        double r = unit(rng);
+        uint32_t bytes = 0;
+        uint64_t lifetime = 0;
+        if (r < 0.20) {
+            bytes = 32 + rng() % 224;
+            lifetime = 1 + rng() % 48;
+        } else if (r < 0.30) {
+            bytes = 256 + rng() % 1344;
+            lifetime = 1 + rng() % 240;
+        } else if (r < 0.30 + 1.0 / (120.0 * RATE_HZ)) {
+            bytes = 2048 + rng() % 4096;
+            lifetime = (uint64_t)RATE_HZ * (60 + rng() % 540);
+        }
+        if (bytes) {
+            result.background_allocs++;
+            uint32_t offset = heap.alloc(bytes);
+            if (offset == UINT32_MAX) {
+                result.background_failures++;
+            } else {
+                background.emplace(tick + lifetime, offset);
+            }
+        }
+        while (!background.empty() && background.begin()->first <= tick) {
+            heap.release(background.begin()->second);
+            background.erase(background.begin());
+        }
+
+        // Control frames on /in at about 10 Hz, released after dispatch
+        bool control = unit(rng) < 10.0 / RATE_HZ;
+        int dispatch_nodes = 1 + (int)(rng() % (uint32_t)nodes);
+        // Catch-up resync after a credit grant, about once every 2 s
+        bool resync = unit(rng) < 0.5 / RATE_HZ;
+
+        if (pools) {
+            if (control) {
+                frame_t *chunk = frame_pool_alloc(&control_pool);
+                chunk ? frame_release(chunk) : (void)result.frame_failures++;
+            }
+            frame_t *frame = frame_pool_alloc(&telemetry_pool);
+            frame_t *json = frame_pool_alloc(&json_pool);
+            if (!frame || !json) {
+                result.frame_failures++;
+            }
+            if (frame) {
+                frame_ref(frame);
+                if (latest_frame) {
+                    frame_release(latest_frame);
+                }
+                latest_frame = frame;
+                if (resync) {
+                    frame_t *keyframe = frame_pool_alloc(&telemetry_pool);
+                    keyframe ? frame_release(keyframe) : (void)result.frame_failures++;
+                }
+                frame_release(frame);
+            }
+            if (json) {
+                frame_release(json);
+            }
+        } else {
+            if (control) {
+                uint32_t chunk = heap.alloc(dispatch_bytes(dispatch_nodes));
+                chunk == UINT32_MAX ? (void)result.frame_failures++ : heap.release(chunk);
+            }
+            uint32_t frame = heap.alloc(telemetry_bytes(nodes));
+            uint32_t json = heap.alloc(json_bytes(nodes));
+            if (frame == UINT32_MAX || json == UINT32_MAX) {
+                result.frame_failures++;
+            }
+            if (frame != UINT32_MAX) {
+                if (latest_heap != UINT32_MAX) {
+                    heap.release(latest_heap);
+                }
+                latest_heap = frame;
+                if (resync) {
+                    uint32_t keyframe = heap.alloc(telemetry_bytes(nodes));
+                    keyframe == UINT32_MAX ? (void)result.frame_failures++ : heap.release(keyframe);
+                }
+            }
+            if (json != UINT32_MAX) {
+                heap.release(json);
+            }
+        }
+
+        if (tick % RATE_HZ == 0) {
+            sample();
+        }
+    }
+    sample();
+
+    if (pools) {
+        frame_pool_get_stats(&telemetry_pool, &result.pools[0]);
+        frame_pool_get_stats(&json_pool, &result.pools[1]);
+        frame_pool_get_stats(&control_pool, &result.pools[2]);
+    }
+    return result;
+}
+
+void print_soak(const options &opt, const char *allocator, const soak_result &r)
+{
+    printf("{\"test\":\"soak\",\"allocator\":\"%s\",\"hours\":%.1f,\"heap_bytes\":%d,\"nodes\":%d,"
+           "\"reserved_bytes\":%u,\"min_largest_free\":%u,\"final_largest_free\":%u,\"max_fragmentation\":%.3f,"
+           "\"final_fragmentation\":%.3f,\"frame_alloc_failures\":%llu,\"background_allocs\":%llu,"
+           "\"background_alloc_failures\":%llu",
+           allocator, opt.hours, opt.heap_kb * 1024, opt.nodes, (unsigned)r.reserved, (unsigned)r.min_largest_free,
+           (unsigned)r.final_largest_free, r.max_fragmentation, r.final_fragmentation,
+           (unsigned long long)r.frame_failures, (unsigned long long)r.background_allocs,
+           (unsigned long long)r.background_failures);
+    if (r.pools[0].name) {
+        printf(",\"pools\":[");
+        for (int i = 0; i < 3; i++) {
+            printf("%s{\"name\":\"%s\",\"blocks\":%u,\"high_water\":%u,\"exhausted\":%u}", i ? "," : "",
+                   r.pools[i].name, (unsigned)r.pools[i].blocks, (unsigned)r.pools[i].high_water,
+                   (unsigned)r.pools[i].exhausted);
+        }
+        printf("]");
+    }
+    printf("}\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    options opt;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = true;
+        if (!strcmp(arg, "--producers") && value) ok = (opt.producers = atoi(value)) > 0;
+        else if (!strcmp(arg, "--consumers") && value) ok = (opt.consumers = atoi(value)) > 0;
+        else if (!strcmp(arg, "--blocks") && value) ok = (opt.blocks = atoi(value)) > 0 && opt.blocks <= FRAME_POOL_MAX_BLOCKS;
+        else if (!strcmp(arg, "--block-bytes") && value) ok = (opt.block_bytes = atoi(value)) > 8;
+        else if (!strcmp(arg, "--seconds") && value) ok = (opt.seconds = atof(value)) >= 0;
+        else if (!strcmp(arg, "--hours") && value) ok = (opt.hours = atof(value)) >= 0;
+        else if (!strcmp(arg, "--heap-kb") && value) ok = (opt.heap_kb = atoi(value)) >= 16;
+        else if (!strcmp(arg, "--nodes") && value) ok = (opt.nodes = atoi(value)) > 0 && opt.nodes <= 255;
+        else if (!strcmp(arg, "--seed") && value) opt.seed = (uint32_t)strtoul(value, nullptr, 10);
+        else ok = false;
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    int status = 0;
+    if (opt.seconds > 0) {
+        status = run_stress(opt);
+    }
+    if (opt.hours > 0) {
+        print_soak(opt, "heap", run_soak(opt, false));
+        print_soak(opt, "pool", run_soak(opt, true));
+    }
+    return status;
+}
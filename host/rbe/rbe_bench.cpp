@@ -0,0 +1,286 @@
+// rbe_bench: bandwidth versus fidelity of report-by-exception telemetry.
+//
+// Replays a telemetry trace through the firmware's delta encoder
+// (grid_model_encode_exception) and decoder (telemetry_state_apply) once per
+// deadband, and compares what the receiver holds with the trace after every
+// frame.
+//
+//   rbe_bench [--trace FILE] [--nodes N] [--rate HZ] [--seconds S] [--noise A]
+//             [--wave-scale X] [--deadbands A1,A2,...] [--ff-deadband F]
+//             [--keyframe-interval N] [--loss P] [--seed N]
+//
+// --trace reads frames in the GET /history layout (uint16 length, frame), as
+// written by griddy_loadgen --record; GRDD traces are rebuilt first. Without
+// it, N model nodes are sampled at --rate for --seconds, with Gaussian demand
+// noise of --noise amps. --loss drops that fraction of frames before the
+// receiver, as a subscriber out of credit would.
+//
+// Prints one JSON line per demand deadband.
+
+#include "binary_protocol.h"
+#include "grid_model.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct bench_options {
+    std::string trace;
+    int nodes = 16;
+    double rate_hz = 24.0;
+    double seconds = 60.0;
+    double noise_a = 0.0;
+    double wave_scale = 1.0;
+    std::vector<double> deadbands{0.0, 0.01, 0.05, 0.1, 0.25};
+    double ff_deadband = 0.005;
+    int keyframe_interval = 24;
+    double loss = 0.0;
+    uint32_t seed = 1;
+};
+
+void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--trace FILE] [--nodes N] [--rate HZ] [--seconds S] [--noise A]\n"
+            "          [--wave-scale X] [--deadbands A1,A2,...] [--ff-deadband F]\n"
+            "          [--keyframe-interval N] [--loss P] [--seed N]\n",
+            argv0);
+}
+
+bool parse_list(const char *value, std::vector<double> &out)
+{
+    out.clear();
+    const char *p = value;
+    while (*p) {
+        char *end;
+        double v = strtod(p, &end);
+        if (end == p || v < 0) {
+            return false;
+        }
+        out.push_back(v);
+        p = *end == ',' ? end + 1 : end;
+    }
+    return !out.empty();
+}
+
+bool load_trace(const std::string &path, std::vector<telemetry_packet_t> &frames)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) {
+        fprintf(stderr, "[rbe] cannot open %s\n", path.c_str());
+        return false;
+    }
+
+    std::vector<uint8_t> buf(65536);
+    telemetry_state_t state;
+    telemetry_state_init(&state);
+    uint16_t len;
+    uint64_t bad = 0;
+    while (fread(&len, 2, 1, f) == 1 && fread(buf.data(), 1, len, f) == len) {
+        telemetry_packet_t packet;
+        if (!decode_telemetry(buf.data(), len, &packet)) {
+            bad++;
+            continue;
+        }
+        if (telemetry_state_apply(&state, &packet)) {
+            frames.push_back(state.packet);
+            frames.back().magic = TELEMETRY_MAGIC;
+        }
+    }
+    fclose(f);
+    if (bad) {
+        fprintf(stderr, "[rbe] %llu undecodable frames skipped\n", (unsigned long long)bad);
+    }
+    return !frames.empty();
+}
+
+void synthesize(const bench_options &opt, std::vector<telemetry_packet_t> &frames)
+{
+    std::vector<uint8_t> ids((size_t)opt.nodes);
+    for (int i = 0; i < opt.nodes; i++) {
+        ids[(size_t)i] = (uint8_t)(i + 1);
+    }
+    grid_model_t model;
+    grid_model_init(&model, ids.data(), opt.nodes, opt.seed);
+    model.wave_scale = (float)opt.wave_scale;
+
+    std::mt19937 rng(opt.seed);
+    std::normal_distribution<double> noise(0.0, opt.noise_a > 0 ? opt.noise_a : 1.0);
+    uint8_t buf[telemetry_max_packet_size(255)];
+    int64_t count = (int64_t)(opt.rate_hz * opt.seconds);
+    for (int64_t k = 0; k < count; k++) {
+        grid_model_update(&model, (int64_t)(k * 1e6 / opt.rate_hz));
+        if (opt.noise_a > 0) {
+            for (int i = 0; i < model.node_count; i++) {
+                model.nodes[i].demand += (float)noise(rng);
+            }
+        }
+        telemetry_packet_t packet;
+        decode_telemetry(buf, grid_model_encode(&model, buf), &packet);
+        frames.push_back(packet);
+    }
+}
+
+struct result {
+    uint64_t frames = 0;
+    uint64_t full_bytes = 0;
+    uint64_t rbe_bytes = 0;
+    uint64_t node_records = 0;
+    uint64_t keyframes = 0;
+    uint64_t lost = 0;
+    uint64_t stale_frames = 0;      // Frame lost or receiver unsynced after it
+    uint64_t bound_violations = 0;  // Synced node outside its deadband
+    uint64_t compared = 0;
+    double max_demand_error = 0.0;
+    double sum_demand_error = 0.0;
+    double max_ff_error = 0.0;
+};
+
+result run(const std::vector<telemetry_packet_t> &trace, const bench_options &opt, double deadband)
+{
+    result r;
+    grid_model_t model;
+    memset(&model, 0, sizeof(model));
+    grid_model_set_exception(&model, (float)deadband, (float)opt.ff_deadband, (uint16_t)opt.keyframe_interval);
+    telemetry_state_t receiver;
+    telemetry_state_init(&receiver);
+    std::mt19937 rng(opt.seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    uint8_t buf[telemetry_max_packet_size(255)];
+
+    for (const telemetry_packet_t &truth : trace) {
+        // Mirror the trace into the model; a changed node set starts over
+        // with a keyframe, like a removal on the device
+        bool same = model.node_count == truth.node_count;
+        for (int i = 0; same && i < truth.node_count; i++) {
+            same = model.nodes[i].id == truth.nodes[i].id;
+        }
+        if (!same) {
+            model.node_count = truth.node_count;
+            for (int i = 0; i < truth.node_count; i++) {
+                model.reports[i] = grid_node_report_t{0.0f, 0.0f, -1.0f, -1.0f, 0};
+            }
+            model.exception.keyframe_due = 1;
+        }
+        model.timestamp_us = truth.timestamp_us;
+        for (int i = 0; i < truth.node_count; i++) {
+            grid_node_t &node = model.nodes[i];
+            node.id = truth.nodes[i].id;
+            node.type = truth.nodes[i].type;
+            node.demand = truth.nodes[i].demand;
+            node.fulfillment = truth.nodes[i].fulfillment;
+            node.fields = truth.nodes[i].fields;
+            memcpy(node.field, truth.nodes[i].field, sizeof(node.field));
+        }
+
+        size_t len = grid_model_encode_exception(&model, buf);
+        r.frames++;
+        r.rbe_bytes += len;
+        r.full_bytes += encode_telemetry(&truth, buf + len);
+
+        telemetry_packet_t packet;
+        if (!decode_telemetry(buf, len, &packet)) {
+            fprintf(stderr, "[rbe] encoder produced an undecodable frame\n");
+            exit(2);
+        }
+        r.node_records += packet.node_count;
+        r.keyframes += (packet.flags & TELEMETRY_DELTA_KEYFRAME) != 0;
+        // A dropped frame leaves the receiver behind until the next one
+        // shows the gap, so it counts as stale too
+        bool lost = opt.loss > 0 && unit(rng) < opt.loss;
+        if (lost) {
+            r.lost++;
+        } else {
+            telemetry_state_apply(&receiver, &packet);
+        }
+        if (lost || !receiver.synced) {
+            r.stale_frames++;
+            continue;
+        }
+
+        for (int i = 0; i < truth.node_count; i++) {
+            const telemetry_node_t &t = truth.nodes[i];
+            const telemetry_node_t *held = nullptr;
+            for (int j = 0; j < receiver.packet.node_count && !held; j++) {
+                if (receiver.packet.nodes[j].id == t.id) {
+                    held = &receiver.packet.nodes[j];
+                }
+            }
+            if (!held) {
+                r.bound_violations++;
+                continue;
+            }
+            double de = std::fabs((double)held->demand - t.demand);
+            double fe = std::fabs((double)held->fulfillment - t.fulfillment);
+            r.compared++;
+            r.sum_demand_error += de;
+            r.max_demand_error = std::max(r.max_demand_error, de);
+            r.max_ff_error = std::max(r.max_ff_error, fe);
+            if (de > deadband + 1e-6 || fe > opt.ff_deadband + 1e-6) {
+                r.bound_violations++;
+            }
+        }
+    }
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    bench_options opt;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (!strcmp(arg, "--trace") && value) opt.trace = value;
+        else if (!strcmp(arg, "--nodes") && value) ok = (opt.nodes = atoi(value)) >= 1 && opt.nodes <= 255;
+        else if (!strcmp(arg, "--rate") && value) ok = (opt.rate_hz = atof(value)) > 0;
+        else if (!strcmp(arg, "--seconds") && value) ok = (opt.seconds = atof(value)) > 0;
+        else if (!strcmp(arg, "--noise") && value) opt.noise_a = atof(value);
+        else if (!strcmp(arg, "--wave-scale") && value) opt.wave_scale = atof(value);
+        else if (!strcmp(arg, "--deadbands") && value) ok = parse_list(value, opt.deadbands);
+        else if (!strcmp(arg, "--ff-deadband") && value) opt.ff_deadband = atof(value);
+        else if (!strcmp(arg, "--keyframe-interval") && value) ok = (opt.keyframe_interval = atoi(value)) >= 1;
+        else if (!strcmp(arg, "--loss") && value) opt.loss = atof(value);
+        else if (!strcmp(arg, "--seed") && value) opt.seed = (uint32_t)strtoul(value, nullptr, 10);
+        else ok = false;
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    std::vector<telemetry_packet_t> trace;
+    if (!opt.trace.empty()) {
+        if (!load_trace(opt.trace, trace)) {
+            fprintf(stderr, "[rbe] no usable frames in %s\n", opt.trace.c_str());
+            return 1;
+        }
+    } else {
+        synthesize(opt, trace);
+    }
+
+    for (double deadband : opt.deadbands) {
+        result r = run(trace, opt, deadband);
+        double frames = (double)std::max<uint64_t>(r.frames, 1);
+        printf("{\"deadband_a\":%.4f,\"ff_deadband\":%.4f,\"keyframe_interval\":%d,\"loss\":%.3f,"
+               "\"frames\":%llu,\"full_bytes_per_frame\":%.1f,\"rbe_bytes_per_frame\":%.1f,\"bytes_ratio\":%.4f,"
+               "\"nodes_per_frame\":%.2f,\"keyframes\":%llu,\"lost\":%llu,\"stale_frames\":%llu,"
+               "\"demand_error_a\":{\"mean\":%.5f,\"max\":%.5f},\"max_ff_error\":%.5f,\"bound_violations\":%llu}\n",
+               deadband, opt.ff_deadband, opt.keyframe_interval, opt.loss, (unsigned long long)r.frames,
+               r.full_bytes / frames, r.rbe_bytes / frames, r.full_bytes ? (double)r.rbe_bytes / r.full_bytes : 0.0,
+               r.node_records / frames, (unsigned long long)r.keyframes, (unsigned long long)r.lost,
+               (unsigned long long)r.stale_frames, r.compared ? r.sum_demand_error / r.compared : 0.0,
+               r.max_demand_error, r.max_ff_error, (unsigned long long)r.bound_violations);
+    }
+    return 0;
+}
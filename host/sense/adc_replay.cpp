@@ -0,0 +1,109 @@
+#include "adc_replay.hpp"
+#include "sense.h"
+
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace griddy {
+
+uint16_t adc_replay::to_code(double amps) const
+{
+    long code = lround(zero_code_ + amps / amps_per_code_);
+    return (uint16_t)(code < 0 ? 0 : code > 4095 ? 4095 : code);
+}
+
+bool adc_replay::load(const std::string &path, std::string &error)
+{
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+
+    std::vector<uint16_t> codes;
+    int channels = 0;
+    std::string line;
+    for (int line_no = 1; std::getline(in, line); line_no++) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::stringstream row(line);
+        std::string cell;
+        int n = 0;
+        while (std::getline(row, cell, ',')) {
+            char *end = nullptr;
+            double amps = strtod(cell.c_str(), &end);
+            if (end == cell.c_str()) {
+                error = path + ":" + std::to_string(line_no) + ": not a number";
+                return false;
+            }
+            codes.push_back(to_code(amps));
+            n++;
+        }
+        if (channels == 0) {
+            channels = n;
+        }
+        if (n != channels || n > SENSE_MAX_CHANNELS) {
+            error = path + ":" + std::to_string(line_no) + ": expected " + std::to_string(channels) +
+                    " channels (at most " + std::to_string(SENSE_MAX_CHANNELS) + ")";
+            return false;
+        }
+    }
+    if (codes.empty()) {
+        error = path + ": no samples";
+        return false;
+    }
+
+    codes_ = std::move(codes);
+    channels_ = channels;
+    cursor_ = 0;
+    return true;
+}
+
+void adc_replay::synthesize(int channels, double scan_hz, double seconds, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> noise(0.0, 0.02);
+    size_t scans = (size_t)(scan_hz * seconds);
+
+    channels_ = channels;
+    codes_.resize(scans * (size_t)channels);
+    cursor_ = 0;
+    for (size_t s = 0; s < scans; s++) {
+        double t = s / scan_hz;
+        for (int c = 0; c < channels; c++) {
+            double peak = 0.5 + 0.4 * c;
+            double amps = peak * sin(2 * M_PI * 50 * t + c) + 0.1 * peak * sin(2 * M_PI * 150 * t) + noise(rng);
+            codes_[s * (size_t)channels + (size_t)c] = to_code(amps);
+        }
+    }
+}
+
+size_t adc_replay::next_frame(uint8_t *frame, size_t size)
+{
+    size_t words = size / 2;
+    for (size_t i = 0; i < words; i++) {
+        uint16_t word = sense_pack_word((uint8_t)(cursor_ % (size_t)channels_), codes_[cursor_]);
+        frame[2 * i] = (uint8_t)(word & 0xFF);
+        frame[2 * i + 1] = (uint8_t)(word >> 8);
+        if (++cursor_ == codes_.size()) {
+            cursor_ = 0;
+        }
+    }
+    return words * 2;
+}
+
+double adc_replay::reference_rms(int channel) const
+{
+    double sum_sq = 0.0;
+    size_t n = scans();
+    for (size_t s = 0; s < n; s++) {
+        double amps = ((int32_t)codes_[s * (size_t)channels_ + (size_t)channel] - zero_code_) * (double)amps_per_code_;
+        sum_sq += amps * amps;
+    }
+    return n ? sqrt(sum_sq / n) : 0.0;
+}
+
+} // namespace griddy
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace griddy {
+
+// Mock of the ESP32 continuous ADC: replays a per-channel current waveform
+// as TYPE1 DMA frames (the same bytes adc_continuous_read() returns), the
+// channels scanned in order like the firmware's conversion pattern.
+class adc_replay {
+public:
+    adc_replay(int32_t zero_code, float amps_per_code) : zero_code_(zero_code), amps_per_code_(amps_per_code) {}
+
+    /**
+     * Load a waveform: one row per scan, one comma-separated current in amps
+     * per channel; blank lines and lines starting with '#' are skipped.
+     */
+    bool load(const std::string &path, std::string &error);
+
+    // Mains-like test waveform: 50 Hz fundamental with a 3rd harmonic and
+    // noise, a different amplitude per channel, scan_hz scans per second
+    void synthesize(int channels, double scan_hz, double seconds, uint32_t seed);
+
+    // Fill frame with up to size / 2 samples, looping over the waveform
+    size_t next_frame(uint8_t *frame, size_t size);
+
+    int channels() const { return channels_; }
+    size_t scans() const { return channels_ ? codes_.size() / (size_t)channels_ : 0; }
+
+    // RMS current of a channel over the whole waveform, after quantisation,
+    // as the reference for window results
+    double reference_rms(int channel) const;
+
+private:
+    uint16_t to_code(double amps) const;
+
+    int32_t zero_code_;
+    float amps_per_code_;
+    int channels_ = 0;
+    std::vector<uint16_t> codes_;   // Scan-major: codes_[scan * channels_ + channel]
+    size_t cursor_ = 0;
+};
+
+} // namespace griddy
@@ -0,0 +1,253 @@
+// sense_bench: replay a current waveform through the firmware's sensing
+// pipeline (sense.c) on the host.
+//
+// A producer thread plays the ADC (adc_replay) and fills two DMA-sized
+// frames in turn; the consumer takes each full frame, feeds it to
+// sense_feed() and closes a window every --sample-hz / --window-hz samples,
+// like the telemetry tick does on the device. Frames are handed over
+// ping-pong style, so production overlaps processing as it does with DMA.
+// A second pass times the decimating filter bank alone on in-cache scans.
+//
+//   sense_bench [--waveform FILE | --channels N] [--sample-hz HZ] [--window-hz HZ]
+//               [--decimation N] [--frame-bytes N] [--frames N] [--seed N]
+//
+// Prints one JSON object on stdout: processing cost per sample (ns, and TSC
+// cycles on x86), the projected CPU share at --sample-hz, wakeups per
+// second, and the worst window RMS error against the waveform's own RMS.
+
+#include "adc_replay.hpp"
+#include "sense.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace griddy;
+
+namespace {
+
+struct bench_options {
+    std::string waveform;
+    int channels = 4;
+    double sample_hz = 20000.0;     // Aggregate, like CONFIG_POWER_GRID_SENSE_SAMPLE_HZ
+    double window_hz = 10.0;        // Telemetry rate
+    int decimation = 8;             // CONFIG_POWER_GRID_SENSE_DECIMATION
+    size_t frame_bytes = 1024;      // ADC_SENSE_FRAME_BYTES
+    uint64_t frames = 200000;
+    uint32_t seed = 1;
+    int32_t zero_code = 2048;
+    float amps_per_code = 0.002f;
+};
+
+// Two frames; the producer fills one while the consumer drains the other
+struct ping_pong {
+    std::vector<uint8_t> frame[2];
+    size_t len[2] = {0, 0};
+    bool full[2] = {false, false};
+    bool done = false;
+    std::mutex lock;
+    std::condition_variable changed;
+};
+
+void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--waveform FILE | --channels N] [--sample-hz HZ] [--window-hz HZ]\n"
+            "          [--decimation N] [--frame-bytes N] [--frames N] [--seed N]\n",
+            argv0);
+}
+
+void parse_args(int argc, char **argv, bench_options &opt)
+{
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char *k = argv[i];
+        const char *v = argv[i + 1];
+        if (!strcmp(k, "--waveform")) opt.waveform = v;
+        else if (!strcmp(k, "--channels")) opt.channels = atoi(v);
+        else if (!strcmp(k, "--sample-hz")) opt.sample_hz = atof(v);
+        else if (!strcmp(k, "--window-hz")) opt.window_hz = atof(v);
+        else if (!strcmp(k, "--decimation")) opt.decimation = atoi(v);
+        else if (!strcmp(k, "--frame-bytes")) opt.frame_bytes = (size_t)atol(v);
+        else if (!strcmp(k, "--frames")) opt.frames = strtoull(v, nullptr, 10);
+        else if (!strcmp(k, "--seed")) opt.seed = (uint32_t)strtoul(v, nullptr, 10);
+        else {
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+    opt.channels = std::max(1, std::min(opt.channels, SENSE_MAX_CHANNELS));
+    opt.frame_bytes = std::max<size_t>(2, opt.frame_bytes & ~(size_t)1);
+}
+
+// Invariant TSC ticks (nominal-frequency cycles); 0 where there is none
+uint64_t cycle_count()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Filter bank alone over in-cache scans: ns and cycles per sample of one channel
+void time_filter_bank(int channels, int decimation, double &ns_per_sample, double &cycles_per_sample)
+{
+    static int32_t scans[SENSE_BLOCK_SCANS][FILTER_BANK_LANES];
+    for (int s = 0; s < SENSE_BLOCK_SCANS; s++) {
+        for (int l = 0; l < FILTER_BANK_LANES; l++) {
+            scans[s][l] = l < channels ? (s * 37 + l * 101) % 2048 - 1024 : 0;
+        }
+    }
+
+    filter_bank_t bank;
+    filter_bank_init(&bank, channels, decimation);
+    const int blocks = 200000;
+    auto t0 = std::chrono::steady_clock::now();
+    uint64_t c0 = cycle_count();
+    for (int b = 0; b < blocks; b++) {
+        filter_bank_feed(&bank, scans, SENSE_BLOCK_SCANS);
+    }
+    uint64_t c1 = cycle_count();
+    auto t1 = std::chrono::steady_clock::now();
+
+    double samples = (double)blocks * SENSE_BLOCK_SCANS * channels;
+    ns_per_sample = std::chrono::duration<double, std::nano>(t1 - t0).count() / samples;
+    cycles_per_sample = (double)(c1 - c0) / samples;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    bench_options opt;
+    parse_args(argc, argv, opt);
+
+    adc_replay adc(opt.zero_code, opt.amps_per_code);
+    if (!opt.waveform.empty()) {
+        std::string error;
+        if (!adc.load(opt.waveform, error)) {
+            fprintf(stderr, "[sense] %s\n", error.c_str());
+            return 1;
+        }
+    } else {
+        adc.synthesize(opt.channels, opt.sample_hz / opt.channels, 1.0, opt.seed);
+    }
+    int channels = adc.channels();
+
+    uint8_t adc_channels[SENSE_MAX_CHANNELS];
+    for (int c = 0; c < channels; c++) {
+        adc_channels[c] = (uint8_t)c;
+    }
+    sense_t sense;
+    sense_init(&sense, adc_channels, channels, opt.zero_code, opt.amps_per_code, opt.decimation);
+
+    std::vector<double> reference((size_t)channels);
+    for (int c = 0; c < channels; c++) {
+        reference[(size_t)c] = adc.reference_rms(c);
+    }
+
+    ping_pong pp;
+    pp.frame[0].resize(opt.frame_bytes);
+    pp.frame[1].resize(opt.frame_bytes);
+
+    std::thread producer([&]() {
+        for (uint64_t f = 0; f < opt.frames; f++) {
+            int k = (int)(f & 1);
+            std::unique_lock<std::mutex> guard(pp.lock);
+            pp.changed.wait(guard, [&]() { return !pp.full[k]; });
+            guard.unlock();
+            size_t len = adc.next_frame(pp.frame[k].data(), opt.frame_bytes);
+            guard.lock();
+            pp.len[k] = len;
+            pp.full[k] = true;
+            pp.changed.notify_all();
+        }
+        std::lock_guard<std::mutex> guard(pp.lock);
+        pp.done = true;
+        pp.changed.notify_all();
+    });
+
+    uint64_t window_samples = (uint64_t)std::max(1.0, opt.sample_hz / opt.window_hz);
+    uint64_t samples = 0;
+    uint64_t since_window = 0;
+    uint64_t windows = 0;
+    double worst_error = 0.0;
+    std::chrono::nanoseconds busy{0};
+    uint64_t busy_cycles = 0;
+    auto started = std::chrono::steady_clock::now();
+
+    for (uint64_t f = 0;; f++) {
+        int k = (int)(f & 1);
+        {
+            std::unique_lock<std::mutex> guard(pp.lock);
+            pp.changed.wait(guard, [&]() { return pp.full[k] || pp.done; });
+            if (!pp.full[k]) {
+                break;
+            }
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t c0 = cycle_count();
+        sense_feed(&sense, pp.frame[k].data(), pp.len[k]);
+        uint64_t n = pp.len[k] / 2;
+        samples += n;
+        since_window += n;
+        sense_window_t window;
+        bool closed = since_window >= window_samples;
+        if (closed) {
+            sense_take_window(&sense, &window);
+            since_window = 0;
+        }
+        busy_cycles += cycle_count() - c0;
+        busy += std::chrono::steady_clock::now() - t0;
+
+        {
+            std::lock_guard<std::mutex> guard(pp.lock);
+            pp.full[k] = false;
+            pp.changed.notify_all();
+        }
+
+        // Skip the first window: it may start mid-waveform
+        if (closed && windows++ > 0) {
+            for (int c = 0; c < channels; c++) {
+                if (reference[(size_t)c] > 0.0) {
+                    double error = fabs(window.rms_amps[c] - reference[(size_t)c]) / reference[(size_t)c];
+                    worst_error = std::max(worst_error, error);
+                }
+            }
+        }
+    }
+    producer.join();
+    double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    double ns_per_sample = samples ? (double)busy.count() / samples : 0.0;
+    double cycles_per_sample = samples ? (double)busy_cycles / samples : 0.0;
+    double filter_ns = 0.0, filter_cycles = 0.0;
+    time_filter_bank(channels, opt.decimation, filter_ns, filter_cycles);
+
+    printf("{\"channels\":%d,\"sample_hz\":%.0f,\"window_hz\":%.2f,\"decimation\":%d,\"output_hz\":%.1f,"
+           "\"frame_bytes\":%zu,\"frames\":%llu,\"samples\":%llu,\"windows\":%llu,"
+           "\"ns_per_sample\":%.3f,\"cycles_per_sample\":%.2f,\"msamples_per_s\":%.1f,"
+           "\"filter_ns_per_sample\":%.3f,\"filter_cycles_per_sample\":%.2f,"
+           "\"cpu_share_at_rate\":%.6f,\"wakeups_per_s\":%.1f,\"stray\":%u,\"wall_s\":%.3f,"
+           "\"max_window_rms_error\":%.5f}\n",
+           channels, opt.sample_hz, opt.window_hz, sense.bank.decimation,
+           opt.sample_hz / channels / sense.bank.decimation, opt.frame_bytes, (unsigned long long)opt.frames,
+           (unsigned long long)samples, (unsigned long long)windows, ns_per_sample, cycles_per_sample,
+           ns_per_sample > 0 ? 1e3 / ns_per_sample : 0.0, filter_ns, filter_cycles,
+           ns_per_sample * opt.sample_hz * 1e-9, opt.sample_hz / (opt.frame_bytes / 2), (unsigned)sense.stray,
+           wall_s, worst_error);
+    return 0;
+}
@@ -0,0 +1,362 @@
+// shm_bench: frame handoff from one writer to co-located readers through the
+// firmware's shared-memory ring (shm_ring.c), against loopback TCP.
+//
+// The writer steps a grid_model at --rate and publishes each encoded frame.
+// Readers are forked processes, so the ring really is shared between address
+// spaces; each one takes every frame, decodes it (in place in the ring for
+// shm) and records the time from publish to decoded in ns. With --transport
+// tcp the same frames go out length-prefixed on one loopback TCP connection
+// per reader instead, read with blocking recv: the floor under a WebSocket.
+//
+//   shm_bench [--transport shm|tcp] [--readers N] [--rate HZ] [--seconds S]
+//             [--nodes N] [--slots N] [--spin]
+//
+// --rate 0 publishes back to back. --spin makes shm readers poll the ring
+// instead of sleeping on its futex. Prints one JSON line.
+
+#include "binary_protocol.h"
+#include "grid_model.h"
+#include "histogram.hpp"
+#include "shm_ring.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t STAMP_SLOTS = 1u << 20;     // Publish times, by sequence
+
+struct bench_options {
+    bool tcp = false;
+    int readers = 2;
+    double rate_hz = 1000.0;
+    double seconds = 5.0;
+    int nodes = 16;
+    uint32_t slots = 256;
+    bool spin = false;
+};
+
+// One per reader, in memory shared with the parent
+struct reader_result {
+    uint64_t frames = 0;
+    uint64_t lost = 0;
+    uint64_t invalid = 0;
+    griddy::histogram handoff_ns;
+};
+
+void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [--transport shm|tcp] [--readers N] [--rate HZ] [--seconds S]\n"
+            "          [--nodes N] [--slots N] [--spin]\n",
+            argv0);
+}
+
+int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void sleep_until_ns(int64_t deadline)
+{
+    struct timespec ts;
+    ts.tv_sec = deadline / 1000000000;
+    ts.tv_nsec = deadline % 1000000000;
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+}
+
+void *shared_alloc(size_t size)
+{
+    void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? nullptr : p;
+}
+
+bool read_full(int fd, void *buf, size_t len)
+{
+    uint8_t *p = static_cast<uint8_t *>(buf);
+    while (len > 0) {
+        ssize_t n = recv(fd, p, len, 0);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+bool write_full(int fd, const void *buf, size_t len)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(buf);
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+void shm_reader(const char *name, const bench_options &opt, const int64_t *stamps, reader_result *result,
+                int ready_fd)
+{
+    shm_ring_reader_t reader;
+    if (!shm_ring_reader_open(&reader, name)) {
+        fprintf(stderr, "[shm] reader: cannot open %s\n", name);
+        _exit(1);
+    }
+    char one = 1;
+    (void)!write(ready_fd, &one, 1);
+
+    telemetry_packet_t packet;
+    while (true) {
+        size_t len;
+        uint64_t seq;
+        const uint8_t *frame = shm_ring_peek(&reader, &len, &seq);
+        if (!frame) {
+            if (opt.spin) {
+                if (__atomic_load_n(&reader.header->closed, __ATOMIC_ACQUIRE) &&
+                    __atomic_load_n(&reader.header->head, __ATOMIC_ACQUIRE) <= reader.next) {
+                    break;
+                }
+                continue;
+            }
+            if (!shm_ring_wait(&reader, -1)) {
+                break;
+            }
+            continue;
+        }
+        bool ok = decode_telemetry(frame, len, &packet);
+        int64_t done = now_ns();
+        if (shm_ring_consume(&reader)) {
+            result->frames++;
+            result->invalid += !ok;
+            result->handoff_ns.record(done - __atomic_load_n(&stamps[seq & (STAMP_SLOTS - 1)], __ATOMIC_RELAXED));
+        }
+    }
+    result->lost = reader.lost;
+    shm_ring_reader_close(&reader);
+}
+
+void tcp_reader(uint16_t port, const int64_t *stamps, reader_result *result, int ready_fd)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror("[shm] reader: connect");
+        _exit(1);
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    char one = 1;
+    (void)!write(ready_fd, &one, 1);
+
+    std::vector<uint8_t> frame(telemetry_max_packet_size(255));
+    telemetry_packet_t packet;
+    for (uint64_t seq = 0;; seq++) {
+        uint32_t len;
+        if (!read_full(fd, &len, sizeof(len)) || len > frame.size() || !read_full(fd, frame.data(), len)) {
+            break;
+        }
+        bool ok = decode_telemetry(frame.data(), len, &packet);
+        int64_t done = now_ns();
+        result->frames++;
+        result->invalid += !ok;
+        result->handoff_ns.record(done - __atomic_load_n(&stamps[seq & (STAMP_SLOTS - 1)], __ATOMIC_RELAXED));
+    }
+    close(fd);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    bench_options opt;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        bool ok = value != nullptr;
+        if (!strcmp(arg, "--spin")) {
+            opt.spin = true;
+            continue;
+        }
+        if (!strcmp(arg, "--transport") && value) ok = !strcmp(value, "shm") || (opt.tcp = !strcmp(value, "tcp"));
+        else if (!strcmp(arg, "--readers") && value) ok = (opt.readers = atoi(value)) >= 1 && opt.readers <= 64;
+        else if (!strcmp(arg, "--rate") && value) ok = (opt.rate_hz = atof(value)) >= 0;
+        else if (!strcmp(arg, "--seconds") && value) ok = (opt.seconds = atof(value)) > 0;
+        else if (!strcmp(arg, "--nodes") && value) ok = (opt.nodes = atoi(value)) >= 1 && opt.nodes <= 255;
+        else if (!strcmp(arg, "--slots") && value) ok = (opt.slots = (uint32_t)atoi(value)) >= 2;
+        else ok = false;
+        if (!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    auto *stamps = static_cast<int64_t *>(shared_alloc(STAMP_SLOTS * sizeof(int64_t)));
+    auto *results = static_cast<reader_result *>(shared_alloc(opt.readers * sizeof(reader_result)));
+    if (!stamps || !results) {
+        perror("[shm] mmap");
+        return 1;
+    }
+    for (int r = 0; r < opt.readers; r++) {
+        new (&results[r]) reader_result();
+    }
+
+    std::string name = "/griddy_shm_bench." + std::to_string(getpid());
+    size_t slot_size = telemetry_max_packet_size((uint8_t)opt.nodes);
+    shm_ring_t ring{};
+    int listen_fd = -1;
+    uint16_t port = 0;
+    if (opt.tcp) {
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t addr_len = sizeof(addr);
+        if (listen_fd < 0 || bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, 64) != 0 ||
+            getsockname(listen_fd, (sockaddr *)&addr, &addr_len) != 0) {
+            perror("[shm] listen");
+            return 1;
+        }
+        port = ntohs(addr.sin_port);
+    } else if (!shm_ring_create(&ring, name.c_str(), opt.slots, (uint32_t)slot_size)) {
+        perror("[shm] shm_ring_create");
+        return 1;
+    }
+
+    int ready[2];
+    if (pipe(ready) != 0) {
+        perror("[shm] pipe");
+        return 1;
+    }
+    std::vector<pid_t> children;
+    for (int r = 0; r < opt.readers; r++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(ready[0]);
+            if (opt.tcp) {
+                tcp_reader(port, stamps, &results[r], ready[1]);
+            } else {
+                shm_reader(name.c_str(), opt, stamps, &results[r], ready[1]);
+            }
+            _exit(0);
+        }
+        children.push_back(pid);
+    }
+    close(ready[1]);
+
+    std::vector<int> clients;
+    for (int r = 0; r < opt.readers; r++) {
+        char one;
+        if (read(ready[0], &one, 1) != 1) {
+            fprintf(stderr, "[shm] a reader failed to start\n");
+            return 1;
+        }
+        if (opt.tcp) {
+            int fd = accept(listen_fd, nullptr, nullptr);
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            clients.push_back(fd);
+        }
+    }
+
+    grid_model_t model;
+    std::vector<uint8_t> ids((size_t)opt.nodes);
+    for (int n = 0; n < opt.nodes; n++) {
+        ids[(size_t)n] = (uint8_t)(n + 1);
+    }
+    grid_model_init(&model, ids.data(), opt.nodes, 1);
+
+    // Length prefix then frame, for TCP; the ring carries frames as they are
+    std::vector<uint8_t> buffer(sizeof(uint32_t) + slot_size);
+    griddy::histogram publish_ns;   // Writer cost per frame, excluding encode
+    uint64_t published = 0;
+    size_t frame_bytes = 0;
+    int64_t period_ns = opt.rate_hz > 0 ? (int64_t)(1e9 / opt.rate_hz) : 0;
+    int64_t start = now_ns();
+    int64_t end = start + (int64_t)(opt.seconds * 1e9);
+    int64_t next = start;
+
+    for (int64_t now = start; now < end; now = now_ns()) {
+        if (period_ns > 0) {
+            if (now < next) {
+                sleep_until_ns(next);
+            }
+            next += period_ns;
+        }
+        grid_model_update(&model, now / 1000);
+        int64_t *stamp = &stamps[published & (STAMP_SLOTS - 1)];
+        int64_t t0;
+        if (opt.tcp) {
+            uint32_t len = (uint32_t)grid_model_encode(&model, buffer.data() + sizeof(uint32_t));
+            memcpy(buffer.data(), &len, sizeof(len));
+            frame_bytes = len;
+            t0 = now_ns();
+            __atomic_store_n(stamp, t0, __ATOMIC_RELAXED);
+            for (int fd : clients) {
+                write_full(fd, buffer.data(), sizeof(uint32_t) + len);
+            }
+        } else {
+            uint8_t *slot = shm_ring_begin(&ring);
+            frame_bytes = grid_model_encode(&model, slot);
+            t0 = now_ns();
+            __atomic_store_n(stamp, t0, __ATOMIC_RELAXED);
+            shm_ring_commit(&ring, frame_bytes);
+        }
+        publish_ns.record(now_ns() - t0);
+        published++;
+    }
+    double elapsed = (double)(now_ns() - start) / 1e9;
+
+    if (opt.tcp) {
+        for (int fd : clients) {
+            close(fd);
+        }
+        close(listen_fd);
+    } else {
+        shm_ring_destroy(&ring);
+    }
+    for (pid_t pid : children) {
+        waitpid(pid, nullptr, 0);
+    }
+
+    griddy::histogram handoff;
+    uint64_t received = 0;
+    uint64_t lost = 0;
+    uint64_t invalid = 0;
+    for (int r = 0; r < opt.readers; r++) {
+        handoff.merge(results[r].handoff_ns);
+        received += results[r].frames;
+        lost += results[r].lost;
+        invalid += results[r].invalid;
+    }
+    printf("{\"transport\":\"%s\",\"readers\":%d,\"spin\":%s,\"rate_hz\":%.0f,\"nodes\":%d,\"frame_bytes\":%zu,"
+           "\"published\":%llu,\"publish_per_s\":%.0f,\"received\":%llu,\"lost\":%llu,\"invalid\":%llu,"
+           "\"publish_ns\":%s,\"handoff_ns\":%s}\n",
+           opt.tcp ? "tcp" : "shm", opt.readers, opt.spin ? "true" : "false", opt.rate_hz, opt.nodes, frame_bytes,
+           (unsigned long long)published, (double)published / elapsed, (unsigned long long)received,
+           (unsigned long long)lost, (unsigned long long)invalid, publish_ns.to_json().c_str(),
+           handoff.to_json().c_str());
+    return 0;
+}
@@ -0,0 +1,199 @@
+"""
+Shared-Memory Telemetry Ring Reader
+===================================
+Python binding for hardware/main/shm_ring.c, the ring a Linux-target
+controller (CONFIG_POWER_GRID_SHM_RING) or griddy_fleet_sim --shm publishes
+its telemetry frames to. Consumers on the same host read the frames /out
+would send, byte for byte, without a WebSocket.
+
+The binding loads the C library through ctypes, so readers share the
+firmware's seqlock and futex code instead of reimplementing it:
+
+    cmake -S host -B host/build && cmake --build host/build -j
+
+builds host/build/shm/libgriddy_shm.so, which is found automatically;
+GRIDDY_SHM_LIB overrides the path.
+
+Blocking calls release the GIL. From asyncio, run read() in an executor.
+
+Usage:
+    with ShmRingReader("/griddy") as ring:
+        for frame in ring:
+            packet = BinaryProtocol.decode_telemetry(frame)
+"""
+
+import ctypes
+import ctypes.util
+import os
+from pathlib import Path
+from typing import Iterator, Optional
+
+
+class _Reader(ctypes.Structure):
+    # Mirrors shm_ring_reader_t
+    _fields_ = [
+        ("header", ctypes.c_void_p),
+        ("map_size", ctypes.c_size_t),
+        ("fd", ctypes.c_int),
+        ("next", ctypes.c_uint64),
+        ("lost", ctypes.c_uint64),
+        ("peeked", ctypes.c_uint64),
+    ]
+
+
+# shm_ring_header_t fields the binding reads directly
+_HEADER_SLOT_SIZE_OFFSET = 12
+_HEADER_CLOSED_OFFSET = 24
+
+
+def _load_library() -> ctypes.CDLL:
+    candidates = []
+    if os.environ.get("GRIDDY_SHM_LIB"):
+        candidates.append(os.environ["GRIDDY_SHM_LIB"])
+    candidates.append(str(Path(__file__).parent / "host" / "build" / "shm" / "libgriddy_shm.so"))
+    found = ctypes.util.find_library("griddy_shm")
+    if found:
+        candidates.append(found)
+
+    for path in candidates:
+        try:
+            lib = ctypes.CDLL(path)
+            break
+        except OSError:
+            continue
+    else:
+        raise OSError(f"libgriddy_shm not found (tried {', '.join(candidates)}); "
+                      "build host/ or set GRIDDY_SHM_LIB")
+
+    reader_p = ctypes.POINTER(_Reader)
+    lib.shm_ring_reader_open.argtypes = [reader_p, ctypes.c_char_p]
+    lib.shm_ring_reader_open.restype = ctypes.c_bool
+    lib.shm_ring_reader_close.argtypes = [reader_p]
+    lib.shm_ring_reader_close.restype = None
+    lib.shm_ring_peek.argtypes = [reader_p, ctypes.POINTER(ctypes.c_size_t), ctypes.POINTER(ctypes.c_uint64)]
+    lib.shm_ring_peek.restype = ctypes.c_void_p
+    lib.shm_ring_consume.argtypes = [reader_p]
+    lib.shm_ring_consume.restype = ctypes.c_bool
+    lib.shm_ring_wait.argtypes = [reader_p, ctypes.c_int]
+    lib.shm_ring_wait.restype = ctypes.c_bool
+    lib.shm_ring_read.argtypes = [reader_p, ctypes.c_void_p, ctypes.c_size_t, ctypes.c_int]
+    lib.shm_ring_read.restype = ctypes.c_int
+    return lib
+
+
+_lib: Optional[ctypes.CDLL] = None
+
+
+class ShmRingReader:
+    """One reader of a telemetry ring, starting at the next frame published."""
+
+    def __init__(self, name: str):
+        global _lib
+        if _lib is None:
+            _lib = _load_library()
+        self._reader = _Reader()
+        if not _lib.shm_ring_reader_open(ctypes.byref(self._reader), name.encode()):
+            raise FileNotFoundError(f"no telemetry ring {name}")
+        self.name = name
+        slot_size = ctypes.c_uint32.from_address(self._reader.header + _HEADER_SLOT_SIZE_OFFSET).value
+        self._buffer = ctypes.create_string_buffer(slot_size)
+
+    def close(self) -> None:
+        if self._reader.header:
+            _lib.shm_ring_reader_close(ctypes.byref(self._reader))
+
+    def __enter__(self) -> "ShmRingReader":
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+    @property
+    def lost(self) -> int:
+        """Frames the writer overwrote before this reader got to them."""
+        return self._reader.lost
+
+    @property
+    def next_seq(self) -> int:
+        """Sequence number of the next frame to be read."""
+        return self._reader.next
+
+    @property
+    def closed(self) -> bool:
+        """The writer has gone; frames already published can still be read."""
+        return bool(ctypes.c_uint32.from_address(self._reader.header + _HEADER_CLOSED_OFFSET).value)
+
+    def read(self, timeout: Optional[float] = None) -> Optional[bytes]:
+        """
+        Next frame, waiting up to timeout seconds (None waits indefinitely).
+
+        Returns None on timeout; raises EOFError once the writer has closed
+        the ring and every frame has been read.
+        """
+        timeout_ms = -1 if timeout is None else max(0, int(timeout * 1000))
+        n = _lib.shm_ring_read(ctypes.byref(self._reader), self._buffer, len(self._buffer), timeout_ms)
+        if n < 0:
+            raise EOFError(f"telemetry ring {self.name} closed")
+        if n == 0:
+            return None
+        return self._buffer.raw[:n]
+
+    def peek(self) -> Optional[memoryview]:
+        """
+        Next frame in place in the ring, without copying, or None.
+
+        The writer may overwrite it at any time: call consume() after using
+        the view and discard what was read from it if that returns False.
+        """
+        length = ctypes.c_size_t()
+        ptr = _lib.shm_ring_peek(ctypes.byref(self._reader), ctypes.byref(length), None)
+        if not ptr:
+            return None
+        return memoryview((ctypes.c_uint8 * length.value).from_address(ptr)).cast("B")
+
+    def consume(self) -> bool:
+        """Step past the peeked frame; False if it was overwritten meanwhile."""
+        return bool(_lib.shm_ring_consume(ctypes.byref(self._reader)))
+
+    def wait(self, timeout: Optional[float] = None) -> bool:
+        """Sleep until a frame is ready; False on timeout or a closed ring."""
+        timeout_ms = -1 if timeout is None else max(0, int(timeout * 1000))
+        return bool(_lib.shm_ring_wait(ctypes.byref(self._reader), timeout_ms))
+
+    def __iter__(self) -> Iterator[bytes]:
+        """Frames until the writer closes the ring."""
+        while True:
+            try:
+                frame = self.read()
+            except EOFError:
+                return
+            if frame is not None:
+                yield frame
+
+
+if __name__ == "__main__":
+    import argparse
+    import time
+
+    from binary_protocol import BinaryProtocol
+
+    parser = argparse.ArgumentParser(description="Print telemetry from a shared-memory ring")
+    parser.add_argument("name", help="ring name, e.g. /griddy or /fleet0")
+    parser.add_argument("--count", type=int, default=0, help="stop after N frames (0 = until closed)")
+    args = parser.parse_args()
+
+    with ShmRingReader(args.name) as ring:
+        frames = 0
+        start = time.monotonic()
+        for frame in ring:
+            packet = BinaryProtocol.decode_telemetry(frame)
+            frames += 1
+            if packet is not None:
+                print(f"seq {ring.next_seq - 1}: t={packet.timestamp_us} us, {len(packet.nodes)} nodes")
+            if args.count and frames >= args.count:
+                break
+        elapsed = time.monotonic() - start
+        print(f"{frames} frames in {elapsed:.2f} s, {ring.lost} lost")